@@ -0,0 +1,188 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    benchmain.cpp
+ * @brief   Benchmark Entry Point
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstdio>
+# include <fstream>
+# include <iostream>
+# include <string>
+
+# include "benchmark.h"
+
+using namespace std;
+
+
+/* ------------------------------- Functions -------------------------------- */
+
+
+/**
+ * @brief   Prints how to run the benchmark
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void printUsage()
+{
+    cerr << "usage: bench [options] MODEL..." << endl;
+    cerr << endl;
+    cerr << "  --list PATH        read model paths from PATH, one per line, - for stdin" << endl;
+    cerr << "  --out PATH         write results to PATH, - for stdout" << endl;
+    cerr << "                     (default benchmark.csv or benchmark.json)" << endl;
+    cerr << "  --format csv|json  result format (default csv)" << endl;
+    cerr << "  --size WxH         image size in pixels (default 800x800)" << endl;
+    cerr << "  --style STYLE      edge style: flat, hidden, cued or hidden-cued (default flat)" << endl;
+    cerr << "  --frames N         frames timed per model, at most "
+         << FrameProfiler::HISTORY_FRAMES << " (default 240)" << endl;
+    cerr << "  --warmup N         frames drawn before timing starts (default 10)" << endl;
+}
+
+
+/**
+ * @brief   Reads model paths from a list file, one per line
+ *
+ * @param   &listPath   The path of the list file, - for standard input
+ * @param   &paths      The paths to append to
+ *
+ * @return  void
+ */
+static void readModelList( const string &listPath, vector<string> &paths )
+{
+    ifstream file;
+    istream *in = &cin;
+
+    if ( listPath != "-" )
+    {
+        file.open( listPath.c_str() );
+
+        if ( !file.is_open() ) throw BenchmarkException( "Failed to open model list: " + listPath );
+
+        in = &file;
+    }
+
+    string line;
+
+    while ( getline( *in, line ) )
+    {
+        if ( !line.empty() ) paths.push_back( line );
+    }
+}
+
+
+/**
+ * @brief   Parses the command line of the benchmark
+ *
+ * @param   argc    The number of arguments
+ * @param   **argv  The arguments
+ *
+ * @return  The options of the benchmark
+ */
+static BenchmarkOptions parseOptions( int argc, char **argv )
+{
+    BenchmarkOptions options;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        string arg = argv[i];
+
+        // every option takes a value
+        if ( ( arg.compare( 0, 2, "--" ) == 0 ) && ( i + 1 >= argc ) )
+        {
+            throw BenchmarkException( "Missing value for " + arg );
+        }
+
+        if ( arg == "--list" )
+        {
+            readModelList( argv[++i], options.modelPaths );
+        }
+        else if ( arg == "--out" )
+        {
+            options.outputPath = argv[++i];
+        }
+        else if ( arg == "--format" )
+        {
+            string format = argv[++i];
+
+            if ( format == "csv" ) options.json = false;
+            else if ( format == "json" ) options.json = true;
+            else throw BenchmarkException( "Unsupported result format: " + format );
+        }
+        else if ( arg == "--size" )
+        {
+            if ( sscanf( argv[++i], "%ux%u", &options.width, &options.height ) != 2 )
+            {
+                throw BenchmarkException( string( "Bad image size: " ) + argv[i] );
+            }
+        }
+        else if ( arg == "--style" )
+        {
+            string style = argv[++i];
+
+            if ( ( style != "flat" ) && ( style != "hidden" ) && ( style != "cued" ) && ( style != "hidden-cued" ) )
+            {
+                throw BenchmarkException( "Unsupported edge style: " + style );
+            }
+
+            options.hiddenLines = ( style == "hidden" ) || ( style == "hidden-cued" );
+            options.depthCueing = ( style == "cued" ) || ( style == "hidden-cued" );
+        }
+        else if ( arg == "--frames" )
+        {
+            if ( sscanf( argv[++i], "%u", &options.frames ) != 1 )
+            {
+                throw BenchmarkException( string( "Bad frame count: " ) + argv[i] );
+            }
+        }
+        else if ( arg == "--warmup" )
+        {
+            if ( sscanf( argv[++i], "%u", &options.warmupFrames ) != 1 )
+            {
+                throw BenchmarkException( string( "Bad frame count: " ) + argv[i] );
+            }
+        }
+        else if ( arg.compare( 0, 2, "--" ) == 0 )
+        {
+            throw BenchmarkException( "Unknown option: " + arg );
+        }
+        else
+        {
+            options.modelPaths.push_back( arg );
+        }
+    }
+
+    if ( options.modelPaths.empty() ) throw BenchmarkException( "No models to measure." );
+
+    return options;
+}
+
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        Benchmark benchmark( parseOptions( argc, argv ) );
+
+        unsigned int failures = benchmark.run();
+
+        if ( failures > 0 ) cerr << failures << " FAILED" << endl;
+
+        return ( failures > 0 ) ? 1 : 0;
+    }
+    catch ( const BenchmarkException &e )
+    {
+        cerr << e.what() << endl << endl;
+        printUsage();
+        return 2;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,293 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    batchrenderer.cpp
+ * @brief   Renders many models from fixed camera angles to image files
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cmath>
+# include <cstdio>
+# include <functional>
+# include <iostream>
+# include <thread>
+
+# include "batchrenderer.h"
+# include "frameprofiler.h"
+# include "imagewriter.h"
+# include "meshcache.h"
+# include "offscreencontext.h"
+# include "rendersession.h"
+# include "stlreader.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a batch renderer
+ *
+ * @param   &options    The models, views and image settings to render with;
+ *                      without views, every model is rendered once from
+ *                      the default view
+ *
+ * @return  The created batch renderer
+ */
+BatchRenderer::BatchRenderer( const BatchOptions &options ) :
+    options( options ), failures( 0 )
+{
+    if ( ( options.width == 0 ) || ( options.height == 0 ) )
+    {
+        throw BatchRendererException( "Image size must not be zero." );
+    }
+
+    if ( this->options.views.empty() ) this->options.views.push_back( BatchView() );
+}
+
+
+/**
+ * @brief   Batch renderer destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+BatchRenderer::~BatchRenderer() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Renders every model from every view and writes the images
+ *
+ * A model that cannot be read or an image that cannot be written is
+ * reported and counted, the rest of the batch carries on.
+ *
+ * @param   void
+ *
+ * @return  The number of models and images that failed
+ */
+unsigned int BatchRenderer::run()
+{
+    BlockingQueue<LoadedModel> loaded( LOAD_QUEUE_DEPTH );
+    BlockingQueue<RenderedImage> rendered( WRITE_QUEUE_DEPTH );
+
+    failures = 0;
+
+    std::thread loader( &BatchRenderer::loadModels, this, std::ref( loaded ) );
+    std::thread writer( &BatchRenderer::writeImages, this, std::ref( rendered ) );
+
+    try
+    {
+        renderModels( loaded, rendered );
+    }
+    catch ( ... )
+    {
+        // let both threads run out before the queues go away
+        loaded.close();
+        rendered.close();
+        loader.join();
+        writer.join();
+        throw;
+    }
+
+    loaded.close();
+    rendered.close();
+    loader.join();
+    writer.join();
+
+    // with RENDER_PROFILE set, every frame of the batch was timed
+    FrameProfiler &profiler = FrameProfiler::getInstance();
+    if ( profiler.isEnabled() ) profiler.report( std::cout );
+
+    return failures;
+}
+
+
+/**
+ * @brief   Gets the path of the image of a model from one of the views
+ *
+ * @param   &modelPath  The path of the model file
+ * @param   view        The index of the view
+ *
+ * @return  The output directory, the model's file name without its
+ *          extension, the view index if there is more than one view, and
+ *          the image extension
+ */
+std::string BatchRenderer::getImagePath( const std::string &modelPath, unsigned int view ) const
+{
+    size_t nameStart = modelPath.find_last_of( '/' );
+    nameStart = ( nameStart == std::string::npos ) ? 0 : nameStart + 1;
+
+    size_t nameEnd = modelPath.find_last_of( '.' );
+    if ( ( nameEnd == std::string::npos ) || ( nameEnd < nameStart ) ) nameEnd = modelPath.size();
+
+    std::string path = options.outputDirectory + "/" + modelPath.substr( nameStart, nameEnd - nameStart );
+
+    if ( options.views.size() > 1 )
+    {
+        char suffix[16];
+        snprintf( suffix, sizeof( suffix ), "_%03u", view );
+        path += suffix;
+    }
+
+    return path + options.imageExtension;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Reads every model into host memory, running ahead of the
+ *          renderer by at most the depth of the load queue
+ *
+ * @param   &loaded     The queue to hand loaded models to, closed once the
+ *                      last one is handed over
+ *
+ * @return  void
+ */
+void BatchRenderer::loadModels( BlockingQueue<LoadedModel> &loaded )
+{
+    for ( const std::string &path : options.modelPaths )
+    {
+        LoadedModel model;
+        model.path = path;
+
+        try
+        {
+            std::unique_ptr<Mesh> mesh( new Mesh() );
+
+            // reuse the preprocessed mesh if there is one
+            if ( !MeshCache::load( path, *mesh ) )
+            {
+                STLReader reader( path );
+                *mesh = std::move( reader.readFacets().getMesh() );
+            }
+
+            model.mesh = std::move( mesh );
+        }
+        catch ( const std::exception &e )
+        {
+            model.error = e.what();
+        }
+
+        if ( !loaded.push( std::move( model ) ) ) break;
+    }
+
+    loaded.close();
+}
+
+
+/**
+ * @brief   Renders every loaded model from every view on the calling thread,
+ *          which owns the device
+ *
+ * @param   &loaded     The queue to take loaded models from
+ * @param   &rendered   The queue to hand rendered images to
+ *
+ * @return  void
+ */
+void BatchRenderer::renderModels( BlockingQueue<LoadedModel> &loaded, BlockingQueue<RenderedImage> &rendered )
+{
+    OffscreenContext gc( options.width, options.height, options.background );
+    ViewContext vc( &gc );
+    RenderSession session;
+
+    size_t pixelCount = ( size_t ) options.width * options.height;
+
+    LoadedModel model;
+
+    while ( loaded.pop( model ) )
+    {
+        if ( !model.mesh )
+        {
+            std::cerr << model.path << ": " << model.error << std::endl;
+            failures++;
+            continue;
+        }
+
+        session.unload();
+
+        ShapeContainer &sc = session.getShapes();
+        sc.getMesh() = *model.mesh;
+        model.mesh.reset();
+
+        session.upload();
+
+        for ( unsigned int view = 0; view < options.views.size(); view++ )
+        {
+            frameModel( vc, sc.getMesh(), options.views[view] );
+
+            // the frame lands in the context's framebuffer
+            session.render( &gc, &vc, options.color );
+
+            RenderedImage image;
+            image.path = getImagePath( model.path, view );
+            image.pixels.assign( gc.getPixels(), gc.getPixels() + pixelCount );
+
+            if ( !rendered.push( std::move( image ) ) ) return;
+        }
+
+        std::cout << "RENDERED: " << model.path << std::endl;
+    }
+
+    session.unload();
+}
+
+
+/**
+ * @brief   Encodes and writes every rendered image
+ *
+ * @param   &rendered   The queue to take rendered images from
+ *
+ * @return  void
+ */
+void BatchRenderer::writeImages( BlockingQueue<RenderedImage> &rendered )
+{
+    RenderedImage image;
+
+    while ( rendered.pop( image ) )
+    {
+        try
+        {
+            ImageWriter::write( image.path, image.pixels.data(), options.width, options.height );
+        }
+        catch ( const std::exception &e )
+        {
+            std::cerr << e.what() << std::endl;
+            failures++;
+        }
+    }
+}
+
+
+/**
+ * @brief   Points a view at a model from a camera angle, centered and scaled
+ *          so the model fits the image from any angle
+ *
+ * @param   &vc     The view context to set
+ * @param   &mesh   The model to frame
+ * @param   &view   The camera angle
+ *
+ * @return  void
+ */
+void BatchRenderer::frameModel( ViewContext &vc, const Mesh &mesh, const BatchView &view ) const
+{
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+    mesh.getBounds( boundsMin, boundsMax );
+
+    vc.resetView();
+    vc.frameBounds( boundsMin, boundsMax, FRAME_FILL );
+    vc.setRotation( view.azimuth, view.elevation );
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,176 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    batchrenderer.h
+ * @brief   Renders many models from fixed camera angles to image files
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_BATCHRENDERER_H
+# define GRAPHICS_BATCHRENDERER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <atomic>
+# include <memory>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include "blockingqueue.h"
+# include "gcontext.h"
+# include "mesh.h"
+# include "viewcontext.h"
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * A camera angle, as the view rotation in radians
+ */
+struct BatchView
+{
+    float azimuth = 0;
+    float elevation = 0;
+};
+
+
+/**
+ * What to render and where to put it
+ */
+struct BatchOptions
+{
+    std::vector<std::string> modelPaths = std::vector<std::string>();
+    std::vector<BatchView> views = std::vector<BatchView>();
+
+    std::string outputDirectory = ".";
+    std::string imageExtension = ".png";
+
+    unsigned int width = 800;
+    unsigned int height = 800;
+
+    unsigned int color = GraphicsContext::BLACK;
+    unsigned int background = GraphicsContext::WHITE;
+};
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class BatchRendererException : public std::runtime_error
+{
+public:
+    explicit BatchRendererException( const std::string& msg ):
+    std::runtime_error( ( std::string( "BatchRenderer Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/**
+ * A batch renderer draws every model from every view into an offscreen
+ * context and writes one image per view. It runs three stages at once: a
+ * loader thread reads the next models from disk, the calling thread owns
+ * the device and renders, and a writer thread encodes and stores finished
+ * images. The stages are joined by bounded queues, so the device only
+ * waits on disk when reading a model takes longer than rendering one, and
+ * memory stays bounded no matter how many models there are.
+ */
+class BatchRenderer
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // models read ahead of the one being rendered
+    static constexpr unsigned int LOAD_QUEUE_DEPTH = 2;
+
+    // rendered images waiting to be written
+    static constexpr unsigned int WRITE_QUEUE_DEPTH = 16;
+
+    // share of the smaller image side the model's bounding sphere fills
+    static constexpr float FRAME_FILL = 0.9f;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit BatchRenderer( const BatchOptions &options );
+    BatchRenderer( const BatchRenderer &renderer ) = delete;
+
+    ~BatchRenderer();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    BatchRenderer &operator=( const BatchRenderer &renderer ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    unsigned int run();
+
+    std::string getImagePath( const std::string &modelPath, unsigned int view ) const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ------------------------------- Types -------------------------------- */
+
+
+    struct LoadedModel
+    {
+        std::string path = std::string();
+        std::unique_ptr<Mesh> mesh = nullptr;
+        std::string error = std::string();
+    };
+
+    struct RenderedImage
+    {
+        std::string path = std::string();
+        std::vector<unsigned int> pixels = std::vector<unsigned int>();
+    };
+
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    BatchOptions options;
+
+    std::atomic<unsigned int> failures;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void loadModels( BlockingQueue<LoadedModel> &loaded );
+    void renderModels( BlockingQueue<LoadedModel> &loaded, BlockingQueue<RenderedImage> &rendered );
+    void writeImages( BlockingQueue<RenderedImage> &rendered );
+
+    void frameModel( ViewContext &vc, const Mesh &mesh, const BatchView &view ) const;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_BATCHRENDERER_H
+
+
+/* -------------------------------------------------------------------------- */
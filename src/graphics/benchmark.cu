@@ -0,0 +1,551 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    benchmark.cpp
+ * @brief   Headless timing of models over a scripted camera path
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <chrono>
+# include <cmath>
+# include <cstdio>
+# include <fstream>
+# include <iomanip>
+# include <utility>
+
+# include "benchmark.h"
+# include "cudaerr.cuh"
+# include "offscreencontext.h"
+# include "rendersession.h"
+# include "stlreader.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+// the stages of a frame, in the order they are written
+const FrameProfiler::Stage FRAME_STAGES[] = {
+    FrameProfiler::STAGE_TRANSFORM,
+    FrameProfiler::STAGE_CULL,
+    FrameProfiler::STAGE_DEPTH,
+    FrameProfiler::STAGE_RASTER,
+    FrameProfiler::STAGE_READBACK,
+    FrameProfiler::STAGE_PRESENT,
+    FrameProfiler::STAGE_FRAME
+};
+
+
+/* ---------------------------- Helper Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the time between two host clock readings
+ *
+ * @param   start   The earlier reading
+ * @param   end     The later reading
+ *
+ * @return  The time between the readings in milliseconds
+ */
+static double elapsedMilliseconds(
+    std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end
+)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count() / 1000000.0;
+}
+
+
+/**
+ * @brief   Quotes a string for JSON
+ *
+ * @param   &value  The string to quote
+ *
+ * @return  The string in double quotes, with quotes, backslashes and control
+ *          characters escaped
+ */
+static std::string quoteJSON( const std::string &value )
+{
+    std::string quoted = "\"";
+
+    for ( char c : value )
+    {
+        if ( ( c == '"' ) || ( c == '\\' ) )
+        {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if ( ( unsigned char ) c < 0x20 )
+        {
+            char escaped[8];
+            snprintf( escaped, sizeof( escaped ), "\\u%04x", ( unsigned int ) c );
+            quoted += escaped;
+        }
+        else
+        {
+            quoted += c;
+        }
+    }
+
+    return quoted + "\"";
+}
+
+
+/**
+ * @brief   Quotes a string for CSV
+ *
+ * @param   &value  The string to quote
+ *
+ * @return  The string as it is, or in double quotes with its quotes doubled
+ *          if it has a comma, a quote or a line break
+ */
+static std::string quoteCSV( const std::string &value )
+{
+    if ( value.find_first_of( ",\"\r\n" ) == std::string::npos ) return value;
+
+    std::string quoted = "\"";
+
+    for ( char c : value )
+    {
+        if ( c == '"' ) quoted += '"';
+        quoted += c;
+    }
+
+    return quoted + "\"";
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a benchmark
+ *
+ * @param   &options    The models to measure, the image size, the number of
+ *                      frames and where to write the results
+ *
+ * @return  The created benchmark
+ */
+Benchmark::Benchmark( const BenchmarkOptions &options ) :
+    options( options )
+{
+    if ( ( options.width == 0 ) || ( options.height == 0 ) )
+    {
+        throw BenchmarkException( "Image size must not be zero." );
+    }
+
+    // percentiles only see the profiler's history
+    if ( ( options.frames == 0 ) || ( options.frames > FrameProfiler::HISTORY_FRAMES ) )
+    {
+        throw BenchmarkException(
+            "Frame count must be between 1 and " + std::to_string( FrameProfiler::HISTORY_FRAMES ) + "."
+        );
+    }
+}
+
+
+/**
+ * @brief   Benchmark destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+Benchmark::~Benchmark() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Measures every model, one at a time, and writes the results
+ *
+ * A model that fails to load is reported and left out of the results.
+ *
+ * @param   void
+ *
+ * @return  The number of models that failed
+ */
+unsigned int Benchmark::run()
+{
+    FrameProfiler &profiler = FrameProfiler::getInstance();
+
+    bool wasEnabled = profiler.isEnabled();
+    profiler.setEnabled( true );
+
+    unsigned int failures = 0;
+
+    results.clear();
+
+    for ( const std::string &path : options.modelPaths )
+    {
+        try
+        {
+            results.push_back( measure( path ) );
+            std::cerr << "MEASURED: " << path << std::endl;
+        }
+        catch ( const std::exception &e )
+        {
+            std::cerr << path << ": " << e.what() << std::endl;
+            failures++;
+        }
+    }
+
+    profiler.setEnabled( wasEnabled );
+
+    writeResults();
+
+    return failures;
+}
+
+
+/**
+ * @brief   Gets the results of the last run
+ *
+ * @param   void
+ *
+ * @return  One result for every model that was measured, in order
+ */
+const std::vector<BenchmarkResult> &Benchmark::getResults() const
+{
+    return results;
+}
+
+
+/**
+ * @brief   Writes the results as CSV, one row per model
+ *
+ * @param   &os     The stream to write to
+ *
+ * @return  void
+ */
+void Benchmark::writeCSV( std::ostream &os ) const
+{
+    os << "model,renderer,vertices,facets,load_ms,upload_ms";
+
+    for ( FrameProfiler::Stage stage : FRAME_STAGES )
+    {
+        const char *name = FrameProfiler::getStageName( stage );
+        os << "," << name << "_p50_ms," << name << "_p95_ms," << name << "_p99_ms";
+    }
+
+    os << ",fps,peak_host_bytes,peak_device_bytes" << std::endl;
+
+    for ( const BenchmarkResult &result : results )
+    {
+        os << quoteCSV( result.path ) << "," << result.renderer << ","
+           << result.vertexCount << "," << result.facetCount << ","
+           << result.loadMilliseconds << "," << result.uploadMilliseconds;
+
+        for ( FrameProfiler::Stage stage : FRAME_STAGES )
+        {
+            const BenchmarkStage &times = result.stages[stage];
+            os << "," << times.p50 << "," << times.p95 << "," << times.p99;
+        }
+
+        os << "," << result.framesPerSecond << ","
+           << result.peakHostBytes << "," << result.peakDeviceBytes << std::endl;
+    }
+}
+
+
+/**
+ * @brief   Writes the settings and the results as one JSON object
+ *
+ * @param   &os     The stream to write to
+ *
+ * @return  void
+ */
+void Benchmark::writeJSON( std::ostream &os ) const
+{
+    os << "{" << std::endl;
+    os << "  \"width\": " << options.width << "," << std::endl;
+    os << "  \"height\": " << options.height << "," << std::endl;
+    os << "  \"warmupFrames\": " << options.warmupFrames << "," << std::endl;
+    os << "  \"frames\": " << options.frames << "," << std::endl;
+    os << "  \"results\": [";
+
+    for ( size_t i = 0; i < results.size(); i++ )
+    {
+        const BenchmarkResult &result = results[i];
+
+        os << ( ( i == 0 ) ? "" : "," ) << std::endl;
+        os << "    {" << std::endl;
+        os << "      \"model\": " << quoteJSON( result.path ) << "," << std::endl;
+        os << "      \"renderer\": " << quoteJSON( result.renderer ) << "," << std::endl;
+        os << "      \"vertices\": " << result.vertexCount << "," << std::endl;
+        os << "      \"facets\": " << result.facetCount << "," << std::endl;
+        os << "      \"loadMs\": " << result.loadMilliseconds << "," << std::endl;
+        os << "      \"uploadMs\": " << result.uploadMilliseconds << "," << std::endl;
+        os << "      \"stagesMs\": {" << std::endl;
+
+        for ( size_t j = 0; j < sizeof( FRAME_STAGES ) / sizeof( FRAME_STAGES[0] ); j++ )
+        {
+            const BenchmarkStage &times = result.stages[FRAME_STAGES[j]];
+
+            os << "        " << quoteJSON( FrameProfiler::getStageName( FRAME_STAGES[j] ) ) << ": { "
+               << "\"p50\": " << times.p50 << ", "
+               << "\"p95\": " << times.p95 << ", "
+               << "\"p99\": " << times.p99 << " }"
+               << ( ( j + 1 < sizeof( FRAME_STAGES ) / sizeof( FRAME_STAGES[0] ) ) ? "," : "" ) << std::endl;
+        }
+
+        os << "      }," << std::endl;
+        os << "      \"fps\": " << result.framesPerSecond << "," << std::endl;
+        os << "      \"peakHostBytes\": " << result.peakHostBytes << "," << std::endl;
+        os << "      \"peakDeviceBytes\": " << result.peakDeviceBytes << std::endl;
+        os << "    }";
+    }
+
+    os << std::endl << "  ]" << std::endl;
+    os << "}" << std::endl;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Loads, uploads and draws one model along the camera path
+ *
+ * Every model gets a fresh render session, so the device memory it needs
+ * includes its own framebuffer and scratch buffers.
+ *
+ * @param   &path   The path of the STL file
+ *
+ * @return  What was measured
+ */
+BenchmarkResult Benchmark::measure( const std::string &path ) const
+{
+    FrameProfiler &profiler = FrameProfiler::getInstance();
+
+    BenchmarkResult result;
+    result.path = path;
+
+    resetPeakHostMemory();
+
+    RenderSession session;
+    bool onDevice = !session.isHostOnly();
+
+    session.setHiddenLines( options.hiddenLines );
+    session.setDepthCueing( options.depthCueing );
+
+    unsigned long long baseDeviceBytes = onDevice ? getDeviceMemoryUsed() : 0;
+    unsigned long long peakDeviceBytes = baseDeviceBytes;
+
+
+    /* ---------------------------- Load and Upload ------------------------- */
+
+
+    ShapeContainer &sc = session.getShapes();
+
+    auto loadStartTime = std::chrono::steady_clock::now();
+    sc.getMesh() = std::move( STLReader( path ).readFacets().getMesh() );
+    result.loadMilliseconds = elapsedMilliseconds( loadStartTime, std::chrono::steady_clock::now() );
+
+    auto uploadStartTime = std::chrono::steady_clock::now();
+    session.upload();
+    result.uploadMilliseconds = elapsedMilliseconds( uploadStartTime, std::chrono::steady_clock::now() );
+
+    if ( onDevice ) peakDeviceBytes = std::max( peakDeviceBytes, getDeviceMemoryUsed() );
+
+    const Mesh &mesh = sc.getMesh();
+    result.vertexCount = mesh.getVertexCount();
+    result.facetCount = mesh.getFacetCount();
+
+    if ( !onDevice ) result.renderer = "cpu";
+    else if ( session.isMultiDevice() ) result.renderer = "multi-gpu";
+    else if ( session.isOutOfCore() ) result.renderer = "out-of-core";
+    else result.renderer = "gpu";
+
+
+    /* ------------------------------ Draw Frames --------------------------- */
+
+
+    OffscreenContext gc( options.width, options.height, GraphicsContext::WHITE );
+    ViewContext vc( &gc );
+
+    std::vector<unsigned int> pixels( ( size_t ) options.width * options.height );
+
+    unsigned int frameCount = options.warmupFrames + options.frames;
+    auto timedStartTime = std::chrono::steady_clock::now();
+
+    for ( unsigned int frame = 0; frame < frameCount; frame++ )
+    {
+        if ( frame == options.warmupFrames )
+        {
+            profiler.reset();
+            timedStartTime = std::chrono::steady_clock::now();
+        }
+
+        placeCamera( vc, mesh, frame, options.frames );
+        vc.updateWindow();
+
+        session.draw( &vc, options.width, options.height, GraphicsContext::BLACK, GraphicsContext::WHITE );
+        session.download( pixels.data() );
+
+        auto presentStartTime = std::chrono::steady_clock::now();
+        gc.drawImage( pixels.data(), options.width, options.height );
+        profiler.addSample(
+            FrameProfiler::STAGE_PRESENT,
+            elapsedMilliseconds( presentStartTime, std::chrono::steady_clock::now() )
+        );
+
+        if ( onDevice ) peakDeviceBytes = std::max( peakDeviceBytes, getDeviceMemoryUsed() );
+    }
+
+    double timedMilliseconds = elapsedMilliseconds( timedStartTime, std::chrono::steady_clock::now() );
+
+
+    /* ----------------------------- Collect Results ------------------------ */
+
+
+    for ( FrameProfiler::Stage stage : FRAME_STAGES )
+    {
+        BenchmarkStage &times = result.stages[stage];
+
+        profiler.getPercentile( stage, 50, &times.p50 );
+        profiler.getPercentile( stage, 95, &times.p95 );
+        profiler.getPercentile( stage, 99, &times.p99 );
+    }
+
+    result.framesPerSecond = ( timedMilliseconds > 0 ) ? options.frames * 1000.0 / timedMilliseconds : 0;
+
+    result.peakHostBytes = getPeakHostMemory();
+    result.peakDeviceBytes = peakDeviceBytes - baseDeviceBytes;
+
+    session.unload();
+
+    return result;
+}
+
+
+/**
+ * @brief   Points a view at a model from the camera path
+ *
+ * The camera orbits the model once every frameCount frames, bobbing up and
+ * down once and zooming in and out twice along the way. It only depends on
+ * the frame number, so every run draws the same frames.
+ *
+ * @param   &vc         The view context to set
+ * @param   &mesh       The model to frame
+ * @param   frame       The frame number
+ * @param   frameCount  The number of frames in one orbit
+ *
+ * @return  void
+ */
+void Benchmark::placeCamera(
+    ViewContext &vc, const Mesh &mesh,
+    unsigned int frame, unsigned int frameCount
+) const
+{
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+    mesh.getBounds( boundsMin, boundsMax );
+
+    float angle = 2 * M_PI * ( frame % frameCount ) / frameCount;
+    float zoom = 1 + PATH_ZOOM * std::sin( 2 * angle );
+
+    vc.resetView();
+    vc.frameBounds( boundsMin, boundsMax, FRAME_FILL );
+    vc.setRotation( angle, PATH_ELEVATION * std::sin( angle ) );
+    vc.scale( zoom, zoom, zoom );
+}
+
+
+/**
+ * @brief   Writes the results to the output path in the chosen format
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Benchmark::writeResults() const
+{
+    std::string outputPath = options.outputPath;
+    if ( outputPath.empty() ) outputPath = options.json ? "benchmark.json" : "benchmark.csv";
+
+    std::ofstream file;
+    std::ostream *os = &std::cout;
+
+    if ( outputPath != "-" )
+    {
+        file.open( outputPath.c_str() );
+
+        if ( !file.is_open() ) throw BenchmarkException( "Failed to open output file: " + outputPath );
+
+        os = &file;
+    }
+
+    *os << std::setprecision( 6 );
+
+    if ( options.json ) writeJSON( *os );
+    else writeCSV( *os );
+
+    if ( !*os ) throw BenchmarkException( "Failed to write results to " + outputPath );
+}
+
+
+/**
+ * @brief   Resets the process's peak resident memory to what it uses now
+ *
+ * Older kernels do not support the reset, and the peak then covers the
+ * whole run so far.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Benchmark::resetPeakHostMemory()
+{
+    std::ofstream clearRefs( "/proc/self/clear_refs" );
+    if ( clearRefs.is_open() ) clearRefs << "5";
+}
+
+
+/**
+ * @brief   Gets the process's peak resident memory
+ *
+ * @param   void
+ *
+ * @return  The high-water mark of resident memory in bytes, or 0 if it
+ *          cannot be read
+ */
+unsigned long long Benchmark::getPeakHostMemory()
+{
+    std::ifstream status( "/proc/self/status" );
+    std::string line;
+
+    while ( std::getline( status, line ) )
+    {
+        unsigned long long kilobytes;
+
+        if ( sscanf( line.c_str(), "VmHWM: %llu kB", &kilobytes ) == 1 ) return kilobytes * 1024;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief   Gets the memory in use on the current device
+ *
+ * @param   void
+ *
+ * @return  The allocated device memory in bytes, by every process
+ */
+unsigned long long Benchmark::getDeviceMemoryUsed()
+{
+    size_t freeBytes = 0;
+    size_t totalBytes = 0;
+
+    HANDLE_CUDA_ERROR( cudaMemGetInfo( &freeBytes, &totalBytes ) );
+
+    return totalBytes - freeBytes;
+}
+
+
+/* -------------------------------------------------------------------------- */
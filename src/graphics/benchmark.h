@@ -0,0 +1,198 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    benchmark.h
+ * @brief   Headless timing of models over a scripted camera path
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_BENCHMARK_H
+# define GRAPHICS_BENCHMARK_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <iostream>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include "frameprofiler.h"
+# include "mesh.h"
+# include "viewcontext.h"
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * What to measure and how to write it
+ */
+struct BenchmarkOptions
+{
+    std::vector<std::string> modelPaths = std::vector<std::string>();
+
+    // - for standard output, empty for benchmark.csv or benchmark.json
+    std::string outputPath = std::string();
+    bool json = false;
+
+    unsigned int width = 800;
+    unsigned int height = 800;
+
+    // how edges are drawn, hidden behind facets and faded by depth
+    bool hiddenLines = false;
+    bool depthCueing = false;
+
+    // frames drawn before timing starts, and frames timed
+    unsigned int warmupFrames = 10;
+    unsigned int frames = 240;
+};
+
+
+/**
+ * The percentiles of one stage over the timed frames, in milliseconds
+ */
+struct BenchmarkStage
+{
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+};
+
+
+/**
+ * Everything measured for one model
+ */
+struct BenchmarkResult
+{
+    std::string path = std::string();
+    std::string renderer = std::string();
+
+    unsigned int vertexCount = 0;
+    unsigned int facetCount = 0;
+
+    double loadMilliseconds = 0;
+    double uploadMilliseconds = 0;
+
+    BenchmarkStage stages[FrameProfiler::STAGE_COUNT] = {};
+    double framesPerSecond = 0;
+
+    unsigned long long peakHostBytes = 0;
+    unsigned long long peakDeviceBytes = 0;
+};
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class BenchmarkException : public std::runtime_error
+{
+public:
+    explicit BenchmarkException( const std::string& msg ):
+    std::runtime_error( ( std::string( "Benchmark Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/**
+ * A benchmark loads every model cold from its STL file, bypassing the mesh
+ * cache, uploads it and draws it offscreen along the same camera path
+ * every run: an orbit that bobs up and down and zooms in and out, so every
+ * frame has a new view and the whole pipeline runs each time. Frame stages
+ * come from the frame profiler, which is reset after the warm-up frames.
+ * Presenting is a copy of the frame into an offscreen context, the part of
+ * a paint left once the frame is on the host.
+ *
+ * Peak host memory is the process's high-water mark, reset before every
+ * model where the kernel allows it. Peak device memory is the most device
+ * memory in use above what was in use before the model was loaded, sampled
+ * after the upload and after every frame on the current device.
+ */
+class Benchmark
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // share of the smaller image side the model's bounding sphere fills
+    static constexpr float FRAME_FILL = 0.9f;
+
+    // elevation swing and zoom swing of the camera path
+    static constexpr float PATH_ELEVATION = 0.6f;
+    static constexpr float PATH_ZOOM = 0.25f;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit Benchmark( const BenchmarkOptions &options );
+    Benchmark( const Benchmark &benchmark ) = delete;
+
+    ~Benchmark();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    Benchmark &operator=( const Benchmark &benchmark ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    unsigned int run();
+
+    const std::vector<BenchmarkResult> &getResults() const;
+
+    void writeCSV( std::ostream &os ) const;
+    void writeJSON( std::ostream &os ) const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    BenchmarkOptions options;
+
+    std::vector<BenchmarkResult> results = std::vector<BenchmarkResult>();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    BenchmarkResult measure( const std::string &path ) const;
+
+    void placeCamera(
+        ViewContext &vc, const Mesh &mesh,
+        unsigned int frame, unsigned int frameCount
+    ) const;
+
+    void writeResults() const;
+
+    static void resetPeakHostMemory();
+    static unsigned long long getPeakHostMemory();
+    static unsigned long long getDeviceMemoryUsed();
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_BENCHMARK_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,1098 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    bvh.cpp
+ * @brief   GPU linear bounding volume hierarchy over the facets of a mesh
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cfloat>
+# include <cmath>
+
+# include <thrust/device_ptr.h>
+# include <thrust/execution_policy.h>
+# include <thrust/scan.h>
+# include <thrust/sort.h>
+
+# include "bvh.h"
+# include "cudaerr.cuh"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+const unsigned int BVH_BLOCK_SIZE = 256;
+
+// device counters written by queryFrustumLevel
+const unsigned int COUNTER_FRONTIER = 0;
+const unsigned int COUNTER_RANGES = 1;
+const unsigned int COUNTER_COUNT = 2;
+
+
+/* ---------------------------- Device Functions ---------------------------- */
+
+
+/**
+ * @brief   Spreads the low 10 bits of a value out to every third bit
+ *
+ * @param   v   The value to spread
+ *
+ * @return  The spread value
+ */
+__device__ unsigned int expandBits( unsigned int v )
+{
+    v = ( v * 0x00010001u ) & 0xFF0000FFu;
+    v = ( v * 0x00000101u ) & 0x0F00F00Fu;
+    v = ( v * 0x00000011u ) & 0xC30C30C3u;
+    v = ( v * 0x00000005u ) & 0x49249249u;
+    return v;
+}
+
+
+/**
+ * @brief   Gets the 30-bit Morton code of a point in the unit cube
+ *
+ * @param   x   The x-coordinate of the point, in [0, 1]
+ * @param   y   The y-coordinate of the point, in [0, 1]
+ * @param   z   The z-coordinate of the point, in [0, 1]
+ *
+ * @return  The Morton code of the point
+ */
+__device__ unsigned int mortonCode( float x, float y, float z )
+{
+    float cells = 1 << BVH::MORTON_BITS;
+
+    x = fminf( fmaxf( x * cells, 0 ), cells - 1 );
+    y = fminf( fmaxf( y * cells, 0 ), cells - 1 );
+    z = fminf( fmaxf( z * cells, 0 ), cells - 1 );
+
+    return
+        ( expandBits( ( unsigned int ) x ) << 2 ) |
+        ( expandBits( ( unsigned int ) y ) << 1 ) |
+        expandBits( ( unsigned int ) z );
+}
+
+
+/**
+ * @brief   Gets the length of the common prefix of two sorted Morton codes,
+ *          with equal codes told apart by their position
+ *
+ * @param   *codes  The sorted Morton codes
+ * @param   count   The number of codes
+ * @param   i       The position of the first code
+ * @param   j       The position of the second code
+ *
+ * @return  The number of leading bits the codes share, or -1 if j is out
+ *          of range
+ */
+__device__ int commonPrefix( const unsigned int *codes, unsigned int count, int i, int j )
+{
+    if ( ( j < 0 ) || ( j >= ( int ) count ) ) return -1;
+
+    unsigned int a = codes[i];
+    unsigned int b = codes[j];
+
+    if ( a == b ) return 32 + __clz( i ^ j );
+
+    return __clz( a ^ b );
+}
+
+
+/**
+ * @brief   Classifies a model-space bounding box against the window
+ *
+ * The view is orthographic, so the box projects to a rectangle whose
+ * half-extent along each screen axis is the absolute row of the transform
+ * applied to the half-extent of the box. Depth is never clipped, which
+ * leaves the window rectangle as the whole view volume.
+ *
+ * @param   *boundsMin  The low corner of the box
+ * @param   *boundsMax  The high corner of the box
+ * @param   rowX        The row of the view transform giving device x
+ * @param   rowY        The row of the view transform giving device y
+ * @param   xMax        The largest x-coordinate in the window
+ * @param   yMax        The largest y-coordinate in the window
+ *
+ * @return  BVH::BOUNDS_OUTSIDE, BVH::BOUNDS_PARTIAL or BVH::BOUNDS_INSIDE
+ */
+__host__ __device__ unsigned int classifyBounds(
+    const float *boundsMin, const float *boundsMax,
+    float4 rowX, float4 rowY, float xMax, float yMax
+)
+{
+    float cx = ( boundsMin[0] + boundsMax[0] ) / 2;
+    float cy = ( boundsMin[1] + boundsMax[1] ) / 2;
+    float cz = ( boundsMin[2] + boundsMax[2] ) / 2;
+
+    float hx = ( boundsMax[0] - boundsMin[0] ) / 2;
+    float hy = ( boundsMax[1] - boundsMin[1] ) / 2;
+    float hz = ( boundsMax[2] - boundsMin[2] ) / 2;
+
+    float x = rowX.x * cx + rowX.y * cy + rowX.z * cz + rowX.w;
+    float y = rowY.x * cx + rowY.y * cy + rowY.z * cz + rowY.w;
+
+    float extentX = fabsf( rowX.x ) * hx + fabsf( rowX.y ) * hy + fabsf( rowX.z ) * hz;
+    float extentY = fabsf( rowY.x ) * hx + fabsf( rowY.y ) * hy + fabsf( rowY.z ) * hz;
+
+    if ( ( x + extentX < 0 ) || ( x - extentX > xMax ) ||
+         ( y + extentY < 0 ) || ( y - extentY > yMax ) )
+    {
+        return BVH::BOUNDS_OUTSIDE;
+    }
+
+    if ( ( x - extentX >= 0 ) && ( x + extentX <= xMax ) &&
+         ( y - extentY >= 0 ) && ( y + extentY <= yMax ) )
+    {
+        return BVH::BOUNDS_INSIDE;
+    }
+
+    return BVH::BOUNDS_PARTIAL;
+}
+
+
+/**
+ * @brief   Gets the difference of two vectors
+ *
+ * @param   &a  The vector to subtract from
+ * @param   &b  The vector to subtract
+ *
+ * @return  a - b
+ */
+__host__ __device__ float3 subtract3( const float3 &a, const float3 &b )
+{
+    return make_float3( a.x - b.x, a.y - b.y, a.z - b.z );
+}
+
+
+/**
+ * @brief   Gets the dot product of two vectors
+ *
+ * @param   &a  The first vector
+ * @param   &b  The second vector
+ *
+ * @return  a . b
+ */
+__host__ __device__ float dot3( const float3 &a, const float3 &b )
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+
+/**
+ * @brief   Gets the cross product of two vectors
+ *
+ * @param   &a  The first vector
+ * @param   &b  The second vector
+ *
+ * @return  a x b
+ */
+__host__ __device__ float3 cross3( const float3 &a, const float3 &b )
+{
+    return make_float3(
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x
+    );
+}
+
+
+/**
+ * @brief   Intersects the line through a ray with a triangle, after Moller
+ *          and Trumbore
+ *
+ * @param   &origin     The origin of the ray
+ * @param   &direction  The direction of the ray
+ * @param   &a          The first corner of the triangle
+ * @param   &b          The second corner of the triangle
+ * @param   &c          The third corner of the triangle
+ * @param   *distance   The distance along the ray to write, may be negative
+ *
+ * @return  True if the line crosses the triangle, false otherwise
+ */
+__host__ __device__ bool intersectTriangle(
+    const float3 &origin, const float3 &direction,
+    const float3 &a, const float3 &b, const float3 &c,
+    float *distance
+)
+{
+    float3 edgeB = subtract3( b, a );
+    float3 edgeC = subtract3( c, a );
+
+    float3 p = cross3( direction, edgeC );
+    float determinant = dot3( edgeB, p );
+
+    // the ray runs parallel to the triangle
+    if ( determinant == 0 ) return false;
+
+    float invDeterminant = 1 / determinant;
+
+    float3 s = subtract3( origin, a );
+    float u = dot3( s, p ) * invDeterminant;
+
+    if ( ( u < 0 ) || ( u > 1 ) ) return false;
+
+    float3 q = cross3( s, edgeB );
+    float v = dot3( direction, q ) * invDeterminant;
+
+    if ( ( v < 0 ) || ( u + v > 1 ) ) return false;
+
+    *distance = dot3( edgeC, q ) * invDeterminant;
+    return true;
+}
+
+
+/**
+ * @brief   Loads a vertex from a structure-of-arrays vertex pool
+ *
+ * @param   *vertices       The vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   vertIdx         The index of the vertex
+ *
+ * @return  The vertex
+ */
+__host__ __device__ float3 loadVertex( const float *vertices, unsigned int vertexStride, unsigned int vertIdx )
+{
+    return make_float3(
+        vertices[vertIdx],
+        vertices[vertexStride + vertIdx],
+        vertices[vertexStride * 2 + vertIdx]
+    );
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty hierarchy
+ *
+ * @param   void
+ *
+ * @return  The created hierarchy
+ */
+BVH::BVH() = default;
+
+
+/**
+ * @brief   Hierarchy destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+BVH::~BVH()
+{
+    freeDevice();
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Builds the hierarchy over the facets of a mesh on the device
+ *
+ * Every step runs on the device: one thread per facet for the Morton codes
+ * and leaves, a radix sort of the codes, one thread per internal node to
+ * find its children, and one thread per leaf walking up to fit the boxes.
+ * The first of two siblings to finish stops at their parent, the second
+ * fits it, so every box is fitted exactly once after both children.
+ *
+ * @param   &mesh   The mesh to build over, already pushed to the device
+ *
+ * @return  void
+ */
+void BVH::build( const Mesh &mesh )
+{
+    clear();
+
+    // streamed meshes are rebuilt once their stream ends
+    if ( !mesh.isOnDevice() || mesh.isStreaming() || ( mesh.getDeviceFacetCount() == 0 ) ) return;
+
+    unsigned int count = mesh.getDeviceFacetCount();
+    size_t nodeCount = ( size_t ) count * 2 - 1;
+
+    mesh.getBounds( boundsMin, boundsMax );
+
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_nodes, nodeCount * sizeof( BVHNode ) ) );
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_sortedFacets, count * sizeof( unsigned int ) ) );
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_frontier, ( size_t ) count * 2 * sizeof( unsigned int ) ) );
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_ranges, ( size_t ) count * 2 * sizeof( unsigned int ) ) );
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_rangeOffsets, count * sizeof( unsigned int ) ) );
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_counters, COUNTER_COUNT * sizeof( unsigned int ) ) );
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_visibleIndices, ( size_t ) count * Mesh::FACET_DIM * sizeof( unsigned int ) ) );
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_hit, sizeof( BVHHit ) ) );
+
+    unsigned int *d_codes;
+    HANDLE_CUDA_ERROR( cudaMalloc( &d_codes, count * sizeof( unsigned int ) ) );
+
+    // map the bounding box to the unit cube, flat axes all land on 0
+    float scale[Mesh::COORD_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        float extent = boundsMax[i] - boundsMin[i];
+        scale[i] = ( extent > 0 ) ? 1 / extent : 0;
+    }
+
+    unsigned int blocks = ( count + BVH_BLOCK_SIZE - 1 ) / BVH_BLOCK_SIZE;
+
+    computeMortonCodes<<<blocks, BVH_BLOCK_SIZE>>>(
+        mesh.getDeviceVertices(), mesh.getDeviceVertexStride(),
+        mesh.getDeviceIndices(), count,
+        make_float3( boundsMin[0], boundsMin[1], boundsMin[2] ),
+        make_float3( scale[0], scale[1], scale[2] ),
+        d_codes, d_sortedFacets
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    thrust::device_ptr<unsigned int> codes( d_codes );
+    thrust::device_ptr<unsigned int> sortedFacets( d_sortedFacets );
+
+    thrust::sort_by_key( thrust::device, codes, codes + count, sortedFacets );
+
+    // leaves first, the internal nodes then set the parent of every child
+    buildLeafNodes<<<blocks, BVH_BLOCK_SIZE>>>(
+        mesh.getDeviceVertices(), mesh.getDeviceVertexStride(),
+        mesh.getDeviceIndices(), d_sortedFacets,
+        count,
+        d_nodes
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    if ( count > 1 )
+    {
+        unsigned int internalBlocks = ( count - 1 + BVH_BLOCK_SIZE - 1 ) / BVH_BLOCK_SIZE;
+
+        buildInternalNodes<<<internalBlocks, BVH_BLOCK_SIZE>>>( d_codes, count, d_nodes );
+        HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+        unsigned int *d_visits;
+        HANDLE_CUDA_ERROR( cudaMalloc( &d_visits, ( count - 1 ) * sizeof( unsigned int ) ) );
+        HANDLE_CUDA_ERROR( cudaMemset( d_visits, 0, ( count - 1 ) * sizeof( unsigned int ) ) );
+
+        fitNodeBounds<<<blocks, BVH_BLOCK_SIZE>>>( d_nodes, count, d_visits );
+        HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+        HANDLE_CUDA_ERROR( cudaFree( d_visits ) );
+    }
+
+    HANDLE_CUDA_ERROR( cudaFree( d_codes ) );
+
+    facetCount = count;
+}
+
+
+/**
+ * @brief   Frees the hierarchy
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void BVH::clear()
+{
+    freeDevice();
+}
+
+
+/**
+ * @brief   Determines if the hierarchy has been built
+ *
+ * @param   void
+ *
+ * @return  True if the hierarchy has been built, false otherwise
+ */
+bool BVH::isBuilt() const
+{
+    return facetCount > 0;
+}
+
+
+/**
+ * @brief   Gets the number of facets the hierarchy was built over
+ *
+ * @param   void
+ *
+ * @return  The number of facets, 0 if the hierarchy has not been built
+ */
+unsigned int BVH::getFacetCount() const
+{
+    return facetCount;
+}
+
+
+/**
+ * @brief   Finds the facets whose bounding boxes reach the window
+ *
+ * The hierarchy is walked breadth first, one launch per level over the
+ * nodes still in question. A node outside the window is dropped with its
+ * whole subtree, a node inside it hands over its run of sorted facets
+ * without being opened, so the work follows the boundary of the window
+ * rather than the size of the mesh. The runs are then expanded into an
+ * index buffer. If the whole model is inside the window, nothing runs and
+ * the index buffer of the mesh is returned as is.
+ *
+ * @param   &mesh           The mesh the hierarchy was built over
+ * @param   transform       The model to device view transform
+ * @param   width           The width of the window in pixels
+ * @param   height          The height of the window in pixels
+ * @param   **d_visible     The device index buffer of the visible facets
+ *                          to write, valid until the next query or build
+ *
+ * @return  The number of visible facets
+ */
+unsigned int BVH::queryFrustum(
+    const Mesh &mesh,
+    const float transform[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM],
+    unsigned int width, unsigned int height,
+    const unsigned int **d_visible
+) const
+{
+    *d_visible = mesh.getDeviceIndices();
+
+    if ( ( width == 0 ) || ( height == 0 ) ) return 0;
+
+    // without a hierarchy, everything is visible
+    if ( !isBuilt() ) return mesh.getDeviceFacetCount();
+
+    float4 rowX = make_float4( transform[0][0], transform[0][1], transform[0][2], transform[0][3] );
+    float4 rowY = make_float4( transform[1][0], transform[1][1], transform[1][2], transform[1][3] );
+
+    float xMax = width - 1;
+    float yMax = height - 1;
+
+    unsigned int rootBounds = classifyBounds( boundsMin, boundsMax, rowX, rowY, xMax, yMax );
+
+    if ( rootBounds == BOUNDS_OUTSIDE ) return 0;
+    if ( rootBounds == BOUNDS_INSIDE ) return facetCount;
+
+    // start from the root, which is node 0
+    HANDLE_CUDA_ERROR( cudaMemset( d_frontier, 0, sizeof( unsigned int ) ) );
+    HANDLE_CUDA_ERROR( cudaMemset( d_counters, 0, COUNTER_COUNT * sizeof( unsigned int ) ) );
+
+    unsigned int *frontier = d_frontier;
+    unsigned int *nextFrontier = d_frontier + facetCount;
+
+    unsigned int counters[COUNTER_COUNT] = { 1, 0 };
+
+    while ( counters[COUNTER_FRONTIER] > 0 )
+    {
+        unsigned int frontierCount = counters[COUNTER_FRONTIER];
+        unsigned int blocks = ( frontierCount + BVH_BLOCK_SIZE - 1 ) / BVH_BLOCK_SIZE;
+
+        HANDLE_CUDA_ERROR( cudaMemset( d_counters + COUNTER_FRONTIER, 0, sizeof( unsigned int ) ) );
+
+        queryFrustumLevel<<<blocks, BVH_BLOCK_SIZE>>>(
+            d_nodes, facetCount,
+            frontier, frontierCount,
+            rowX, rowY, xMax, yMax,
+            nextFrontier, d_ranges,
+            d_counters
+        );
+        HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+        HANDLE_CUDA_ERROR(
+            cudaMemcpy(
+                ( void * ) counters,
+                ( void * ) d_counters,
+                sizeof( counters ),
+                cudaMemcpyDeviceToHost
+            )
+        );
+
+        std::swap( frontier, nextFrontier );
+    }
+
+    unsigned int rangeCount = counters[COUNTER_RANGES];
+
+    if ( rangeCount == 0 ) return 0;
+
+    // the inclusive scan of the run lengths gives the end of every run
+    unsigned int blocks = ( rangeCount + BVH_BLOCK_SIZE - 1 ) / BVH_BLOCK_SIZE;
+
+    measureRanges<<<blocks, BVH_BLOCK_SIZE>>>( d_ranges, rangeCount, d_rangeOffsets );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    thrust::device_ptr<unsigned int> rangeOffsets( d_rangeOffsets );
+    thrust::inclusive_scan( thrust::device, rangeOffsets, rangeOffsets + rangeCount, rangeOffsets );
+
+    unsigned int visibleCount;
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) &visibleCount,
+            ( void * ) ( d_rangeOffsets + rangeCount - 1 ),
+            sizeof( unsigned int ),
+            cudaMemcpyDeviceToHost
+        )
+    );
+
+    blocks = ( visibleCount + BVH_BLOCK_SIZE - 1 ) / BVH_BLOCK_SIZE;
+
+    gatherVisibleFacets<<<blocks, BVH_BLOCK_SIZE>>>(
+        d_ranges, d_rangeOffsets, rangeCount,
+        d_sortedFacets, mesh.getDeviceIndices(),
+        visibleCount,
+        d_visibleIndices
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    *d_visible = d_visibleIndices;
+    return visibleCount;
+}
+
+
+/**
+ * @brief   Finds the first facet hit by a model-space ray
+ *
+ * The whole line through the ray is tested, so the origin may sit inside
+ * the model. A single device thread walks the hierarchy depth first and
+ * skips every box that starts beyond the nearest hit found so far.
+ *
+ * @param   &mesh       The mesh the hierarchy was built over
+ * @param   origin      The origin of the ray
+ * @param   direction   The direction of the ray
+ * @param   *distance   The distance along the ray to the hit to write, in
+ *                      units of direction, or nullptr
+ *
+ * @return  The index of the facet hit, or -1 if no facet is hit
+ */
+int BVH::queryRay(
+    const Mesh &mesh,
+    const float origin[Mesh::COORD_DIM], const float direction[Mesh::COORD_DIM],
+    float *distance
+) const
+{
+    if ( !isBuilt() ) return -1;
+
+    intersectRay<<<1, 1>>>(
+        d_nodes, facetCount,
+        mesh.getDeviceVertices(), mesh.getDeviceVertexStride(),
+        mesh.getDeviceIndices(), d_sortedFacets,
+        make_float3( origin[0], origin[1], origin[2] ),
+        make_float3( direction[0], direction[1], direction[2] ),
+        d_hit
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    BVHHit hit;
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) &hit,
+            ( void * ) d_hit,
+            sizeof( hit ),
+            cudaMemcpyDeviceToHost
+        )
+    );
+
+    if ( ( hit.facet >= 0 ) && ( distance != nullptr ) ) *distance = hit.distance;
+
+    return hit.facet;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Frees the device buffers of this hierarchy
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void BVH::freeDevice()
+{
+    if ( d_nodes != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_nodes ) );
+        d_nodes = nullptr;
+    }
+
+    if ( d_sortedFacets != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_sortedFacets ) );
+        d_sortedFacets = nullptr;
+    }
+
+    if ( d_frontier != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_frontier ) );
+        d_frontier = nullptr;
+    }
+
+    if ( d_ranges != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_ranges ) );
+        d_ranges = nullptr;
+    }
+
+    if ( d_rangeOffsets != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_rangeOffsets ) );
+        d_rangeOffsets = nullptr;
+    }
+
+    if ( d_counters != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_counters ) );
+        d_counters = nullptr;
+    }
+
+    if ( d_visibleIndices != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_visibleIndices ) );
+        d_visibleIndices = nullptr;
+    }
+
+    if ( d_hit != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_hit ) );
+        d_hit = nullptr;
+    }
+
+    facetCount = 0;
+}
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+/**
+ * @brief   Computes the Morton code of every facet centroid, one thread per
+ *          facet
+ *
+ * @param   *vertices       The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *indices        The triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   boundsMin       The low corner of the mesh bounding box
+ * @param   boundsScale     The inverse extent of the mesh bounding box
+ * @param   *codes          The Morton codes to write
+ * @param   *facets         The facet indices to write, the sort values
+ *
+ * @return  void
+ */
+__global__ void computeMortonCodes(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    float3 boundsMin, float3 boundsScale,
+    unsigned int * codes, unsigned int * facets
+)
+{
+    unsigned int facetIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( facetIdx >= facetCount ) return;
+
+    float3 a = loadVertex( vertices, vertexStride, indices[facetIdx * Mesh::FACET_DIM + 0] );
+    float3 b = loadVertex( vertices, vertexStride, indices[facetIdx * Mesh::FACET_DIM + 1] );
+    float3 c = loadVertex( vertices, vertexStride, indices[facetIdx * Mesh::FACET_DIM + 2] );
+
+    float x = ( ( a.x + b.x + c.x ) / 3 - boundsMin.x ) * boundsScale.x;
+    float y = ( ( a.y + b.y + c.y ) / 3 - boundsMin.y ) * boundsScale.y;
+    float z = ( ( a.z + b.z + c.z ) / 3 - boundsMin.z ) * boundsScale.z;
+
+    codes[facetIdx] = mortonCode( x, y, z );
+    facets[facetIdx] = facetIdx;
+}
+
+
+/**
+ * @brief   Fills in the leaf of every sorted facet, one thread per facet
+ *
+ * @param   *vertices       The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *indices        The triangle index buffer
+ * @param   *sortedFacets   The facet indices in Morton order
+ * @param   facetCount      The number of facets
+ * @param   *nodes          The nodes, leaves starting at facetCount - 1
+ *
+ * @return  void
+ */
+__global__ void buildLeafNodes(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, const unsigned int * sortedFacets,
+    unsigned int facetCount,
+    BVHNode * nodes
+)
+{
+    unsigned int sortedIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( sortedIdx >= facetCount ) return;
+
+    unsigned int facetIdx = sortedFacets[sortedIdx];
+    BVHNode &leaf = nodes[facetCount - 1 + sortedIdx];
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        leaf.boundsMin[i] = FLT_MAX;
+        leaf.boundsMax[i] = -FLT_MAX;
+    }
+
+    for ( unsigned int corner = 0; corner < Mesh::FACET_DIM; corner++ )
+    {
+        unsigned int vertIdx = indices[facetIdx * Mesh::FACET_DIM + corner];
+
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+        {
+            float v = vertices[vertexStride * i + vertIdx];
+
+            leaf.boundsMin[i] = fminf( leaf.boundsMin[i], v );
+            leaf.boundsMax[i] = fmaxf( leaf.boundsMax[i], v );
+        }
+    }
+
+    leaf.left = BVH::NO_NODE;
+    leaf.right = BVH::NO_NODE;
+    leaf.parent = BVH::NO_NODE;
+    leaf.first = sortedIdx;
+    leaf.last = sortedIdx;
+}
+
+
+/**
+ * @brief   Finds the range and children of every internal node, one thread
+ *          per internal node
+ *
+ * Internal node i starts or ends at sorted position i. Its direction is
+ * the neighbour sharing the longer prefix, its far end is found by an
+ * exponential then a binary search for the last code sharing more than the
+ * other neighbour, and it splits where the shared prefix first gets
+ * shorter. Children covering a single facet are leaves.
+ *
+ * @param   *codes          The sorted Morton codes
+ * @param   facetCount      The number of facets
+ * @param   *nodes          The nodes, leaves starting at facetCount - 1
+ *
+ * @return  void
+ */
+__global__ void buildInternalNodes(
+    const unsigned int * codes, unsigned int facetCount,
+    BVHNode * nodes
+)
+{
+    unsigned int nodeIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( nodeIdx + 1 >= facetCount ) return;
+
+    int i = nodeIdx;
+
+    // grow toward the neighbour that shares more
+    int direction = ( commonPrefix( codes, facetCount, i, i + 1 ) >= commonPrefix( codes, facetCount, i, i - 1 ) ) ? 1 : -1;
+    int minPrefix = commonPrefix( codes, facetCount, i, i - direction );
+
+    int maxLength = 2;
+
+    while ( commonPrefix( codes, facetCount, i, i + maxLength * direction ) > minPrefix ) maxLength *= 2;
+
+    int length = 0;
+
+    for ( int step = maxLength / 2; step >= 1; step /= 2 )
+    {
+        if ( commonPrefix( codes, facetCount, i, i + ( length + step ) * direction ) > minPrefix ) length += step;
+    }
+
+    int j = i + length * direction;
+    int nodePrefix = commonPrefix( codes, facetCount, i, j );
+
+    // find the last position sharing more than the whole node
+    int split = 0;
+    int step = length;
+
+    do
+    {
+        step = ( step + 1 ) / 2;
+
+        if ( commonPrefix( codes, facetCount, i, i + ( split + step ) * direction ) > nodePrefix ) split += step;
+    }
+    while ( step > 1 );
+
+    int gamma = i + split * direction + min( direction, 0 );
+
+    unsigned int first = min( i, j );
+    unsigned int last = max( i, j );
+    unsigned int leafStart = facetCount - 1;
+
+    BVHNode &node = nodes[nodeIdx];
+
+    node.left = ( first == ( unsigned int ) gamma ) ? leafStart + gamma : gamma;
+    node.right = ( last == ( unsigned int ) gamma + 1 ) ? leafStart + gamma + 1 : gamma + 1;
+    node.first = first;
+    node.last = last;
+
+    nodes[node.left].parent = nodeIdx;
+    nodes[node.right].parent = nodeIdx;
+
+    if ( nodeIdx == 0 ) node.parent = BVH::NO_NODE;
+}
+
+
+/**
+ * @brief   Fits the bounding box of every internal node, one thread per leaf
+ *
+ * @param   *nodes          The nodes, leaves starting at facetCount - 1
+ * @param   facetCount      The number of facets
+ * @param   *visits         One zeroed counter per internal node
+ *
+ * @return  void
+ */
+__global__ void fitNodeBounds(
+    BVHNode * nodes, unsigned int facetCount,
+    unsigned int * visits
+)
+{
+    unsigned int sortedIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( sortedIdx >= facetCount ) return;
+
+    unsigned int parentIdx = nodes[facetCount - 1 + sortedIdx].parent;
+
+    while ( parentIdx != BVH::NO_NODE )
+    {
+        // publish this child's box before its sibling can read it
+        __threadfence();
+
+        // the first child to arrive leaves the parent to the second
+        if ( atomicAdd( &visits[parentIdx], 1u ) == 0 ) return;
+
+        BVHNode &parent = nodes[parentIdx];
+        const BVHNode &left = nodes[parent.left];
+        const BVHNode &right = nodes[parent.right];
+
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+        {
+            parent.boundsMin[i] = fminf( left.boundsMin[i], right.boundsMin[i] );
+            parent.boundsMax[i] = fmaxf( left.boundsMax[i], right.boundsMax[i] );
+        }
+
+        parentIdx = parent.parent;
+    }
+}
+
+
+/**
+ * @brief   Classifies one level of nodes against the window, one thread per
+ *          node
+ *
+ * Nodes outside the window are dropped. Nodes inside it, and leaves that
+ * reach it, append their run of sorted facets to the ranges. The children
+ * of the rest make up the next level.
+ *
+ * @param   *nodes          The nodes, leaves starting at facetCount - 1
+ * @param   facetCount      The number of facets
+ * @param   *frontier       The nodes of this level
+ * @param   frontierCount   The number of nodes in this level
+ * @param   rowX            The row of the view transform giving device x
+ * @param   rowY            The row of the view transform giving device y
+ * @param   xMax            The largest x-coordinate in the window
+ * @param   yMax            The largest y-coordinate in the window
+ * @param   *nextFrontier   The nodes of the next level to write
+ * @param   *ranges         The runs to append to, first and last per run
+ * @param   *counters       The next level and run counts to append with
+ *
+ * @return  void
+ */
+__global__ void queryFrustumLevel(
+    const BVHNode * nodes, unsigned int facetCount,
+    const unsigned int * frontier, unsigned int frontierCount,
+    float4 rowX, float4 rowY, float xMax, float yMax,
+    unsigned int * nextFrontier, unsigned int * ranges,
+    unsigned int * counters
+)
+{
+    unsigned int frontierIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( frontierIdx >= frontierCount ) return;
+
+    unsigned int nodeIdx = frontier[frontierIdx];
+    const BVHNode &node = nodes[nodeIdx];
+
+    unsigned int bounds = classifyBounds( node.boundsMin, node.boundsMax, rowX, rowY, xMax, yMax );
+
+    if ( bounds == BVH::BOUNDS_OUTSIDE ) return;
+
+    if ( ( bounds == BVH::BOUNDS_INSIDE ) || ( nodeIdx >= facetCount - 1 ) )
+    {
+        unsigned int rangeIdx = atomicAdd( &counters[COUNTER_RANGES], 1u );
+
+        ranges[rangeIdx * 2 + 0] = node.first;
+        ranges[rangeIdx * 2 + 1] = node.last;
+    }
+    else
+    {
+        unsigned int nextIdx = atomicAdd( &counters[COUNTER_FRONTIER], 2u );
+
+        nextFrontier[nextIdx + 0] = node.left;
+        nextFrontier[nextIdx + 1] = node.right;
+    }
+}
+
+
+/**
+ * @brief   Writes the number of facets in every run, one thread per run
+ *
+ * @param   *ranges     The runs, first and last per run
+ * @param   rangeCount  The number of runs
+ * @param   *lengths    The run lengths to write
+ *
+ * @return  void
+ */
+__global__ void measureRanges(
+    const unsigned int * ranges, unsigned int rangeCount,
+    unsigned int * lengths
+)
+{
+    unsigned int rangeIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( rangeIdx >= rangeCount ) return;
+
+    lengths[rangeIdx] = ranges[rangeIdx * 2 + 1] - ranges[rangeIdx * 2 + 0] + 1;
+}
+
+
+/**
+ * @brief   Expands the visible runs into an index buffer, one thread per
+ *          visible facet
+ *
+ * Each thread binary searches the run ends for its run, so a long run is
+ * spread over as many threads as it has facets.
+ *
+ * @param   *ranges         The runs, first and last per run
+ * @param   *rangeEnds      The inclusive prefix sum of the run lengths
+ * @param   rangeCount      The number of runs
+ * @param   *sortedFacets   The facet indices in Morton order
+ * @param   *indices        The triangle index buffer of the mesh
+ * @param   visibleCount    The total number of facets in the runs
+ * @param   *visibleIndices The index buffer of the visible facets to write
+ *
+ * @return  void
+ */
+__global__ void gatherVisibleFacets(
+    const unsigned int * ranges, const unsigned int * rangeEnds, unsigned int rangeCount,
+    const unsigned int * sortedFacets, const unsigned int * indices,
+    unsigned int visibleCount,
+    unsigned int * visibleIndices
+)
+{
+    unsigned int visibleIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( visibleIdx >= visibleCount ) return;
+
+    // first run ending past this facet
+    unsigned int low = 0;
+    unsigned int high = rangeCount - 1;
+
+    while ( low < high )
+    {
+        unsigned int mid = ( low + high ) / 2;
+
+        if ( rangeEnds[mid] > visibleIdx ) high = mid;
+        else low = mid + 1;
+    }
+
+    unsigned int rangeStart = ( low == 0 ) ? 0 : rangeEnds[low - 1];
+    unsigned int facetIdx = sortedFacets[ranges[low * 2] + visibleIdx - rangeStart];
+
+    for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+    {
+        visibleIndices[visibleIdx * Mesh::FACET_DIM + i] = indices[facetIdx * Mesh::FACET_DIM + i];
+    }
+}
+
+
+/**
+ * @brief   Finds the facet with the smallest distance along a ray, on a
+ *          single thread
+ *
+ * @param   *nodes          The nodes, leaves starting at facetCount - 1
+ * @param   facetCount      The number of facets
+ * @param   *vertices       The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *indices        The triangle index buffer
+ * @param   *sortedFacets   The facet indices in Morton order
+ * @param   origin          The origin of the ray
+ * @param   direction       The direction of the ray
+ * @param   *hit            The nearest hit to write, facet -1 for none
+ *
+ * @return  void
+ */
+__global__ void intersectRay(
+    const BVHNode * nodes, unsigned int facetCount,
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, const unsigned int * sortedFacets,
+    float3 origin, float3 direction,
+    BVHHit * hit
+)
+{
+    if ( ( blockIdx.x != 0 ) || ( threadIdx.x != 0 ) ) return;
+
+    float rayOrigin[Mesh::COORD_DIM] = { origin.x, origin.y, origin.z };
+    float invDirection[Mesh::COORD_DIM] = { 1 / direction.x, 1 / direction.y, 1 / direction.z };
+
+    float nearest = FLT_MAX;
+    int nearestFacet = -1;
+
+    unsigned int stack[BVH::RAY_STACK_SIZE];
+    unsigned int stackSize = 0;
+
+    stack[stackSize++] = 0;
+
+    while ( stackSize > 0 )
+    {
+        unsigned int nodeIdx = stack[--stackSize];
+        const BVHNode &node = nodes[nodeIdx];
+
+        // slab test, an axis the ray runs along only gives infinities
+        float near = -FLT_MAX;
+        float far = FLT_MAX;
+
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+        {
+            float t0 = ( node.boundsMin[i] - rayOrigin[i] ) * invDirection[i];
+            float t1 = ( node.boundsMax[i] - rayOrigin[i] ) * invDirection[i];
+
+            near = fmaxf( near, fminf( t0, t1 ) );
+            far = fminf( far, fmaxf( t0, t1 ) );
+        }
+
+        if ( ( near > far ) || ( near >= nearest ) ) continue;
+
+        if ( nodeIdx >= facetCount - 1 )
+        {
+            unsigned int facetIdx = sortedFacets[node.first];
+            float distance;
+
+            bool crossed = intersectTriangle(
+                origin, direction,
+                loadVertex( vertices, vertexStride, indices[facetIdx * Mesh::FACET_DIM + 0] ),
+                loadVertex( vertices, vertexStride, indices[facetIdx * Mesh::FACET_DIM + 1] ),
+                loadVertex( vertices, vertexStride, indices[facetIdx * Mesh::FACET_DIM + 2] ),
+                &distance
+            );
+
+            if ( crossed && ( distance < nearest ) )
+            {
+                nearest = distance;
+                nearestFacet = facetIdx;
+            }
+        }
+        else
+        {
+            stack[stackSize++] = node.right;
+            stack[stackSize++] = node.left;
+        }
+    }
+
+    hit->distance = nearest;
+    hit->facet = nearestFacet;
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,238 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    bvh.h
+ * @brief   GPU linear bounding volume hierarchy over the facets of a mesh
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_BVH_H
+# define GRAPHICS_BVH_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "mesh.h"
+# include "viewcontext.h"
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * A node of the hierarchy. Internal nodes come first, leaves after them,
+ * one per facet in Morton order, so every node covers the contiguous run
+ * [first, last] of the sorted facets.
+ */
+struct BVHNode
+{
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+
+    unsigned int left;
+    unsigned int right;
+    unsigned int parent;
+
+    unsigned int first;
+    unsigned int last;
+};
+
+
+/**
+ * The nearest facet along a ray and its distance along the ray
+ */
+struct BVHHit
+{
+    float distance;
+    int facet;
+};
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A linear BVH built entirely on the device, after Karras, "Maximizing
+ * Parallelism in the Construction of BVHs, Octrees, and k-d Trees" (2012).
+ * Facet centroids are quantized to 30-bit Morton codes and sorted, every
+ * internal node then finds its own children from the sorted codes, and the
+ * bounding boxes are fitted bottom-up. The hierarchy answers which facets
+ * can reach the window and which facet a ray hits first, visiting only the
+ * nodes along the way instead of every facet.
+ */
+class BVH
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int MORTON_BITS = 10;
+    static constexpr unsigned int NO_NODE = 0xFFFFFFFF;
+
+    // how a bounding box lies against the window
+    static constexpr unsigned int BOUNDS_OUTSIDE = 0;
+    static constexpr unsigned int BOUNDS_PARTIAL = 1;
+    static constexpr unsigned int BOUNDS_INSIDE = 2;
+
+    // Morton codes tied on the facet index give keys of at most 62 bits,
+    // so no root to leaf path is longer than that
+    static constexpr unsigned int RAY_STACK_SIZE = 64;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    BVH();
+    BVH( const BVH &bvh ) = delete;
+
+    ~BVH();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    BVH &operator=( const BVH &bvh ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void build( const Mesh &mesh );
+    void clear();
+
+    bool isBuilt() const;
+    unsigned int getFacetCount() const;
+
+    unsigned int queryFrustum(
+        const Mesh &mesh,
+        const float transform[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM],
+        unsigned int width, unsigned int height,
+        const unsigned int **d_visibleIndices
+    ) const;
+
+    int queryRay(
+        const Mesh &mesh,
+        const float origin[Mesh::COORD_DIM], const float direction[Mesh::COORD_DIM],
+        float *distance
+    ) const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    unsigned int facetCount = 0;
+
+    // bounds of the root, so an all-in or all-out view never leaves the host
+    float boundsMin[Mesh::COORD_DIM] = { 0, 0, 0 };
+    float boundsMax[Mesh::COORD_DIM] = { 0, 0, 0 };
+
+    BVHNode * d_nodes = nullptr;
+    unsigned int * d_sortedFacets = nullptr;
+
+    // query scratch, sized for the worst case when the hierarchy is built
+    unsigned int * d_frontier = nullptr;
+    unsigned int * d_ranges = nullptr;
+    unsigned int * d_rangeOffsets = nullptr;
+    unsigned int * d_counters = nullptr;
+    unsigned int * d_visibleIndices = nullptr;
+    BVHHit * d_hit = nullptr;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void freeDevice();
+
+
+    /* ====================================================================== */
+};
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+__host__ __device__ unsigned int classifyBounds(
+    const float *boundsMin, const float *boundsMax,
+    float4 rowX, float4 rowY, float xMax, float yMax
+);
+
+__host__ __device__ bool intersectTriangle(
+    const float3 &origin, const float3 &direction,
+    const float3 &a, const float3 &b, const float3 &c,
+    float *distance
+);
+
+__host__ __device__ float3 loadVertex( const float *vertices, unsigned int vertexStride, unsigned int vertIdx );
+
+__global__ void computeMortonCodes(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    float3 boundsMin, float3 boundsScale,
+    unsigned int * codes, unsigned int * facets
+);
+
+__global__ void buildLeafNodes(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, const unsigned int * sortedFacets,
+    unsigned int facetCount,
+    BVHNode * nodes
+);
+
+__global__ void buildInternalNodes(
+    const unsigned int * codes, unsigned int facetCount,
+    BVHNode * nodes
+);
+
+__global__ void fitNodeBounds(
+    BVHNode * nodes, unsigned int facetCount,
+    unsigned int * visits
+);
+
+__global__ void queryFrustumLevel(
+    const BVHNode * nodes, unsigned int facetCount,
+    const unsigned int * frontier, unsigned int frontierCount,
+    float4 rowX, float4 rowY, float xMax, float yMax,
+    unsigned int * nextFrontier, unsigned int * ranges,
+    unsigned int * counters
+);
+
+__global__ void measureRanges(
+    const unsigned int * ranges, unsigned int rangeCount,
+    unsigned int * lengths
+);
+
+__global__ void gatherVisibleFacets(
+    const unsigned int * ranges, const unsigned int * rangeEnds, unsigned int rangeCount,
+    const unsigned int * sortedFacets, const unsigned int * indices,
+    unsigned int visibleCount,
+    unsigned int * visibleIndices
+);
+
+__global__ void intersectRay(
+    const BVHNode * nodes, unsigned int facetCount,
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, const unsigned int * sortedFacets,
+    float3 origin, float3 direction,
+    BVHHit * hit
+);
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_BVH_H
+
+
+/* -------------------------------------------------------------------------- */
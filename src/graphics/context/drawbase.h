@@ -15,5 +15,11 @@ class DrawingBase
 		virtual void mouseButtonDown( GraphicsContext *gc, unsigned int button, int x, int y) = 0;
 		virtual void mouseButtonUp( GraphicsContext *gc, unsigned int button, int x, int y) = 0;
 		virtual void mouseMove( GraphicsContext *gc, int x, int y) = 0;
+
+		// Drawings that render on another thread hand back a descriptor
+		// that becomes readable when a frame is ready, and are told when
+		// it does.  -1 means frames are only drawn from paint().
+		virtual int getFrameFd() { return -1; }
+		virtual void frameReady( GraphicsContext *gc) {}
 };
 #endif
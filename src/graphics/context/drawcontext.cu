@@ -11,15 +11,33 @@
 
 
 # include <algorithm>
+# include <chrono>
 # include <iostream>
 # include <cmath>
+# include <utility>
 
 # include "line.h"
 # include "drawcontext.h"
+# include "frameprofiler.h"
+# include "meshcache.h"
 # include "shape.h"
 # include "stlreader.h"
 
 
+/* -------------------------------- Constants ------------------------------- */
+
+
+// how often a streaming load redraws the facets that have arrived
+const std::chrono::milliseconds PROGRESSIVE_PAINT_INTERVAL = std::chrono::milliseconds( 50 );
+
+// how often the frame profile is printed while it is on
+const std::chrono::milliseconds PROFILE_REPORT_INTERVAL = std::chrono::milliseconds( 1000 );
+
+// share of a model's largest extent it is moved by per key press, and kept
+// clear of the model imported before it
+const float MODEL_STEP = 0.1f;
+
+
 /* ----------------------- Constructors / Destructors ----------------------- */
 
 
@@ -38,18 +56,9 @@ DrawContext::~DrawContext() = default;
 
 void DrawContext::paint( GraphicsContext *gc )
 {
-    // clear the canvas
-    gc->clear();
-
-    // update view context
-    vc->update();
-
-    // draw 3D axis
-    if ( drawAxis ) draw3DAxis( gc );
-
-    // redraw shapes
-    gc->setColor( drawColor.toX11() );
-    sc.draw( gc, vc );
+    // ask for a frame of the current view and show the newest one there is
+    requestFrame( gc );
+    showFrame( gc );
 }
 
 
@@ -128,7 +137,43 @@ void DrawContext::keyDown( GraphicsContext *gc, unsigned int keycode )
         case DrawContext::KEY_CODE_A:
             drawAxis = !drawAxis;
             std::cout << "DRAW 3D AXIS: " << ( drawAxis ? "ENABLED" : "DISABLED" ) << std::endl;
-            paint( gc );
+            showFrame( gc );
+            break;
+
+        // B: toggle back-face culling
+        case DrawContext::KEY_CODE_B:
+            backFaceCulling = !backFaceCulling;
+            std::cout << "BACK-FACE CULLING: " << ( backFaceCulling ? "ENABLED" : "DISABLED" ) << std::endl;
+            requestFrame( gc );
+            break;
+
+        // D: toggle fading edges by depth
+        case DrawContext::KEY_CODE_D:
+            depthCueing = !depthCueing;
+            std::cout << "DEPTH CUEING: " << ( depthCueing ? "ENABLED" : "DISABLED" ) << std::endl;
+            requestFrame( gc );
+            break;
+
+        // H: toggle drawing the selected model
+        case DrawContext::KEY_CODE_H:
+            toggleModelVisibility();
+            break;
+
+        // I: import a drawing next to the open ones
+        case DrawContext::KEY_CODE_I:
+            fileImport( gc );
+            break;
+
+        // L: toggle hiding edges behind facets
+        case DrawContext::KEY_CODE_L:
+            hiddenLines = !hiddenLines;
+            std::cout << "HIDDEN LINES: " << ( hiddenLines ? "ENABLED" : "DISABLED" ) << std::endl;
+            requestFrame( gc );
+            break;
+
+        // N: select the next model
+        case DrawContext::KEY_CODE_N:
+            selectNextModel();
             break;
 
         // O: open drawing
@@ -136,34 +181,61 @@ void DrawContext::keyDown( GraphicsContext *gc, unsigned int keycode )
             fileOpen( gc );
             break;
 
+        // P: toggle frame profiling
+        case DrawContext::KEY_CODE_P:
+        {
+            FrameProfiler &profiler = FrameProfiler::getInstance();
+
+            profiler.setEnabled( !profiler.isEnabled() );
+            std::cout << "FRAME PROFILING: " << ( profiler.isEnabled() ? "ENABLED" : "DISABLED" ) << std::endl;
+
+            lastProfileReport = std::chrono::steady_clock::now();
+            break;
+        }
+
         // R: reset view
         case DrawContext::KEY_CODE_R:
             vc->resetView();
-            paint( gc );
+            requestFrame( gc );
+            break;
+
+        // X: move the selected model along x, back with shift
+        case DrawContext::KEY_CODE_X:
+            moveModel( 0, shiftHeld ? -1 : 1 );
+            break;
+
+        // Y: move the selected model along y, back with shift
+        case DrawContext::KEY_CODE_Y:
+            moveModel( 1, shiftHeld ? -1 : 1 );
+            break;
+
+        // SHIFT: reverse model moves while held
+        case DrawContext::KEY_CODE_SHIFT:
+            shiftHeld = true;
             break;
 
         // LEFT: left view
         case DrawContext::KEY_CODE_LEFT:
             vc->setRotation( ( -1 * M_PI_2 ), 0 );
-            paint( gc );
+            requestFrame( gc );
             break;
 
         // RIGHT: right view
         case DrawContext::KEY_CODE_RIGHT:
             vc->setRotation( M_PI_2, 0 );
-            paint( gc );
+            requestFrame( gc );
             break;
 
         // UP: top view
         case DrawContext::KEY_CODE_UP:
             vc->setRotation( 0, M_PI_2 );
-            paint( gc );
+            requestFrame( gc );
             break;
 
         // DOWN: bottom view
         case DrawContext::KEY_CODE_DOWN:
             vc->setRotation( 0, ( -1 * M_PI_2 ) );
-            paint( gc );
+            requestFrame( gc );
             break;
 
         default:
@@ -175,6 +247,8 @@ void DrawContext::keyDown( GraphicsContext *gc, unsigned int keycode )
 void DrawContext::keyUp( GraphicsContext *gc, unsigned int keycode )
 {
     // std::cout << "Key Up: " << keycode << std::endl;
+
+    if ( keycode == DrawContext::KEY_CODE_SHIFT ) shiftHeld = false;
 }
 
 
@@ -189,6 +263,7 @@ void DrawContext::mouseButtonDown( GraphicsContext *gc, unsigned int button, int
     if ( ( button == MOUSE_BUTTON_LEFT ) && ( !panActive ) && ( !orbitActive ) )
     {
         panActive = true;
+        interactive = true;
         mouseStartPos = Point2D( x, y );
         lastMouseDelta = Point2D( 0, 0 );
     }
@@ -197,22 +272,36 @@ void DrawContext::mouseButtonDown( GraphicsContext *gc, unsigned int button, int
     else if ( ( button == MOUSE_BUTTON_RIGHT ) && ( !panActive ) && ( !orbitActive ) )
     {
         orbitActive = true;
+        interactive = true;
         mouseStartPos = Point2D( x, y );
         lastMouseDelta = Point2D( 0, 0 );
     }
 
+    // CMB down - pick the facet under the cursor
+    else if ( ( button == MOUSE_BUTTON_CENTER ) && ( !panActive ) && ( !orbitActive ) )
+    {
+        // the mesh lives on the render thread, pick with the view it draws
+        renderer.post( [x, y]( RenderThread &r )
+        {
+            int facet = r.getSession().pick( r.getView(), x, y );
+
+            if ( facet < 0 ) std::cout << "PICKED FACET: NONE" << std::endl;
+            else std::cout << "PICKED FACET: " << facet << std::endl;
+        } );
+    }
+
     // scroll forward - zoom in
     else if ( ( button == MOUSE_BUTTON_SCROLL_IN ) && ( !panActive ) && ( !orbitActive ) )
     {
         vc->scale( 1.05, 1.05, 1 );
-        paint( gc );
+        requestFrame( gc );
     }
 
     // scroll backward - zoom out
     else if ( ( button == MOUSE_BUTTON_SCROLL_OUT ) && ( !panActive ) && ( !orbitActive ) )
     {
         vc->scale( 1 / 1.05, 1 / 1.05, 1 );
-        paint( gc );
+        requestFrame( gc );
     }
 }
 
@@ -221,27 +310,31 @@ void DrawContext::mouseButtonUp( GraphicsContext *gc, unsigned int button, int x
 {
     // std::cout << "Mouse Up: " << button << " at (" << x << ", " << y << ")" << std::endl;
 
-    // LMB up - stop pan
+    // LMB up - stop pan, back to full detail
     if ( button == MOUSE_BUTTON_LEFT  )
     {
+        interactive = false;
+
         double scale = vc->getScale()[0];
         vc->pan(
             lastMouseDelta.getX() / scale,
             -lastMouseDelta.getY() / scale
         );
-        paint( gc );
+        requestFrame( gc );
         panActive = false;
     }
 
-    // MMB up - stop orbit
+    // MMB up - stop orbit, back to full detail
     else if ( button == MOUSE_BUTTON_RIGHT  )
     {
+        interactive = false;
+
         vc->rotate(
             lastMouseDelta.getY() / 200,
             lastMouseDelta.getX() / 200
         );
 
-        paint( gc );
+        requestFrame( gc );
 
         orbitActive = false;
     }
@@ -268,7 +361,7 @@ void DrawContext::mouseMove( GraphicsContext *gc, int x, int y )
                 -mouseDelta.getY() / scale
             );
 
-            paint( gc );
+            requestFrame( gc );
 
             vc->setTranslation(
                 currentTranslation.getX(),
@@ -295,7 +388,7 @@ void DrawContext::mouseMove( GraphicsContext *gc, int x, int y )
                 mouseDelta.getX() / 200
             );
 
-            paint( gc );
+            requestFrame( gc );
 
             vc->setRotation(
                 currentRotation.getX(),
@@ -309,11 +402,34 @@ void DrawContext::mouseMove( GraphicsContext *gc, int x, int y )
 }
 
 
+int DrawContext::getFrameFd()
+{
+    return renderer.getFrameFd();
+}
+
+
+void DrawContext::frameReady( GraphicsContext *gc )
+{
+    // a loaded model tells the view where it is
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+
+    if ( renderer.takeViewFit( boundsMin, boundsMax ) )
+    {
+        vc->frameBounds( boundsMin, boundsMax, ViewContext::DEFAULT_FRAME_FILL );
+        requestFrame( gc );
+    }
+
+    showFrame( gc );
+}
+
+
 /* ---------------------------- Private Functions --------------------------- */
 
 
 /**
- * @brief   Sets the draw color of the view
+ * @brief   Sets the draw color of the view, or of the selected model if it
+ *          is not the opened one
  *
  * @param   *gc     The graphics context to draw to
  * @param   &c      The draw color
@@ -322,9 +438,106 @@ void DrawContext::mouseMove( GraphicsContext *gc, int x, int y )
  */
 void DrawContext::setDrawColor( GraphicsContext *gc, const Color &c )
 {
+    if ( selectedModel > 0 )
+    {
+        unsigned int model = selectedModel;
+        unsigned int color = c.toX11();
+
+        renderer.post( [model, color]( RenderThread &r )
+        {
+            Scene &scene = r.getSession().getScene();
+
+            if ( model < scene.getModelCount() ) scene.getModel( model ).setColor( color );
+        } );
+        return;
+    }
+
     drawColor = c;
     gc->setColor( drawColor.toX11() );
-    paint( gc );
+    requestFrame( gc );
+}
+
+
+/**
+ * @brief   Publishes the current view to the render thread, which draws it
+ *          once it is done with the frame it is on
+ *
+ * @param   *gc     The graphics context the frame is for
+ *
+ * @return  void
+ */
+void DrawContext::requestFrame( GraphicsContext *gc )
+{
+    RenderState state;
+
+    Vector3<float> translation = vc->getTranslation();
+    Vector2<float> rotation = vc->getRotation();
+    Vector3<float> scale = vc->getScale();
+
+    state.translation[0] = translation.getX();
+    state.translation[1] = translation.getY();
+    state.translation[2] = translation.getZ();
+
+    state.rotation[0] = rotation.getX();
+    state.rotation[1] = rotation.getY();
+
+    state.scale[0] = scale.getX();
+    state.scale[1] = scale.getY();
+    state.scale[2] = scale.getZ();
+
+    state.width = gc->getWindowWidth();
+    state.height = gc->getWindowHeight();
+
+    state.color = drawColor.toX11();
+    state.background = gc->getBackgroundColor();
+
+    state.interactive = interactive;
+    state.backFaceCulling = backFaceCulling;
+    state.hiddenLines = hiddenLines;
+    state.depthCueing = depthCueing;
+
+    renderer.publish( state );
+}
+
+
+/**
+ * @brief   Shows the newest frame the render thread has finished
+ *
+ * While frame profiling is on, the time to present the frame is added to
+ * the profile, which is printed every PROFILE_REPORT_INTERVAL.
+ *
+ * @param   *gc     The graphics context to draw to
+ *
+ * @return  void
+ */
+void DrawContext::showFrame( GraphicsContext *gc )
+{
+    auto presentStartTime = std::chrono::steady_clock::now();
+
+    // nothing to show until the first frame is done
+    if ( !renderer.present( gc ) ) return;
+
+    // draw 3D axis
+    if ( drawAxis ) draw3DAxis( gc );
+
+    // show the frame
+    gc->present();
+
+    FrameProfiler &profiler = FrameProfiler::getInstance();
+
+    if ( !profiler.isEnabled() ) return;
+
+    auto presentEndTime = std::chrono::steady_clock::now();
+    double presentTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        presentEndTime - presentStartTime
+    ).count() / 1000000.0;
+    profiler.addSample( FrameProfiler::STAGE_PRESENT, presentTime );
+
+    if ( presentEndTime - lastProfileReport >= PROFILE_REPORT_INTERVAL )
+    {
+        profiler.report( std::cout );
+        lastProfileReport = presentEndTime;
+    }
 }
 
 
@@ -371,15 +584,261 @@ void DrawContext::fileOpen( GraphicsContext *gc )
     std::string fileName;
     std::cin >> fileName;
 
-    // open file and read facets
-    STLReader stlReader = STLReader( fileName );
-    sc = stlReader.readFacets();
-    sc.pushToDevice();
-
-    // reset view and paint
+    // reset the view first, it is framed once the first facets arrive
     vc->resetView();
-    paint( gc );
+    requestFrame( gc );
+
+    // opening replaces every imported model too
+    modelCount = 1;
+    selectedModel = 0;
+
+    // load on the render thread, which owns the device buffers
+    renderer.post( [fileName]( RenderThread &r )
+    {
+        RenderSession &session = r.getSession();
+
+        // free the previous model before loading the next one
+        session.unload();
+
+        ShapeContainer &sc = session.getShapes();
+
+        // reuse the preprocessed mesh if the file has not changed
+        if ( MeshCache::load( fileName, sc.getMesh() ) )
+        {
+            session.upload();
+        }
+        else
+        {
+            STLReader stlReader = STLReader( fileName );
+
+            // a split or out-of-core mesh is read whole first, it cannot be
+            // streamed into a single device
+            if ( !session.canStream( stlReader.getFacetCount() ) )
+            {
+                sc.getMesh() = std::move( stlReader.readFacets().getMesh() );
+                session.upload();
+
+                // a split mesh never gets a full edge list, so it is not
+                // cached; an out-of-core one gets it on the host for the cache
+                if ( !session.isMultiDevice() )
+                {
+                    if ( !sc.getMesh().hasEdges() ) sc.getMesh().buildHostEdges();
+
+                    MeshCache::store( fileName, sc.getMesh() );
+                }
+            }
+            else
+            {
+                // stream facets, drawing what has arrived as it does
+                unsigned int paintedFacets = 0;
+                auto lastPaintTime = std::chrono::steady_clock::now();
+
+                stlReader.streamFacets( sc, [&]( unsigned int facetsRead )
+                {
+                    unsigned int deviceFacets = sc.getMesh().getDeviceFacetCount();
+                    auto now = std::chrono::steady_clock::now();
+
+                    // paint as soon as anything lands, then at a steady rate
+                    if ( deviceFacets == paintedFacets ) return;
+                    if ( ( paintedFacets > 0 ) && ( now - lastPaintTime < PROGRESSIVE_PAINT_INTERVAL ) ) return;
+
+                    // frame the first facets, so the rest arrive in view
+                    if ( paintedFacets == 0 )
+                    {
+                        float boundsMin[Mesh::COORD_DIM];
+                        float boundsMax[Mesh::COORD_DIM];
+                        sc.getMesh().getBounds( boundsMin, boundsMax );
+
+                        r.fitView( boundsMin, boundsMax );
+                    }
+
+                    r.drawLatest();
+
+                    paintedFacets = deviceFacets;
+                    lastPaintTime = now;
+                } );
+
+                // the edge list is built when the stream ends, so cache after it
+                MeshCache::store( fileName, sc.getMesh() );
+            }
+        }
+
+        // frame and paint the finished mesh
+        float boundsMin[Mesh::COORD_DIM];
+        float boundsMax[Mesh::COORD_DIM];
+        sc.getMesh().getBounds( boundsMin, boundsMax );
+
+        r.fitView( boundsMin, boundsMax );
+        r.drawLatest();
+
+        // simplified levels are only drawn while the view moves, build them last
+        session.buildLevelsOfDetail();
+    } );
+}
+
+
+/**
+ * @brief   Imports a drawing from file as a new model, placed to the right of
+ *          the last one, and selects it
+ *
+ * @param   *gc     The graphics context to draw to
+ *
+ * @return  void
+ */
+void DrawContext::fileImport( GraphicsContext *gc )
+{
+    // get file name
+    std::cout << "IMPORT FILE: ";
+    std::string fileName;
+    std::cin >> fileName;
+
+    selectedModel = modelCount++;
+
+    // load on the render thread, which owns the device buffers
+    renderer.post( [fileName]( RenderThread &r )
+    {
+        RenderSession &session = r.getSession();
+        Scene &scene = session.getScene();
+
+        // a model that fails to load stays empty, so the event thread's
+        // indices still match
+        unsigned int model = scene.addModel( fileName );
+        ShapeContainer &sc = scene.getModel( model ).getShapes();
+
+        // the whole mesh is needed to place it, so it is never streamed
+        bool cached = MeshCache::load( fileName, sc.getMesh() );
+
+        if ( !cached )
+        {
+            STLReader stlReader = STLReader( fileName );
+            sc.getMesh() = std::move( stlReader.readFacets().getMesh() );
+        }
+
+        session.uploadModel( model );
+
+        // the edge list is built by the upload, so cache after it
+        if ( !cached ) MeshCache::store( fileName, sc.getMesh() );
+
+        // an empty model, like one that failed to load, has nothing to line up with
+        const SceneModel &previous = scene.getModel( model - 1 );
+
+        if ( ( previous.getShapes().getMesh().getVertexCount() > 0 ) && ( sc.getMesh().getVertexCount() > 0 ) )
+        {
+            float previousMin[Mesh::COORD_DIM];
+            float previousMax[Mesh::COORD_DIM];
+            previous.getShapes().getMesh().getBounds( previousMin, previousMax );
+
+            float boundsMin[Mesh::COORD_DIM];
+            float boundsMax[Mesh::COORD_DIM];
+            sc.getMesh().getBounds( boundsMin, boundsMax );
+
+            // line the model up with the last one, a step clear of it along x
+            float gap = MODEL_STEP * ( boundsMax[0] - boundsMin[0] );
+            float offset[Mesh::COORD_DIM];
+
+            offset[0] = previous.getTransform()[0][3] + previousMax[0] + gap - boundsMin[0];
+
+            for ( unsigned int i = 1; i < Mesh::COORD_DIM; i++ )
+            {
+                offset[i] = previous.getTransform()[i][3] + previousMin[i] - boundsMin[i];
+            }
+
+            scene.getModel( model ).setTransform( Mat4f::translation( offset[0], offset[1], offset[2] ) );
+        }
+
+        std::cout << "MODEL " << model << ": " << fileName << std::endl;
+
+        // paint the imported mesh
+        r.drawLatest();
+
+        // simplified levels are only drawn while the view moves, build them last
+        sc.buildLevelsOfDetail();
+    } );
+}
+
+
+/**
+ * @brief   Selects the next model of the scene, wrapping around to the
+ *          opened one
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void DrawContext::selectNextModel()
+{
+    selectedModel = ( selectedModel + 1 ) % modelCount;
+    std::cout << "MODEL SELECTED: " << selectedModel << std::endl;
+}
+
+
+/**
+ * @brief   Hides the selected model, or shows it again if it is hidden
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void DrawContext::toggleModelVisibility()
+{
+    unsigned int model = selectedModel;
+
+    renderer.post( [model]( RenderThread &r )
+    {
+        Scene &scene = r.getSession().getScene();
+        if ( model >= scene.getModelCount() ) return;
+
+        SceneModel &sceneModel = scene.getModel( model );
+        sceneModel.setVisible( !sceneModel.isVisible() );
+
+        std::cout << "MODEL " << model << ": " << ( sceneModel.isVisible() ? "SHOWN" : "HIDDEN" ) << std::endl;
+    } );
+}
+
+
+/**
+ * @brief   Moves the selected model by a step of its size along an axis
+ *
+ * The opened model stays where it is, so facets are picked where they are
+ * drawn.
+ *
+ * @param   axis        The axis to move along, 0 for x and 1 for y
+ * @param   direction   1 to move along the axis, -1 to move back
+ *
+ * @return  void
+ */
+void DrawContext::moveModel( unsigned int axis, float direction )
+{
+    if ( selectedModel == 0 ) return;
+
+    unsigned int model = selectedModel;
+
+    renderer.post( [model, axis, direction]( RenderThread &r )
+    {
+        Scene &scene = r.getSession().getScene();
+        if ( model >= scene.getModelCount() ) return;
+
+        SceneModel &sceneModel = scene.getModel( model );
+
+        float boundsMin[Mesh::COORD_DIM];
+        float boundsMax[Mesh::COORD_DIM];
+        sceneModel.getShapes().getMesh().getBounds( boundsMin, boundsMax );
+
+        float extent = 0;
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+        {
+            extent = std::max( extent, boundsMax[i] - boundsMin[i] );
+        }
+
+        float step[Mesh::COORD_DIM] = { 0, 0, 0 };
+        step[axis] = direction * MODEL_STEP * extent;
+
+        // only this model is transformed again on the next frame
+        sceneModel.setTransform(
+            Mat4f::translation( step[0], step[1], step[2] ) * sceneModel.getTransform()
+        );
+    } );
 }
 
 
-/* -------------------------------------------------------------------------- */
\ No newline at end of file
+/* -------------------------------------------------------------------------- */
@@ -17,12 +17,13 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include <chrono>
 # include <vector>
 
 # include "color.h"
 # include "drawbase.h"
 # include "point2d.h"
-# include "shapecontainer.h"
+# include "renderthread.h"
 # include "viewcontext.h"
 #include "drawcontext.h"
 
@@ -51,8 +52,15 @@ public:
     static constexpr unsigned int KEY_CODE_9 = 57;
 
     static constexpr unsigned int KEY_CODE_A = 97;
+    static constexpr unsigned int KEY_CODE_B = 98;
     static constexpr unsigned int KEY_CODE_C = 99;
+    static constexpr unsigned int KEY_CODE_D = 100;
+    static constexpr unsigned int KEY_CODE_H = 104;
+    static constexpr unsigned int KEY_CODE_I = 105;
+    static constexpr unsigned int KEY_CODE_L = 108;
+    static constexpr unsigned int KEY_CODE_N = 110;
     static constexpr unsigned int KEY_CODE_O = 111;
+    static constexpr unsigned int KEY_CODE_P = 112;
     static constexpr unsigned int KEY_CODE_R = 114;
     static constexpr unsigned int KEY_CODE_S = 115;
     static constexpr unsigned int KEY_CODE_X = 120;
@@ -94,6 +102,9 @@ public:
     void mouseButtonUp( GraphicsContext *gc, unsigned int button, int x, int y ) override;
     void mouseMove( GraphicsContext *gc, int x, int y ) override;
 
+    int getFrameFd() override;
+    void frameReady( GraphicsContext *gc ) override;
+
 
     /* ============================== PROTECTED ============================= */
 
@@ -108,11 +119,22 @@ private:
 
     Color drawColor = Color( 0, 0, 0 );
 
-    ShapeContainer sc = ShapeContainer();
+    RenderThread renderer;
 
     ViewContext *vc;
 
     bool drawAxis = true;
+    bool backFaceCulling = false;
+    bool hiddenLines = false;
+    bool depthCueing = false;
+    bool interactive = false;
+    bool shiftHeld = false;
+
+    // mirrors the scene on the render thread, model 0 is the opened file
+    unsigned int modelCount = 1;
+    unsigned int selectedModel = 0;
+
+    std::chrono::steady_clock::time_point lastProfileReport = std::chrono::steady_clock::time_point();
 
     bool panActive = false;
     bool orbitActive = false;
@@ -128,9 +150,17 @@ private:
 
     void setDrawColor( GraphicsContext *gc, const Color &c );
 
+    void requestFrame( GraphicsContext *gc );
+    void showFrame( GraphicsContext *gc );
+
     void draw3DAxis( GraphicsContext *gc );
 
     void fileOpen( GraphicsContext *gc );
+    void fileImport( GraphicsContext *gc );
+
+    void selectNextModel();
+    void toggleModelVisibility();
+    void moveModel( unsigned int axis, float direction );
 
 
     /* ====================================================================== */
@@ -23,4 +23,33 @@ void GraphicsContext::endLoop()
 	run = false;
 }
 
+/*
+ * Naive image blit - one setPixel per pixel
+ */
+void GraphicsContext::drawImage(const unsigned int *pixels, int width, int height)
+{
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			setColor(pixels[y * width + x]);
+			setPixel(x, y);
+		}
+	}
+}
+
+/*
+ * No back buffer by default
+ */
+unsigned int *GraphicsContext::getBackBuffer()
+{
+	return NULL;
+}
 
+/*
+ * Nothing is batched by default
+ */
+void GraphicsContext::present()
+{
+	// nothing to do
+}
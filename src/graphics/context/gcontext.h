@@ -89,6 +89,27 @@ class GraphicsContext
 		// This should reset entire context to the current background
 		virtual void clear() = 0;
 
+		// Get the 24-bit RGB background color of the context
+		virtual unsigned int getBackgroundColor() = 0;
+
+		// Copy a whole row-major frame of 24-bit RGB pixels to the
+		// context, starting at the top-left corner.  A naive version
+		// that relies on setPixel is provided, but contexts should
+		// override it with a single blit.
+		virtual void drawImage(const unsigned int *pixels, int width, int height);
+
+		// Contexts that batch a whole frame of pixels before showing
+		// it return their back buffer here - getWindowWidth() by
+		// getWindowHeight() row-major 24-bit RGB pixels that may be
+		// written directly.  The default has no back buffer and
+		// returns NULL.
+		virtual unsigned int *getBackBuffer();
+
+		// Push everything drawn since the last present to the screen.
+		// Drawing operations are not guaranteed to be visible until
+		// this is called.  The default does nothing.
+		virtual void present();
+
 		// These are the naive implementations that use setPixel,
 		// but are overridable should a context have a better-
 		// performing version available.
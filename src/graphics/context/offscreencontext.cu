@@ -0,0 +1,217 @@
+/* Provides a drawing context without a window, rendering into memory.
+ * Nothing here needs an X display, so it works on headless machines.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "drawbase.h"
+#include "offscreencontext.h"
+
+
+/**
+ * The only constructor provided.  Allows size of framebuffer and
+ * background color be specified.
+ * */
+OffscreenContext::OffscreenContext(unsigned int sizex,unsigned int sizey,
+						unsigned int bg_color)
+{
+	background_color = bg_color;
+	width = sizex;
+	height = sizey;
+	draw_color = OffscreenContext::WHITE;
+	draw_mode = OffscreenContext::MODE_NORMAL;
+
+	pixels.assign((size_t) width * height, background_color);
+}
+
+
+// Destructor - the framebuffer frees itself
+OffscreenContext::~OffscreenContext()
+{
+}
+
+
+// Set the drawing mode - argument is enumerated
+void OffscreenContext::setMode(drawMode newMode)
+{
+	draw_mode = newMode;
+}
+
+
+// Set drawing color - 24 bit RGB
+void OffscreenContext::setColor(unsigned int color)
+{
+	draw_color = color;
+}
+
+
+// Set a pixel in the current color
+void OffscreenContext::setPixel(int x, int y)
+{
+	plot(x, y);
+}
+
+
+// Get the color of a pixel
+unsigned int OffscreenContext::getPixel(int x, int y)
+{
+	if (x < 0 || y < 0 || x >= width || y >= height)
+		return 0;
+	return pixels[y * width + x] & 0xFFFFFF;
+}
+
+
+// Draw a line in the current color
+void OffscreenContext::drawLine(int x1, int y1, int x2, int y2)
+{
+	// Bresenham into the framebuffer
+	int dx = abs(x2 - x1);
+	int dy = -abs(y2 - y1);
+	int sx = (x1 < x2) ? 1 : -1;
+	int sy = (y1 < y2) ? 1 : -1;
+	int err = dx + dy;
+
+	for (;;)
+	{
+		plot(x1, y1);
+
+		if (x1 == x2 && y1 == y2)
+			break;
+
+		int err2 = 2 * err;
+
+		if (err2 >= dy)
+		{
+			err += dy;
+			x1 += sx;
+		}
+
+		if (err2 <= dx)
+		{
+			err += dx;
+			y1 += sy;
+		}
+	}
+}
+
+
+// Draw a circle in the current color
+void OffscreenContext::drawCircle(int x, int y, int radius)
+{
+	// midpoint circle into the framebuffer
+	int cx = radius;
+	int cy = 0;
+	int err = 1 - radius;
+
+	while (cx >= cy)
+	{
+		plot(x + cx, y + cy);
+		plot(x + cy, y + cx);
+		plot(x - cy, y + cx);
+		plot(x - cx, y + cy);
+		plot(x - cx, y - cy);
+		plot(x - cy, y - cx);
+		plot(x + cy, y - cx);
+		plot(x + cx, y - cy);
+
+		cy++;
+
+		if (err < 0)
+		{
+			err += 2 * cy + 1;
+		}
+		else
+		{
+			cx--;
+			err += 2 * (cy - cx) + 1;
+		}
+	}
+}
+
+
+// Clear graphics context
+void OffscreenContext::clear()
+{
+	std::fill(pixels.begin(), pixels.end(), background_color);
+}
+
+
+// Get the background color the context was created with
+unsigned int OffscreenContext::getBackgroundColor()
+{
+	return background_color;
+}
+
+
+// Copy a whole frame of pixels into the framebuffer
+void OffscreenContext::drawImage(const unsigned int *image, int image_width, int image_height)
+{
+	int rows = (image_height < height) ? image_height : height;
+	int cols = (image_width < width) ? image_width : width;
+
+	for (int y = 0; y < rows; y++)
+		memcpy(pixels.data() + y * width, image + y * image_width,
+				cols * sizeof(unsigned int));
+}
+
+
+// The framebuffer is the back buffer
+unsigned int *OffscreenContext::getBackBuffer()
+{
+	return pixels.data();
+}
+
+
+// There are no events to wait for - paint once and return
+void OffscreenContext::runLoop(DrawingBase* drawing)
+{
+	run = true;
+	drawing->paint(this);
+	run = false;
+}
+
+
+// Get the width of the framebuffer
+int OffscreenContext::getWindowWidth()
+{
+	return width;
+}
+
+
+// Get the height of the framebuffer
+int OffscreenContext::getWindowHeight()
+{
+	return height;
+}
+
+
+// Get the framebuffer - getWindowWidth() by getWindowHeight() row-major
+// 24-bit RGB pixels
+const unsigned int *OffscreenContext::getPixels()
+{
+	return pixels.data();
+}
+
+
+// Change the size of the framebuffer, clearing it
+void OffscreenContext::resize(unsigned int sizex, unsigned int sizey)
+{
+	width = sizex;
+	height = sizey;
+	pixels.assign((size_t) width * height, background_color);
+}
+
+
+// Write one pixel of the framebuffer in the current color and mode
+void OffscreenContext::plot(int x, int y)
+{
+	if (x < 0 || y < 0 || x >= width || y >= height)
+		return;
+
+	if (draw_mode == OffscreenContext::MODE_XOR)
+		pixels[y * width + x] ^= draw_color;
+	else
+		pixels[y * width + x] = draw_color;
+}
@@ -0,0 +1,60 @@
+#ifndef OFFSCREEN_CONTEXT
+#define OFFSCREEN_CONTEXT
+/**
+ * A GraphicsContext with no window, for rendering without an X display.
+ *
+ * Everything is drawn into a framebuffer in memory, which is also the
+ * back buffer, so the rasterizer copies finished frames straight into it
+ * from the device.  There are no events - runLoop paints the drawing
+ * once and returns - and the framebuffer can be read back or resized
+ * between frames.
+ * */
+
+#include <vector>
+#include "gcontext.h"	// base class
+
+class OffscreenContext : public GraphicsContext
+{
+	public:
+		// Default Constructor
+		OffscreenContext(unsigned int sizex,unsigned int sizey,unsigned int bg_color);
+
+		// Destructor
+		virtual ~OffscreenContext();
+
+		// Drawing Operations
+		void setMode(drawMode newMode);
+		void setColor(unsigned int color);
+		void setPixel(int x, int y);
+		unsigned int getPixel(int x, int y);
+		void drawLine(int x1, int y1, int x2, int y2);
+		void drawCircle(int x, int y, int radius);
+		void clear();
+		unsigned int getBackgroundColor();
+		void drawImage(const unsigned int *pixels, int width, int height);
+		unsigned int *getBackBuffer();
+
+		// Event loop functions - paints once, there are no events
+		void runLoop(DrawingBase* drawing);
+
+		// Utility functions
+		int getWindowWidth();
+		int getWindowHeight();
+
+		// framebuffer access for writing images
+		const unsigned int *getPixels();
+		void resize(unsigned int sizex, unsigned int sizey);
+
+	private:
+		int width;
+		int height;
+		unsigned int background_color;
+
+		std::vector<unsigned int> pixels;
+		unsigned int draw_color;
+		drawMode draw_mode;
+
+		void plot(int x, int y);
+};
+
+#endif
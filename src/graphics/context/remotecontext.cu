@@ -0,0 +1,256 @@
+/* Provides a drawing context without a window that streams its frames to a
+ * remote viewer, and takes its events from the viewer in turn.
+ */
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include "drawbase.h"
+#include "remotecontext.h"
+
+
+// Shrink a framebuffer size, keeping its shape, until its frames fit in
+// one message whatever they hold
+static void fitFrameSize(int &width, int &height)
+{
+	int largest = std::max(width, height);
+
+	if (largest > (int) FrameDecoder::MAX_FRAME_DIMENSION)
+	{
+		double scale = (double) FrameDecoder::MAX_FRAME_DIMENSION / largest;
+		width = std::max(1, (int) (width * scale));
+		height = std::max(1, (int) (height * scale));
+	}
+
+	while (FrameEncoder::getMaxSize(width, height) > RemoteLink::MAX_FRAME_SIZE)
+	{
+		double scale = sqrt((double) RemoteLink::MAX_FRAME_SIZE /
+			FrameEncoder::getMaxSize(width, height));
+		width = std::max(1, (int) (width * scale));
+		height = std::max(1, (int) (height * scale));
+	}
+}
+
+
+/**
+ * The only constructor provided.  Allows the port, the size of the
+ * framebuffer and the background color to be specified.
+ * */
+RemoteContext::RemoteContext(unsigned short port,unsigned int sizex,
+						unsigned int sizey,unsigned int bg_color) :
+	OffscreenContext(sizex, sizey, bg_color)
+{
+	int width = getWindowWidth();
+	int height = getWindowHeight();
+
+	fitFrameSize(width, height);
+
+	if (width != getWindowWidth() || height != getWindowHeight())
+		resize(width, height);
+
+	listen_fd = RemoteLink::listen(port);
+	next_sequence = 0;
+	frames_in_flight = 0;
+	frame_pending = false;
+}
+
+
+// Destructor - closes the viewer's link and stops listening
+RemoteContext::~RemoteContext()
+{
+	link.close();
+	close(listen_fd);
+}
+
+
+// Send the framebuffer, or keep it for when the viewer catches up
+void RemoteContext::present()
+{
+	if (!link.isOpen())
+		return;
+
+	if (frames_in_flight >= MAX_FRAMES_IN_FLIGHT)
+	{
+		frame_pending = true;
+		return;
+	}
+
+	sendFrame();
+}
+
+
+// Wait on the listening socket or the viewer and on the drawing's frames,
+// until endLoop is called
+void RemoteContext::runLoop(DrawingBase* drawing)
+{
+	run = true;
+
+	drawing->paint(this);
+
+	while (run)
+	{
+		int frame_fd = drawing->getFrameFd();
+
+		// only one viewer at a time, the next one waits to be accepted
+		int fd = link.isOpen() ? link.getFd() : listen_fd;
+
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+
+		if (frame_fd >= 0)
+			FD_SET(frame_fd, &fds);
+
+		int max_fd = (frame_fd > fd) ? frame_fd : fd;
+
+		if (select(max_fd + 1, &fds, NULL, NULL, NULL) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		bool connected = link.isOpen();
+
+		if (frame_fd >= 0 && FD_ISSET(frame_fd, &fds))
+			drawing->frameReady(this);
+
+		if (FD_ISSET(fd, &fds))
+		{
+			if (fd == listen_fd)
+				acceptViewer(drawing);
+			else
+			{
+				RemoteLink::Message m;
+
+				while (run && link.receive(m))
+					handleMessage(drawing, m);
+			}
+		}
+
+		// sending a frame or reading from the viewer can find it gone
+		if (connected && !link.isOpen())
+			std::cout << "VIEWER DISCONNECTED" << std::endl;
+	}
+}
+
+
+// true while a viewer is connected
+bool RemoteContext::isConnected()
+{
+	return link.isOpen();
+}
+
+
+// Take the next viewer and start it off with a key frame
+void RemoteContext::acceptViewer(DrawingBase *drawing)
+{
+	link = RemoteLink::accept(listen_fd);
+
+	if (!link.isOpen())
+		return;
+
+	encoder.reset();
+	next_sequence = 0;
+	frames_in_flight = 0;
+	frame_pending = false;
+
+	std::cout << "VIEWER CONNECTED" << std::endl;
+
+	drawing->paint(this);
+}
+
+
+// Pass one message from the viewer on to the drawing
+void RemoteContext::handleMessage(DrawingBase *drawing, const RemoteLink::Message &m)
+{
+	// Frame shown - make room for the next, and send the newest if one
+	// has been waiting
+	if (m.type == RemoteLink::MESSAGE_ACK)
+	{
+		if (frames_in_flight > 0)
+			frames_in_flight--;
+
+		if (frame_pending)
+			sendFrame();
+	}
+
+	// Resize - the framebuffer takes the size of the viewer's window
+	else if (m.type == RemoteLink::MESSAGE_RESIZE)
+	{
+		int width = RemoteLink::getValue(m, 0);
+		int height = RemoteLink::getValue(m, 1);
+
+		if (width < 1 || height < 1)
+			return;
+
+		// a window larger than a frame can be gets a smaller frame, which
+		// the viewer shows in its corner
+		fitFrameSize(width, height);
+
+		if (width == getWindowWidth() && height == getWindowHeight())
+			return;
+
+		resize(width, height);
+		drawing->paint(this);
+	}
+
+	// Key Down
+	else if (m.type == RemoteLink::MESSAGE_KEY_DOWN)
+		drawing->keyDown(this, RemoteLink::getValue(m, 0));
+
+	// Key Up
+	else if (m.type == RemoteLink::MESSAGE_KEY_UP)
+		drawing->keyUp(this, RemoteLink::getValue(m, 0));
+
+	// Mouse Button Down
+	else if (m.type == RemoteLink::MESSAGE_BUTTON_DOWN)
+		drawing->mouseButtonDown(this,
+		RemoteLink::getValue(m, 0),
+		(int) RemoteLink::getValue(m, 1),
+		(int) RemoteLink::getValue(m, 2));
+
+	// Mouse Button Up
+	else if (m.type == RemoteLink::MESSAGE_BUTTON_UP)
+		drawing->mouseButtonUp(this,
+		RemoteLink::getValue(m, 0),
+		(int) RemoteLink::getValue(m, 1),
+		(int) RemoteLink::getValue(m, 2));
+
+	// Mouse Move
+	else if (m.type == RemoteLink::MESSAGE_MOTION)
+		drawing->mouseMove(this,
+		(int) RemoteLink::getValue(m, 0),
+		(int) RemoteLink::getValue(m, 1));
+}
+
+
+// Encode the framebuffer against the last frame sent and send it, unless
+// nothing changed
+void RemoteContext::sendFrame()
+{
+	frame_pending = false;
+
+	if (!encoder.encode(getPixels(), getWindowWidth(), getWindowHeight(), frame_data))
+		return;
+
+	// the sequence number goes first, for the viewer to ack
+	uint32_t sequence = htonl(next_sequence);
+
+	message.resize(sizeof(sequence) + frame_data.size());
+	memcpy(message.data(), &sequence, sizeof(sequence));
+	memcpy(message.data() + sizeof(sequence), frame_data.data(), frame_data.size());
+
+	if (!link.send(RemoteLink::MESSAGE_FRAME, message.data(), message.size()))
+		return;
+
+	next_sequence++;
+	frames_in_flight++;
+}
@@ -0,0 +1,68 @@
+#ifndef REMOTE_CONTEXT
+#define REMOTE_CONTEXT
+/**
+ * A GraphicsContext with no window, that streams its frames to a remote
+ * viewer over TCP instead, for rendering on a headless GPU server.
+ *
+ * Everything is drawn into a framebuffer in memory, exactly like the
+ * offscreen context.  present() encodes the framebuffer as the tiles that
+ * changed since the last frame sent, so the bandwidth follows how many
+ * pixels changed and not how many lines were drawn, and a frame in which
+ * nothing changed is not sent at all.  The window size is the viewer's,
+ * and the key and mouse events the viewer sends back are handed on to
+ * the drawing as if they came from a window.
+ *
+ * Latency is bounded by acknowledgements: the viewer acks every frame it
+ * shows, and no more than MAX_FRAMES_IN_FLIGHT frames are ever unacked.
+ * Frames finished while the window is full are not queued - only the
+ * newest one is sent, as soon as an ack makes room - so a slow link drops
+ * frames instead of falling behind.
+ *
+ * One viewer is served at a time; others wait until it disconnects.
+ * */
+
+#include <vector>
+#include "framecodec.h"
+#include "offscreencontext.h"	// base class
+#include "remotelink.h"
+
+class RemoteContext : public OffscreenContext
+{
+	public:
+		// Listens for a viewer on a port, with the size of the framebuffer
+		// until a viewer says how large its window is
+		RemoteContext(unsigned short port,unsigned int sizex,unsigned int sizey,unsigned int bg_color);
+
+		// Destructor
+		virtual ~RemoteContext();
+
+		// Sends the framebuffer to the viewer
+		void present();
+
+		// Event loop functions - runs until endLoop, serving one viewer
+		// after another
+		void runLoop(DrawingBase* drawing);
+
+		// true while a viewer is connected
+		bool isConnected();
+
+	private:
+		static const unsigned int MAX_FRAMES_IN_FLIGHT = 2;
+
+		int listen_fd;
+		RemoteLink link;
+
+		FrameEncoder encoder;
+		std::vector<unsigned char> frame_data;
+		std::vector<unsigned char> message;
+
+		unsigned int next_sequence;
+		unsigned int frames_in_flight;
+		bool frame_pending;
+
+		void acceptViewer(DrawingBase *drawing);
+		void handleMessage(DrawingBase *drawing, const RemoteLink::Message &m);
+		void sendFrame();
+};
+
+#endif
@@ -0,0 +1,183 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    remoteviewer.cpp
+ * @brief   Thin client that shows the frames of a remote render server
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <iostream>
+
+# include "gcontext.h"
+# include "remoteviewer.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+RemoteViewer::RemoteViewer( const std::string &host, unsigned short port ) :
+    link( RemoteLink::connect( host, port ) ),
+    decoder( RemoteLink::MAX_FRAME_SIZE )
+{
+
+}
+
+
+RemoteViewer::~RemoteViewer() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+void RemoteViewer::paint( GraphicsContext *gc )
+{
+    // the server redraws at the new size, until then show the last frame
+    sendWindowSize( gc );
+    showFrame( gc );
+}
+
+
+void RemoteViewer::keyDown( GraphicsContext *gc, unsigned int keycode )
+{
+    link.send( RemoteLink::MESSAGE_KEY_DOWN, { keycode } );
+    checkLink( gc );
+}
+
+
+void RemoteViewer::keyUp( GraphicsContext *gc, unsigned int keycode )
+{
+    link.send( RemoteLink::MESSAGE_KEY_UP, { keycode } );
+    checkLink( gc );
+}
+
+
+void RemoteViewer::mouseButtonDown( GraphicsContext *gc, unsigned int button, int x, int y )
+{
+    link.send( RemoteLink::MESSAGE_BUTTON_DOWN, { button, ( uint32_t ) x, ( uint32_t ) y } );
+    checkLink( gc );
+}
+
+
+void RemoteViewer::mouseButtonUp( GraphicsContext *gc, unsigned int button, int x, int y )
+{
+    link.send( RemoteLink::MESSAGE_BUTTON_UP, { button, ( uint32_t ) x, ( uint32_t ) y } );
+    checkLink( gc );
+}
+
+
+void RemoteViewer::mouseMove( GraphicsContext *gc, int x, int y )
+{
+    link.send( RemoteLink::MESSAGE_MOTION, { ( uint32_t ) x, ( uint32_t ) y } );
+    checkLink( gc );
+}
+
+
+int RemoteViewer::getFrameFd()
+{
+    return link.getFd();
+}
+
+
+void RemoteViewer::frameReady( GraphicsContext *gc )
+{
+    RemoteLink::Message m;
+    std::vector<uint32_t> sequences;
+
+    // decode every frame that has arrived, but only show the newest
+    while ( link.receive( m ) )
+    {
+        if ( m.type != RemoteLink::MESSAGE_FRAME ) continue;
+
+        sequences.push_back( RemoteLink::getValue( m, 0 ) );
+
+        try
+        {
+            if ( m.payload.size() < sizeof( uint32_t ) ) throw FrameCodecException( "Frame without a sequence number" );
+
+            decoder.decode( m.payload.data() + sizeof( uint32_t ), m.payload.size() - sizeof( uint32_t ) );
+        }
+        catch ( const FrameCodecException &e )
+        {
+            std::cerr << e.what() << std::endl;
+            link.close();
+            break;
+        }
+    }
+
+    if ( !sequences.empty() && link.isOpen() )
+    {
+        showFrame( gc );
+
+        for ( uint32_t sequence : sequences ) link.send( RemoteLink::MESSAGE_ACK, { sequence } );
+    }
+
+    // a window made smaller is not exposed, so check its size here too
+    sendWindowSize( gc );
+
+    checkLink( gc );
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Tells the server the size of the window, if it changed since it
+ *          was last told
+ *
+ * @param   *gc     The graphics context of the window
+ *
+ * @return  void
+ */
+void RemoteViewer::sendWindowSize( GraphicsContext *gc )
+{
+    int width = gc->getWindowWidth();
+    int height = gc->getWindowHeight();
+
+    if ( ( width == sentWidth ) && ( height == sentHeight ) ) return;
+
+    if ( link.send( RemoteLink::MESSAGE_RESIZE, { ( uint32_t ) width, ( uint32_t ) height } ) )
+    {
+        sentWidth = width;
+        sentHeight = height;
+    }
+}
+
+
+/**
+ * @brief   Shows the last frame decoded, if there is one
+ *
+ * @param   *gc     The graphics context to show the frame on
+ *
+ * @return  void
+ */
+void RemoteViewer::showFrame( GraphicsContext *gc )
+{
+    if ( ( decoder.getWidth() == 0 ) || ( decoder.getHeight() == 0 ) ) return;
+
+    gc->drawImage( decoder.getPixels(), decoder.getWidth(), decoder.getHeight() );
+    gc->present();
+}
+
+
+/**
+ * @brief   Ends the viewer's event loop once the server is gone
+ *
+ * @param   *gc     The graphics context of the window
+ *
+ * @return  void
+ */
+void RemoteViewer::checkLink( GraphicsContext *gc )
+{
+    if ( link.isOpen() ) return;
+
+    std::cout << "SERVER DISCONNECTED" << std::endl;
+    gc->endLoop();
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,99 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    remoteviewer.h
+ * @brief   Thin client that shows the frames of a remote render server
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_CONTEXT_REMOTEVIEWER_H
+# define GRAPHICS_CONTEXT_REMOTEVIEWER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <string>
+
+# include "drawbase.h"
+# include "framecodec.h"
+# include "remotelink.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A remote viewer draws nothing itself. Every key and mouse event of its
+ * window goes to the render server, which handles it as a draw context
+ * would, and every frame the server sends is decoded onto the last one
+ * and shown as soon as it arrives, then acked so the server sends more.
+ * The window is waited on together with the link, so frames are shown
+ * between events. The server's framebuffer follows the size of the window.
+ */
+class RemoteViewer : public DrawingBase
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    RemoteViewer( const std::string &host, unsigned short port );
+    ~RemoteViewer() override;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void paint( GraphicsContext *gc ) override;
+    void keyDown( GraphicsContext *gc, unsigned int keycode ) override;
+    void keyUp( GraphicsContext *gc, unsigned int keycode ) override;
+    void mouseButtonDown( GraphicsContext *gc, unsigned int button, int x, int y ) override;
+    void mouseButtonUp( GraphicsContext *gc, unsigned int button, int x, int y ) override;
+    void mouseMove( GraphicsContext *gc, int x, int y ) override;
+
+    int getFrameFd() override;
+    void frameReady( GraphicsContext *gc ) override;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    RemoteLink link;
+
+    FrameDecoder decoder;
+
+    // the window size the server was last told
+    int sentWidth = 0;
+    int sentHeight = 0;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void sendWindowSize( GraphicsContext *gc );
+    void showFrame( GraphicsContext *gc );
+    void checkLink( GraphicsContext *gc );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_CONTEXT_REMOTEVIEWER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -10,18 +10,12 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include <algorithm>
 # include <cmath>
 
 # include "cudaerr.cuh"
 # include "viewcontext.h"
 
-/* ---------------------------- Static Variables ---------------------------- */
-
-
-float * ViewContext::d_viewTransform = nullptr;
-Matrix<float> ViewContext::transform = Matrix<float>(4, 4);
-Matrix<float> ViewContext::invTransform = Matrix<float>(4, 4);
-
 
 /* ----------------------- Constructors / Destructors ----------------------- */
 
@@ -36,10 +30,22 @@ Matrix<float> ViewContext::invTransform = Matrix<float>(4, 4);
 ViewContext::ViewContext( GraphicsContext *gc ) :
     gc( gc )
 {
-    HANDLE_CUDA_ERROR(
-        cudaMalloc(&d_viewTransform, 4 * 4 * sizeof(float))
-    );
+    update();
+}
+
 
+/**
+ * @brief   Creates a view context object that is not paired with a graphics
+ *          context, for drawing off the window's thread
+ *
+ * @param   width   The width of the window in pixels
+ * @param   height  The height of the window in pixels
+ *
+ * @return  The created view context
+ */
+ViewContext::ViewContext( int width, int height ) :
+    gc( nullptr ), windowWidth( width ), windowHeight( height )
+{
     update();
 }
 
@@ -65,7 +71,7 @@ ViewContext::~ViewContext() = default;
  *
  * @return  The transformed 3D device point
  */
-Point3D ViewContext::modelToDevice( const Point3D &p )
+Point3D ViewContext::modelToDevice( const Point3D &p ) const
 {
     return p.transform( transform );
 }
@@ -79,7 +85,7 @@ Point3D ViewContext::modelToDevice( const Point3D &p )
  *
  * @return  The transformed 3D model point
  */
-Point3D ViewContext::deviceToModel( const Point3D &p )
+Point3D ViewContext::deviceToModel( const Point3D &p ) const
 {
     return p.transform( invTransform );
 }
@@ -92,10 +98,12 @@ Point3D ViewContext::deviceToModel( const Point3D &p )
  *
  * @return  A unit vector pointing in direction of the view plane's look direction
  */
-Point3D ViewContext::getLookVector()
+Point3D ViewContext::getLookVector() const
 {
-    Point3D lookVector = Point3D( 0, 0, 1 );
-    return lookVector.transform( genInvViewRotationMatrix() );
+    Mat4f rotation = genViewRotationMatrix();
+
+    // the inverse rotation is the transpose, so +z maps to the third row
+    return Point3D( rotation[2][0], rotation[2][1], rotation[2][2] );
 }
 
 
@@ -350,30 +358,174 @@ void ViewContext::resetView()
 }
 
 
+/**
+ * @brief   Centers the view on a bounding box and scales it so the box fills
+ *          the window from any rotation
+ *
+ * The translation is applied before the rotation, so the model spins about
+ * the center of the box. An empty box resets the translation and scale, a
+ * box of a single point only centers on it.
+ *
+ * @param   *boundsMin  The smallest coordinates of the box
+ * @param   *boundsMax  The largest coordinates of the box
+ * @param   fill        The share of the smaller window side the bounding
+ *                      sphere of the box fills
+ *
+ * @return  void
+ */
+void ViewContext::frameBounds( const float *boundsMin, const float *boundsMax, float fill )
+{
+    // every axis of an empty box is inverted
+    if ( boundsMin[0] > boundsMax[0] )
+    {
+        resetTranslation();
+        resetScale();
+        return;
+    }
+
+    setTranslation(
+        -( boundsMin[0] + boundsMax[0] ) / 2,
+        -( boundsMin[1] + boundsMax[1] ) / 2,
+        -( boundsMin[2] + boundsMax[2] ) / 2
+    );
+
+    // in double, so the extents of huge coordinates cannot overflow
+    double diameter = 0;
+
+    for ( unsigned int i = 0; i < 3; i++ )
+    {
+        double extent = ( double ) boundsMax[i] - boundsMin[i];
+        diameter += extent * extent;
+    }
+
+    diameter = std::sqrt( diameter );
+
+    // the window size comes from the graphics context, if there is one
+    updateWindow();
+
+    if ( ( diameter > 0 ) && ( windowWidth > 0 ) && ( windowHeight > 0 ) )
+    {
+        float scale = fill * std::min( windowWidth, windowHeight ) / diameter;
+        setScale( scale, scale, scale );
+    }
+    else
+    {
+        resetScale();
+    }
+}
+
+
 /**
  * @brief   Updates the view context's transformation matrices
  *
+ * The matrices are composed on the stack and assigned to transform and
+ * invTransform, so an update never allocates.
+ *
  * @param   void
  *
  * @return  void
  */
 void ViewContext::update()
 {
+    if ( gc != nullptr )
+    {
+        windowWidth = gc->getWindowWidth();
+        windowHeight = gc->getWindowHeight();
+    }
+
     // determine transformation matrix
-    transform =
-            genScreenTranslationMatrix() *
-            genScreenFlipMatrix()        *
-            genViewScaleMatrix()         *
-            genViewRotationMatrix()      *
-            genViewTranslationMatrix();
+    transform = genScreenTranslationMatrix() *
+                genScreenFlipMatrix() *
+                genViewScaleMatrix() *
+                genViewRotationMatrix() *
+                genViewTranslationMatrix();
 
     // determine inverse transformation matrix
-    invTransform =
-            genInvViewTranslationMatrix()    *
-            genInvViewRotationMatrix()       *
-            genInvViewScaleMatrix()          *
-            genInvScreenFlipMatrix()         *
-            genInvScreenTranslationMatrix();
+    invTransform = genInvViewTranslationMatrix() *
+                   genInvViewRotationMatrix() *
+                   genInvViewScaleMatrix() *
+                   genInvScreenFlipMatrix() *
+                   genInvScreenTranslationMatrix();
+
+    version++;
+}
+
+
+/**
+ * @brief   Updates the view context's transformation matrices if the window
+ *          has been resized since the last update
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ViewContext::updateWindow()
+{
+    if ( gc == nullptr ) return;
+
+    if ( ( gc->getWindowWidth() == windowWidth ) && ( gc->getWindowHeight() == windowHeight ) ) return;
+
+    update();
+}
+
+
+/**
+ * @brief   Sets the window size of a view context that is not paired with a
+ *          graphics context, updating the transformation matrices if it
+ *          changed
+ *
+ * @param   width   The width of the window in pixels
+ * @param   height  The height of the window in pixels
+ *
+ * @return  void
+ */
+void ViewContext::setWindowSize( int width, int height )
+{
+    if ( ( width == windowWidth ) && ( height == windowHeight ) ) return;
+
+    windowWidth = width;
+    windowHeight = height;
+    update();
+}
+
+
+/**
+ * @brief   Copies the transformation matrix into a plain 4x4 array
+ *
+ * @param   m   The array to copy the transformation matrix to
+ *
+ * @return  void
+ */
+void ViewContext::getTransform( float m[TRANSFORM_DIM][TRANSFORM_DIM] ) const
+{
+    transform.toArray( m );
+}
+
+
+/**
+ * @brief   Copies the inverse transformation matrix into a plain 4x4 array
+ *
+ * @param   m   The array to copy the inverse transformation matrix to
+ *
+ * @return  void
+ */
+void ViewContext::getInverseTransform( float m[TRANSFORM_DIM][TRANSFORM_DIM] ) const
+{
+    invTransform.toArray( m );
+}
+
+
+/**
+ * @brief   Gets the version of the transformation matrices, which changes
+ *          every time they are updated
+ *
+ * @param   void
+ *
+ * @return  The version of the transformation matrices
+ */
+unsigned long long ViewContext::getVersion() const
+{
+    return version;
 }
 
 
@@ -404,7 +556,7 @@ std::ostream &ViewContext::out( std::ostream &os ) const
 void ViewContext::panX( float magnitude )
 {
     // get Y rotation
-    float rotationY = getRotation().getY();
+    float rotationY = viewRotationY;
 
     // determine view plane x translation
     int quadrant = ( ( int ) ( rotationY / ( M_PI_2 ) ) ) % 4;
@@ -481,7 +633,7 @@ void ViewContext::panX( float magnitude )
 void ViewContext::panY( float magnitude )
 {
     // get X rotation
-    float rotationX = getRotation().getX();
+    float rotationX = viewRotationX;
 
     // determine view plane x translation
     int quadrant = ( ( int ) ( rotationX / ( M_PI_2 ) ) ) % 4;
@@ -529,11 +681,11 @@ void ViewContext::panY( float magnitude )
     float thetaY = atan( translateY / translateN );
     translateY = signY * magnitude * sin( thetaY );
 
-    Point3D lookTarget = getLookVector();
+    // look vector, as in getLookVector
+    Mat4f rotation = genViewRotationMatrix();
 
-    lookTarget.setX( -1 * magnitude * lookTarget.getX() );
-    lookTarget.setY( 0 );
-    lookTarget.setZ( -1 * magnitude * lookTarget.getZ() );
+    float lookTargetX = -1 * magnitude * rotation[2][0];
+    float lookTargetZ = -1 * magnitude * rotation[2][2];
 
     // std::cout << "QUAD:  " << quadrant << std::endl;
     // std::cout << "SCALE: " << magnitude << std::endl;
@@ -544,7 +696,7 @@ void ViewContext::panY( float magnitude )
     // std::cout << std::endl;
 
     // translate
-    translate( lookTarget.getX(), translateY, lookTarget.getZ() );
+    translate( lookTargetX, translateY, lookTargetZ );
 }
 
 
@@ -555,23 +707,9 @@ void ViewContext::panY( float magnitude )
  *
  * @return  The view translation matrix
  */
-Matrix<float> ViewContext::genViewTranslationMatrix() const
+Mat4f ViewContext::genViewTranslationMatrix() const
 {
-    Matrix<float> viewTranslationMatrix = Matrix<float>( 4, 4 );
-
-    viewTranslationMatrix[0][0] = 1;
-    viewTranslationMatrix[1][1] = 1;
-    viewTranslationMatrix[2][2] = 1;
-    viewTranslationMatrix[3][3] = 1;
-
-    viewTranslationMatrix[0][3] = viewTranslationX;
-    viewTranslationMatrix[1][3] = viewTranslationY;
-    viewTranslationMatrix[2][3] = viewTranslationZ;
-
-    // std::cout << std::endl << "View Translation: " << std::endl;
-    // viewTranslationMatrix.out(std::cout);
-
-    return viewTranslationMatrix;
+    return Mat4f::translation( viewTranslationX, viewTranslationY, viewTranslationZ );
 }
 
 
@@ -582,38 +720,31 @@ Matrix<float> ViewContext::genViewTranslationMatrix() const
  *
  * @return  The view rotation matrix
  */
-Matrix<float> ViewContext::genViewRotationMatrix() const
+Mat4f ViewContext::genViewRotationMatrix() const
 {
-    // generate view rotation X
-    Matrix<float> viewRotationXMatrix = Matrix<float>( 4, 4 );
+    float cosX = cos( viewRotationX );
+    float sinX = sin( viewRotationX );
+    float cosY = cos( viewRotationY );
+    float sinY = sin( viewRotationY );
 
-    viewRotationXMatrix[0][0] = 1;
-    viewRotationXMatrix[3][3] = 1;
+    // generate view rotation X
+    Mat4f rotationX = Mat4f::identity();
 
-    viewRotationXMatrix[1][1] = cos( viewRotationX );
-    viewRotationXMatrix[1][2] = -sin( viewRotationX );
-    viewRotationXMatrix[2][1] = sin( viewRotationX );
-    viewRotationXMatrix[2][2] = cos( viewRotationX );
+    rotationX[1][1] = cosX;
+    rotationX[1][2] = -sinX;
+    rotationX[2][1] = sinX;
+    rotationX[2][2] = cosX;
 
     // generate view rotation Y
-    Matrix<float> viewRotationYMatrix = Matrix<float>( 4, 4 );
+    Mat4f rotationY = Mat4f::identity();
 
-    viewRotationYMatrix[1][1] = 1;
-    viewRotationYMatrix[3][3] = 1;
-
-    viewRotationYMatrix[0][0] = cos( viewRotationY );
-    viewRotationYMatrix[2][0] = -sin( viewRotationY );
-    viewRotationYMatrix[0][2] = sin( viewRotationY );
-    viewRotationYMatrix[2][2] = cos( viewRotationY );
+    rotationY[0][0] = cosY;
+    rotationY[2][0] = -sinY;
+    rotationY[0][2] = sinY;
+    rotationY[2][2] = cosY;
 
     // generate combined rotation matrix x -> y
-    Matrix<float> viewRotationMatrix =
-        viewRotationXMatrix * viewRotationYMatrix;
-
-    // std::cout << std::endl << "View Rotation: " << std::endl;
-    // viewRotationMatrix.out(std::cout);
-
-    return viewRotationMatrix;
+    return rotationX * rotationY;
 }
 
 
@@ -624,19 +755,9 @@ Matrix<float> ViewContext::genViewRotationMatrix() const
  *
  * @return  The view scale matrix
  */
-Matrix<float> ViewContext::genViewScaleMatrix() const
+Mat4f ViewContext::genViewScaleMatrix() const
 {
-    Matrix<float> viewScaleMatrix = Matrix<float>( 4, 4 );
-
-    viewScaleMatrix[0][0] = viewScaleX;
-    viewScaleMatrix[1][1] = viewScaleY;
-    viewScaleMatrix[2][2] = viewScaleZ;
-    viewScaleMatrix[3][3] = 1;
-
-    // std::cout << std::endl << "View Scale: " << std::endl;
-    // viewScaleMatrix.out(std::cout);
-
-    return viewScaleMatrix;
+    return Mat4f::scaling( viewScaleX, viewScaleY, viewScaleZ );
 }
 
 
@@ -647,18 +768,9 @@ Matrix<float> ViewContext::genViewScaleMatrix() const
  *
  * @return  The inverse view translation matrix
  */
-Matrix<float> ViewContext::genInvViewTranslationMatrix() const
+Mat4f ViewContext::genInvViewTranslationMatrix() const
 {
-    Matrix<float> invViewTranslationMatrix = genViewTranslationMatrix();
-
-    invViewTranslationMatrix[0][3] = -1 * invViewTranslationMatrix[0][3];
-    invViewTranslationMatrix[1][3] = -1 * invViewTranslationMatrix[1][3];
-    invViewTranslationMatrix[2][3] = -1 * invViewTranslationMatrix[2][3];
-
-    // std::cout << std::endl << "Inverse View Translation: " << std::endl;
-    // invViewTranslationMatrix.out(std::cout);
-
-    return invViewTranslationMatrix;
+    return Mat4f::translation( -1 * viewTranslationX, -1 * viewTranslationY, -1 * viewTranslationZ );
 }
 
 
@@ -669,16 +781,10 @@ Matrix<float> ViewContext::genInvViewTranslationMatrix() const
  *
  * @return  The inverse view rotation matrix
  */
-Matrix<float> ViewContext::genInvViewRotationMatrix() const
+Mat4f ViewContext::genInvViewRotationMatrix() const
 {
-    Matrix<float> invViewRotationMatrix = genViewRotationMatrix();
-
-    invViewRotationMatrix = ~invViewRotationMatrix;
-
-    // std::cout << std::endl << "Inverse View Rotation: " << std::endl;
-    // invViewRotationMatrix.out(std::cout);
-
-    return invViewRotationMatrix;
+    // a rotation's inverse is its transpose
+    return genViewRotationMatrix().transposed();
 }
 
 
@@ -689,18 +795,9 @@ Matrix<float> ViewContext::genInvViewRotationMatrix() const
  *
  * @return  The inverse view scale matrix
  */
-Matrix<float> ViewContext::genInvViewScaleMatrix() const
+Mat4f ViewContext::genInvViewScaleMatrix() const
 {
-    Matrix<float> invViewScaleMatrix = genViewScaleMatrix();
-
-    invViewScaleMatrix[0][0] = 1 / invViewScaleMatrix[0][0];
-    invViewScaleMatrix[1][1] = 1 / invViewScaleMatrix[1][1];
-    invViewScaleMatrix[2][2] = 1 / invViewScaleMatrix[2][2];
-
-    // std::cout << std::endl << "Inverse View Scale: " << std::endl;
-    // invViewScaleMatrix.out(std::cout);
-
-    return invViewScaleMatrix;
+    return Mat4f::scaling( 1 / viewScaleX, 1 / viewScaleY, 1 / viewScaleZ );
 }
 
 
@@ -711,22 +808,9 @@ Matrix<float> ViewContext::genInvViewScaleMatrix() const
  *
  * @return  The screen translation matrix
  */
-Matrix<float> ViewContext::genScreenTranslationMatrix() const
+Mat4f ViewContext::genScreenTranslationMatrix() const
 {
-    Matrix<float> screenTranslationMatrix = Matrix<float>( 4, 4 );
-
-    screenTranslationMatrix[0][0] = 1;
-    screenTranslationMatrix[1][1] = 1;
-    screenTranslationMatrix[2][2] = 1;
-    screenTranslationMatrix[3][3] = 1;
-
-    screenTranslationMatrix[0][3] = ( ( float ) gc->getWindowWidth() ) / 2;
-    screenTranslationMatrix[1][3] = ( ( float ) gc->getWindowHeight() ) / 2;
-
-    // std::cout << std::endl << "Screen Translation: " << std::endl;
-    // screenTranslationMatrix.out( std::cout);
-
-    return screenTranslationMatrix;
+    return Mat4f::translation( ( ( float ) windowWidth ) / 2, ( ( float ) windowHeight ) / 2, 0 );
 }
 
 
@@ -737,19 +821,9 @@ Matrix<float> ViewContext::genScreenTranslationMatrix() const
  *
  * @return  The screen flip matrix
  */
-Matrix<float> ViewContext::genScreenFlipMatrix() const
+Mat4f ViewContext::genScreenFlipMatrix() const
 {
-    Matrix<float> screenFlipMatrix = Matrix<float>( 4, 4 );
-
-    screenFlipMatrix[0][0] = 1;
-    screenFlipMatrix[1][1] = -1;
-    screenFlipMatrix[2][2] = 1;
-    screenFlipMatrix[3][3] = 1;
-
-    // std::cout << std::endl << "Screen Flip: " << std::endl;
-    // screenFlipMatrix.out( std::cout);
-
-    return screenFlipMatrix;
+    return Mat4f::scaling( 1, -1, 1 );
 }
 
 
@@ -760,18 +834,9 @@ Matrix<float> ViewContext::genScreenFlipMatrix() const
  *
  * @return  The inverse screen translation matrix
  */
-Matrix<float> ViewContext::genInvScreenTranslationMatrix() const
+Mat4f ViewContext::genInvScreenTranslationMatrix() const
 {
-    Matrix<float> invScreenTranslationMatrix = genScreenTranslationMatrix();
-
-    invScreenTranslationMatrix[0][3] = -1 * invScreenTranslationMatrix[0][3];
-    invScreenTranslationMatrix[1][3] = -1 * invScreenTranslationMatrix[1][3];
-    invScreenTranslationMatrix[2][3] = -1 * invScreenTranslationMatrix[2][3];
-
-    // std::cout << std::endl << "Inverse Screen Translation: " << std::endl;
-    // invScreenTranslationMatrix.out( std::cout);
-
-    return invScreenTranslationMatrix;
+    return Mat4f::translation( -1 * ( ( float ) windowWidth ) / 2, -1 * ( ( float ) windowHeight ) / 2, 0 );
 }
 
 
@@ -782,18 +847,10 @@ Matrix<float> ViewContext::genInvScreenTranslationMatrix() const
  *
  * @return  The inverse screen flip matrix
  */
-Matrix<float> ViewContext::genInvScreenFlipMatrix() const
+Mat4f ViewContext::genInvScreenFlipMatrix() const
 {
-    Matrix<float> invScreenFlipMatrix = genScreenFlipMatrix();
-
-    invScreenFlipMatrix[0][0] = 1 / invScreenFlipMatrix[0][0];
-    invScreenFlipMatrix[1][1] = 1 / invScreenFlipMatrix[1][1];
-    invScreenFlipMatrix[2][2] = 1 / invScreenFlipMatrix[2][2];
-
-    // std::cout << std::endl << "Inverse Screen Flip: " << std::endl;
-    // invScreenFlipMatrix.out( std::cout);
-
-    return invScreenFlipMatrix;
+    // the flip is its own inverse
+    return genScreenFlipMatrix();
 }
 
 
@@ -17,6 +17,7 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include "mat4f.h"
 # include "matrix.h"
 # include "point3d.h"
 # include "gcontext.h"
@@ -43,6 +44,8 @@ public:
     /* ----------------------------- Attributes ----------------------------- */
 
 
+    static constexpr unsigned int TRANSFORM_DIM = 4;
+
     constexpr static const float DEFAULT_VIEW_TRANSLATION_X = 0;
     constexpr static const float DEFAULT_VIEW_TRANSLATION_Y = 0;
     constexpr static const float DEFAULT_VIEW_TRANSLATION_Z = 0;
@@ -52,25 +55,28 @@ public:
     constexpr static const float DEFAULT_VIEW_SCALE_Y = 100;
     constexpr static const float DEFAULT_VIEW_SCALE_Z = 100;
 
-    static float * d_viewTransform;
-    static Matrix<float> transform;
-    static Matrix<float> invTransform;
+    // share of the smaller window side a framed model's bounding sphere fills
+    constexpr static const float DEFAULT_FRAME_FILL = 0.9f;
+
+    Mat4f transform = Mat4f::identity();
+    Mat4f invTransform = Mat4f::identity();
 
 
     /* --------------------- Constructors / Destructors --------------------- */
 
 
     explicit ViewContext( GraphicsContext *gc );
+    ViewContext( int width, int height );
     ~ViewContext();
 
 
     /* ------------------------------ Functions ----------------------------- */
 
 
-    Point3D modelToDevice( const Point3D &p );
-    Point3D deviceToModel( const Point3D &p );
+    Point3D modelToDevice( const Point3D &p ) const;
+    Point3D deviceToModel( const Point3D &p ) const;
 
-    Point3D getLookVector();
+    Point3D getLookVector() const;
 
     void translate( float x, float y, float z );
     void rotate( float x, float y );
@@ -91,7 +97,15 @@ public:
     void resetScale();
     void resetView();
 
+    void frameBounds( const float *boundsMin, const float *boundsMax, float fill );
+
     void update();
+    void updateWindow();
+    void setWindowSize( int width, int height );
+
+    void getTransform( float m[TRANSFORM_DIM][TRANSFORM_DIM] ) const;
+    void getInverseTransform( float m[TRANSFORM_DIM][TRANSFORM_DIM] ) const;
+    unsigned long long getVersion() const;
 
     std::ostream &out( std::ostream &os ) const;
 
@@ -115,7 +129,12 @@ private:
     float viewScaleY = DEFAULT_VIEW_SCALE_Y;
     float viewScaleZ = DEFAULT_VIEW_SCALE_Z;
 
-    GraphicsContext *gc;
+    GraphicsContext *gc = nullptr;
+
+    int windowWidth = 0;
+    int windowHeight = 0;
+
+    unsigned long long version = 0;
 
 
     /* ------------------------------ Functions ----------------------------- */
@@ -124,19 +143,19 @@ private:
     void panX( float magnitude );
     void panY( float magnitude );
 
-    Matrix<float> genViewTranslationMatrix() const;
-    Matrix<float> genViewRotationMatrix() const;
-    Matrix<float> genViewScaleMatrix() const;
+    Mat4f genViewTranslationMatrix() const;
+    Mat4f genViewRotationMatrix() const;
+    Mat4f genViewScaleMatrix() const;
 
-    Matrix<float> genInvViewTranslationMatrix() const;
-    Matrix<float> genInvViewRotationMatrix() const;
-    Matrix<float> genInvViewScaleMatrix() const;
+    Mat4f genInvViewTranslationMatrix() const;
+    Mat4f genInvViewRotationMatrix() const;
+    Mat4f genInvViewScaleMatrix() const;
 
-    Matrix<float> genScreenTranslationMatrix() const;
-    Matrix<float> genScreenFlipMatrix() const;
+    Mat4f genScreenTranslationMatrix() const;
+    Mat4f genScreenFlipMatrix() const;
 
-    Matrix<float> genInvScreenTranslationMatrix() const;
-    Matrix<float> genInvScreenFlipMatrix() const;
+    Mat4f genInvScreenTranslationMatrix() const;
+    Mat4f genInvScreenFlipMatrix() const;
 
 
     /* ====================================================================== */
@@ -3,16 +3,39 @@
  * 'sudo apt-get install libx11-dev' should help.
  */
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <sys/ipc.h> // needed for shared memory
+#include <sys/select.h> // needed to wait for events with a timeout
+#include <sys/shm.h>
 #include <X11/Xlib.h> // Every Xlib program must include this
 #include <X11/Xutil.h> // needed for XGetPixel
 #include <X11/XKBlib.h> // needed for keyboard setup
+#include <X11/extensions/XShm.h> // needed for shared-memory images
 
 #include "drawbase.h"
 #include "point2d.h"
 #include "x11context.h"
 
 
+// Set by the temporary error handler if XShmAttach is refused, which
+// happens when the X server is remote
+static bool shm_attach_failed = false;
+
+static int shmAttachErrorHandler(Display *display, XErrorEvent *error)
+{
+	shm_attach_failed = true;
+	return 0;
+}
+
+// Event predicate for XIfEvent - matches MIT-SHM completion events
+static Bool isShmCompletion(Display *display, XEvent *e, XPointer arg)
+{
+	return e->type == *((int *) arg);
+}
+
+
 
 /**
  * The only constructor provided.  Allows size of window and background
@@ -21,6 +44,25 @@
 X11Context::X11Context(unsigned int sizex,unsigned int sizey,
 						unsigned int bg_color=X11Context::BLACK)
 {
+	background_color = bg_color;
+	window_width = sizex;
+	window_height = sizey;
+	draw_color = X11Context::WHITE;
+	draw_mode = X11Context::MODE_NORMAL;
+	shm_enabled = false;
+	shm_completion_type = -1;
+	back_buffer = 0;
+	motion_pending = false;
+	motion_x = 0;
+	motion_y = 0;
+	expose_pending = false;
+
+	for (int i = 0; i < SHM_BUFFER_COUNT; i++)
+	{
+		shm_images[i] = NULL;
+		shm_busy[i] = false;
+	}
+
 	// Open the display
 	display = XOpenDisplay(NULL);
 	
@@ -59,8 +101,9 @@ X11Context::X11Context(unsigned int sizex,unsigned int sizey,
 		break;
 	}
 
-	// We also want exposure, mouse, and keyboard events
+	// We also want exposure, resize, mouse, and keyboard events
 	XSelectInput(display, window, ExposureMask|
+								StructureNotifyMask|
 								ButtonPressMask|
 								ButtonReleaseMask|
 								KeyPressMask|
@@ -72,6 +115,14 @@ X11Context::X11Context(unsigned int sizex,unsigned int sizey,
 	Atom atomKill = XInternAtom(display, "WM_DELETE_WINDOW", False);
 	XSetWMProtocols(display, window, &atomKill, 1);
 
+	// Present through shared memory if the server allows it - set
+	// RENDER_NO_SHM to force the plain X request path
+	if (XShmQueryExtension(display) && !getenv("RENDER_NO_SHM"))
+	{
+		shm_completion_type = XShmGetEventBase(display) + ShmCompletion;
+		shm_enabled = createShmBuffers(window_width, window_height);
+	}
+
 	return;
 }
 
@@ -79,6 +130,7 @@ X11Context::X11Context(unsigned int sizex,unsigned int sizey,
 // Destructor  - shut down window and connection to server
 X11Context::~X11Context()
 {
+	destroyShmBuffers();
 	XFreeGC(display, graphics_context);
 	XDestroyWindow(display,window);
 	XCloseDisplay(display);
@@ -88,6 +140,8 @@ X11Context::~X11Context()
 // Set the drawing mode - argument is enumerated
 void X11Context::setMode(drawMode newMode)
 {
+	draw_mode = newMode;
+
 	if ( newMode == X11Context::MODE_NORMAL)
 	{
 		XSetFunction(display,graphics_context,GXcopy);
@@ -105,20 +159,37 @@ void X11Context::setColor(unsigned int color)
 	// Go ahead and set color here - better performance than setting
 	// on every setPixel 
     XSetForeground(display, graphics_context, color);
+	draw_color = color;
 }
 
 
 // Set a pixel in the current color
 void X11Context::setPixel(int x, int y)
 {
+	unsigned int *pixels = prepareBackBuffer();
+
+	if (pixels)
+	{
+		plot(pixels, x, y);
+		return;
+	}
+
 	XDrawPoint(display, window, graphics_context, x, y);
-	XFlush(display);
 }
 
 
 // Get the color of a pixel
 unsigned int X11Context::getPixel(int x, int y)
 {
+	unsigned int *pixels = prepareBackBuffer();
+
+	if (pixels)
+	{
+		if (x < 0 || y < 0 || x >= window_width || y >= window_height)
+			return 0;
+		return pixels[y * window_width + x] & 0xFFFFFF;
+	}
+
 	XImage *image;
 	image = XGetImage (display, window, x, y, 1, 1, AllPlanes, XYPixmap);
 	XColor color;
@@ -139,81 +210,215 @@ unsigned int X11Context::getPixel(int x, int y)
 // Draw a line in the current color
 void X11Context::drawLine(int x1, int y1, int x2, int y2)
 {
-    XDrawLine(display, window, graphics_context, x1, y1, x2, y2);
-    XFlush(display);
+	unsigned int *pixels = prepareBackBuffer();
+
+	if (!pixels)
+	{
+		XDrawLine(display, window, graphics_context, x1, y1, x2, y2);
+		return;
+	}
+
+	// Bresenham into the back buffer
+	int dx = abs(x2 - x1);
+	int dy = -abs(y2 - y1);
+	int sx = (x1 < x2) ? 1 : -1;
+	int sy = (y1 < y2) ? 1 : -1;
+	int err = dx + dy;
+
+	for (;;)
+	{
+		plot(pixels, x1, y1);
+
+		if (x1 == x2 && y1 == y2)
+			break;
+
+		int err2 = 2 * err;
+
+		if (err2 >= dy)
+		{
+			err += dy;
+			x1 += sx;
+		}
+
+		if (err2 <= dx)
+		{
+			err += dx;
+			y1 += sy;
+		}
+	}
 }
 
 
 // Draw a circle in the current color
 void X11Context::drawCircle(int x, int y, int radius)
 {
-    XDrawArc(display, window, graphics_context, x-radius,
-             y-radius, radius*2, radius*2, 0, 360*64);
-    XFlush(display);
+	unsigned int *pixels = prepareBackBuffer();
+
+	if (!pixels)
+	{
+		XDrawArc(display, window, graphics_context, x-radius,
+				y-radius, radius*2, radius*2, 0, 360*64);
+		return;
+	}
+
+	// midpoint circle into the back buffer
+	int cx = radius;
+	int cy = 0;
+	int err = 1 - radius;
+
+	while (cx >= cy)
+	{
+		plot(pixels, x + cx, y + cy);
+		plot(pixels, x + cy, y + cx);
+		plot(pixels, x - cy, y + cx);
+		plot(pixels, x - cx, y + cy);
+		plot(pixels, x - cx, y - cy);
+		plot(pixels, x - cy, y - cx);
+		plot(pixels, x + cy, y - cx);
+		plot(pixels, x + cx, y - cy);
+
+		cy++;
+
+		if (err < 0)
+		{
+			err += 2 * cy + 1;
+		}
+		else
+		{
+			cx--;
+			err += 2 * (cy - cx) + 1;
+		}
+	}
 }
 
 
 // Clear graphics context
 void X11Context::clear()
 {
-	XClearWindow(display, window);
+	unsigned int *pixels = prepareBackBuffer();
+
+	if (!pixels)
+	{
+		XClearWindow(display, window);
+		return;
+	}
+
+	for (int i = 0; i < window_width * window_height; i++)
+		pixels[i] = background_color;
+}
+
+
+// Get the background color the window was created with
+unsigned int X11Context::getBackgroundColor()
+{
+	return background_color;
+}
+
+
+// Blit a whole frame of pixels - into the back buffer when using MIT-SHM,
+// otherwise straight to the window with one XPutImage
+void X11Context::drawImage(const unsigned int *pixels, int width, int height)
+{
+	unsigned int *back = prepareBackBuffer();
+
+	if (back)
+	{
+		int rows = (height < window_height) ? height : window_height;
+		int cols = (width < window_width) ? width : window_width;
+
+		for (int y = 0; y < rows; y++)
+			memcpy(back + y * window_width, pixels + y * width,
+					cols * sizeof(unsigned int));
+		return;
+	}
+
+	int screen = DefaultScreen(display);
+
+	// wrap the caller's pixels - XImage expects 32 bits per pixel
+	XImage *image = XCreateImage(display, DefaultVisual(display, screen),
+				DefaultDepth(display, screen), ZPixmap, 0,
+				(char *) pixels, width, height, 32,
+				width * sizeof(unsigned int));
+
+	XPutImage(display, window, graphics_context, image, 0, 0, 0, 0,
+				width, height);
+
+	// the pixels belong to the caller, so don't let XDestroyImage free them
+	image->data = NULL;
+	XDestroyImage(image);
+}
+
+
+// Get the MIT-SHM back buffer, or NULL without MIT-SHM
+unsigned int *X11Context::getBackBuffer()
+{
+	return prepareBackBuffer();
+}
+
+
+// Show the frame - one XShmPutImage, then swap buffers
+void X11Context::present()
+{
+	if (shm_enabled && shm_images[back_buffer])
+	{
+		XShmPutImage(display, window, graphics_context,
+				shm_images[back_buffer], 0, 0, 0, 0,
+				window_width, window_height, True);
+		shm_busy[back_buffer] = true;
+		back_buffer = (back_buffer + 1) % SHM_BUFFER_COUNT;
+	}
+
 	XFlush(display);
 }
 
 
-// Run event loop
+// True if frames are presented through MIT-SHM
+bool X11Context::isShmEnabled()
+{
+	return shm_enabled;
+}
+
+
+// Run event loop - everything queued is handled before anything is drawn,
+// and merged motion and exposure are handed on once per frame
 void X11Context::runLoop(DrawingBase* drawing)
 {
 	run = true;
+	motion_pending = false;
+	expose_pending = false;
 	
     drawing->paint(this);
+
+	next_frame = std::chrono::steady_clock::now() +
+			std::chrono::microseconds(FRAME_INTERVAL_US);
 	
 	while(run)
 	{
-		XEvent e;
-		XNextEvent(display, &e);
-
-		// Exposure event - lets not worry about region
-		if (e.type == Expose)
-			drawing->paint(this);
-
-		// Key Down
-		else if (e.type == KeyPress)
-			drawing->keyDown(this,XLookupKeysym((XKeyEvent*)&e,
-					(((e.xkey.state&0x01)&&!(e.xkey.state&0x02))||
-					(!(e.xkey.state&0x01)&&(e.xkey.state&0x02)))?1:0));
-	 
-		// Key Up
-		else if (e.type == KeyRelease){
-			drawing->keyUp(this,XLookupKeysym((XKeyEvent*)&e,
-					(((e.xkey.state&0x01)&&!(e.xkey.state&0x02))||
-					(!(e.xkey.state&0x01)&&(e.xkey.state&0x02)))?1:0));
-				}
-
-		// Mouse Button Down
-		else if (e.type == ButtonPress)
-			drawing->mouseButtonDown(this,
-			e.xbutton.button,
-			e.xbutton.x,
-			e.xbutton.y);
-			
-		// Mouse Button Up
-		else if (e.type == ButtonRelease)
-			drawing->mouseButtonUp(this,
-			e.xbutton.button,
-			e.xbutton.x,
-			e.xbutton.y);
-			
-		// Mouse Move	
-		else if (e.type == MotionNotify)
-			drawing->mouseMove(this,
-			e.xmotion.x,
-			e.xmotion.y);
-
-		// This will respond to the WM_DELETE_WINDOW from the
-		// window manager.
-		else if (e.type == ClientMessage)
-		break;
+		// drain the queue, motion and exposure only update what is pending
+		while (run && XPending(display))
+		{
+			XEvent e;
+			XNextEvent(display, &e);
+			handleEvent(drawing, e);
+		}
+
+		if (!run)
+			break;
+
+		// draw the merged input once the frame is due, unless more
+		// input arrives first
+		if (motion_pending || expose_pending)
+		{
+			if (std::chrono::steady_clock::now() >= next_frame)
+				flushPending(drawing);
+			else
+				waitForEvents(drawing, true);
+
+			continue;
+		}
+
+		// nothing to draw - sleep until the next event or frame
+		waitForEvents(drawing, false);
 	}
 }
 
@@ -221,16 +426,326 @@ void X11Context::runLoop(DrawingBase* drawing)
 // Get the width of the window
 int X11Context::getWindowWidth()
 {
-	XWindowAttributes window_attributes;
-	XGetWindowAttributes(display,window, &window_attributes);
-	return window_attributes.width;
+	return window_width;
 }
 
 
 // Get the height of the window
 int X11Context::getWindowHeight()
 {
-	XWindowAttributes window_attributes;
-	XGetWindowAttributes(display,window, &window_attributes);
-	return window_attributes.height;
-}
\ No newline at end of file
+	return window_height;
+}
+
+
+// Create the shared-memory images - returns false if MIT-SHM can't be used
+bool X11Context::createShmBuffers(int width, int height)
+{
+	int screen = DefaultScreen(display);
+	bool ok = true;
+
+	// catch XShmAttach errors instead of exiting
+	shm_attach_failed = false;
+	XErrorHandler oldHandler = XSetErrorHandler(shmAttachErrorHandler);
+
+	for (int i = 0; i < SHM_BUFFER_COUNT; i++)
+	{
+		shm_info[i].shmid = -1;
+		shm_info[i].shmaddr = (char *) -1;
+		shm_busy[i] = false;
+
+		shm_images[i] = XShmCreateImage(display,
+				DefaultVisual(display, screen), DefaultDepth(display, screen),
+				ZPixmap, NULL, &shm_info[i], width, height);
+
+		// the pixel layout must match our 32-bit framebuffers
+		if (!shm_images[i] || shm_images[i]->bits_per_pixel != 32 ||
+			shm_images[i]->bytes_per_line != width * (int) sizeof(unsigned int))
+		{
+			ok = false;
+			break;
+		}
+
+		shm_info[i].shmid = shmget(IPC_PRIVATE,
+				shm_images[i]->bytes_per_line * height, IPC_CREAT | 0600);
+
+		if (shm_info[i].shmid < 0)
+		{
+			ok = false;
+			break;
+		}
+
+		shm_info[i].shmaddr = (char *) shmat(shm_info[i].shmid, NULL, 0);
+
+		if (shm_info[i].shmaddr == (char *) -1)
+		{
+			ok = false;
+			break;
+		}
+
+		shm_images[i]->data = shm_info[i].shmaddr;
+		shm_info[i].readOnly = False;
+
+		XShmAttach(display, &shm_info[i]);
+	}
+
+	XSync(display, False);
+	XSetErrorHandler(oldHandler);
+
+	// segments are removed once both sides have detached
+	for (int i = 0; i < SHM_BUFFER_COUNT; i++)
+		if (shm_images[i] && shm_info[i].shmid >= 0)
+			shmctl(shm_info[i].shmid, IPC_RMID, NULL);
+
+	if (!ok || shm_attach_failed)
+	{
+		destroyShmBuffers();
+		return false;
+	}
+
+	back_buffer = 0;
+	return true;
+}
+
+
+// Release the shared-memory images
+void X11Context::destroyShmBuffers()
+{
+	for (int i = 0; i < SHM_BUFFER_COUNT; i++)
+	{
+		if (!shm_images[i])
+			continue;
+
+		if (shm_info[i].shmaddr != (char *) -1)
+		{
+			if (!shm_attach_failed)
+				XShmDetach(display, &shm_info[i]);
+			shmdt(shm_info[i].shmaddr);
+		}
+
+		// data lives in the segment, not the heap
+		shm_images[i]->data = NULL;
+		XDestroyImage(shm_images[i]);
+		shm_images[i] = NULL;
+		shm_busy[i] = false;
+	}
+
+	XSync(display, False);
+}
+
+
+// Get a back buffer that is safe to write and matches the window size,
+// or NULL without MIT-SHM
+unsigned int *X11Context::prepareBackBuffer()
+{
+	if (!shm_enabled)
+		return NULL;
+
+	// recreate the images after a resize
+	if (!shm_images[back_buffer] ||
+		shm_images[back_buffer]->width != window_width ||
+		shm_images[back_buffer]->height != window_height)
+	{
+		for (int i = 0; i < SHM_BUFFER_COUNT; i++)
+		{
+			while (shm_busy[i])
+			{
+				XEvent e;
+				XIfEvent(display, &e, isShmCompletion, (XPointer) &shm_completion_type);
+				handleShmCompletion(e);
+			}
+		}
+
+		destroyShmBuffers();
+		shm_enabled = createShmBuffers(window_width, window_height);
+
+		if (!shm_enabled)
+			return NULL;
+	}
+
+	// wait until the server has finished reading the back buffer
+	while (shm_busy[back_buffer])
+	{
+		XEvent e;
+		XIfEvent(display, &e, isShmCompletion, (XPointer) &shm_completion_type);
+		handleShmCompletion(e);
+	}
+
+	return (unsigned int *) shm_images[back_buffer]->data;
+}
+
+
+// Mark the image named by a completion event as free
+void X11Context::handleShmCompletion(XEvent &e)
+{
+	XShmCompletionEvent *completion = (XShmCompletionEvent *) &e;
+
+	for (int i = 0; i < SHM_BUFFER_COUNT; i++)
+		if (shm_images[i] && shm_info[i].shmseg == completion->shmseg)
+			shm_busy[i] = false;
+}
+
+
+// Write one pixel of the back buffer in the current color and mode
+void X11Context::plot(unsigned int *pixels, int x, int y)
+{
+	if (x < 0 || y < 0 || x >= window_width || y >= window_height)
+		return;
+
+	if (draw_mode == X11Context::MODE_XOR)
+		pixels[y * window_width + x] ^= draw_color;
+	else
+		pixels[y * window_width + x] = draw_color;
+}
+
+
+// Pass one event on to the drawing, or merge it into the pending input
+void X11Context::handleEvent(DrawingBase *drawing, XEvent &e)
+{
+	// Exposure event - lets not worry about region
+	if (e.type == Expose)
+		expose_pending = true;
+
+	// Resize - remember the new size
+	else if (e.type == ConfigureNotify)
+	{
+		window_width = e.xconfigure.width;
+		window_height = e.xconfigure.height;
+	}
+
+	// MIT-SHM finished reading an image
+	else if (e.type == shm_completion_type)
+		handleShmCompletion(e);
+
+	// Key Down
+	else if (e.type == KeyPress)
+	{
+		flushMotion(drawing);
+		drawing->keyDown(this,XLookupKeysym((XKeyEvent*)&e,
+				(((e.xkey.state&0x01)&&!(e.xkey.state&0x02))||
+				(!(e.xkey.state&0x01)&&(e.xkey.state&0x02)))?1:0));
+	}
+
+	// Key Up
+	else if (e.type == KeyRelease)
+	{
+		flushMotion(drawing);
+		drawing->keyUp(this,XLookupKeysym((XKeyEvent*)&e,
+				(((e.xkey.state&0x01)&&!(e.xkey.state&0x02))||
+				(!(e.xkey.state&0x01)&&(e.xkey.state&0x02)))?1:0));
+	}
+
+	// Mouse Button Down
+	else if (e.type == ButtonPress)
+	{
+		flushMotion(drawing);
+		drawing->mouseButtonDown(this,
+		e.xbutton.button,
+		e.xbutton.x,
+		e.xbutton.y);
+	}
+
+	// Mouse Button Up
+	else if (e.type == ButtonRelease)
+	{
+		flushMotion(drawing);
+		drawing->mouseButtonUp(this,
+		e.xbutton.button,
+		e.xbutton.x,
+		e.xbutton.y);
+	}
+
+	// Mouse Move - only the latest position matters
+	else if (e.type == MotionNotify)
+	{
+		motion_pending = true;
+		motion_x = e.xmotion.x;
+		motion_y = e.xmotion.y;
+	}
+
+	// This will respond to the WM_DELETE_WINDOW from the
+	// window manager.
+	else if (e.type == ClientMessage)
+		run = false;
+}
+
+
+// Hand the latest pointer position on before a button or key, so the
+// drawing sees the pointer where the user left it
+void X11Context::flushMotion(DrawingBase *drawing)
+{
+	if (!motion_pending)
+		return;
+
+	motion_pending = false;
+	drawing->mouseMove(this, motion_x, motion_y);
+}
+
+
+// Hand all pending input on and schedule the next frame - a frame that
+// overruns its interval makes the next one due at once, never later
+void X11Context::flushPending(DrawingBase *drawing)
+{
+	next_frame = std::chrono::steady_clock::now() +
+			std::chrono::microseconds(FRAME_INTERVAL_US);
+
+	flushMotion(drawing);
+
+	if (expose_pending)
+	{
+		expose_pending = false;
+		drawing->paint(this);
+	}
+}
+
+
+// Wait until an event arrives, or the next frame is due if timed - a
+// finished frame of the drawing is shown while waiting.  Returns true if
+// events are queued
+bool X11Context::waitForEvents(DrawingBase *drawing, bool timed)
+{
+	int fd = ConnectionNumber(display);
+	int frame_fd = drawing->getFrameFd();
+
+	for (;;)
+	{
+		// requests still buffered might be what the server is waiting on
+		XFlush(display);
+
+		if (XPending(display))
+			return true;
+
+		timeval timeout;
+		timeval *wait = NULL;
+
+		if (timed)
+		{
+			long long remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+					next_frame - std::chrono::steady_clock::now()).count();
+
+			if (remaining <= 0)
+				return false;
+
+			timeout.tv_sec = remaining / 1000000;
+			timeout.tv_usec = remaining % 1000000;
+			wait = &timeout;
+		}
+
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+
+		if (frame_fd >= 0)
+			FD_SET(frame_fd, &fds);
+
+		int max_fd = (frame_fd > fd) ? frame_fd : fd;
+
+		if (select(max_fd + 1, &fds, NULL, NULL, wait) <= 0)
+			return false;
+
+		if (frame_fd >= 0 && FD_ISSET(frame_fd, &fds))
+			drawing->frameReady(this);
+
+		if (FD_ISSET(fd, &fds))
+			return XPending(display) > 0;
+	}
+}
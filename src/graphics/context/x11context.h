@@ -3,9 +3,26 @@
 /**
  * This class is a sample implementation of the GraphicsContext class
  * for the X11 / XWindows system.
- * */    
- 
+ *
+ * When the X server supports the MIT-SHM extension, the context owns
+ * two shared-memory XImages.  All drawing goes into the back image and
+ * present() shows it with a single XShmPutImage, then swaps, so the
+ * next frame can be drawn while the current one is on screen.  Without
+ * MIT-SHM, drawing is issued as regular X requests and present() flushes
+ * them in one go.
+ *
+ * The event loop drains every queued event before drawing.  Pointer
+ * motion and exposure are merged into the latest position and a single
+ * repaint, and handed on at most once per FRAME_INTERVAL, so a frame
+ * that takes longer than the gap between events never leaves a backlog
+ * of stale positions behind it.  A drawing that renders on its own
+ * thread is waited on together with the window, and shown as soon as a
+ * frame of it is ready.
+ * */
+
+#include <chrono>
 #include <X11/Xlib.h>   // Every Xlib program must include this
+#include <X11/extensions/XShm.h> // shared-memory images
 #include "gcontext.h"	// base class
 
 class X11Context : public GraphicsContext
@@ -16,7 +33,7 @@ class X11Context : public GraphicsContext
 
 		// Destructor
 		virtual ~X11Context();
-		
+
 		// Drawing Operations
 		void setMode(drawMode newMode);
 		void setColor(unsigned int color);
@@ -25,6 +42,10 @@ class X11Context : public GraphicsContext
         void drawLine(int x1, int y1, int x2, int y2);
         void drawCircle(int x, int y, int radius);
 		void clear();
+		unsigned int getBackgroundColor();
+		void drawImage(const unsigned int *pixels, int width, int height);
+		unsigned int *getBackBuffer();
+		void present();
 
 		/*
 		 * These are not currently overridden, but could be as XLib
@@ -36,19 +57,58 @@ class X11Context : public GraphicsContext
 
 		// Event loop functions
 		void runLoop(DrawingBase* drawing);
-		
+
 		// we will use endLoop provided by base class
-		
+
 		// Utility functions
 		int getWindowWidth();
 		int getWindowHeight();
-		
+
+		// true if frames are presented through MIT-SHM
+		bool isShmEnabled();
+
 
 	private:
 		// X11 stuff - specific to this context
 		Display* display;
 		Window window;
 		GC graphics_context;
+		unsigned int background_color;
+
+		// window size, tracked through ConfigureNotify
+		int window_width;
+		int window_height;
+
+		// merged input waiting for the next frame
+		static const int FRAME_INTERVAL_US = 16667;
+		bool motion_pending;
+		int motion_x;
+		int motion_y;
+		bool expose_pending;
+		std::chrono::steady_clock::time_point next_frame;
+
+		// MIT-SHM double buffer
+		static const int SHM_BUFFER_COUNT = 2;
+		bool shm_enabled;
+		int shm_completion_type;
+		XImage *shm_images[SHM_BUFFER_COUNT];
+		XShmSegmentInfo shm_info[SHM_BUFFER_COUNT];
+		bool shm_busy[SHM_BUFFER_COUNT];
+		int back_buffer;
+
+		// software drawing state for the back buffer
+		unsigned int draw_color;
+		drawMode draw_mode;
+
+		bool createShmBuffers(int width, int height);
+		void destroyShmBuffers();
+		unsigned int *prepareBackBuffer();
+		void handleShmCompletion(XEvent &e);
+		void plot(unsigned int *pixels, int x, int y);
+		void handleEvent(DrawingBase *drawing, XEvent &e);
+		void flushMotion(DrawingBase *drawing);
+		void flushPending(DrawingBase *drawing);
+		bool waitForEvents(DrawingBase *drawing, bool timed);
 };
 
 #endif
@@ -0,0 +1,698 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    cpurenderer.cpp
+ * @brief   Multi-threaded host renderer for machines without a GPU device
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cfloat>
+# include <cmath>
+# include <cstring>
+
+# if defined( __GNUC__ ) && defined( __x86_64__ ) && !defined( __CUDA_ARCH__ )
+# define CPU_RENDERER_AVX2
+# include <immintrin.h>
+# endif
+
+# include "bvh.h"
+# include "cpurenderer.h"
+# include "frameprofiler.h"
+# include "rasterizer.h"
+
+
+/* ---------------------------- Helper Functions ---------------------------- */
+
+
+/**
+ * @brief   Applies rows 0 and 1 of a view transform to a run of vertices
+ *
+ * The products are summed in the same order as on the device.
+ *
+ * @param   *x          The model-space x-coordinates of the vertices
+ * @param   *y          The model-space y-coordinates of the vertices
+ * @param   *z          The model-space z-coordinates of the vertices
+ * @param   begin       The first vertex to transform
+ * @param   end         The vertex past the last one to transform
+ * @param   m           The view transform
+ * @param   *outX       The device-space x-coordinates to write
+ * @param   *outY       The device-space y-coordinates to write
+ *
+ * @return  void
+ */
+static void transformScalar(
+    const float *x, const float *y, const float *z,
+    unsigned int begin, unsigned int end,
+    const float m[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM],
+    float *outX, float *outY
+)
+{
+    for ( unsigned int i = begin; i < end; i++ )
+    {
+        outX[i] = m[0][0] * x[i] + m[0][1] * y[i] + m[0][2] * z[i] + m[0][3];
+        outY[i] = m[1][0] * x[i] + m[1][1] * y[i] + m[1][2] * z[i] + m[1][3];
+    }
+}
+
+
+# ifdef CPU_RENDERER_AVX2
+/**
+ * @brief   Applies rows 0 and 1 of a view transform to a run of vertices,
+ *          eight at a time with AVX2
+ *
+ * Only compiled for AVX2, so it must not be called unless the processor
+ * has it. The products are summed in the same order as transformScalar,
+ * without fusing, so both give exactly the same result.
+ *
+ * @param   *x          The model-space x-coordinates of the vertices
+ * @param   *y          The model-space y-coordinates of the vertices
+ * @param   *z          The model-space z-coordinates of the vertices
+ * @param   begin       The first vertex to transform
+ * @param   end         The vertex past the last one to transform
+ * @param   m           The view transform
+ * @param   *outX       The device-space x-coordinates to write
+ * @param   *outY       The device-space y-coordinates to write
+ *
+ * @return  void
+ */
+__attribute__(( target( "avx2" ) ))
+static void transformAvx2(
+    const float *x, const float *y, const float *z,
+    unsigned int begin, unsigned int end,
+    const float m[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM],
+    float *outX, float *outY
+)
+{
+    __m256 rowX[ViewContext::TRANSFORM_DIM];
+    __m256 rowY[ViewContext::TRANSFORM_DIM];
+
+    for ( unsigned int i = 0; i < ViewContext::TRANSFORM_DIM; i++ )
+    {
+        rowX[i] = _mm256_set1_ps( m[0][i] );
+        rowY[i] = _mm256_set1_ps( m[1][i] );
+    }
+
+    unsigned int i = begin;
+
+    for ( ; i + 8 <= end; i += 8 )
+    {
+        __m256 vx = _mm256_loadu_ps( x + i );
+        __m256 vy = _mm256_loadu_ps( y + i );
+        __m256 vz = _mm256_loadu_ps( z + i );
+
+        __m256 sumX = _mm256_add_ps( _mm256_mul_ps( rowX[0], vx ), _mm256_mul_ps( rowX[1], vy ) );
+        __m256 sumY = _mm256_add_ps( _mm256_mul_ps( rowY[0], vx ), _mm256_mul_ps( rowY[1], vy ) );
+
+        sumX = _mm256_add_ps( _mm256_add_ps( sumX, _mm256_mul_ps( rowX[2], vz ) ), rowX[3] );
+        sumY = _mm256_add_ps( _mm256_add_ps( sumY, _mm256_mul_ps( rowY[2], vz ) ), rowY[3] );
+
+        _mm256_storeu_ps( outX + i, sumX );
+        _mm256_storeu_ps( outY + i, sumY );
+    }
+
+    // the last few vertices of the run
+    transformScalar( x, y, z, i, end, m, outX, outY );
+}
+# endif
+
+
+/**
+ * @brief   Gets the vertex indices at the ends of a segment
+ *
+ * @param   *elements   The triangle index buffer, or the unique edge list
+ * @param   facets      True if the elements are facets, false for edges
+ * @param   segment     The segment, the corner of a facet or an edge
+ * @param   &start      The vertex at the start of the segment, written
+ * @param   &end        The vertex at the end of the segment, written
+ *
+ * @return  void
+ */
+static void segmentEnds(
+    const unsigned int *elements, bool facets, unsigned int segment,
+    unsigned int &start, unsigned int &end
+)
+{
+    if ( facets )
+    {
+        const unsigned int *corners = elements + ( size_t ) ( segment / Mesh::FACET_DIM ) * Mesh::FACET_DIM;
+        unsigned int corner = segment % Mesh::FACET_DIM;
+
+        start = corners[corner];
+        end = corners[( corner + 1 ) % Mesh::FACET_DIM];
+    }
+    else
+    {
+        start = elements[( size_t ) segment * Mesh::EDGE_DIM];
+        end = elements[( size_t ) segment * Mesh::EDGE_DIM + 1];
+    }
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a CPU renderer without a framebuffer, with a thread for
+ *          every hardware thread
+ *
+ * @param   void
+ *
+ * @return  The created CPU renderer
+ */
+CpuRenderer::CpuRenderer() = default;
+
+
+/**
+ * @brief   CPU renderer destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+CpuRenderer::~CpuRenderer() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Determines if vertices are transformed with AVX2
+ *
+ * @param   void
+ *
+ * @return  True if the processor has AVX2, false if the scalar path is used
+ */
+bool CpuRenderer::hasVectorTransform()
+{
+# ifdef CPU_RENDERER_AVX2
+    static const bool supported = __builtin_cpu_supports( "avx2" );
+    return supported;
+# else
+    return false;
+# endif
+}
+
+
+/**
+ * @brief   Resizes the framebuffer, leaving its contents undefined
+ *
+ * @param   width   The width of the framebuffer in pixels
+ * @param   height  The height of the framebuffer in pixels
+ *
+ * @return  void
+ */
+void CpuRenderer::resize( unsigned int width, unsigned int height )
+{
+    this->width = width;
+    this->height = height;
+
+    frameBuffer.resize( ( size_t ) width * height );
+}
+
+
+/**
+ * @brief   Fills the framebuffer with one color
+ *
+ * @param   color   The 24-bit RGB color to fill with
+ *
+ * @return  void
+ */
+void CpuRenderer::clear( unsigned int color )
+{
+    std::fill( frameBuffer.begin(), frameBuffer.end(), color );
+}
+
+
+/**
+ * @brief   Draws the wireframe of a host mesh into the framebuffer
+ *
+ * The vertices are transformed in batches across the pool. With back-face
+ * culling the edges of every front-facing facet are drawn, as on the
+ * device; otherwise the mesh's unique edge list is, which must already be
+ * built. Segments that cannot reach the window are dropped while they are
+ * binned to bands.
+ *
+ * @param   &mesh           The mesh to draw, in host memory
+ * @param   *vc             The view context to render with
+ * @param   cullBackFaces   Whether to skip facets facing away from the viewer
+ * @param   color           The 24-bit RGB color to draw with
+ *
+ * @return  void
+ */
+void CpuRenderer::draw( const Mesh &mesh, const ViewContext *vc, bool cullBackFaces, unsigned int color )
+{
+    draw( mesh, vc->transform, cullBackFaces, color );
+}
+
+
+/**
+ * @brief   Draws the wireframe of a host mesh into the framebuffer with a
+ *          transform from its model space straight to device space, such as
+ *          the view transform of one instance of it
+ *
+ * @param   &mesh           The mesh to draw, in host memory
+ * @param   &modelTransform The transform from model space to device space
+ * @param   cullBackFaces   Whether to skip facets facing away from the viewer
+ * @param   color           The 24-bit RGB color to draw with
+ *
+ * @return  void
+ */
+void CpuRenderer::draw( const Mesh &mesh, const Mat4f &modelTransform, bool cullBackFaces, unsigned int color )
+{
+    if ( ( width == 0 ) || ( height == 0 ) || ( mesh.getFacetCount() == 0 ) ) return;
+
+    float transform[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM];
+    modelTransform.toArray( transform );
+
+    ProfileRange transformRange( FrameProfiler::STAGE_TRANSFORM, false );
+    transformVertices( mesh, transform );
+    transformRange.end();
+
+    // facing is per facet, otherwise each unique edge is drawn once
+    const unsigned int *elements = cullBackFaces ? mesh.getIndices() : mesh.getEdges();
+    unsigned int elementCount = cullBackFaces ? mesh.getFacetCount() : mesh.getEdgeCount();
+
+    unsigned int bandCount = std::max( 1u, std::min( pool->getThreadCount() * BANDS_PER_THREAD, height ) );
+    unsigned int bandHeight = ( height + bandCount - 1 ) / bandCount;
+    bandCount = ( height + bandHeight - 1 ) / bandHeight;
+
+    ProfileRange cullRange( FrameProfiler::STAGE_CULL, false );
+    binSegments( elements, elementCount, cullBackFaces, bandCount, bandHeight );
+    cullRange.end();
+
+    ProfileRange rasterRange( FrameProfiler::STAGE_RASTER, false );
+    drawBands( elements, cullBackFaces, bandCount, bandHeight, color );
+}
+
+
+/**
+ * @brief   Finds the facet of a host mesh under a point in the window
+ *
+ * Like ShapeContainer::pick, the point is taken back to model space along
+ * the device +z axis. Without a hierarchy every facet is tested, in
+ * batches across the pool.
+ *
+ * @param   &mesh   The mesh to search, in host memory
+ * @param   *vc     The view context the window is drawn with
+ * @param   x       The x-coordinate of the point in pixels
+ * @param   y       The y-coordinate of the point in pixels
+ *
+ * @return  The index of the nearest facet under the point, or -1 if there
+ *          is none
+ */
+int CpuRenderer::pick( const Mesh &mesh, const ViewContext *vc, int x, int y ) const
+{
+    unsigned int facetCount = mesh.getFacetCount();
+
+    if ( facetCount == 0 ) return -1;
+
+    float inverse[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM];
+    vc->getInverseTransform( inverse );
+
+    float origin[Mesh::COORD_DIM];
+    float direction[Mesh::COORD_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        origin[i] = inverse[i][0] * x + inverse[i][1] * y + inverse[i][3];
+        direction[i] = inverse[i][2];
+    }
+
+    float3 rayOrigin = make_float3( origin[0], origin[1], origin[2] );
+    float3 rayDirection = make_float3( direction[0], direction[1], direction[2] );
+
+    const float *vertX = mesh.getX();
+    const float *vertY = mesh.getY();
+    const float *vertZ = mesh.getZ();
+    const unsigned int *indices = mesh.getIndices();
+
+    unsigned int batchCount = ( facetCount + PICK_BATCH - 1 ) / PICK_BATCH;
+
+    std::vector<float> nearest( batchCount, FLT_MAX );
+    std::vector<int> nearestFacet( batchCount, -1 );
+
+    pool->parallelFor( batchCount, [&]( unsigned int batch )
+        {
+            unsigned int begin = batch * PICK_BATCH;
+            unsigned int end = std::min( begin + PICK_BATCH, facetCount );
+
+            for ( unsigned int facet = begin; facet < end; facet++ )
+            {
+                const unsigned int *corners = indices + ( size_t ) facet * Mesh::FACET_DIM;
+                float3 v[Mesh::FACET_DIM];
+
+                for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+                {
+                    v[i] = make_float3( vertX[corners[i]], vertY[corners[i]], vertZ[corners[i]] );
+                }
+
+                float distance;
+
+                bool crossed = intersectTriangle( rayOrigin, rayDirection, v[0], v[1], v[2], &distance );
+
+                if ( crossed && ( distance < nearest[batch] ) )
+                {
+                    nearest[batch] = distance;
+                    nearestFacet[batch] = facet;
+                }
+            }
+        }
+    );
+
+    // ties go to the lowest facet index, whichever thread found it
+    unsigned int best = 0;
+
+    for ( unsigned int batch = 1; batch < batchCount; batch++ )
+    {
+        if ( nearest[batch] < nearest[best] ) best = batch;
+    }
+
+    return nearestFacet[best];
+}
+
+
+/**
+ * @brief   Copies the framebuffer to a graphics context
+ *
+ * The pixels are copied straight into the back buffer when the window is
+ * the size of the framebuffer, as Rasterizer::blit does.
+ *
+ * @param   *gc     The graphics context to copy to
+ *
+ * @return  void
+ */
+void CpuRenderer::blit( GraphicsContext *gc ) const
+{
+    if ( frameBuffer.empty() ) return;
+
+    ProfileRange readbackRange( FrameProfiler::STAGE_READBACK, false );
+
+    unsigned int *backBuffer = gc->getBackBuffer();
+
+    if ( ( backBuffer != nullptr ) &&
+         ( ( unsigned int ) gc->getWindowWidth() == width ) &&
+         ( ( unsigned int ) gc->getWindowHeight() == height ) )
+    {
+        memcpy( backBuffer, frameBuffer.data(), frameBuffer.size() * sizeof( unsigned int ) );
+        return;
+    }
+
+    gc->drawImage( frameBuffer.data(), width, height );
+}
+
+
+/**
+ * @brief   Copies the framebuffer out
+ *
+ * @param   *pixels     The row-major pixels to write, width * height of them
+ *
+ * @return  void
+ */
+void CpuRenderer::download( unsigned int *pixels ) const
+{
+    if ( frameBuffer.empty() ) return;
+
+    ProfileRange readbackRange( FrameProfiler::STAGE_READBACK, false );
+
+    memcpy( pixels, frameBuffer.data(), frameBuffer.size() * sizeof( unsigned int ) );
+}
+
+
+/**
+ * @brief   Gets the width of the framebuffer
+ *
+ * @param   void
+ *
+ * @return  The width of the framebuffer in pixels
+ */
+unsigned int CpuRenderer::getWidth() const
+{
+    return width;
+}
+
+
+/**
+ * @brief   Gets the height of the framebuffer
+ *
+ * @param   void
+ *
+ * @return  The height of the framebuffer in pixels
+ */
+unsigned int CpuRenderer::getHeight() const
+{
+    return height;
+}
+
+
+/**
+ * @brief   Gets the number of threads a frame is drawn with
+ *
+ * @param   void
+ *
+ * @return  The number of threads, including the calling one
+ */
+unsigned int CpuRenderer::getThreadCount() const
+{
+    return pool->getThreadCount();
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Applies the view transform to every vertex of a mesh, keeping
+ *          the device-space x and y
+ *
+ * @param   &mesh       The mesh to transform
+ * @param   transform   The view transform
+ *
+ * @return  void
+ */
+void CpuRenderer::transformVertices(
+    const Mesh &mesh,
+    const float transform[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM]
+)
+{
+    unsigned int vertexCount = mesh.getVertexCount();
+
+    deviceX.resize( vertexCount );
+    deviceY.resize( vertexCount );
+
+    const float *x = mesh.getX();
+    const float *y = mesh.getY();
+    const float *z = mesh.getZ();
+
+    bool vector = hasVectorTransform();
+    unsigned int batchCount = ( vertexCount + TRANSFORM_BATCH - 1 ) / TRANSFORM_BATCH;
+
+    pool->parallelFor( batchCount, [&]( unsigned int batch )
+        {
+            unsigned int begin = batch * TRANSFORM_BATCH;
+            unsigned int end = std::min( begin + TRANSFORM_BATCH, vertexCount );
+
+# ifdef CPU_RENDERER_AVX2
+            if ( vector )
+            {
+                transformAvx2( x, y, z, begin, end, transform, deviceX.data(), deviceY.data() );
+                return;
+            }
+# endif
+
+            transformScalar( x, y, z, begin, end, transform, deviceX.data(), deviceY.data() );
+        }
+    );
+}
+
+
+/**
+ * @brief   Sorts the segments that can reach the window into the bands of
+ *          rows they cross
+ *
+ * Each batch of elements is culled and counted per band in parallel, the
+ * counts are turned into offsets, and each batch then writes its segments
+ * to its own slice of every band. A band ends up with its segments in
+ * element order, so a frame is drawn the same no matter how the batches
+ * were scheduled.
+ *
+ * @param   *elements       The triangle index buffer, or the unique edge list
+ * @param   elementCount    The number of facets or edges
+ * @param   facets          True to bin the edges of the front-facing facets,
+ *                          false to bin the unique edges
+ * @param   bandCount       The number of bands
+ * @param   bandHeight      The number of rows in each band
+ *
+ * @return  void
+ */
+void CpuRenderer::binSegments(
+    const unsigned int *elements, unsigned int elementCount, bool facets,
+    unsigned int bandCount, unsigned int bandHeight
+)
+{
+    unsigned int segmentsPerElement = facets ? Mesh::FACET_DIM : 1;
+    unsigned int batchCount = ( elementCount + SEGMENT_BATCH - 1 ) / SEGMENT_BATCH;
+
+    segmentBands.resize( ( size_t ) elementCount * segmentsPerElement * 2 );
+    batchBandCounts.assign( ( size_t ) batchCount * bandCount, 0 );
+
+    float xMax = width - 1;
+    float yMax = height - 1;
+
+    pool->parallelFor( batchCount, [&]( unsigned int batch )
+        {
+            unsigned int *counts = batchBandCounts.data() + ( size_t ) batch * bandCount;
+
+            unsigned int begin = batch * SEGMENT_BATCH;
+            unsigned int end = std::min( begin + SEGMENT_BATCH, elementCount );
+
+            for ( unsigned int element = begin; element < end; element++ )
+            {
+                bool visible = true;
+
+                if ( facets )
+                {
+                    const unsigned int *corners = elements + ( size_t ) element * Mesh::FACET_DIM;
+
+                    float x0 = deviceX[corners[0]];
+                    float y0 = deviceY[corners[0]];
+
+                    // z of the device-space normal, edge-on facets are kept,
+                    // as in markVisibleFacets
+                    float normalZ =
+                        ( deviceX[corners[1]] - x0 ) * ( deviceY[corners[2]] - y0 ) -
+                        ( deviceY[corners[1]] - y0 ) * ( deviceX[corners[2]] - x0 );
+
+                    visible = ( normalZ >= 0 );
+                }
+
+                for ( unsigned int i = 0; i < segmentsPerElement; i++ )
+                {
+                    unsigned int segment = element * segmentsPerElement + i;
+
+                    unsigned int start;
+                    unsigned int stop;
+                    segmentEnds( elements, facets, segment, start, stop );
+
+                    float left = std::min( deviceX[start], deviceX[stop] );
+                    float right = std::max( deviceX[start], deviceX[stop] );
+                    float top = std::min( deviceY[start], deviceY[stop] );
+                    float bottom = std::max( deviceY[start], deviceY[stop] );
+
+                    // an empty range for segments that cannot be seen
+                    unsigned int firstBand = 1;
+                    unsigned int lastBand = 0;
+
+                    // min and max drop a NaN end, and clipEdge drops the segment
+                    bool finite = std::isfinite( deviceX[start] ) && std::isfinite( deviceX[stop] ) &&
+                                  std::isfinite( deviceY[start] ) && std::isfinite( deviceY[stop] );
+
+                    if ( visible && finite && ( right >= 0 ) && ( left <= xMax ) && ( bottom >= 0 ) && ( top <= yMax ) )
+                    {
+                        // a row of slack either way for the rounding of the
+                        // clipped end points
+                        firstBand = ( unsigned int ) std::max( top - 1, 0.0f ) / bandHeight;
+                        lastBand = ( unsigned int ) std::min( bottom + 1, yMax ) / bandHeight;
+
+                        for ( unsigned int band = firstBand; band <= lastBand; band++ ) counts[band]++;
+                    }
+
+                    segmentBands[( size_t ) segment * 2] = firstBand;
+                    segmentBands[( size_t ) segment * 2 + 1] = lastBand;
+                }
+            }
+        }
+    );
+
+    // every band holds the slices of the batches in order
+    bandOffsets.resize( bandCount + 1 );
+
+    unsigned int total = 0;
+
+    for ( unsigned int band = 0; band < bandCount; band++ )
+    {
+        bandOffsets[band] = total;
+
+        for ( unsigned int batch = 0; batch < batchCount; batch++ )
+        {
+            unsigned int &count = batchBandCounts[( size_t ) batch * bandCount + band];
+            unsigned int sliceOffset = total;
+
+            total += count;
+            count = sliceOffset;
+        }
+    }
+
+    bandOffsets[bandCount] = total;
+    bandSegments.resize( total );
+
+    pool->parallelFor( batchCount, [&]( unsigned int batch )
+        {
+            unsigned int *offsets = batchBandCounts.data() + ( size_t ) batch * bandCount;
+
+            unsigned int begin = batch * SEGMENT_BATCH;
+            unsigned int end = std::min( begin + SEGMENT_BATCH, elementCount );
+
+            for ( unsigned int segment = begin * segmentsPerElement; segment < end * segmentsPerElement; segment++ )
+            {
+                unsigned int firstBand = segmentBands[( size_t ) segment * 2];
+                unsigned int lastBand = segmentBands[( size_t ) segment * 2 + 1];
+
+                for ( unsigned int band = firstBand; band <= lastBand; band++ )
+                {
+                    bandSegments[offsets[band]++] = segment;
+                }
+            }
+        }
+    );
+}
+
+
+/**
+ * @brief   Draws the binned segments, one band of rows per task
+ *
+ * Every band only writes its own rows, so the bands can be drawn by any
+ * number of threads at once without races.
+ *
+ * @param   *elements   The triangle index buffer, or the unique edge list
+ * @param   facets      True if the elements are facets, false for edges
+ * @param   bandCount   The number of bands
+ * @param   bandHeight  The number of rows in each band
+ * @param   color       The 24-bit RGB color to draw with
+ *
+ * @return  void
+ */
+void CpuRenderer::drawBands(
+    const unsigned int *elements, bool facets,
+    unsigned int bandCount, unsigned int bandHeight,
+    unsigned int color
+)
+{
+    pool->parallelFor( bandCount, [&]( unsigned int band )
+        {
+            unsigned int rowBegin = band * bandHeight;
+            unsigned int rowEnd = std::min( rowBegin + bandHeight, height );
+
+            for ( unsigned int i = bandOffsets[band]; i < bandOffsets[band + 1]; i++ )
+            {
+                unsigned int start;
+                unsigned int stop;
+                segmentEnds( elements, facets, bandSegments[i], start, stop );
+
+                drawLine(
+                    frameBuffer.data(), width, height,
+                    deviceX[start], deviceY[start], deviceX[stop], deviceY[stop],
+                    color,
+                    rowBegin, rowEnd
+                );
+            }
+        }
+    );
+}
+
+
+/* -------------------------------------------------------------------------- */
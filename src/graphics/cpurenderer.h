@@ -0,0 +1,147 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    cpurenderer.h
+ * @brief   Multi-threaded host renderer for machines without a GPU device
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_CPURENDERER_H
+# define GRAPHICS_CPURENDERER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <memory>
+# include <vector>
+
+# include "gcontext.h"
+# include "mesh.h"
+# include "threadpool.h"
+# include "viewcontext.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A CPU renderer draws a host-resident mesh into a host framebuffer with
+ * the same transform, back-face rule and line rasterizer as the device
+ * path, so a machine without a CUDA device still gets the same picture.
+ * The vertex transform runs eight vertices at a time with AVX2 when the
+ * processor has it. The framebuffer is cut into horizontal bands that are
+ * handed out to a thread pool, and every segment is binned to the bands it
+ * crosses first, so no two threads ever write the same pixel.
+ */
+class CpuRenderer
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int TRANSFORM_BATCH = 1 << 14;
+    static constexpr unsigned int SEGMENT_BATCH = 1 << 14;
+    static constexpr unsigned int PICK_BATCH = 1 << 14;
+
+    // more bands than threads keeps the threads busy when the model only
+    // covers part of the window
+    static constexpr unsigned int BANDS_PER_THREAD = 4;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    CpuRenderer();
+    CpuRenderer( const CpuRenderer &renderer ) = delete;
+
+    ~CpuRenderer();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    CpuRenderer &operator=( const CpuRenderer &renderer ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static bool hasVectorTransform();
+
+    void resize( unsigned int width, unsigned int height );
+    void clear( unsigned int color );
+
+    void draw( const Mesh &mesh, const ViewContext *vc, bool cullBackFaces, unsigned int color );
+    void draw( const Mesh &mesh, const Mat4f &modelTransform, bool cullBackFaces, unsigned int color );
+    int pick( const Mesh &mesh, const ViewContext *vc, int x, int y ) const;
+
+    void blit( GraphicsContext *gc ) const;
+    void download( unsigned int *pixels ) const;
+
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+    unsigned int getThreadCount() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    std::vector<unsigned int> frameBuffer = std::vector<unsigned int>();
+
+    // device-space x and y of every vertex
+    std::vector<float> deviceX = std::vector<float>();
+    std::vector<float> deviceY = std::vector<float>();
+
+    // the first and last band of every segment, the number of segments
+    // each batch puts in each band, and the segments of every band
+    std::vector<unsigned int> segmentBands = std::vector<unsigned int>();
+    std::vector<unsigned int> batchBandCounts = std::vector<unsigned int>();
+    std::vector<unsigned int> bandOffsets = std::vector<unsigned int>();
+    std::vector<unsigned int> bandSegments = std::vector<unsigned int>();
+
+    std::unique_ptr<ThreadPool> pool = std::unique_ptr<ThreadPool>( new ThreadPool() );
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void transformVertices( const Mesh &mesh, const float transform[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM] );
+
+    void binSegments(
+        const unsigned int *elements, unsigned int elementCount, bool facets,
+        unsigned int bandCount, unsigned int bandHeight
+    );
+
+    void drawBands(
+        const unsigned int *elements, bool facets,
+        unsigned int bandCount, unsigned int bandHeight,
+        unsigned int color
+    );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_CPURENDERER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,470 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    culler.cpp
+ * @brief   GPU off-screen and back-face culling with stream compaction
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <thrust/device_ptr.h>
+# include <thrust/execution_policy.h>
+# include <thrust/scan.h>
+
+# include "cudaerr.cuh"
+# include "culler.h"
+# include "mesh.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+const unsigned int CULL_BLOCK_SIZE = 256;
+
+const unsigned int OUTCODE_LEFT = 1;
+const unsigned int OUTCODE_RIGHT = 2;
+const unsigned int OUTCODE_BOTTOM = 4;
+const unsigned int OUTCODE_TOP = 8;
+
+
+/* ---------------------------- Device Functions ---------------------------- */
+
+
+/**
+ * @brief   Classifies a point against the rectangle [0, xMax] x [0, yMax],
+ *          the same rectangle the rasterizer clips to
+ *
+ * @param   x       The x-coordinate of the point
+ * @param   y       The y-coordinate of the point
+ * @param   xMax    The largest x-coordinate in the rectangle
+ * @param   yMax    The largest y-coordinate in the rectangle
+ *
+ * @return  The Cohen-Sutherland outcode of the point, 0 if it is inside
+ */
+__device__ unsigned int outcode( float x, float y, float xMax, float yMax )
+{
+    unsigned int code = 0;
+
+    if ( x < 0 ) code |= OUTCODE_LEFT;
+    else if ( x > xMax ) code |= OUTCODE_RIGHT;
+
+    if ( y < 0 ) code |= OUTCODE_BOTTOM;
+    else if ( y > yMax ) code |= OUTCODE_TOP;
+
+    return code;
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a culler with no scratch buffers allocated
+ *
+ * @param   void
+ *
+ * @return  The created culler
+ */
+Culler::Culler() = default;
+
+
+/**
+ * @brief   Culler destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+Culler::~Culler()
+{
+    freeDevice();
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Culls the edges that lie entirely on one side outside the window
+ *
+ * @param   *d_vertices     The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *d_edges        The device edge list, two vertex indices per edge
+ * @param   edgeCount       The number of edges
+ * @param   width           The width of the window in pixels
+ * @param   height          The height of the window in pixels
+ *
+ * @return  The number of surviving edges, see getDeviceSurvivors
+ */
+unsigned int Culler::cullEdges(
+    const float *d_vertices, unsigned int vertexStride,
+    const unsigned int *d_edges, unsigned int edgeCount,
+    unsigned int width, unsigned int height
+)
+{
+    if ( ( edgeCount == 0 ) || ( width == 0 ) || ( height == 0 ) ) return 0;
+
+    reserve( edgeCount, Mesh::EDGE_DIM );
+
+    unsigned int blocks = ( edgeCount + CULL_BLOCK_SIZE - 1 ) / CULL_BLOCK_SIZE;
+
+    markVisibleEdges<<<blocks, CULL_BLOCK_SIZE>>>(
+        d_vertices, vertexStride,
+        d_edges, edgeCount,
+        width, height,
+        d_flags
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    return compact( d_edges, edgeCount, Mesh::EDGE_DIM );
+}
+
+
+/**
+ * @brief   Culls the facets that lie entirely on one side outside the window
+ *          and, if back-face culling is enabled, the facets that face away
+ *          from the viewer
+ *
+ * @param   *d_vertices     The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *d_indices      The device triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   width           The width of the window in pixels
+ * @param   height          The height of the window in pixels
+ *
+ * @return  The number of surviving facets, see getDeviceSurvivors
+ */
+unsigned int Culler::cullFacets(
+    const float *d_vertices, unsigned int vertexStride,
+    const unsigned int *d_indices, unsigned int facetCount,
+    unsigned int width, unsigned int height
+)
+{
+    if ( ( facetCount == 0 ) || ( width == 0 ) || ( height == 0 ) ) return 0;
+
+    reserve( facetCount, Mesh::FACET_DIM );
+
+    unsigned int blocks = ( facetCount + CULL_BLOCK_SIZE - 1 ) / CULL_BLOCK_SIZE;
+
+    markVisibleFacets<<<blocks, CULL_BLOCK_SIZE>>>(
+        d_vertices, vertexStride,
+        d_indices, facetCount,
+        width, height,
+        cullBackFaces,
+        d_flags
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    return compact( d_indices, facetCount, Mesh::FACET_DIM );
+}
+
+
+/**
+ * @brief   Gets the elements that survived the last cull
+ *
+ * @param   void
+ *
+ * @return  A device pointer to the compacted edge list or index buffer
+ */
+const unsigned int *Culler::getDeviceSurvivors() const
+{
+    return d_survivors;
+}
+
+
+/**
+ * @brief   Sets whether cullFacets also culls back-facing facets
+ *
+ * @param   enabled     True to cull back-facing facets, false to keep them
+ *
+ * @return  void
+ */
+void Culler::setBackFaceCulling( bool enabled )
+{
+    cullBackFaces = enabled;
+}
+
+
+/**
+ * @brief   Determines if cullFacets also culls back-facing facets
+ *
+ * @param   void
+ *
+ * @return  True if back-facing facets are culled, false otherwise
+ */
+bool Culler::isBackFaceCulling() const
+{
+    return cullBackFaces;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Grows the scratch buffers to fit a cull, keeping them if they
+ *          are already large enough
+ *
+ * @param   elementCount    The number of elements to cull
+ * @param   elementDim      The number of indices per element
+ *
+ * @return  void
+ */
+void Culler::reserve( unsigned int elementCount, unsigned int elementDim )
+{
+    size_t survivorCount = ( size_t ) elementCount * elementDim;
+
+    if ( elementCount > elementCapacity )
+    {
+        if ( d_flags != nullptr ) HANDLE_CUDA_ERROR( cudaFree( d_flags ) );
+        if ( d_offsets != nullptr ) HANDLE_CUDA_ERROR( cudaFree( d_offsets ) );
+
+        HANDLE_CUDA_ERROR(
+            cudaMalloc( &d_flags, elementCount * sizeof( unsigned int ) )
+        );
+
+        HANDLE_CUDA_ERROR(
+            cudaMalloc( &d_offsets, elementCount * sizeof( unsigned int ) )
+        );
+
+        elementCapacity = elementCount;
+    }
+
+    if ( survivorCount > survivorCapacity )
+    {
+        if ( d_survivors != nullptr ) HANDLE_CUDA_ERROR( cudaFree( d_survivors ) );
+
+        HANDLE_CUDA_ERROR(
+            cudaMalloc( &d_survivors, survivorCount * sizeof( unsigned int ) )
+        );
+
+        survivorCapacity = survivorCount;
+    }
+}
+
+
+/**
+ * @brief   Compacts the flagged elements into the survivor buffer
+ *
+ * An inclusive scan of the flags gives every survivor its position, plus
+ * one, in the compacted list; the last entry is the survivor count.
+ *
+ * @param   *d_elements     The device elements that were flagged
+ * @param   elementCount    The number of elements
+ * @param   elementDim      The number of indices per element
+ *
+ * @return  The number of surviving elements
+ */
+unsigned int Culler::compact( const unsigned int *d_elements, unsigned int elementCount, unsigned int elementDim )
+{
+    thrust::device_ptr<unsigned int> flags( d_flags );
+    thrust::device_ptr<unsigned int> offsets( d_offsets );
+
+    thrust::inclusive_scan( thrust::device, flags, flags + elementCount, offsets );
+
+    unsigned int survivorCount;
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) &survivorCount,
+            ( void * ) ( d_offsets + elementCount - 1 ),
+            sizeof( unsigned int ),
+            cudaMemcpyDeviceToHost
+        )
+    );
+
+    // nothing to scatter
+    if ( survivorCount == 0 ) return 0;
+
+    unsigned int blocks = ( elementCount + CULL_BLOCK_SIZE - 1 ) / CULL_BLOCK_SIZE;
+
+    scatterSurvivors<<<blocks, CULL_BLOCK_SIZE>>>(
+        d_elements, elementCount, elementDim,
+        d_flags, d_offsets,
+        d_survivors
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    return survivorCount;
+}
+
+
+/**
+ * @brief   Frees the scratch buffers of this culler
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Culler::freeDevice()
+{
+    if ( d_flags != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_flags ) );
+        d_flags = nullptr;
+    }
+
+    if ( d_offsets != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_offsets ) );
+        d_offsets = nullptr;
+    }
+
+    if ( d_survivors != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_survivors ) );
+        d_survivors = nullptr;
+    }
+
+    elementCapacity = 0;
+    survivorCapacity = 0;
+}
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+/**
+ * @brief   Flags the edges that may cross the window, one thread per edge
+ *
+ * An edge is rejected when both of its end points are outside the same
+ * side of the window, which is exact for the rectangle the rasterizer
+ * clips to, and conservative for edges that pass a corner.
+ *
+ * @param   *vertices       The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *edges          The edge list, two vertex indices per edge
+ * @param   edgeCount       The number of edges
+ * @param   width           The width of the window in pixels
+ * @param   height          The height of the window in pixels
+ * @param   *flags          The flags to write, 1 for visible and 0 for culled
+ *
+ * @return  void
+ */
+__global__ void markVisibleEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * edges, unsigned int edgeCount,
+    unsigned int width, unsigned int height,
+    unsigned int * flags
+)
+{
+    unsigned int edgeIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( edgeIdx >= edgeCount ) return;
+
+    unsigned int start = edges[edgeIdx * Mesh::EDGE_DIM + 0];
+    unsigned int end = edges[edgeIdx * Mesh::EDGE_DIM + 1];
+
+    float xMax = width - 1;
+    float yMax = height - 1;
+
+    unsigned int code =
+        outcode( vertices[start], vertices[vertexStride + start], xMax, yMax ) &
+        outcode( vertices[end], vertices[vertexStride + end], xMax, yMax );
+
+    flags[edgeIdx] = ( code == 0 ) ? 1 : 0;
+}
+
+
+/**
+ * @brief   Flags the facets that may be seen in the window, one thread per
+ *          facet
+ *
+ * A facet is rejected when all three of its corners are outside the same
+ * side of the window. With cullBackFaces, it is also rejected when its
+ * normal points along ViewContext::getLookVector. The view is orthographic
+ * and flips y, which makes that exactly the case where the z of its
+ * device-space normal is negative, so the look vector is never needed.
+ *
+ * @param   *vertices       The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *indices        The triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   width           The width of the window in pixels
+ * @param   height          The height of the window in pixels
+ * @param   cullBackFaces   Whether to reject back-facing facets
+ * @param   *flags          The flags to write, 1 for visible and 0 for culled
+ *
+ * @return  void
+ */
+__global__ void markVisibleFacets(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    unsigned int width, unsigned int height,
+    bool cullBackFaces,
+    unsigned int * flags
+)
+{
+    unsigned int facetIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( facetIdx >= facetCount ) return;
+
+    float x[Mesh::FACET_DIM];
+    float y[Mesh::FACET_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+    {
+        unsigned int vertIdx = indices[facetIdx * Mesh::FACET_DIM + i];
+
+        x[i] = vertices[vertIdx];
+        y[i] = vertices[vertexStride + vertIdx];
+    }
+
+    float xMax = width - 1;
+    float yMax = height - 1;
+
+    unsigned int code =
+        outcode( x[0], y[0], xMax, yMax ) &
+        outcode( x[1], y[1], xMax, yMax ) &
+        outcode( x[2], y[2], xMax, yMax );
+
+    bool visible = ( code == 0 );
+
+    if ( visible && cullBackFaces )
+    {
+        // z of the device-space normal, edge-on facets are kept
+        float normalZ = ( x[1] - x[0] ) * ( y[2] - y[0] ) - ( y[1] - y[0] ) * ( x[2] - x[0] );
+
+        visible = ( normalZ >= 0 );
+    }
+
+    flags[facetIdx] = visible ? 1 : 0;
+}
+
+
+/**
+ * @brief   Copies every flagged element to its compacted position, one
+ *          thread per element
+ *
+ * @param   *elements       The elements that were flagged
+ * @param   elementCount    The number of elements
+ * @param   elementDim      The number of indices per element
+ * @param   *flags          The visibility flags of the elements
+ * @param   *offsets        The inclusive prefix sum of the flags
+ * @param   *survivors      The compacted elements to write
+ *
+ * @return  void
+ */
+__global__ void scatterSurvivors(
+    const unsigned int * elements, unsigned int elementCount, unsigned int elementDim,
+    const unsigned int * flags, const unsigned int * offsets,
+    unsigned int * survivors
+)
+{
+    unsigned int elementIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( ( elementIdx >= elementCount ) || ( flags[elementIdx] == 0 ) ) return;
+
+    unsigned int survivorIdx = offsets[elementIdx] - 1;
+
+    for ( unsigned int i = 0; i < elementDim; i++ )
+    {
+        survivors[survivorIdx * elementDim + i] = elements[elementIdx * elementDim + i];
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
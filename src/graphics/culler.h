@@ -0,0 +1,130 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    culler.h
+ * @brief   GPU off-screen and back-face culling with stream compaction
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_CULLER_H
+# define GRAPHICS_CULLER_H
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * Culls device-space edges or facets before they are rasterized. Each
+ * element is flagged visible or not, the flags are prefix-summed and the
+ * survivors scattered into a compact list, so rasterization only launches
+ * threads for what can actually reach the window. The scratch buffers only
+ * ever grow and are kept between frames.
+ */
+class Culler
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    Culler();
+    Culler( const Culler &culler ) = delete;
+
+    ~Culler();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    Culler &operator=( const Culler &culler ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    unsigned int cullEdges(
+        const float *d_vertices, unsigned int vertexStride,
+        const unsigned int *d_edges, unsigned int edgeCount,
+        unsigned int width, unsigned int height
+    );
+
+    unsigned int cullFacets(
+        const float *d_vertices, unsigned int vertexStride,
+        const unsigned int *d_indices, unsigned int facetCount,
+        unsigned int width, unsigned int height
+    );
+
+    const unsigned int *getDeviceSurvivors() const;
+
+    void setBackFaceCulling( bool enabled );
+    bool isBackFaceCulling() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    bool cullBackFaces = false;
+
+    unsigned int elementCapacity = 0;
+    size_t survivorCapacity = 0;
+
+    unsigned int * d_flags = nullptr;
+    unsigned int * d_offsets = nullptr;
+    unsigned int * d_survivors = nullptr;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void reserve( unsigned int elementCount, unsigned int elementDim );
+    unsigned int compact( const unsigned int *d_elements, unsigned int elementCount, unsigned int elementDim );
+
+    void freeDevice();
+
+
+    /* ====================================================================== */
+};
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+__global__ void markVisibleEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * edges, unsigned int edgeCount,
+    unsigned int width, unsigned int height,
+    unsigned int * flags
+);
+
+__global__ void markVisibleFacets(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    unsigned int width, unsigned int height,
+    bool cullBackFaces,
+    unsigned int * flags
+);
+
+__global__ void scatterSurvivors(
+    const unsigned int * elements, unsigned int elementCount, unsigned int elementDim,
+    const unsigned int * flags, const unsigned int * offsets,
+    unsigned int * survivors
+);
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_CULLER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,560 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    frameprofiler.cpp
+ * @brief   Per-stage frame timing with rolling percentiles
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cmath>
+# include <cstdlib>
+# include <iomanip>
+
+# if defined( __has_include )
+# if __has_include( <nvtx3/nvToolsExt.h> )
+# define FRAME_PROFILER_NVTX
+# include <nvtx3/nvToolsExt.h>
+# endif
+# endif
+
+# include "cudaerr.cuh"
+# include "frameprofiler.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+const char * const STAGE_NAMES[FrameProfiler::STAGE_COUNT] = {
+    "upload", "transform", "cull", "depth", "raster", "readback", "present", "frame"
+};
+
+
+/* ---------------------------- Helper Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the time between two host clock readings
+ *
+ * @param   start   The earlier reading
+ * @param   end     The later reading
+ *
+ * @return  The time between the readings in milliseconds
+ */
+static double elapsedMilliseconds(
+    std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end
+)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count() / 1000000.0;
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates the frame profiler, enabled if RENDER_PROFILE is set
+ *
+ * @param   void
+ *
+ * @return  The created frame profiler
+ */
+FrameProfiler::FrameProfiler() : enabled( getenv( "RENDER_PROFILE" ) != nullptr )
+{}
+
+
+/**
+ * @brief   Frame profiler destructor
+ *
+ * This runs at exit, when the runtime may already be gone, so the events
+ * are destroyed without checking for errors.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+FrameProfiler::~FrameProfiler()
+{
+    for ( cudaEvent_t event : events ) cudaEventDestroy( event );
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the frame profiler shared by every stage of the pipeline
+ *
+ * @param   void
+ *
+ * @return  The frame profiler
+ */
+FrameProfiler &FrameProfiler::getInstance()
+{
+    static FrameProfiler profiler;
+    return profiler;
+}
+
+
+/**
+ * @brief   Gets the name a stage is reported and shown in Nsight with
+ *
+ * @param   stage   The stage
+ *
+ * @return  The name of the stage
+ */
+const char *FrameProfiler::getStageName( Stage stage )
+{
+    return STAGE_NAMES[stage];
+}
+
+
+/**
+ * @brief   Turns timing on or off, clearing the history when it is turned on
+ *
+ * @param   enabled     True to time the stages, false to only mark them
+ *
+ * @return  void
+ */
+void FrameProfiler::setEnabled( bool enabled )
+{
+    if ( enabled && !this->enabled ) reset();
+
+    this->enabled = enabled;
+}
+
+
+/**
+ * @brief   Determines if the stages are timed
+ *
+ * @param   void
+ *
+ * @return  True if the stages are timed, false otherwise
+ */
+bool FrameProfiler::isEnabled() const
+{
+    return enabled;
+}
+
+
+/**
+ * @brief   Starts timing a frame on the calling thread
+ *
+ * The first frame looks for a device to time the device stages on.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FrameProfiler::beginFrame()
+{
+    if ( !enabled ) return;
+
+    if ( eventDevice < 0 )
+    {
+        int deviceCount = 0;
+
+        // no driver or no devices, which leaves the host clock
+        if ( cudaGetDeviceCount( &deviceCount ) != cudaSuccess )
+        {
+            cudaGetLastError();
+            deviceCount = 0;
+        }
+
+        eventDevice = 0;
+        deviceTiming = ( deviceCount > 0 );
+
+        if ( deviceTiming ) HANDLE_CUDA_ERROR( cudaGetDevice( &eventDevice ) );
+    }
+
+    frameThread = std::this_thread::get_id();
+    frameStart = std::chrono::steady_clock::now();
+    inFrame = true;
+
+    ranges.clear();
+    eventsUsed = 0;
+}
+
+
+/**
+ * @brief   Finishes the frame and adds the time of every stage it ran to the
+ *          history
+ *
+ * It must be called once the frame is on the host, so its events have
+ * already completed and reading them does not stall.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FrameProfiler::endFrame()
+{
+    if ( !inFrame || ( std::this_thread::get_id() != frameThread ) ) return;
+
+    inFrame = false;
+
+    double stageTimes[STAGE_COUNT] = {};
+    bool stageRan[STAGE_COUNT] = {};
+
+    for ( const Range &range : ranges )
+    {
+        if ( !range.ended ) continue;
+
+        double milliseconds = range.hostMilliseconds;
+
+        if ( range.onDevice )
+        {
+            float deviceMilliseconds = 0;
+
+            HANDLE_CUDA_ERROR( cudaEventSynchronize( range.stop ) );
+            HANDLE_CUDA_ERROR( cudaEventElapsedTime( &deviceMilliseconds, range.start, range.stop ) );
+
+            milliseconds = deviceMilliseconds;
+        }
+
+        stageTimes[range.stage] += milliseconds;
+        stageRan[range.stage] = true;
+    }
+
+    auto frameEnd = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    for ( unsigned int stage = 0; stage < STAGE_FRAME; stage++ )
+    {
+        if ( stageRan[stage] ) recordSample( ( Stage ) stage, stageTimes[stage] );
+    }
+
+    recordSample( STAGE_FRAME, elapsedMilliseconds( frameStart, frameEnd ) );
+
+    frameEnds[nextFrameEnd] = frameEnd;
+    nextFrameEnd = ( nextFrameEnd + 1 ) % HISTORY_FRAMES;
+    if ( frameEndCount < HISTORY_FRAMES ) frameEndCount++;
+}
+
+
+/**
+ * @brief   Starts a range of a stage
+ *
+ * The range is always marked for Nsight, but only timed while the
+ * profiler is enabled, inside a frame, on the thread drawing it and, for a
+ * device range, on the device the frame started on.
+ *
+ * @param   stage       The stage the range belongs to
+ * @param   onDevice    True to time the range on the device, false for the
+ *                      host clock
+ * @param   stream      The stream the range's device work runs on
+ *
+ * @return  The range to end, or NO_RANGE if it is not timed
+ */
+unsigned int FrameProfiler::beginRange( Stage stage, bool onDevice, cudaStream_t stream )
+{
+# ifdef FRAME_PROFILER_NVTX
+    nvtxRangePushA( STAGE_NAMES[stage] );
+# endif
+
+    if ( !enabled || ( std::this_thread::get_id() != frameThread ) || !inFrame ) return NO_RANGE;
+
+    Range range;
+    range.stage = stage;
+    range.onDevice = onDevice && deviceTiming;
+
+    if ( range.onDevice )
+    {
+        int device = 0;
+        HANDLE_CUDA_ERROR( cudaGetDevice( &device ) );
+
+        // events can only be recorded on the device they were created on
+        if ( device != eventDevice ) return NO_RANGE;
+
+        range.stream = stream;
+        range.start = takeEvent();
+        range.stop = takeEvent();
+
+        HANDLE_CUDA_ERROR( cudaEventRecord( range.start, stream ) );
+    }
+    else
+    {
+        range.hostStart = std::chrono::steady_clock::now();
+    }
+
+    ranges.push_back( range );
+
+    return ranges.size() - 1;
+}
+
+
+/**
+ * @brief   Ends a range of a stage
+ *
+ * @param   range   The range returned by beginRange
+ *
+ * @return  void
+ */
+void FrameProfiler::endRange( unsigned int range )
+{
+# ifdef FRAME_PROFILER_NVTX
+    nvtxRangePop();
+# endif
+
+    if ( ( range == NO_RANGE ) || ( range >= ranges.size() ) ) return;
+
+    Range &timed = ranges[range];
+
+    if ( timed.onDevice )
+    {
+        HANDLE_CUDA_ERROR( cudaEventRecord( timed.stop, timed.stream ) );
+    }
+    else
+    {
+        timed.hostMilliseconds = elapsedMilliseconds( timed.hostStart, std::chrono::steady_clock::now() );
+    }
+
+    timed.ended = true;
+}
+
+
+/**
+ * @brief   Adds a time that was measured outside of a frame to the history,
+ *          from any thread
+ *
+ * @param   stage           The stage the time belongs to
+ * @param   milliseconds    The time the stage took
+ *
+ * @return  void
+ */
+void FrameProfiler::addSample( Stage stage, double milliseconds )
+{
+    if ( !enabled ) return;
+
+    std::lock_guard<std::mutex> lock( mutex );
+    recordSample( stage, milliseconds );
+}
+
+
+/**
+ * @brief   Gets a percentile of the recent times of a stage
+ *
+ * @param   stage           The stage
+ * @param   percentile      The percentile, from 0 to 100
+ * @param   *milliseconds   The time at the percentile, written
+ *
+ * @return  True if the stage has any samples, false otherwise
+ */
+bool FrameProfiler::getPercentile( Stage stage, double percentile, double *milliseconds ) const
+{
+    std::vector<double> sorted;
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        sorted.assign( samples[stage], samples[stage] + sampleCounts[stage] );
+    }
+
+    if ( sorted.empty() ) return false;
+
+    // nearest rank
+    long rank = ( long ) std::ceil( percentile / 100 * sorted.size() ) - 1;
+    size_t index = std::min( ( size_t ) std::max( rank, 0l ), sorted.size() - 1 );
+
+    std::nth_element( sorted.begin(), sorted.begin() + index, sorted.end() );
+    *milliseconds = sorted[index];
+
+    return true;
+}
+
+
+/**
+ * @brief   Gets the rate frames were recently finished at
+ *
+ * @param   void
+ *
+ * @return  The frames per second over the history, or 0 with fewer than
+ *          two frames
+ */
+double FrameProfiler::getFramesPerSecond() const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+
+    if ( frameEndCount < 2 ) return 0;
+
+    unsigned int oldest = ( frameEndCount < HISTORY_FRAMES ) ? 0 : nextFrameEnd;
+    unsigned int newest = ( nextFrameEnd + HISTORY_FRAMES - 1 ) % HISTORY_FRAMES;
+
+    double seconds = elapsedMilliseconds( frameEnds[oldest], frameEnds[newest] ) / 1000;
+
+    return ( seconds > 0 ) ? ( frameEndCount - 1 ) / seconds : 0;
+}
+
+
+/**
+ * @brief   Gets the number of recent times kept for a stage
+ *
+ * @param   stage   The stage
+ *
+ * @return  The number of samples, at most HISTORY_FRAMES
+ */
+unsigned int FrameProfiler::getSampleCount( Stage stage ) const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    return sampleCounts[stage];
+}
+
+
+/**
+ * @brief   Writes the frame rate and the p50, p95 and p99 of every stage
+ *          with samples to an output stream
+ *
+ * @param   &os     The output stream to write to
+ *
+ * @return  void
+ */
+void FrameProfiler::report( std::ostream &os ) const
+{
+    const double percentiles[] = { 50, 95, 99 };
+
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+
+    os << std::fixed << std::setprecision( 3 );
+    os << "Frame Profile: " << getSampleCount( STAGE_FRAME ) << " frames, "
+       << getFramesPerSecond() << " fps" << std::endl;
+
+    for ( unsigned int stage = 0; stage < STAGE_COUNT; stage++ )
+    {
+        if ( getSampleCount( ( Stage ) stage ) == 0 ) continue;
+
+        os << "    " << std::left << std::setw( 10 ) << STAGE_NAMES[stage] << std::right;
+
+        for ( double percentile : percentiles )
+        {
+            double milliseconds = 0;
+            getPercentile( ( Stage ) stage, percentile, &milliseconds );
+
+            os << "  p" << ( int ) percentile << " " << std::setw( 9 ) << milliseconds << "ms";
+        }
+
+        os << std::endl;
+    }
+
+    os.flags( flags );
+    os.precision( precision );
+}
+
+
+/**
+ * @brief   Clears the history of every stage
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FrameProfiler::reset()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+
+    for ( unsigned int stage = 0; stage < STAGE_COUNT; stage++ )
+    {
+        sampleCounts[stage] = 0;
+        nextSamples[stage] = 0;
+    }
+
+    frameEndCount = 0;
+    nextFrameEnd = 0;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Takes the next unused event of the frame, creating it the first
+ *          time
+ *
+ * @param   void
+ *
+ * @return  The event
+ */
+cudaEvent_t FrameProfiler::takeEvent()
+{
+    if ( eventsUsed == events.size() )
+    {
+        cudaEvent_t event;
+        HANDLE_CUDA_ERROR( cudaEventCreate( &event ) );
+
+        events.push_back( event );
+    }
+
+    return events[eventsUsed++];
+}
+
+
+/**
+ * @brief   Adds a time to the history of a stage, dropping the oldest once
+ *          it is full; the mutex must be held
+ *
+ * @param   stage           The stage the time belongs to
+ * @param   milliseconds    The time the stage took
+ *
+ * @return  void
+ */
+void FrameProfiler::recordSample( Stage stage, double milliseconds )
+{
+    samples[stage][nextSamples[stage]] = milliseconds;
+
+    nextSamples[stage] = ( nextSamples[stage] + 1 ) % HISTORY_FRAMES;
+    if ( sampleCounts[stage] < HISTORY_FRAMES ) sampleCounts[stage]++;
+}
+
+
+/* ------------------------------ Profile Range ----------------------------- */
+
+
+/**
+ * @brief   Starts a range of a stage
+ *
+ * @param   stage       The stage the range belongs to
+ * @param   onDevice    True to time the range on the device, false for the
+ *                      host clock
+ * @param   stream      The stream the range's device work runs on
+ *
+ * @return  The started range
+ */
+ProfileRange::ProfileRange( FrameProfiler::Stage stage, bool onDevice, cudaStream_t stream ) :
+    range( FrameProfiler::getInstance().beginRange( stage, onDevice, stream ) )
+{}
+
+
+/**
+ * @brief   Profile range destructor, ends the range if it is still open
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+ProfileRange::~ProfileRange()
+{
+    end();
+}
+
+
+/**
+ * @brief   Ends the range before it goes out of scope
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ProfileRange::end()
+{
+    if ( !open ) return;
+
+    FrameProfiler::getInstance().endRange( range );
+    open = false;
+}
+
+
+/* -------------------------------------------------------------------------- */
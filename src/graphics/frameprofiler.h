@@ -0,0 +1,237 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    frameprofiler.h
+ * @brief   Per-stage frame timing with rolling percentiles
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_FRAMEPROFILER_H
+# define GRAPHICS_FRAMEPROFILER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <atomic>
+# include <chrono>
+# include <iostream>
+# include <mutex>
+# include <thread>
+# include <vector>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * The frame profiler times every stage of the pipeline without adding any
+ * synchronization of its own. Device stages are bracketed with CUDA events
+ * on the stream they run on and read back once the frame has been copied
+ * to the host, which waits for the device anyway; host stages, and every
+ * stage when there is no device, use the host clock. The last
+ * HISTORY_FRAMES samples of each stage are kept for percentiles, along with
+ * the times frames were finished for the frame rate.
+ *
+ * Every range is also an NVTX range when the NVTX headers are available,
+ * so the stages show up in Nsight whether or not the profiler is enabled.
+ * Timing itself is off until setEnabled, or RENDER_PROFILE in the
+ * environment, turns it on. Ranges are only timed on the thread drawing
+ * the frame and on the device it started on, which leaves out the
+ * secondary devices of a split mesh.
+ */
+class FrameProfiler
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ------------------------------- Types -------------------------------- */
+
+
+    enum Stage
+    {
+        STAGE_UPLOAD = 0,
+        STAGE_TRANSFORM,
+        STAGE_CULL,
+        STAGE_DEPTH,
+        STAGE_RASTER,
+        STAGE_READBACK,
+        STAGE_PRESENT,
+        STAGE_FRAME,
+        STAGE_COUNT
+    };
+
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int HISTORY_FRAMES = 240;
+    static constexpr unsigned int NO_RANGE = 0xFFFFFFFF;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    FrameProfiler( const FrameProfiler &profiler ) = delete;
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    FrameProfiler &operator=( const FrameProfiler &profiler ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static FrameProfiler &getInstance();
+    static const char *getStageName( Stage stage );
+
+    void setEnabled( bool enabled );
+    bool isEnabled() const;
+
+    void beginFrame();
+    void endFrame();
+
+    unsigned int beginRange( Stage stage, bool onDevice = true, cudaStream_t stream = 0 );
+    void endRange( unsigned int range );
+
+    void addSample( Stage stage, double milliseconds );
+
+    bool getPercentile( Stage stage, double percentile, double *milliseconds ) const;
+    double getFramesPerSecond() const;
+    unsigned int getSampleCount( Stage stage ) const;
+
+    void report( std::ostream &os ) const;
+    void reset();
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ------------------------------- Types -------------------------------- */
+
+
+    struct Range
+    {
+        Stage stage = STAGE_FRAME;
+        bool onDevice = false;
+
+        cudaStream_t stream = 0;
+        cudaEvent_t start = nullptr;
+        cudaEvent_t stop = nullptr;
+
+        std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::time_point();
+        double hostMilliseconds = 0;
+
+        bool ended = false;
+    };
+
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::atomic<bool> enabled;
+
+    // only touched by the thread drawing the frame
+    std::thread::id frameThread = std::thread::id();
+    bool inFrame = false;
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::time_point();
+
+    std::vector<Range> ranges = std::vector<Range>();
+    std::vector<cudaEvent_t> events = std::vector<cudaEvent_t>();
+    unsigned int eventsUsed = 0;
+
+    // -1 until the device is first looked for
+    int eventDevice = -1;
+    bool deviceTiming = false;
+
+    // the history is shared with the event thread
+    mutable std::mutex mutex;
+
+    double samples[STAGE_COUNT][HISTORY_FRAMES] = {};
+    unsigned int sampleCounts[STAGE_COUNT] = {};
+    unsigned int nextSamples[STAGE_COUNT] = {};
+
+    std::chrono::steady_clock::time_point frameEnds[HISTORY_FRAMES] = {};
+    unsigned int frameEndCount = 0;
+    unsigned int nextFrameEnd = 0;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    FrameProfiler();
+    ~FrameProfiler();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    cudaEvent_t takeEvent();
+    void recordSample( Stage stage, double milliseconds );
+
+
+    /* ====================================================================== */
+};
+
+
+/**
+ * A profile range times a block of code as one range of a stage, from its
+ * construction to its destruction or an earlier end
+ */
+class ProfileRange
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit ProfileRange( FrameProfiler::Stage stage, bool onDevice = true, cudaStream_t stream = 0 );
+    ProfileRange( const ProfileRange &range ) = delete;
+
+    ~ProfileRange();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    ProfileRange &operator=( const ProfileRange &range ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void end();
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    unsigned int range = FrameProfiler::NO_RANGE;
+    bool open = true;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_FRAMEPROFILER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,1404 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mesh.cpp
+ * @brief   Indexed triangle mesh with a structure-of-arrays vertex pool
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cstring>
+# include <utility>
+
+# include <thrust/device_ptr.h>
+# include <thrust/execution_policy.h>
+# include <thrust/sort.h>
+# include <thrust/unique.h>
+
+# include "cudaerr.cuh"
+# include "mesh.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+const unsigned int WELD_TABLE_MIN_SIZE = 1024;
+const unsigned int WELD_TABLE_EMPTY = 0;
+
+const unsigned long long DEGENERATE_EDGE_KEY = ~0ull;
+
+
+/* -------------------------- Alignment Functions --------------------------- */
+
+
+/**
+ * @brief   Rounds a vertex count up to a device vertex stride
+ *
+ * @param   vertexCount     The number of vertices
+ *
+ * @return  The smallest multiple of Mesh::VERTEX_ALIGN not below vertexCount
+ */
+static size_t alignVertexStride( size_t vertexCount )
+{
+    return ( vertexCount + Mesh::VERTEX_ALIGN - 1 ) / Mesh::VERTEX_ALIGN * Mesh::VERTEX_ALIGN;
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty mesh
+ *
+ * @param   void
+ *
+ * @return  The created mesh
+ */
+Mesh::Mesh() = default;
+
+
+/**
+ * @brief   Creates a mesh from an existing mesh
+ *
+ * The host vertex pool and index buffer are copied, device buffers are not.
+ *
+ * @param   &mesh   The mesh to create from
+ *
+ * @return  The created mesh
+ */
+Mesh::Mesh( const Mesh &mesh ):
+x( mesh.x ), y( mesh.y ), z( mesh.z ),
+indices( mesh.indices ), edges( mesh.edges ), weldTable( mesh.weldTable ),
+edgesValid( mesh.edgesValid )
+{
+    memcpy( boundsMin, mesh.boundsMin, sizeof( boundsMin ) );
+    memcpy( boundsMax, mesh.boundsMax, sizeof( boundsMax ) );
+}
+
+
+/**
+ * @brief   Creates a mesh that takes over the host arrays of another mesh,
+ *          leaving it empty
+ *
+ * Like a copy, the created mesh is not on the device; the device buffers of
+ * the other mesh are freed with it.
+ *
+ * @param   &&mesh  The mesh to move from
+ *
+ * @return  The created mesh
+ */
+Mesh::Mesh( Mesh &&mesh ) noexcept:
+x( std::move( mesh.x ) ), y( std::move( mesh.y ) ), z( std::move( mesh.z ) ),
+indices( std::move( mesh.indices ) ), edges( std::move( mesh.edges ) ),
+weldTable( std::move( mesh.weldTable ) ),
+edgesValid( mesh.edgesValid )
+{
+    memcpy( boundsMin, mesh.boundsMin, sizeof( boundsMin ) );
+    memcpy( boundsMax, mesh.boundsMax, sizeof( boundsMax ) );
+
+    mesh.erase();
+}
+
+
+/**
+ * @brief   Mesh destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+Mesh::~Mesh()
+{
+    freeDevice();
+}
+
+
+/* -------------------------- Overloaded Operators -------------------------- */
+
+
+/**
+ * @brief   Assigns a mesh to this mesh
+ *
+ * @param   &mesh   The mesh to assign from
+ *
+ * @return  A reference to this mesh
+ */
+Mesh &Mesh::operator=( const Mesh &mesh )
+{
+    if ( this == &mesh ) return *this;
+
+    freeDevice();
+
+    x = mesh.x;
+    y = mesh.y;
+    z = mesh.z;
+    indices = mesh.indices;
+    edges = mesh.edges;
+    weldTable = mesh.weldTable;
+    edgesValid = mesh.edgesValid;
+
+    memcpy( boundsMin, mesh.boundsMin, sizeof( boundsMin ) );
+    memcpy( boundsMax, mesh.boundsMax, sizeof( boundsMax ) );
+
+    return *this;
+}
+
+
+/**
+ * @brief   Moves the host arrays of another mesh into this mesh, leaving it
+ *          empty
+ *
+ * @param   &&mesh  The mesh to move from
+ *
+ * @return  A reference to this mesh
+ */
+Mesh &Mesh::operator=( Mesh &&mesh ) noexcept
+{
+    if ( this == &mesh ) return *this;
+
+    freeDevice();
+
+    x = std::move( mesh.x );
+    y = std::move( mesh.y );
+    z = std::move( mesh.z );
+    indices = std::move( mesh.indices );
+    edges = std::move( mesh.edges );
+    weldTable = std::move( mesh.weldTable );
+    edgesValid = mesh.edgesValid;
+
+    memcpy( boundsMin, mesh.boundsMin, sizeof( boundsMin ) );
+    memcpy( boundsMax, mesh.boundsMax, sizeof( boundsMax ) );
+
+    mesh.erase();
+
+    return *this;
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Adds a vertex to the vertex pool, welding it to an existing vertex
+ *          with identical coordinates if there is one
+ *
+ * @param   x   The x-coordinate of the vertex
+ * @param   y   The y-coordinate of the vertex
+ * @param   z   The z-coordinate of the vertex
+ *
+ * @return  The index of the vertex in the vertex pool
+ */
+unsigned int Mesh::addVertex( float x, float y, float z )
+{
+    // fold negative zero into positive zero so they weld
+    if ( x == 0 ) x = 0;
+    if ( y == 0 ) y = 0;
+    if ( z == 0 ) z = 0;
+
+    // keep the weld table at most half full
+    if ( ( getVertexCount() + 1 ) * 2 > weldTable.size() ) growWeldTable();
+
+    // probe for an existing vertex
+    unsigned int mask = weldTable.size() - 1;
+    unsigned int slot = hashVertex( x, y, z ) & mask;
+
+    while ( weldTable[slot] != WELD_TABLE_EMPTY )
+    {
+        unsigned int vertIdx = weldTable[slot] - 1;
+
+        if ( ( this->x[vertIdx] == x ) &&
+             ( this->y[vertIdx] == y ) &&
+             ( this->z[vertIdx] == z ) )
+        {
+            return vertIdx;
+        }
+
+        slot = ( slot + 1 ) & mask;
+    }
+
+    // append a new vertex
+    unsigned int vertIdx = getVertexCount();
+
+    this->x.push_back( x );
+    this->y.push_back( y );
+    this->z.push_back( z );
+
+    weldTable[slot] = vertIdx + 1;
+
+    // grow the bounding box
+    float coords[COORD_DIM] = { x, y, z };
+
+    for ( unsigned int i = 0; i < COORD_DIM; i++ )
+    {
+        if ( coords[i] < boundsMin[i] ) boundsMin[i] = coords[i];
+        if ( coords[i] > boundsMax[i] ) boundsMax[i] = coords[i];
+    }
+
+    return vertIdx;
+}
+
+
+/**
+ * @brief   Adds a facet from three vertex pool indices
+ *
+ * @param   a   The index of the first vertex
+ * @param   b   The index of the second vertex
+ * @param   c   The index of the third vertex
+ *
+ * @return  void
+ */
+void Mesh::addFacet( unsigned int a, unsigned int b, unsigned int c )
+{
+    if ( ( a >= getVertexCount() ) || ( b >= getVertexCount() ) || ( c >= getVertexCount() ) )
+    {
+        throw MeshException( "Facet vertex index out of range." );
+    }
+
+    indices.push_back( a );
+    indices.push_back( b );
+    indices.push_back( c );
+
+    // the edge list no longer covers every facet
+    edgesValid = false;
+}
+
+
+/**
+ * @brief   Adds a facet from three points, welding shared vertices
+ *
+ * @param   &a  The first vertex of the facet
+ * @param   &b  The second vertex of the facet
+ * @param   &c  The third vertex of the facet
+ *
+ * @return  void
+ */
+void Mesh::addFacet( const Point3D &a, const Point3D &b, const Point3D &c )
+{
+    unsigned int ia = addVertex( a.getX(), a.getY(), a.getZ() );
+    unsigned int ib = addVertex( b.getX(), b.getY(), b.getZ() );
+    unsigned int ic = addVertex( c.getX(), c.getY(), c.getZ() );
+
+    addFacet( ia, ib, ic );
+}
+
+
+/**
+ * @brief   Appends the facets of another mesh to this mesh
+ *
+ * @param   &mesh   The mesh to append
+ *
+ * @return  void
+ */
+void Mesh::append( const Mesh &mesh )
+{
+    reserve( getFacetCount() + mesh.getFacetCount() );
+
+    for ( unsigned int i = 0; i < mesh.indices.size(); i += FACET_DIM )
+    {
+        unsigned int facet[FACET_DIM];
+
+        for ( unsigned int j = 0; j < FACET_DIM; j++ )
+        {
+            unsigned int vertIdx = mesh.indices[i + j];
+            facet[j] = addVertex( mesh.x[vertIdx], mesh.y[vertIdx], mesh.z[vertIdx] );
+        }
+
+        addFacet( facet[0], facet[1], facet[2] );
+    }
+}
+
+
+/**
+ * @brief   Replaces the contents of this mesh with an already welded vertex
+ *          pool, index buffer and unique edge list
+ *
+ * Used to restore a preprocessed mesh without welding or rebuilding edges
+ * again. The indices are checked so a corrupt source cannot make the
+ * kernels read out of range. Without an edge list, it is built on the next
+ * pushToDevice.
+ *
+ * @param   *x              The x-coordinates of the vertex pool
+ * @param   *y              The y-coordinates of the vertex pool
+ * @param   *z              The z-coordinates of the vertex pool
+ * @param   vertexCount     The number of vertices in the vertex pool
+ * @param   *indices        The triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   *edges          The unique edge list, two indices per edge, or
+ *                          nullptr to build it on the device
+ * @param   edgeCount       The number of edges
+ *
+ * @return  void
+ */
+void Mesh::assign(
+    const float *x, const float *y, const float *z, unsigned int vertexCount,
+    const unsigned int *indices, unsigned int facetCount,
+    const unsigned int *edges, unsigned int edgeCount
+)
+{
+    for ( size_t i = 0; i < ( size_t ) facetCount * FACET_DIM; i++ )
+    {
+        if ( indices[i] >= vertexCount )
+        {
+            throw MeshException( "Facet vertex index out of range." );
+        }
+    }
+
+    for ( size_t i = 0; i < ( size_t ) edgeCount * EDGE_DIM; i++ )
+    {
+        if ( edges[i] >= vertexCount )
+        {
+            throw MeshException( "Edge vertex index out of range." );
+        }
+    }
+
+    erase();
+
+    this->x.assign( x, x + vertexCount );
+    this->y.assign( y, y + vertexCount );
+    this->z.assign( z, z + vertexCount );
+    this->indices.assign( indices, indices + ( size_t ) facetCount * FACET_DIM );
+    if ( edges != nullptr ) this->edges.assign( edges, edges + ( size_t ) edgeCount * EDGE_DIM );
+
+    edgesValid = ( edges != nullptr );
+
+    // the weld table is rebuilt on the next addVertex
+    for ( unsigned int vertIdx = 0; vertIdx < vertexCount; vertIdx++ )
+    {
+        float coords[COORD_DIM] = { x[vertIdx], y[vertIdx], z[vertIdx] };
+
+        for ( unsigned int i = 0; i < COORD_DIM; i++ )
+        {
+            if ( coords[i] < boundsMin[i] ) boundsMin[i] = coords[i];
+            if ( coords[i] > boundsMax[i] ) boundsMax[i] = coords[i];
+        }
+    }
+}
+
+
+/**
+ * @brief   Reserves host storage for a number of facets
+ *
+ * @param   facetCount  The number of facets to reserve storage for
+ *
+ * @return  void
+ */
+void Mesh::reserve( unsigned int facetCount )
+{
+    indices.reserve( facetCount * FACET_DIM );
+
+    // closed meshes have roughly half as many vertices as facets
+    x.reserve( facetCount / 2 );
+    y.reserve( facetCount / 2 );
+    z.reserve( facetCount / 2 );
+}
+
+
+/**
+ * @brief   Gets the number of vertices in the vertex pool
+ *
+ * @param   void
+ *
+ * @return  The number of vertices in the vertex pool
+ */
+unsigned int Mesh::getVertexCount() const
+{
+    return x.size();
+}
+
+
+/**
+ * @brief   Gets the number of facets in the mesh
+ *
+ * @param   void
+ *
+ * @return  The number of facets in the mesh
+ */
+unsigned int Mesh::getFacetCount() const
+{
+    return indices.size() / FACET_DIM;
+}
+
+
+/**
+ * @brief   Gets the number of unique edges in the mesh
+ *
+ * The edge list is built when the mesh is pushed to the device.
+ *
+ * @param   void
+ *
+ * @return  The number of unique edges in the mesh
+ */
+unsigned int Mesh::getEdgeCount() const
+{
+    return edges.size() / EDGE_DIM;
+}
+
+
+/**
+ * @brief   Determines if the host edge list is up to date with the facets
+ *
+ * @param   void
+ *
+ * @return  True if the edge list covers every facet, false otherwise
+ */
+bool Mesh::hasEdges() const
+{
+    return edgesValid;
+}
+
+
+/**
+ * @brief   Gets the axis-aligned bounding box of the vertex pool
+ *
+ * The bounds are kept up to date as vertices are added. An empty mesh has
+ * an inverted box, with min at +inf and max at -inf.
+ *
+ * @param   *min    Set to the minimum x, y and z
+ * @param   *max    Set to the maximum x, y and z
+ *
+ * @return  void
+ */
+void Mesh::getBounds( float *min, float *max ) const
+{
+    for ( unsigned int i = 0; i < COORD_DIM; i++ )
+    {
+        min[i] = boundsMin[i];
+        max[i] = boundsMax[i];
+    }
+}
+
+
+/**
+ * @brief   Gets the x-coordinates of the vertex pool
+ *
+ * @param   void
+ *
+ * @return  A pointer to the x-coordinates of the vertex pool
+ */
+const float *Mesh::getX() const
+{
+    return x.data();
+}
+
+
+/**
+ * @brief   Gets the y-coordinates of the vertex pool
+ *
+ * @param   void
+ *
+ * @return  A pointer to the y-coordinates of the vertex pool
+ */
+const float *Mesh::getY() const
+{
+    return y.data();
+}
+
+
+/**
+ * @brief   Gets the z-coordinates of the vertex pool
+ *
+ * @param   void
+ *
+ * @return  A pointer to the z-coordinates of the vertex pool
+ */
+const float *Mesh::getZ() const
+{
+    return z.data();
+}
+
+
+/**
+ * @brief   Gets the triangle index buffer
+ *
+ * @param   void
+ *
+ * @return  A pointer to the triangle index buffer
+ */
+const unsigned int *Mesh::getIndices() const
+{
+    return indices.data();
+}
+
+
+/**
+ * @brief   Gets the unique edge list as pairs of vertex pool indices
+ *
+ * @param   void
+ *
+ * @return  A pointer to the unique edge list
+ */
+const unsigned int *Mesh::getEdges() const
+{
+    return edges.data();
+}
+
+
+/**
+ * @brief   Builds the unique edge list on the host, for a mesh that is drawn
+ *          without a GPU device, or cached without being pushed whole
+ *
+ * The edges are deduplicated with the same ordered-index keys as on the
+ * device, so a later pushToDevice uploads them as they are.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::buildHostEdges()
+{
+    unsigned int facetCount = getFacetCount();
+
+    std::vector<unsigned long long> edgeKeys;
+    edgeKeys.reserve( facetCount * FACET_DIM );
+
+    for ( unsigned int facetIdx = 0; facetIdx < facetCount; facetIdx++ )
+    {
+        unsigned int facetOffset = facetIdx * FACET_DIM;
+
+        for ( unsigned int i = 0; i < FACET_DIM; i++ )
+        {
+            unsigned long long a = indices[facetOffset + i];
+            unsigned long long b = indices[facetOffset + ( ( i + 1 ) % FACET_DIM )];
+
+            if ( a != b ) edgeKeys.push_back( ( std::min( a, b ) << 32 ) | std::max( a, b ) );
+        }
+    }
+
+    std::sort( edgeKeys.begin(), edgeKeys.end() );
+    edgeKeys.erase( std::unique( edgeKeys.begin(), edgeKeys.end() ), edgeKeys.end() );
+
+    edges.resize( edgeKeys.size() * EDGE_DIM );
+
+    for ( size_t i = 0; i < edgeKeys.size(); i++ )
+    {
+        edges[i * EDGE_DIM] = ( unsigned int ) ( edgeKeys[i] >> 32 );
+        edges[i * EDGE_DIM + 1] = ( unsigned int ) edgeKeys[i];
+    }
+
+    edgesValid = true;
+}
+
+
+/**
+ * @brief   Pushes the vertex pool and index buffer to the GPU device
+ *
+ * Both buffers are packed into one pinned staging buffer and uploaded with a
+ * single transfer. The device vertex pool is laid out as x[], y[], z[], each
+ * padded to getDeviceVertexStride() with zeros. If the host edge list is up
+ * to date it is uploaded as well, otherwise the unique edge list is built on
+ * the device from the index buffer.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::pushToDevice()
+{
+    // free existing device mallocs if they exist
+    freeDevice();
+
+    // nothing to push
+    if ( indices.empty() ) return;
+
+    size_t vertexCount = getVertexCount();
+    size_t vertexStride = alignVertexStride( vertexCount );
+    size_t vertexBytes = vertexStride * COORD_DIM * sizeof( float );
+    size_t indexBytes = indices.size() * sizeof( unsigned int );
+
+    // pack the vertex pool and index buffer into a pinned staging buffer
+    char *h_staging = nullptr;
+
+    HANDLE_CUDA_ERROR(
+        cudaMallocHost( &h_staging, vertexBytes + indexBytes )
+    );
+
+    float *h_vertices = ( float * ) h_staging;
+
+    memset( h_vertices, 0, vertexBytes );
+    memcpy( h_vertices,                     x.data(), vertexCount * sizeof( float ) );
+    memcpy( h_vertices + vertexStride,      y.data(), vertexCount * sizeof( float ) );
+    memcpy( h_vertices + vertexStride * 2,  z.data(), vertexCount * sizeof( float ) );
+    memcpy( h_staging + vertexBytes, indices.data(), indexBytes );
+
+    // malloc device buffer and copy in a single transfer
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_buffer, vertexBytes + indexBytes )
+    );
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            d_buffer,
+            ( void * ) h_staging,
+            vertexBytes + indexBytes,
+            cudaMemcpyHostToDevice
+        )
+    );
+
+    HANDLE_CUDA_ERROR( cudaFreeHost( h_staging ) );
+
+    d_vertices = ( float * ) d_buffer;
+    d_indices = ( unsigned int * ) ( ( char * ) d_buffer + vertexBytes );
+
+    deviceVertexCount = vertexCount;
+    deviceVertexStride = vertexStride;
+    deviceFacetCount = getFacetCount();
+
+    // deduplicate shared edges, unless they already are
+    if ( edgesValid ) uploadEdges();
+    else buildEdges();
+}
+
+
+/**
+ * @brief   Starts streaming this mesh to the GPU device while it is built
+ *
+ * Device buffers are allocated for the worst case of facetCapacity facets
+ * with no shared vertices, so nothing is reallocated while streaming. Each
+ * streamPending call then queues whatever was added since the last one.
+ * Until endStream, the device vertex pool is laid out as x[], y[], z[] with
+ * a stride of getDeviceVertexStride() and there is no unique edge list.
+ *
+ * @param   facetCapacity   The total number of facets the mesh will hold
+ *
+ * @return  void
+ */
+void Mesh::beginStream( unsigned int facetCapacity )
+{
+    // free existing device mallocs if they exist
+    freeDevice();
+
+    if ( facetCapacity < getFacetCount() ) facetCapacity = getFacetCount();
+
+    streamFacetCapacity = facetCapacity;
+    streamVertexCapacity = alignVertexStride( getVertexCount() + ( size_t ) ( facetCapacity - getFacetCount() ) * FACET_DIM );
+
+    size_t vertexBytes = ( size_t ) streamVertexCapacity * COORD_DIM * sizeof( float );
+    size_t indexBytes = ( size_t ) streamFacetCapacity * FACET_DIM * sizeof( unsigned int );
+
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_buffer, vertexBytes + indexBytes )
+    );
+
+    d_vertices = ( float * ) d_buffer;
+    d_indices = ( unsigned int * ) ( ( char * ) d_buffer + vertexBytes );
+
+    deviceVertexStride = streamVertexCapacity;
+
+    // one pinned staging slot and non-blocking stream per batch in flight
+    size_t slotBytes = STREAM_SLOT_VERTICES * COORD_DIM * sizeof( float ) +
+                       STREAM_SLOT_FACETS * FACET_DIM * sizeof( unsigned int );
+
+    for ( unsigned int slot = 0; slot < STREAM_SLOT_COUNT; slot++ )
+    {
+        HANDLE_CUDA_ERROR(
+            cudaMallocHost( &h_slotStaging[slot], slotBytes )
+        );
+
+        HANDLE_CUDA_ERROR(
+            cudaStreamCreateWithFlags( &streams[slot], cudaStreamNonBlocking )
+        );
+
+        HANDLE_CUDA_ERROR(
+            cudaEventCreateWithFlags( &slotEvents[slot], cudaEventDisableTiming )
+        );
+
+        slotBusy[slot] = false;
+    }
+
+    nextSlot = 0;
+    streaming = true;
+}
+
+
+/**
+ * @brief   Queues the vertices and facets added since the last call for
+ *          upload, without waiting for the transfers
+ *
+ * Work is split into staging-slot sized batches, each copied with
+ * cudaMemcpyAsync on its slot's stream, so the caller can carry on parsing
+ * while the previous batch is in flight. A batch's facets only reference
+ * vertices of the same or an earlier batch.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::streamPending()
+{
+    if ( !streaming ) return;
+
+    if ( ( getFacetCount() > streamFacetCapacity ) || ( getVertexCount() > streamVertexCapacity ) )
+    {
+        throw MeshException( "Stream capacity exceeded." );
+    }
+
+    while ( ( queuedFacetCount < getFacetCount() ) || ( queuedVertexCount < getVertexCount() ) )
+    {
+        unsigned int slot = nextSlot;
+
+        // wait for the slot's previous batch before overwriting its staging
+        if ( slotBusy[slot] )
+        {
+            HANDLE_CUDA_ERROR( cudaEventSynchronize( slotEvents[slot] ) );
+            retireSlot( slot );
+        }
+
+        // take as many facets as fit, then every vertex they need
+        unsigned int facetCount = getFacetCount() - queuedFacetCount;
+        if ( facetCount > STREAM_SLOT_FACETS ) facetCount = STREAM_SLOT_FACETS;
+        unsigned int vertexEnd = queuedVertexCount;
+
+        for ( size_t i = queuedFacetCount * FACET_DIM; i < ( size_t ) ( queuedFacetCount + facetCount ) * FACET_DIM; i++ )
+        {
+            vertexEnd = std::max( vertexEnd, indices[i] + 1 );
+        }
+
+        // vertices that were added without facets go along too
+        if ( queuedFacetCount + facetCount == getFacetCount() ) vertexEnd = getVertexCount();
+
+        unsigned int vertexCount = vertexEnd - queuedVertexCount;
+
+        // too many vertices for one slot, send vertices only for now
+        if ( vertexCount > STREAM_SLOT_VERTICES )
+        {
+            vertexCount = STREAM_SLOT_VERTICES;
+            facetCount = 0;
+        }
+
+        // pack the batch into the slot's pinned staging buffer
+        float *h_vertices = ( float * ) h_slotStaging[slot];
+        unsigned int *h_indices = ( unsigned int * ) ( h_vertices + STREAM_SLOT_VERTICES * COORD_DIM );
+
+        const float *coords[COORD_DIM] = { x.data(), y.data(), z.data() };
+
+        for ( unsigned int i = 0; i < COORD_DIM; i++ )
+        {
+            memcpy(
+                h_vertices + i * STREAM_SLOT_VERTICES,
+                coords[i] + queuedVertexCount,
+                vertexCount * sizeof( float )
+            );
+        }
+
+        memcpy(
+            h_indices,
+            indices.data() + ( size_t ) queuedFacetCount * FACET_DIM,
+            facetCount * FACET_DIM * sizeof( unsigned int )
+        );
+
+        // queue the transfers
+        if ( vertexCount > 0 )
+        {
+            for ( unsigned int i = 0; i < COORD_DIM; i++ )
+            {
+                HANDLE_CUDA_ERROR(
+                    cudaMemcpyAsync(
+                        ( void * ) ( d_vertices + ( size_t ) i * deviceVertexStride + queuedVertexCount ),
+                        ( void * ) ( h_vertices + i * STREAM_SLOT_VERTICES ),
+                        vertexCount * sizeof( float ),
+                        cudaMemcpyHostToDevice,
+                        streams[slot]
+                    )
+                );
+            }
+        }
+
+        if ( facetCount > 0 )
+        {
+            HANDLE_CUDA_ERROR(
+                cudaMemcpyAsync(
+                    ( void * ) ( d_indices + ( size_t ) queuedFacetCount * FACET_DIM ),
+                    ( void * ) h_indices,
+                    facetCount * FACET_DIM * sizeof( unsigned int ),
+                    cudaMemcpyHostToDevice,
+                    streams[slot]
+                )
+            );
+        }
+
+        HANDLE_CUDA_ERROR( cudaEventRecord( slotEvents[slot], streams[slot] ) );
+
+        queuedVertexCount += vertexCount;
+        queuedFacetCount += facetCount;
+
+        slotVertexCount[slot] = queuedVertexCount;
+        slotFacetCount[slot] = queuedFacetCount;
+        slotBusy[slot] = true;
+
+        nextSlot = ( slot + 1 ) % STREAM_SLOT_COUNT;
+    }
+
+    // publish whatever has landed so far
+    pollStream();
+}
+
+
+/**
+ * @brief   Waits for the streamed uploads, compacts the device buffers into
+ *          the regular layout and builds the unique edge list
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::endStream()
+{
+    if ( !streaming ) return;
+
+    streamPending();
+
+    for ( unsigned int i = 0; i < STREAM_SLOT_COUNT; i++ )
+    {
+        unsigned int slot = ( nextSlot + i ) % STREAM_SLOT_COUNT;
+
+        if ( slotBusy[slot] )
+        {
+            HANDLE_CUDA_ERROR( cudaEventSynchronize( slotEvents[slot] ) );
+            retireSlot( slot );
+        }
+    }
+
+    // repack from the capacity stride into the regular stride
+    size_t vertexCount = getVertexCount();
+    size_t vertexStride = alignVertexStride( vertexCount );
+    size_t vertexBytes = vertexStride * COORD_DIM * sizeof( float );
+    size_t indexBytes = indices.size() * sizeof( unsigned int );
+
+    void *d_packed = nullptr;
+
+    if ( !indices.empty() )
+    {
+        HANDLE_CUDA_ERROR(
+            cudaMalloc( &d_packed, vertexBytes + indexBytes )
+        );
+
+        // zero the stride padding, as pushToDevice does
+        HANDLE_CUDA_ERROR(
+            cudaMemset( d_packed, 0, vertexBytes )
+        );
+
+        for ( unsigned int i = 0; i < COORD_DIM; i++ )
+        {
+            HANDLE_CUDA_ERROR(
+                cudaMemcpy(
+                    ( void * ) ( ( float * ) d_packed + i * vertexStride ),
+                    ( void * ) ( d_vertices + ( size_t ) i * deviceVertexStride ),
+                    vertexCount * sizeof( float ),
+                    cudaMemcpyDeviceToDevice
+                )
+            );
+        }
+
+        HANDLE_CUDA_ERROR(
+            cudaMemcpy(
+                ( void * ) ( ( char * ) d_packed + vertexBytes ),
+                ( void * ) d_indices,
+                indexBytes,
+                cudaMemcpyDeviceToDevice
+            )
+        );
+    }
+
+    freeDevice();
+
+    // an empty mesh stays off the device, as with pushToDevice
+    if ( d_packed == nullptr ) return;
+
+    d_buffer = d_packed;
+    d_vertices = ( float * ) d_buffer;
+    d_indices = ( unsigned int * ) ( ( char * ) d_buffer + vertexBytes );
+
+    deviceVertexCount = vertexCount;
+    deviceVertexStride = vertexStride;
+    deviceFacetCount = getFacetCount();
+
+    // deduplicate shared edges
+    buildEdges();
+}
+
+
+/**
+ * @brief   Determines if this mesh is being streamed to the device
+ *
+ * @param   void
+ *
+ * @return  True between beginStream and endStream, false otherwise
+ */
+bool Mesh::isStreaming() const
+{
+    return streaming;
+}
+
+
+/**
+ * @brief   Gets the device vertex pool, laid out as x[], y[], z[]
+ *
+ * @param   void
+ *
+ * @return  A device pointer to the vertex pool
+ */
+const float *Mesh::getDeviceVertices() const
+{
+    return d_vertices;
+}
+
+
+/**
+ * @brief   Gets the device triangle index buffer
+ *
+ * @param   void
+ *
+ * @return  A device pointer to the triangle index buffer
+ */
+const unsigned int *Mesh::getDeviceIndices() const
+{
+    return d_indices;
+}
+
+
+/**
+ * @brief   Gets the device unique edge list as pairs of vertex pool indices
+ *
+ * @param   void
+ *
+ * @return  A device pointer to the unique edge list
+ */
+const unsigned int *Mesh::getDeviceEdges() const
+{
+    return d_edges;
+}
+
+
+/**
+ * @brief   Gets the number of vertices that are ready on the device
+ *
+ * @param   void
+ *
+ * @return  The number of device vertices, which trails the host vertex pool
+ *          while streaming
+ */
+unsigned int Mesh::getDeviceVertexCount() const
+{
+    return deviceVertexCount;
+}
+
+
+/**
+ * @brief   Gets the distance between the x[], y[] and z[] arrays of the
+ *          device vertex pool
+ *
+ * @param   void
+ *
+ * @return  The stride in floats, a multiple of VERTEX_ALIGN that is at least
+ *          the vertex count, or the streaming capacity while streaming
+ */
+unsigned int Mesh::getDeviceVertexStride() const
+{
+    return deviceVertexStride;
+}
+
+
+/**
+ * @brief   Gets the number of facets that are ready on the device
+ *
+ * @param   void
+ *
+ * @return  The number of device facets, which trails the host index buffer
+ *          while streaming
+ */
+unsigned int Mesh::getDeviceFacetCount() const
+{
+    return deviceFacetCount;
+}
+
+
+/**
+ * @brief   Determines if this mesh has been pushed to the GPU device
+ *
+ * @param   void
+ *
+ * @return  True if this mesh has device buffers, false otherwise
+ */
+bool Mesh::isOnDevice() const
+{
+    return d_buffer != nullptr;
+}
+
+
+/**
+ * @brief   Removes all vertices and facets from this mesh
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::erase()
+{
+    freeDevice();
+
+    x.clear();
+    y.clear();
+    z.clear();
+    indices.clear();
+    edges.clear();
+    weldTable.clear();
+
+    edgesValid = false;
+    resetBounds();
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Doubles the size of the weld table and rehashes the vertex pool
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::growWeldTable()
+{
+    unsigned int size = weldTable.empty() ? WELD_TABLE_MIN_SIZE : weldTable.size() * 2;
+
+    // a pool restored by assign has no table yet, so it may need several doublings
+    while ( ( getVertexCount() + 1 ) * 2 > size ) size *= 2;
+
+    unsigned int mask = size - 1;
+
+    weldTable.assign( size, WELD_TABLE_EMPTY );
+
+    for ( unsigned int vertIdx = 0; vertIdx < getVertexCount(); vertIdx++ )
+    {
+        unsigned int slot = hashVertex( x[vertIdx], y[vertIdx], z[vertIdx] ) & mask;
+
+        while ( weldTable[slot] != WELD_TABLE_EMPTY ) slot = ( slot + 1 ) & mask;
+
+        weldTable[slot] = vertIdx + 1;
+    }
+}
+
+
+/**
+ * @brief   Resets the bounding box to the empty, inverted box
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::resetBounds()
+{
+    for ( unsigned int i = 0; i < COORD_DIM; i++ )
+    {
+        boundsMin[i] = INFINITY;
+        boundsMax[i] = -INFINITY;
+    }
+}
+
+
+/**
+ * @brief   Builds the unique edge list from the device index buffer
+ *
+ * Every facet edge is packed into a 64-bit key of its ordered vertex
+ * indices, then the keys are sorted and deduplicated on the device so each
+ * edge shared between facets appears once.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::buildEdges()
+{
+    unsigned int facetCount = getFacetCount();
+    unsigned int keyCount = facetCount * FACET_DIM;
+
+    // pack every facet edge into a key
+    unsigned long long *d_edgeKeys = nullptr;
+
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_edgeKeys, keyCount * sizeof( unsigned long long ) )
+    );
+
+    unsigned int blocks = ceil( facetCount / 1024.0 );
+
+    packFacetEdges<<<blocks, 1024>>>( d_indices, d_edgeKeys, facetCount );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    // sort and deduplicate the keys
+    thrust::device_ptr<unsigned long long> keys( d_edgeKeys );
+
+    thrust::sort( thrust::device, keys, keys + keyCount );
+    unsigned int edgeCount = thrust::unique( thrust::device, keys, keys + keyCount ) - keys;
+
+    // degenerate edges sort to the end
+    unsigned long long lastKey = 0;
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) &lastKey,
+            ( void * ) ( d_edgeKeys + edgeCount - 1 ),
+            sizeof( unsigned long long ),
+            cudaMemcpyDeviceToHost
+        )
+    );
+
+    if ( lastKey == DEGENERATE_EDGE_KEY ) edgeCount--;
+
+    // unpack the unique keys into vertex index pairs
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_edges, edgeCount * EDGE_DIM * sizeof( unsigned int ) )
+    );
+
+    blocks = ceil( edgeCount / 1024.0 );
+
+    if ( edgeCount > 0 )
+    {
+        unpackEdgeKeys<<<blocks, 1024>>>( d_edgeKeys, d_edges, edgeCount );
+        HANDLE_CUDA_ERROR( cudaGetLastError() );
+    }
+
+    HANDLE_CUDA_ERROR( cudaFree( d_edgeKeys ) );
+
+    // keep a host copy of the edge list
+    edges.resize( edgeCount * EDGE_DIM );
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) edges.data(),
+            ( void * ) d_edges,
+            edgeCount * EDGE_DIM * sizeof( unsigned int ),
+            cudaMemcpyDeviceToHost
+        )
+    );
+
+    edgesValid = true;
+}
+
+
+/**
+ * @brief   Uploads the host edge list to the device
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::uploadEdges()
+{
+    size_t edgeBytes = edges.size() * sizeof( unsigned int );
+
+    if ( edgeBytes == 0 ) return;
+
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_edges, edgeBytes )
+    );
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) d_edges,
+            ( void * ) edges.data(),
+            edgeBytes,
+            cudaMemcpyHostToDevice
+        )
+    );
+}
+
+
+/**
+ * @brief   Marks a finished staging slot free and publishes its batch
+ *
+ * @param   slot    The slot whose event has completed
+ *
+ * @return  void
+ */
+void Mesh::retireSlot( unsigned int slot )
+{
+    slotBusy[slot] = false;
+
+    // batches finish in order, so never move the counts backwards
+    deviceVertexCount = std::max( deviceVertexCount, slotVertexCount[slot] );
+    deviceFacetCount = std::max( deviceFacetCount, slotFacetCount[slot] );
+}
+
+
+/**
+ * @brief   Publishes the batches that have finished uploading, oldest first,
+ *          without blocking
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::pollStream()
+{
+    for ( unsigned int i = 0; i < STREAM_SLOT_COUNT; i++ )
+    {
+        unsigned int slot = ( nextSlot + i ) % STREAM_SLOT_COUNT;
+
+        if ( !slotBusy[slot] ) continue;
+
+        cudaError_t status = cudaEventQuery( slotEvents[slot] );
+
+        // a newer batch cannot be published before an older one
+        if ( status == cudaErrorNotReady ) return;
+
+        HANDLE_CUDA_ERROR( status );
+        retireSlot( slot );
+    }
+}
+
+
+/**
+ * @brief   Frees the streams, events and staging slots used for streaming
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::freeStream()
+{
+    if ( !streaming ) return;
+
+    for ( unsigned int slot = 0; slot < STREAM_SLOT_COUNT; slot++ )
+    {
+        HANDLE_CUDA_ERROR( cudaStreamSynchronize( streams[slot] ) );
+        HANDLE_CUDA_ERROR( cudaStreamDestroy( streams[slot] ) );
+        HANDLE_CUDA_ERROR( cudaEventDestroy( slotEvents[slot] ) );
+        HANDLE_CUDA_ERROR( cudaFreeHost( h_slotStaging[slot] ) );
+
+        streams[slot] = nullptr;
+        slotEvents[slot] = nullptr;
+        h_slotStaging[slot] = nullptr;
+        slotBusy[slot] = false;
+    }
+
+    streaming = false;
+    streamVertexCapacity = 0;
+    streamFacetCapacity = 0;
+    queuedVertexCount = 0;
+    queuedFacetCount = 0;
+}
+
+
+/**
+ * @brief   Frees the device buffers of this mesh
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Mesh::freeDevice()
+{
+    // in-flight uploads still write to the device buffer
+    freeStream();
+
+    if ( d_buffer != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_buffer ) );
+    }
+
+    if ( d_edges != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_edges ) );
+    }
+
+    d_buffer = nullptr;
+    d_vertices = nullptr;
+    d_indices = nullptr;
+    d_edges = nullptr;
+
+    deviceVertexCount = 0;
+    deviceVertexStride = 0;
+    deviceFacetCount = 0;
+}
+
+
+/**
+ * @brief   Hashes the bit patterns of a vertex's coordinates
+ *
+ * @param   x   The x-coordinate of the vertex
+ * @param   y   The y-coordinate of the vertex
+ * @param   z   The z-coordinate of the vertex
+ *
+ * @return  The hash of the vertex
+ */
+unsigned int Mesh::hashVertex( float x, float y, float z )
+{
+    unsigned int bx;
+    unsigned int by;
+    unsigned int bz;
+
+    memcpy( &bx, &x, sizeof( bx ) );
+    memcpy( &by, &y, sizeof( by ) );
+    memcpy( &bz, &z, sizeof( bz ) );
+
+    return ( bx * 73856093u ) ^ ( by * 19349663u ) ^ ( bz * 83492791u );
+}
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+/**
+ * @brief   Packs the three edges of every facet into 64-bit keys of their
+ *          ordered vertex indices, one thread per facet
+ *
+ * @param   *indices    The triangle index buffer
+ * @param   *edgeKeys   The output edge keys, three per facet
+ * @param   facetCount  The number of facets
+ *
+ * @return  void
+ */
+__global__ void packFacetEdges(
+    const unsigned int * indices, unsigned long long * edgeKeys, unsigned int facetCount
+)
+{
+    unsigned int facetIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( facetIdx >= facetCount ) return;
+
+    unsigned int facetOffset = facetIdx * Mesh::FACET_DIM;
+
+    for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+    {
+        unsigned int a = indices[facetOffset + i];
+        unsigned int b = indices[facetOffset + ( ( i + 1 ) % Mesh::FACET_DIM )];
+
+        unsigned long long lo = min( a, b );
+        unsigned long long hi = max( a, b );
+
+        edgeKeys[facetOffset + i] = ( a == b ) ? DEGENERATE_EDGE_KEY : ( ( lo << 32 ) | hi );
+    }
+}
+
+
+/**
+ * @brief   Unpacks 64-bit edge keys into pairs of vertex indices, one thread
+ *          per edge
+ *
+ * @param   *edgeKeys   The edge keys
+ * @param   *edges      The output edge list, two indices per edge
+ * @param   edgeCount   The number of edges
+ *
+ * @return  void
+ */
+__global__ void unpackEdgeKeys(
+    const unsigned long long * edgeKeys, unsigned int * edges, unsigned int edgeCount
+)
+{
+    unsigned int edgeIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( edgeIdx >= edgeCount ) return;
+
+    unsigned long long key = edgeKeys[edgeIdx];
+
+    edges[edgeIdx * Mesh::EDGE_DIM + 0] = ( unsigned int ) ( key >> 32 );
+    edges[edgeIdx * Mesh::EDGE_DIM + 1] = ( unsigned int ) ( key & 0xFFFFFFFF );
+}
+
+
+/* -------------------------------------------------------------------------- */
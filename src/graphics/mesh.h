@@ -0,0 +1,203 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mesh.h
+ * @brief   Indexed triangle mesh with a structure-of-arrays vertex pool
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_MESH_H
+# define GRAPHICS_MESH_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cmath>
+# include <stdexcept>
+# include <vector>
+
+# include "point3d.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class MeshException : public std::runtime_error
+{
+public:
+    explicit MeshException( const std::string& msg ):
+    std::runtime_error( ( std::string( "Mesh Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+class Mesh
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int FACET_DIM = 3;
+    static constexpr unsigned int COORD_DIM = 3;
+    static constexpr unsigned int EDGE_DIM = 2;
+
+    // device x[], y[] and z[] strides are padded so each array is float4 aligned
+    static constexpr unsigned int VERTEX_ALIGN = 4;
+
+    static constexpr unsigned int STREAM_SLOT_COUNT = 2;
+    static constexpr unsigned int STREAM_SLOT_FACETS = 16384;
+    static constexpr unsigned int STREAM_SLOT_VERTICES = STREAM_SLOT_FACETS * FACET_DIM;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    Mesh();
+    Mesh( const Mesh &mesh );
+    Mesh( Mesh &&mesh ) noexcept;
+
+    ~Mesh();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    Mesh &operator=( const Mesh &mesh );
+    Mesh &operator=( Mesh &&mesh ) noexcept;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    unsigned int addVertex( float x, float y, float z );
+    void addFacet( unsigned int a, unsigned int b, unsigned int c );
+    void addFacet( const Point3D &a, const Point3D &b, const Point3D &c );
+    void append( const Mesh &mesh );
+    void assign(
+        const float *x, const float *y, const float *z, unsigned int vertexCount,
+        const unsigned int *indices, unsigned int facetCount,
+        const unsigned int *edges, unsigned int edgeCount
+    );
+
+    void reserve( unsigned int facetCount );
+
+    unsigned int getVertexCount() const;
+    unsigned int getFacetCount() const;
+    unsigned int getEdgeCount() const;
+    bool hasEdges() const;
+    void getBounds( float *min, float *max ) const;
+
+    const float *getX() const;
+    const float *getY() const;
+    const float *getZ() const;
+    const unsigned int *getIndices() const;
+    const unsigned int *getEdges() const;
+
+    void buildHostEdges();
+    void pushToDevice();
+
+    void beginStream( unsigned int facetCapacity );
+    void streamPending();
+    void endStream();
+    bool isStreaming() const;
+
+    const float *getDeviceVertices() const;
+    const unsigned int *getDeviceIndices() const;
+    const unsigned int *getDeviceEdges() const;
+    unsigned int getDeviceVertexCount() const;
+    unsigned int getDeviceVertexStride() const;
+    unsigned int getDeviceFacetCount() const;
+    bool isOnDevice() const;
+
+    void erase();
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::vector<float> x = std::vector<float>();
+    std::vector<float> y = std::vector<float>();
+    std::vector<float> z = std::vector<float>();
+    std::vector<unsigned int> indices = std::vector<unsigned int>();
+    std::vector<unsigned int> edges = std::vector<unsigned int>();
+
+    std::vector<unsigned int> weldTable = std::vector<unsigned int>();
+
+    bool edgesValid = false;
+    float boundsMin[COORD_DIM] = { INFINITY, INFINITY, INFINITY };
+    float boundsMax[COORD_DIM] = { -INFINITY, -INFINITY, -INFINITY };
+
+    void * d_buffer = nullptr;
+    float * d_vertices = nullptr;
+    unsigned int * d_indices = nullptr;
+    unsigned int * d_edges = nullptr;
+
+    unsigned int deviceVertexCount = 0;
+    unsigned int deviceVertexStride = 0;
+    unsigned int deviceFacetCount = 0;
+
+    bool streaming = false;
+    unsigned int streamVertexCapacity = 0;
+    unsigned int streamFacetCapacity = 0;
+    unsigned int queuedVertexCount = 0;
+    unsigned int queuedFacetCount = 0;
+    unsigned int nextSlot = 0;
+
+    cudaStream_t streams[STREAM_SLOT_COUNT] = {};
+    cudaEvent_t slotEvents[STREAM_SLOT_COUNT] = {};
+    char * h_slotStaging[STREAM_SLOT_COUNT] = {};
+    unsigned int slotVertexCount[STREAM_SLOT_COUNT] = {};
+    unsigned int slotFacetCount[STREAM_SLOT_COUNT] = {};
+    bool slotBusy[STREAM_SLOT_COUNT] = {};
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void growWeldTable();
+    void resetBounds();
+    void buildEdges();
+    void uploadEdges();
+    void retireSlot( unsigned int slot );
+    void pollStream();
+    void freeStream();
+    void freeDevice();
+
+    static unsigned int hashVertex( float x, float y, float z );
+
+
+    /* ====================================================================== */
+};
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+__global__ void packFacetEdges(
+    const unsigned int * indices, unsigned long long * edgeKeys, unsigned int facetCount
+);
+
+__global__ void unpackEdgeKeys(
+    const unsigned long long * edgeKeys, unsigned int * edges, unsigned int edgeCount
+);
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_MESH_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,475 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    meshpreprocessor.cpp
+ * @brief   GPU welding of a freshly read mesh
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <climits>
+# include <cstdlib>
+# include <new>
+# include <vector>
+
+# include <thrust/device_ptr.h>
+# include <thrust/execution_policy.h>
+# include <thrust/scan.h>
+# include <thrust/sequence.h>
+# include <thrust/sort.h>
+# include <thrust/system_error.h>
+
+# include "cudaerr.cuh"
+# include "meshpreprocessor.h"
+# include "outofcorerenderer.h"
+# include "splitrenderer.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Frees the device buffers of a weld
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+WeldBuffers::~WeldBuffers()
+{
+    for ( void *pointer : pointers ) cudaFree( pointer );
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Determines if meshes can be preprocessed on a device
+ *
+ * @param   void
+ *
+ * @return  True if there is a device and drawing on the host was not asked
+ *          for, false otherwise
+ */
+bool MeshPreprocessor::isAvailable()
+{
+    if ( getenv( "RENDER_CPU" ) != nullptr ) return false;
+
+    return SplitRenderer::getDeviceCount() > 0;
+}
+
+
+/**
+ * @brief   Determines if the weld of a mesh fits in the free memory of the
+ *          current device
+ *
+ * @param   facetCount  The number of facets of the mesh
+ *
+ * @return  True if the weld's buffers would fit, false otherwise
+ */
+bool MeshPreprocessor::fitsOnDevice( unsigned int facetCount )
+{
+    // the corners are counted in 32 bits
+    if ( facetCount > UINT_MAX / Mesh::FACET_DIM ) return false;
+
+    size_t freeBytes = 0;
+    size_t totalBytes = 0;
+
+    if ( cudaMemGetInfo( &freeBytes, &totalBytes ) != cudaSuccess )
+    {
+        cudaGetLastError();
+        return false;
+    }
+
+    size_t weldBytes = ( size_t ) facetCount * Mesh::FACET_DIM * WELD_BYTES_PER_CORNER;
+
+    return weldBytes <= freeBytes * OutOfCoreRenderer::DEVICE_MEMORY_SHARE;
+}
+
+
+/**
+ * @brief   Welds the raw corners of a triangle soup into a mesh on the
+ *          device
+ *
+ * The mesh is replaced and left in host memory, ready for pushToDevice. If
+ * the weld does not fit on the device, or a buffer cannot be allocated,
+ * nothing is welded and the mesh is left empty, for the caller to weld it
+ * on the host instead.
+ *
+ * @param   *coords     Nine coordinates per facet, three per corner
+ * @param   facetCount  The number of facets
+ * @param   &mesh       The mesh to replace
+ *
+ * @return  True if the mesh was welded, false otherwise
+ */
+bool MeshPreprocessor::process( const float *coords, unsigned int facetCount, Mesh &mesh )
+{
+    mesh.erase();
+
+    if ( facetCount == 0 ) return true;
+    if ( !fitsOnDevice( facetCount ) ) return false;
+
+    WeldBuffers buffers;
+
+    try
+    {
+        if ( weld( coords, facetCount, buffers, mesh ) ) return true;
+    }
+    catch ( const std::bad_alloc & )
+    {
+        // thrust could not allocate the scratch space of a sort
+    }
+    catch ( const thrust::system_error & )
+    {
+
+    }
+
+    // leave no error behind for the next call to report
+    cudaGetLastError();
+    mesh.erase();
+
+    return false;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Allocates a device buffer of a weld, freed with the others when
+ *          the weld ends
+ *
+ * @param   **buffer    Set to the buffer, or to null if it could not be
+ *                      allocated
+ * @param   bytes       The size of the buffer in bytes
+ * @param   &buffers    The buffers of the weld
+ *
+ * @return  True if the buffer was allocated, false otherwise
+ */
+bool MeshPreprocessor::allocate( void **buffer, size_t bytes, WeldBuffers &buffers )
+{
+    *buffer = nullptr;
+
+    if ( cudaMalloc( buffer, bytes ) != cudaSuccess )
+    {
+        *buffer = nullptr;
+        return false;
+    }
+
+    buffers.pointers.push_back( *buffer );
+
+    return true;
+}
+
+
+/**
+ * @brief   Welds the raw corners of a triangle soup into a mesh on the
+ *          device
+ *
+ * @param   *coords     Nine coordinates per facet, three per corner
+ * @param   facetCount  The number of facets, at least one
+ * @param   &buffers    The buffers of the weld, freed by the caller
+ * @param   &mesh       The empty mesh to fill
+ *
+ * @return  True if the mesh was welded, false if a buffer could not be
+ *          allocated
+ */
+bool MeshPreprocessor::weld( const float *coords, unsigned int facetCount, WeldBuffers &buffers, Mesh &mesh )
+{
+    unsigned int cornerCount = facetCount * Mesh::FACET_DIM;
+    size_t coordBytes = ( size_t ) cornerCount * Mesh::COORD_DIM * sizeof( float );
+
+    float *d_coords = nullptr;
+    unsigned long long *d_keys = nullptr;
+    unsigned int *d_corners = nullptr;
+    unsigned int *d_heads = nullptr;
+    unsigned int *d_runIds = nullptr;
+
+    if ( !allocate( ( void ** ) &d_coords, coordBytes, buffers ) ||
+         !allocate( ( void ** ) &d_keys, cornerCount * sizeof( unsigned long long ), buffers ) ||
+         !allocate( ( void ** ) &d_corners, cornerCount * sizeof( unsigned int ), buffers ) ||
+         !allocate( ( void ** ) &d_heads, cornerCount * sizeof( unsigned int ), buffers ) ||
+         !allocate( ( void ** ) &d_runIds, cornerCount * sizeof( unsigned int ), buffers ) )
+    {
+        return false;
+    }
+
+    HANDLE_CUDA_ERROR( cudaMemcpy( d_coords, coords, coordBytes, cudaMemcpyHostToDevice ) );
+
+    // sort the corners by the exact bits of their coordinates, z first and
+    // then x and y, so that every shared corner is one run
+    unsigned int cornerBlocks = ( cornerCount + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+
+    thrust::device_ptr<unsigned long long> keys( d_keys );
+    thrust::device_ptr<unsigned int> corners( d_corners );
+
+    thrust::sequence( thrust::device, corners, corners + cornerCount );
+
+    // stable, so every run of equal keys starts with its first corner
+    packCornerKeys<<<cornerBlocks, BLOCK_SIZE>>>( d_coords, d_corners, cornerCount, 2, 1, d_keys );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    thrust::stable_sort_by_key( thrust::device, keys, keys + cornerCount, corners );
+
+    packCornerKeys<<<cornerBlocks, BLOCK_SIZE>>>( d_coords, d_corners, cornerCount, 0, 2, d_keys );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    thrust::stable_sort_by_key( thrust::device, keys, keys + cornerCount, corners );
+
+    // number the runs of equal keys
+    markWeldRuns<<<cornerBlocks, BLOCK_SIZE>>>( d_coords, d_corners, d_keys, cornerCount, d_heads );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    thrust::device_ptr<unsigned int> heads( d_heads );
+    thrust::device_ptr<unsigned int> runIds( d_runIds );
+    thrust::inclusive_scan( thrust::device, heads, heads + cornerCount, runIds );
+
+    unsigned int vertexCount = 0;
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy( &vertexCount, d_runIds + cornerCount - 1, sizeof( unsigned int ), cudaMemcpyDeviceToHost )
+    );
+
+    // the keys are no longer needed, they hold the first corner and the
+    // run of every vertex, as there are at most as many runs as corners
+    unsigned int *d_runCorners = ( unsigned int * ) d_keys;
+    unsigned int *d_runOrder = d_runCorners + cornerCount;
+
+    // order the runs by their first corner, which numbers the vertices
+    scatterRunCorners<<<cornerBlocks, BLOCK_SIZE>>>( d_heads, d_runIds, d_corners, cornerCount, d_runCorners );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    thrust::device_ptr<unsigned int> runCorners( d_runCorners );
+    thrust::device_ptr<unsigned int> runOrder( d_runOrder );
+
+    thrust::sequence( thrust::device, runOrder, runOrder + vertexCount );
+    thrust::sort_by_key( thrust::device, runCorners, runCorners + vertexCount, runOrder );
+
+    // the heads are no longer needed, they become the run-to-vertex table
+    unsigned int *d_runVertices = d_heads;
+
+    float *d_vertices = nullptr;
+    unsigned int *d_indices = nullptr;
+
+    if ( !allocate( ( void ** ) &d_vertices, ( size_t ) vertexCount * Mesh::COORD_DIM * sizeof( float ), buffers ) ||
+         !allocate( ( void ** ) &d_indices, cornerCount * sizeof( unsigned int ), buffers ) )
+    {
+        return false;
+    }
+
+    unsigned int vertexBlocks = ( vertexCount + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+
+    gatherWeldedVertices<<<vertexBlocks, BLOCK_SIZE>>>(
+        d_coords, d_runCorners, d_runOrder, vertexCount, d_vertices, d_runVertices
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    // point every corner at the vertex of its run
+    resolveCornerIndices<<<cornerBlocks, BLOCK_SIZE>>>(
+        d_corners, d_runIds, d_runVertices, cornerCount, d_indices
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    // the mesh keeps its host copy, the device buffers are made by pushToDevice
+    std::vector<float> vertices( ( size_t ) vertexCount * Mesh::COORD_DIM );
+    std::vector<unsigned int> indices( cornerCount );
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy( vertices.data(), d_vertices, vertices.size() * sizeof( float ), cudaMemcpyDeviceToHost )
+    );
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy( indices.data(), d_indices, indices.size() * sizeof( unsigned int ), cudaMemcpyDeviceToHost )
+    );
+
+    mesh.assign(
+        vertices.data(), vertices.data() + vertexCount, vertices.data() + 2 * ( size_t ) vertexCount, vertexCount,
+        indices.data(), facetCount,
+        nullptr, 0
+    );
+
+    return true;
+}
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+/**
+ * @brief   Gets the bits a coordinate is welded on, with negative zero
+ *          folded into positive zero like the host weld
+ *
+ * @param   coord   The coordinate
+ *
+ * @return  The bits of the coordinate
+ */
+__device__ inline unsigned int getWeldBits( float coord )
+{
+    return __float_as_uint( coord + 0.0f );
+}
+
+
+/**
+ * @brief   Packs the weld bits of one or two axes of every sorted corner
+ *          into a 64-bit key, one thread per sorted corner
+ *
+ * @param   *coords         Three coordinates per corner
+ * @param   *corners        The corner indices in their current order
+ * @param   cornerCount     The number of corners
+ * @param   firstAxis       The axis in the high bits of the key
+ * @param   axisCount       The number of axes to pack, one or two
+ * @param   *keys           The weld key of every sorted corner to write
+ *
+ * @return  void
+ */
+__global__ void packCornerKeys(
+    const float * coords, const unsigned int * corners, unsigned int cornerCount,
+    unsigned int firstAxis, unsigned int axisCount, unsigned long long * keys
+)
+{
+    unsigned int i = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( i >= cornerCount ) return;
+
+    const float *corner = coords + ( size_t ) corners[i] * Mesh::COORD_DIM;
+
+    unsigned long long key = 0;
+
+    for ( unsigned int axis = firstAxis; axis < firstAxis + axisCount; axis++ )
+    {
+        key = ( key << 32 ) | getWeldBits( corner[axis] );
+    }
+
+    keys[i] = key;
+}
+
+
+/**
+ * @brief   Flags the first corner of every run of equal coordinates, one
+ *          thread per sorted corner
+ *
+ * The keys hold x and y; z was sorted on first, so it is compared here.
+ * A corner with a NaN coordinate starts its own run, as the host weld never
+ * finds it equal to anything.
+ *
+ * @param   *coords         Three coordinates per corner
+ * @param   *corners        The corner indices in sorted order
+ * @param   *keys           The x and y weld keys of the sorted corners
+ * @param   cornerCount     The number of corners
+ * @param   *heads          The flags to write, 1 for the first corner of a
+ *                          run and 0 otherwise
+ *
+ * @return  void
+ */
+__global__ void markWeldRuns(
+    const float * coords, const unsigned int * corners, const unsigned long long * keys,
+    unsigned int cornerCount, unsigned int * heads
+)
+{
+    unsigned int i = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( i >= cornerCount ) return;
+
+    const float *corner = coords + ( size_t ) corners[i] * Mesh::COORD_DIM;
+
+    if ( ( i == 0 ) || isnan( corner[0] ) || isnan( corner[1] ) || isnan( corner[2] ) )
+    {
+        heads[i] = 1;
+        return;
+    }
+
+    const float *previous = coords + ( size_t ) corners[i - 1] * Mesh::COORD_DIM;
+
+    heads[i] = ( ( keys[i] != keys[i - 1] ) || ( getWeldBits( corner[2] ) != getWeldBits( previous[2] ) ) ) ? 1 : 0;
+}
+
+
+/**
+ * @brief   Records the first corner of every run, one thread per sorted
+ *          corner
+ *
+ * @param   *heads          The run head flags
+ * @param   *runIds         The inclusive prefix sum of the flags
+ * @param   *corners        The corner indices in key order
+ * @param   cornerCount     The number of corners
+ * @param   *runCorners     The first corner of every run to write
+ *
+ * @return  void
+ */
+__global__ void scatterRunCorners(
+    const unsigned int * heads, const unsigned int * runIds, const unsigned int * corners,
+    unsigned int cornerCount, unsigned int * runCorners
+)
+{
+    unsigned int i = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( ( i >= cornerCount ) || ( heads[i] == 0 ) ) return;
+
+    runCorners[runIds[i] - 1] = corners[i];
+}
+
+
+/**
+ * @brief   Writes the position of every welded vertex and the vertex of
+ *          every run, one thread per vertex
+ *
+ * @param   *coords         Three coordinates per corner
+ * @param   *runCorners     The first corner of every vertex, in vertex order
+ * @param   *runOrder       The run of every vertex
+ * @param   vertexCount     The number of vertices
+ * @param   *vertices       The x[], y[] and z[] arrays of the vertex pool to
+ *                          write, vertexCount apart
+ * @param   *runVertices    The vertex of every run to write
+ *
+ * @return  void
+ */
+__global__ void gatherWeldedVertices(
+    const float * coords, const unsigned int * runCorners, const unsigned int * runOrder,
+    unsigned int vertexCount, float * vertices, unsigned int * runVertices
+)
+{
+    unsigned int vertIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( vertIdx >= vertexCount ) return;
+
+    const float *corner = coords + ( size_t ) runCorners[vertIdx] * Mesh::COORD_DIM;
+
+    // adding zero folds negative zero into positive zero, like the host weld
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        vertices[( size_t ) i * vertexCount + vertIdx] = corner[i] + 0.0f;
+    }
+
+    runVertices[runOrder[vertIdx]] = vertIdx;
+}
+
+
+/**
+ * @brief   Writes the vertex index of every corner into the index buffer,
+ *          one thread per sorted corner
+ *
+ * @param   *corners        The corner indices in key order
+ * @param   *runIds         The inclusive prefix sum of the run head flags
+ * @param   *runVertices    The vertex of every run
+ * @param   cornerCount     The number of corners
+ * @param   *indices        The index buffer to write
+ *
+ * @return  void
+ */
+__global__ void resolveCornerIndices(
+    const unsigned int * corners, const unsigned int * runIds, const unsigned int * runVertices,
+    unsigned int cornerCount, unsigned int * indices
+)
+{
+    unsigned int i = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( i >= cornerCount ) return;
+
+    indices[corners[i]] = runVertices[runIds[i] - 1];
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,132 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    meshpreprocessor.h
+ * @brief   GPU welding of a freshly read mesh
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_MESHPREPROCESSOR_H
+# define GRAPHICS_MESHPREPROCESSOR_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <vector>
+
+# include "mesh.h"
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * The device buffers of one weld, freed together however the weld ends
+ */
+struct WeldBuffers
+{
+    std::vector<void *> pointers = std::vector<void *>();
+
+    ~WeldBuffers();
+};
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * Builds an indexed mesh from the raw corners of an STL file on the device,
+ * once per load. Corners are welded on the exact bits of their coordinates,
+ * like the host weld: the corners are sorted by z and then, stably, by x
+ * and y, and each run of equal coordinates becomes one vertex. Vertices are
+ * numbered in the order their first corner appears in the file, so the
+ * vertex pool and index buffer are the same as those of the host weld, no
+ * matter where a file was read.
+ *
+ * A weld needs up to WELD_BYTES_PER_CORNER of device memory per corner for
+ * the length of the load. A mesh whose weld does not fit in the free memory
+ * of the device, or whose buffers cannot be allocated, is not welded here,
+ * so that the caller welds it on the host and the renderer still gets to
+ * stream it or split it over several devices.
+ */
+class MeshPreprocessor
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int BLOCK_SIZE = 256;
+
+    // the corners, their keys, run flags and ids, and the welded vertices
+    // and index buffer, when no two corners weld
+    static constexpr size_t WELD_BYTES_PER_CORNER = 48;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static bool isAvailable();
+    static bool fitsOnDevice( unsigned int facetCount );
+
+    static bool process( const float *coords, unsigned int facetCount, Mesh &mesh );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static bool allocate( void **buffer, size_t bytes, WeldBuffers &buffers );
+    static bool weld( const float *coords, unsigned int facetCount, WeldBuffers &buffers, Mesh &mesh );
+
+
+    /* ====================================================================== */
+};
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+__global__ void packCornerKeys(
+    const float * coords, const unsigned int * corners, unsigned int cornerCount,
+    unsigned int firstAxis, unsigned int axisCount, unsigned long long * keys
+);
+
+__global__ void markWeldRuns(
+    const float * coords, const unsigned int * corners, const unsigned long long * keys,
+    unsigned int cornerCount, unsigned int * heads
+);
+
+__global__ void scatterRunCorners(
+    const unsigned int * heads, const unsigned int * runIds, const unsigned int * corners,
+    unsigned int cornerCount, unsigned int * runCorners
+);
+
+__global__ void gatherWeldedVertices(
+    const float * coords, const unsigned int * runCorners, const unsigned int * runOrder,
+    unsigned int vertexCount, float * vertices, unsigned int * runVertices
+);
+
+__global__ void resolveCornerIndices(
+    const unsigned int * corners, const unsigned int * runIds, const unsigned int * runVertices,
+    unsigned int cornerCount, unsigned int * indices
+);
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_MESHPREPROCESSOR_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,792 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    meshsimplifier.cpp
+ * @brief   Quadric edge collapse simplification of indexed meshes
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cmath>
+# include <cstring>
+
+# include "meshsimplifier.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+// the error threshold of pass i is THRESHOLD_SCALE * ( i + 3 ) ^ THRESHOLD_EXPONENT
+const double THRESHOLD_SCALE = 1e-9;
+const double THRESHOLD_EXPONENT = 7;
+
+// passes between rebuilding the vertex to triangle references
+const unsigned int UPDATE_INTERVAL = 5;
+
+// collapses that fold a neighboring triangle further than this are rejected
+const double MIN_NORMAL_ALIGNMENT = 0.2;
+const double MAX_EDGE_ALIGNMENT = 0.999;
+
+// quadrics closer to singular than this are not solved for a position
+const double MIN_DETERMINANT = 1e-12;
+
+
+/* ---------------------------- Vector Functions ---------------------------- */
+
+
+/**
+ * @brief   Subtracts two 3D vectors
+ *
+ * @param   *a      The vector to subtract from
+ * @param   *b      The vector to subtract
+ * @param   *out    The difference a - b to write
+ *
+ * @return  void
+ */
+static void subtract( const double *a, const double *b, double *out )
+{
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ ) out[i] = a[i] - b[i];
+}
+
+
+/**
+ * @brief   Computes the dot product of two 3D vectors
+ *
+ * @param   *a  The first vector
+ * @param   *b  The second vector
+ *
+ * @return  The dot product
+ */
+static double dot( const double *a, const double *b )
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+
+/**
+ * @brief   Computes the cross product of two 3D vectors
+ *
+ * @param   *a      The first vector
+ * @param   *b      The second vector
+ * @param   *out    The cross product a x b to write
+ *
+ * @return  void
+ */
+static void cross( const double *a, const double *b, double *out )
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+
+/**
+ * @brief   Scales a 3D vector to unit length, leaving zero vectors as they are
+ *
+ * @param   *v  The vector to normalize in place
+ *
+ * @return  void
+ */
+static void normalize( double *v )
+{
+    double length = sqrt( dot( v, v ) );
+
+    if ( length == 0 ) return;
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ ) v[i] /= length;
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a simplifier holding a copy of a mesh
+ *
+ * @param   &mesh   The mesh to simplify
+ *
+ * @return  The created simplifier
+ */
+MeshSimplifier::MeshSimplifier( const Mesh &mesh )
+{
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+    mesh.getBounds( boundsMin, boundsMax );
+
+    extent = 0;
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        center[i] = ( ( double ) boundsMin[i] + boundsMax[i] ) / 2;
+        extent = std::max( extent, ( ( double ) boundsMax[i] - boundsMin[i] ) / 2 );
+    }
+
+    if ( !( extent > 0 ) ) extent = 1;
+
+    const float *coords[Mesh::COORD_DIM] = { mesh.getX(), mesh.getY(), mesh.getZ() };
+
+    vertices.resize( mesh.getVertexCount() );
+
+    for ( unsigned int vertIdx = 0; vertIdx < vertices.size(); vertIdx++ )
+    {
+        Vertex &v = vertices[vertIdx];
+
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+        {
+            v.p[i] = ( coords[i][vertIdx] - center[i] ) / extent;
+        }
+    }
+
+    const unsigned int *indices = mesh.getIndices();
+
+    triangles.reserve( mesh.getFacetCount() );
+
+    for ( unsigned int facetIdx = 0; facetIdx < mesh.getFacetCount(); facetIdx++ )
+    {
+        Triangle t;
+        memset( &t, 0, sizeof( t ) );
+
+        for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+        {
+            t.v[i] = indices[facetIdx * Mesh::FACET_DIM + i];
+        }
+
+        // collapses never make degenerate triangles, but the source may have them
+        if ( ( t.v[0] == t.v[1] ) || ( t.v[1] == t.v[2] ) || ( t.v[2] == t.v[0] ) ) continue;
+
+        triangles.push_back( t );
+    }
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Collapses edges until at most a target number of facets remain,
+ *          or no collapse is cheap enough within MAX_ITERATIONS passes
+ *
+ * @param   targetFacetCount    The number of facets to simplify down to
+ *
+ * @return  void
+ */
+void MeshSimplifier::simplify( unsigned int targetFacetCount )
+{
+    unsigned int facetCount = triangles.size();
+    unsigned int deletedCount = 0;
+
+    std::vector<bool> deleted0;
+    std::vector<bool> deleted1;
+
+    for ( unsigned int iteration = 0; iteration < MAX_ITERATIONS; iteration++ )
+    {
+        if ( facetCount - deletedCount <= targetFacetCount ) break;
+
+        if ( iteration % UPDATE_INTERVAL == 0 ) updateMesh( iteration );
+
+        for ( Triangle &t : triangles ) t.dirty = false;
+
+        double threshold = THRESHOLD_SCALE * pow( iteration + 3.0, THRESHOLD_EXPONENT );
+
+        for ( unsigned int triangleIdx = 0; triangleIdx < triangles.size(); triangleIdx++ )
+        {
+            Triangle &t = triangles[triangleIdx];
+
+            if ( t.deleted || t.dirty || ( t.error[Mesh::FACET_DIM] > threshold ) ) continue;
+
+            for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ )
+            {
+                if ( t.error[j] > threshold ) continue;
+
+                unsigned int i0 = t.v[j];
+                unsigned int i1 = t.v[( j + 1 ) % Mesh::FACET_DIM];
+                Vertex &v0 = vertices[i0];
+                Vertex &v1 = vertices[i1];
+
+                // keep open boundaries where they are
+                if ( v0.border != v1.border ) continue;
+
+                double p[Mesh::COORD_DIM];
+                edgeError( i0, i1, p );
+
+                deleted0.assign( v0.refCount, false );
+                deleted1.assign( v1.refCount, false );
+
+                if ( flipped( p, i1, v0, deleted0 ) ) continue;
+                if ( flipped( p, i0, v1, deleted1 ) ) continue;
+
+                // merge v1 into v0
+                memcpy( v0.p, p, sizeof( p ) );
+                addQuadric( v0.q, v1.q );
+
+                unsigned int refStart = refs.size();
+
+                updateTriangles( i0, v0, deleted0, deletedCount );
+                updateTriangles( i0, v1, deleted1, deletedCount );
+
+                unsigned int refCount = refs.size() - refStart;
+
+                // reuse v0's references in place if they still fit
+                if ( refCount <= v0.refCount )
+                {
+                    if ( refCount > 0 )
+                    {
+                        memmove( &refs[v0.refStart], &refs[refStart], refCount * sizeof( Reference ) );
+                    }
+                }
+                else
+                {
+                    v0.refStart = refStart;
+                }
+
+                v0.refCount = refCount;
+                break;
+            }
+
+            if ( facetCount - deletedCount <= targetFacetCount ) break;
+        }
+    }
+
+    compactMesh();
+}
+
+
+/**
+ * @brief   Gets the number of facets left
+ *
+ * @param   void
+ *
+ * @return  The number of facets in the simplified mesh
+ */
+unsigned int MeshSimplifier::getFacetCount() const
+{
+    unsigned int facetCount = 0;
+
+    for ( const Triangle &t : triangles )
+    {
+        if ( !t.deleted ) facetCount++;
+    }
+
+    return facetCount;
+}
+
+
+/**
+ * @brief   Stores the simplified mesh, replacing the contents of a mesh
+ *
+ * The unique edge list is left to be built when the mesh is pushed to the
+ * device.
+ *
+ * @param   &mesh   The mesh to store into
+ *
+ * @return  void
+ */
+void MeshSimplifier::store( Mesh &mesh ) const
+{
+    std::vector<float> coords[Mesh::COORD_DIM];
+    std::vector<unsigned int> remap( vertices.size(), ~0u );
+    std::vector<unsigned int> indices;
+
+    indices.reserve( triangles.size() * Mesh::FACET_DIM );
+
+    for ( const Triangle &t : triangles )
+    {
+        if ( t.deleted ) continue;
+
+        for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ )
+        {
+            unsigned int vertIdx = t.v[j];
+
+            // only keep the vertices that are still used
+            if ( remap[vertIdx] == ~0u )
+            {
+                remap[vertIdx] = coords[0].size();
+
+                for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+                {
+                    coords[i].push_back( ( float ) ( vertices[vertIdx].p[i] * extent + center[i] ) );
+                }
+            }
+
+            indices.push_back( remap[vertIdx] );
+        }
+    }
+
+    mesh.assign(
+        coords[0].data(), coords[1].data(), coords[2].data(), coords[0].size(),
+        indices.data(), indices.size() / Mesh::FACET_DIM,
+        nullptr, 0
+    );
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Drops deleted triangles and rebuilds the vertex references, and
+ *          on the first pass sets up the borders, quadrics and edge errors
+ *
+ * @param   iteration   The current pass
+ *
+ * @return  void
+ */
+void MeshSimplifier::updateMesh( unsigned int iteration )
+{
+    if ( iteration > 0 )
+    {
+        unsigned int dst = 0;
+
+        for ( unsigned int i = 0; i < triangles.size(); i++ )
+        {
+            if ( !triangles[i].deleted ) triangles[dst++] = triangles[i];
+        }
+
+        triangles.resize( dst );
+    }
+
+    buildReferences();
+
+    if ( iteration == 0 )
+    {
+        findBorders();
+        buildQuadrics();
+    }
+}
+
+
+/**
+ * @brief   Drops deleted triangles and unused vertices
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void MeshSimplifier::compactMesh()
+{
+    unsigned int dst = 0;
+
+    for ( Vertex &v : vertices ) v.refCount = 0;
+
+    for ( unsigned int i = 0; i < triangles.size(); i++ )
+    {
+        if ( triangles[i].deleted ) continue;
+
+        triangles[dst] = triangles[i];
+
+        for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ ) vertices[triangles[dst].v[j]].refCount = 1;
+
+        dst++;
+    }
+
+    triangles.resize( dst );
+
+    // refStart holds each kept vertex's new index
+    dst = 0;
+
+    for ( unsigned int i = 0; i < vertices.size(); i++ )
+    {
+        if ( vertices[i].refCount == 0 ) continue;
+
+        vertices[i].refStart = dst;
+        memcpy( vertices[dst].p, vertices[i].p, sizeof( vertices[i].p ) );
+        dst++;
+    }
+
+    for ( Triangle &t : triangles )
+    {
+        for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ ) t.v[j] = vertices[t.v[j]].refStart;
+    }
+
+    vertices.resize( dst );
+    refs.clear();
+}
+
+
+/**
+ * @brief   Rebuilds the list of triangle corners that use each vertex
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void MeshSimplifier::buildReferences()
+{
+    for ( Vertex &v : vertices )
+    {
+        v.refStart = 0;
+        v.refCount = 0;
+    }
+
+    for ( const Triangle &t : triangles )
+    {
+        for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ ) vertices[t.v[j]].refCount++;
+    }
+
+    unsigned int refStart = 0;
+
+    for ( Vertex &v : vertices )
+    {
+        v.refStart = refStart;
+        refStart += v.refCount;
+        v.refCount = 0;
+    }
+
+    refs.resize( triangles.size() * Mesh::FACET_DIM );
+
+    for ( unsigned int i = 0; i < triangles.size(); i++ )
+    {
+        for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ )
+        {
+            Vertex &v = vertices[triangles[i].v[j]];
+
+            refs[v.refStart + v.refCount].triangleIdx = i;
+            refs[v.refStart + v.refCount].corner = j;
+            v.refCount++;
+        }
+    }
+}
+
+
+/**
+ * @brief   Marks the vertices on an open boundary, where an edge is used by
+ *          only one triangle
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void MeshSimplifier::findBorders()
+{
+    std::vector<unsigned int> neighborCounts;
+    std::vector<unsigned int> neighbors;
+
+    for ( Vertex &v : vertices ) v.border = false;
+
+    for ( const Vertex &v : vertices )
+    {
+        neighborCounts.clear();
+        neighbors.clear();
+
+        for ( unsigned int k = 0; k < v.refCount; k++ )
+        {
+            const Triangle &t = triangles[refs[v.refStart + k].triangleIdx];
+
+            for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ )
+            {
+                unsigned int id = t.v[j];
+                unsigned int ofs = 0;
+
+                while ( ( ofs < neighbors.size() ) && ( neighbors[ofs] != id ) ) ofs++;
+
+                if ( ofs == neighbors.size() )
+                {
+                    neighbors.push_back( id );
+                    neighborCounts.push_back( 1 );
+                }
+                else
+                {
+                    neighborCounts[ofs]++;
+                }
+            }
+        }
+
+        // a neighbor seen by one triangle only is across a boundary edge
+        for ( unsigned int j = 0; j < neighbors.size(); j++ )
+        {
+            if ( neighborCounts[j] == 1 ) vertices[neighbors[j]].border = true;
+        }
+    }
+}
+
+
+/**
+ * @brief   Sums the plane quadrics of every vertex's triangles and computes
+ *          the collapse error of every edge
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void MeshSimplifier::buildQuadrics()
+{
+    for ( Vertex &v : vertices ) memset( &v.q, 0, sizeof( v.q ) );
+
+    for ( Triangle &t : triangles )
+    {
+        double e1[Mesh::COORD_DIM];
+        double e2[Mesh::COORD_DIM];
+
+        subtract( vertices[t.v[1]].p, vertices[t.v[0]].p, e1 );
+        subtract( vertices[t.v[2]].p, vertices[t.v[0]].p, e2 );
+        cross( e1, e2, t.n );
+        normalize( t.n );
+
+        double d = -dot( t.n, vertices[t.v[0]].p );
+
+        for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ )
+        {
+            addPlane( vertices[t.v[j]].q, t.n[0], t.n[1], t.n[2], d );
+        }
+    }
+
+    for ( Triangle &t : triangles )
+    {
+        double p[Mesh::COORD_DIM];
+
+        for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ )
+        {
+            t.error[j] = edgeError( t.v[j], t.v[( j + 1 ) % Mesh::FACET_DIM], p );
+        }
+
+        t.error[Mesh::FACET_DIM] = std::min( t.error[0], std::min( t.error[1], t.error[2] ) );
+    }
+}
+
+
+/**
+ * @brief   Computes the cost of collapsing an edge and where the merged
+ *          vertex should go
+ *
+ * The position that minimizes the summed quadric is used if it can be
+ * solved for; otherwise the best of the end points and the midpoint.
+ *
+ * @param   v0      The index of the first vertex of the edge
+ * @param   v1      The index of the second vertex of the edge
+ * @param   *p      The position of the merged vertex to write
+ *
+ * @return  The quadric error of the merged vertex
+ */
+double MeshSimplifier::edgeError( unsigned int v0, unsigned int v1, double *p ) const
+{
+    Quadric q = vertices[v0].q;
+    addQuadric( q, vertices[v1].q );
+
+    bool border = vertices[v0].border && vertices[v1].border;
+    double det = determinant( q, 0, 1, 2, 1, 4, 5, 2, 5, 7 );
+
+    if ( !border && ( fabs( det ) > MIN_DETERMINANT ) )
+    {
+        p[0] = -1 / det * determinant( q, 1, 2, 3, 4, 5, 6, 5, 7, 8 );
+        p[1] =  1 / det * determinant( q, 0, 2, 3, 1, 5, 6, 2, 7, 8 );
+        p[2] = -1 / det * determinant( q, 0, 1, 3, 1, 4, 6, 2, 5, 8 );
+
+        return evaluate( q, p );
+    }
+
+    const double *p0 = vertices[v0].p;
+    const double *p1 = vertices[v1].p;
+    double mid[Mesh::COORD_DIM] = {
+        ( p0[0] + p1[0] ) / 2,
+        ( p0[1] + p1[1] ) / 2,
+        ( p0[2] + p1[2] ) / 2
+    };
+
+    double error0 = evaluate( q, p0 );
+    double error1 = evaluate( q, p1 );
+    double errorMid = evaluate( q, mid );
+    double error = std::min( error0, std::min( error1, errorMid ) );
+
+    if ( error == error0 ) memcpy( p, p0, sizeof( mid ) );
+    else if ( error == error1 ) memcpy( p, p1, sizeof( mid ) );
+    else memcpy( p, mid, sizeof( mid ) );
+
+    return error;
+}
+
+
+/**
+ * @brief   Determines if moving a vertex would fold over one of its
+ *          triangles, and marks the triangles the collapse deletes
+ *
+ * @param   *p          The position the vertex would move to
+ * @param   i1          The index of the vertex at the other end of the edge
+ * @param   &v0         The vertex that would move
+ * @param   &deleted    Set for each of v0's references that uses i1 too
+ *
+ * @return  True if the collapse should be rejected, false otherwise
+ */
+bool MeshSimplifier::flipped(
+    const double *p, unsigned int i1, const Vertex &v0, std::vector<bool> &deleted
+) const
+{
+    for ( unsigned int k = 0; k < v0.refCount; k++ )
+    {
+        const Reference &r = refs[v0.refStart + k];
+        const Triangle &t = triangles[r.triangleIdx];
+
+        if ( t.deleted ) continue;
+
+        unsigned int id1 = t.v[( r.corner + 1 ) % Mesh::FACET_DIM];
+        unsigned int id2 = t.v[( r.corner + 2 ) % Mesh::FACET_DIM];
+
+        // this triangle collapses with the edge
+        if ( ( id1 == i1 ) || ( id2 == i1 ) )
+        {
+            deleted[k] = true;
+            continue;
+        }
+
+        double d1[Mesh::COORD_DIM];
+        double d2[Mesh::COORD_DIM];
+
+        subtract( vertices[id1].p, p, d1 );
+        subtract( vertices[id2].p, p, d2 );
+        normalize( d1 );
+        normalize( d2 );
+
+        // the triangle would become a sliver
+        if ( fabs( dot( d1, d2 ) ) > MAX_EDGE_ALIGNMENT ) return true;
+
+        double n[Mesh::COORD_DIM];
+        cross( d1, d2, n );
+        normalize( n );
+
+        deleted[k] = false;
+
+        // the triangle would turn over
+        if ( dot( n, t.n ) < MIN_NORMAL_ALIGNMENT ) return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief   Points the triangles of a collapsed vertex at the merged vertex,
+ *          deletes the ones the collapse removes and recomputes edge errors
+ *
+ * The references of the surviving triangles are appended to refs.
+ *
+ * @param   i0              The index of the merged vertex
+ * @param   &v              The vertex whose triangles to update
+ * @param   &deleted        Which of v's references are deleted
+ * @param   &deletedCount   The number of deleted triangles, incremented
+ *
+ * @return  void
+ */
+void MeshSimplifier::updateTriangles(
+    unsigned int i0, const Vertex &v, const std::vector<bool> &deleted,
+    unsigned int &deletedCount
+)
+{
+    double p[Mesh::COORD_DIM];
+
+    for ( unsigned int k = 0; k < v.refCount; k++ )
+    {
+        // copied, refs may grow below
+        Reference r = refs[v.refStart + k];
+        Triangle &t = triangles[r.triangleIdx];
+
+        if ( t.deleted ) continue;
+
+        if ( deleted[k] )
+        {
+            t.deleted = true;
+            deletedCount++;
+            continue;
+        }
+
+        t.v[r.corner] = i0;
+        t.dirty = true;
+
+        for ( unsigned int j = 0; j < Mesh::FACET_DIM; j++ )
+        {
+            t.error[j] = edgeError( t.v[j], t.v[( j + 1 ) % Mesh::FACET_DIM], p );
+        }
+
+        t.error[Mesh::FACET_DIM] = std::min( t.error[0], std::min( t.error[1], t.error[2] ) );
+
+        refs.push_back( r );
+    }
+}
+
+
+/**
+ * @brief   Adds one quadric to another
+ *
+ * @param   &q  The quadric to add to
+ * @param   &r  The quadric to add
+ *
+ * @return  void
+ */
+void MeshSimplifier::addQuadric( Quadric &q, const Quadric &r )
+{
+    for ( unsigned int i = 0; i < 10; i++ ) q.m[i] += r.m[i];
+}
+
+
+/**
+ * @brief   Adds the quadric of a plane ax + by + cz + d = 0 to a quadric
+ *
+ * @param   &q  The quadric to add to
+ * @param   a   The x coefficient of the plane
+ * @param   b   The y coefficient of the plane
+ * @param   c   The z coefficient of the plane
+ * @param   d   The constant of the plane
+ *
+ * @return  void
+ */
+void MeshSimplifier::addPlane( Quadric &q, double a, double b, double c, double d )
+{
+    double plane[10] = {
+        a * a, a * b, a * c, a * d,
+               b * b, b * c, b * d,
+                      c * c, c * d,
+                             d * d
+    };
+
+    for ( unsigned int i = 0; i < 10; i++ ) q.m[i] += plane[i];
+}
+
+
+/**
+ * @brief   Evaluates a quadric at a point, the sum of squared distances to
+ *          the planes it was built from
+ *
+ * @param   &q  The quadric to evaluate
+ * @param   *p  The point to evaluate at
+ *
+ * @return  The quadric error at the point
+ */
+double MeshSimplifier::evaluate( const Quadric &q, const double *p )
+{
+    double x = p[0];
+    double y = p[1];
+    double z = p[2];
+
+    return q.m[0] * x * x + 2 * q.m[1] * x * y + 2 * q.m[2] * x * z + 2 * q.m[3] * x +
+           q.m[4] * y * y + 2 * q.m[5] * y * z + 2 * q.m[6] * y +
+           q.m[7] * z * z + 2 * q.m[8] * z +
+           q.m[9];
+}
+
+
+/**
+ * @brief   Computes the determinant of a 3x3 matrix picked out of a quadric
+ *
+ * @param   &q      The quadric to pick from
+ * @param   a11     The quadric index of each entry of the 3x3 matrix, from
+ *                  a11 to a33 row by row
+ *
+ * @return  The determinant
+ */
+double MeshSimplifier::determinant(
+    const Quadric &q,
+    unsigned int a11, unsigned int a12, unsigned int a13,
+    unsigned int a21, unsigned int a22, unsigned int a23,
+    unsigned int a31, unsigned int a32, unsigned int a33
+)
+{
+    const double *m = q.m;
+
+    return m[a11] * m[a22] * m[a33] + m[a13] * m[a21] * m[a32] + m[a12] * m[a23] * m[a31] -
+           m[a13] * m[a22] * m[a31] - m[a11] * m[a23] * m[a32] - m[a12] * m[a21] * m[a33];
+}
+
+
+/* -------------------------------------------------------------------------- */
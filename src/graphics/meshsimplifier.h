@@ -0,0 +1,157 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    meshsimplifier.h
+ * @brief   Quadric edge collapse simplification of indexed meshes
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_MESHSIMPLIFIER_H
+# define GRAPHICS_MESHSIMPLIFIER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <vector>
+
+# include "mesh.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * Simplifies a mesh by repeatedly collapsing the edge whose merged vertex
+ * moves the surface least, measured with Garland and Heckbert's error
+ * quadrics. Rather than keeping a priority queue, each pass collapses every
+ * edge under an error threshold that grows from pass to pass, which is a
+ * little less exact but runs in linear time per pass. Coordinates are
+ * normalized to the bounding box while simplifying, so the thresholds do
+ * not depend on the model's units.
+ */
+class MeshSimplifier
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int MAX_ITERATIONS = 100;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit MeshSimplifier( const Mesh &mesh );
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void simplify( unsigned int targetFacetCount );
+
+    unsigned int getFacetCount() const;
+
+    void store( Mesh &mesh ) const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* -------------------------------- Types ------------------------------- */
+
+
+    // symmetric 4x4 matrix, stored as its upper triangle
+    struct Quadric
+    {
+        double m[10];
+    };
+
+    struct Vertex
+    {
+        double p[Mesh::COORD_DIM];
+        Quadric q;
+        unsigned int refStart;
+        unsigned int refCount;
+        bool border;
+    };
+
+    struct Triangle
+    {
+        unsigned int v[Mesh::FACET_DIM];
+        double error[Mesh::FACET_DIM + 1];
+        double n[Mesh::COORD_DIM];
+        bool deleted;
+        bool dirty;
+    };
+
+    // a corner of a triangle that uses a vertex
+    struct Reference
+    {
+        unsigned int triangleIdx;
+        unsigned int corner;
+    };
+
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::vector<Vertex> vertices = std::vector<Vertex>();
+    std::vector<Triangle> triangles = std::vector<Triangle>();
+    std::vector<Reference> refs = std::vector<Reference>();
+
+    double center[Mesh::COORD_DIM] = { 0, 0, 0 };
+    double extent = 1;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void updateMesh( unsigned int iteration );
+    void compactMesh();
+
+    void buildReferences();
+    void findBorders();
+    void buildQuadrics();
+
+    double edgeError( unsigned int v0, unsigned int v1, double *p ) const;
+
+    bool flipped(
+        const double *p, unsigned int i1, const Vertex &v0, std::vector<bool> &deleted
+    ) const;
+
+    void updateTriangles(
+        unsigned int i0, const Vertex &v, const std::vector<bool> &deleted,
+        unsigned int &deletedCount
+    );
+
+    static void addQuadric( Quadric &q, const Quadric &r );
+    static void addPlane( Quadric &q, double a, double b, double c, double d );
+    static double evaluate( const Quadric &q, const double *p );
+    static double determinant(
+        const Quadric &q,
+        unsigned int a11, unsigned int a12, unsigned int a13,
+        unsigned int a21, unsigned int a22, unsigned int a23,
+        unsigned int a31, unsigned int a32, unsigned int a33
+    );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_MESHSIMPLIFIER_H
+
+
+/* -------------------------------------------------------------------------- */
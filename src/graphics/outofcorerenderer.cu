@@ -0,0 +1,729 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    outofcorerenderer.cpp
+ * @brief   Renders a mesh larger than device memory by streaming it in chunks
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cfloat>
+# include <cstring>
+# include <iostream>
+
+# include "bvh.h"
+# include "cudaerr.cuh"
+# include "frameprofiler.h"
+# include "outofcorerenderer.h"
+# include "shapecontainer.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+// chunks start on a float4 boundary in host memory
+const size_t CHUNK_ALIGN = 16;
+
+const unsigned int NO_CHUNK = 0xFFFFFFFF;
+
+
+/* ---------------------------- Helper Functions ---------------------------- */
+
+
+/**
+ * @brief   Spreads the low 10 bits of a value out to every third bit
+ *
+ * @param   v   The value to spread
+ *
+ * @return  The spread value
+ */
+static unsigned int spreadBits( unsigned int v )
+{
+    v = ( v * 0x00010001u ) & 0xFF0000FFu;
+    v = ( v * 0x00000101u ) & 0x0F00F00Fu;
+    v = ( v * 0x00000011u ) & 0xC30C30C3u;
+    v = ( v * 0x00000005u ) & 0x49249249u;
+    return v;
+}
+
+
+/**
+ * @brief   Gets the bytes a chunk takes up, in host memory and in a slot
+ *
+ * @param   &chunk  The chunk
+ *
+ * @return  The size of the chunk's vertex pool, index buffer and edge list
+ */
+static size_t getChunkBytes( const MeshChunk &chunk )
+{
+    return ( size_t ) chunk.vertexStride * Mesh::COORD_DIM * sizeof( float ) +
+           ( size_t ) chunk.facetCount * Mesh::FACET_DIM * sizeof( unsigned int ) +
+           ( size_t ) chunk.edgeCount * Mesh::EDGE_DIM * sizeof( unsigned int );
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an out-of-core renderer with no mesh
+ *
+ * @param   void
+ *
+ * @return  The created out-of-core renderer
+ */
+OutOfCoreRenderer::OutOfCoreRenderer() = default;
+
+
+/**
+ * @brief   Out-of-core renderer destructor, frees the slots and unpins the
+ *          host chunks
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+OutOfCoreRenderer::~OutOfCoreRenderer()
+{
+    clear();
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Determines if a mesh can be pushed to the current device whole
+ *
+ * @param   vertexCount     The number of vertices of the mesh
+ * @param   facetCount      The number of facets of the mesh
+ *
+ * @return  True if the resident mesh would fit in the free device memory,
+ *          false otherwise
+ */
+bool OutOfCoreRenderer::fitsOnDevice( unsigned int vertexCount, unsigned int facetCount )
+{
+    size_t freeBytes = 0;
+    size_t totalBytes = 0;
+
+    // without an answer, carry on as if the mesh fits
+    if ( cudaMemGetInfo( &freeBytes, &totalBytes ) != cudaSuccess )
+    {
+        cudaGetLastError();
+        return true;
+    }
+
+    size_t residentBytes = ( size_t ) vertexCount * RESIDENT_BYTES_PER_VERTEX +
+                           ( size_t ) facetCount * RESIDENT_BYTES_PER_FACET;
+
+    return residentBytes <= freeBytes * DEVICE_MEMORY_SHARE;
+}
+
+
+/**
+ * @brief   Cuts a mesh into chunks in host memory and allocates the device
+ *          slots to stream them through
+ *
+ * @param   &mesh   The mesh to render, only read on the host
+ *
+ * @return  void
+ */
+void OutOfCoreRenderer::load( const Mesh &mesh )
+{
+    clear();
+
+    if ( mesh.getFacetCount() == 0 ) return;
+
+    buildChunks( mesh );
+
+    // transfers straight from the chunks if they can be page-locked
+    if ( cudaHostRegister( store.data(), store.size(), cudaHostRegisterDefault ) == cudaSuccess )
+    {
+        storePinned = true;
+    }
+    else
+    {
+        cudaGetLastError();
+    }
+
+    allocateSlots();
+}
+
+
+/**
+ * @brief   Frees the chunks and the device slots
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void OutOfCoreRenderer::clear()
+{
+    freeDevice();
+
+    if ( storePinned )
+    {
+        HANDLE_CUDA_ERROR( cudaHostUnregister( store.data() ) );
+        storePinned = false;
+    }
+
+    chunks.clear();
+    store.clear();
+    store.shrink_to_fit();
+    facetIds.clear();
+    facetIds.shrink_to_fit();
+}
+
+
+/**
+ * @brief   Determines if a mesh is loaded
+ *
+ * @param   void
+ *
+ * @return  True if there are chunks to draw, false otherwise
+ */
+bool OutOfCoreRenderer::isLoaded() const
+{
+    return !chunks.empty();
+}
+
+
+/**
+ * @brief   Gets the number of chunks the mesh is cut into
+ *
+ * @param   void
+ *
+ * @return  The number of chunks
+ */
+unsigned int OutOfCoreRenderer::getChunkCount() const
+{
+    return chunks.size();
+}
+
+
+/**
+ * @brief   Streams every chunk that can reach the window through the slots
+ *          and draws it into a framebuffer
+ *
+ * The first chunks are queued on their slots' streams up front. The draw
+ * work runs on the default stream, waiting on each chunk's upload, and a
+ * slot is refilled as soon as the draw is done with it, so up to
+ * SLOT_COUNT - 1 uploads are in flight behind every chunk being drawn. The
+ * view transform must already be on the device.
+ *
+ * @param   *vc         The view context to render with
+ * @param   &raster     The framebuffer to draw into, already cleared
+ * @param   &culler     The culler to drop facets or edges that cannot be
+ *                      seen with
+ * @param   color       The 24-bit RGB color to draw with
+ *
+ * @return  void
+ */
+void OutOfCoreRenderer::draw( ViewContext *vc, Rasterizer &raster, Culler &culler, unsigned int color )
+{
+    unsigned int width = raster.getWidth();
+    unsigned int height = raster.getHeight();
+
+    if ( chunks.empty() || ( width == 0 ) || ( height == 0 ) ) return;
+
+    float transform[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM];
+    vc->getTransform( transform );
+
+    float4 rowX = make_float4( transform[0][0], transform[0][1], transform[0][2], transform[0][3] );
+    float4 rowY = make_float4( transform[1][0], transform[1][1], transform[1][2], transform[1][3] );
+
+    // chunks off the window are never uploaded
+    std::vector<unsigned int> visible;
+
+    for ( unsigned int i = 0; i < chunks.size(); i++ )
+    {
+        unsigned int bounds = classifyBounds(
+            chunks[i].boundsMin, chunks[i].boundsMax,
+            rowX, rowY, width - 1, height - 1
+        );
+
+        if ( bounds != BVH::BOUNDS_OUTSIDE ) visible.push_back( i );
+    }
+
+    // facing is per facet, otherwise each unique edge is drawn once
+    bool drawFacets = culler.isBackFaceCulling();
+
+    size_t streamedBytes = 0;
+
+    for ( unsigned int i = 0; ( i < SLOT_COUNT ) && ( i < visible.size() ); i++ )
+    {
+        queueUpload( i, chunks[visible[i]], drawFacets );
+    }
+
+    for ( unsigned int i = 0; i < visible.size(); i++ )
+    {
+        unsigned int slot = i % SLOT_COUNT;
+        const MeshChunk &chunk = chunks[visible[i]];
+
+        const float *d_vertices = ( const float * ) slots[slot].d_buffer;
+        size_t vertexBytes = ( size_t ) chunk.vertexStride * Mesh::COORD_DIM * sizeof( float );
+        size_t indexBytes = ( size_t ) chunk.facetCount * Mesh::FACET_DIM * sizeof( unsigned int );
+
+        const unsigned int *d_indices = ( const unsigned int * ) ( slots[slot].d_buffer + vertexBytes );
+        const unsigned int *d_edges = ( const unsigned int * ) ( slots[slot].d_buffer + vertexBytes + indexBytes );
+
+        streamedBytes += vertexBytes + ( drawFacets ? indexBytes : chunk.edgeCount * Mesh::EDGE_DIM * sizeof( unsigned int ) );
+
+        HANDLE_CUDA_ERROR( cudaStreamWaitEvent( 0, slots[slot].uploaded, 0 ) );
+
+        // one thread per VERTEX_ALIGN consecutive vertices
+        unsigned int groupCount = ( chunk.vertexCount + Mesh::VERTEX_ALIGN - 1 ) / Mesh::VERTEX_ALIGN;
+        unsigned int blocks = ( groupCount + TRANSFORM_BLOCK_SIZE - 1 ) / TRANSFORM_BLOCK_SIZE;
+
+        ProfileRange transformRange( FrameProfiler::STAGE_TRANSFORM );
+
+        applyViewTransform<<<blocks, TRANSFORM_BLOCK_SIZE>>>(
+            ( const float4 * ) d_vertices,
+            ( float4 * ) d_outputVertices,
+            chunk.vertexStride,
+            chunk.vertexCount
+        );
+        HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+        transformRange.end();
+
+        if ( drawFacets )
+        {
+            ProfileRange cullRange( FrameProfiler::STAGE_CULL );
+
+            unsigned int facetCount = culler.cullFacets(
+                d_outputVertices, chunk.vertexStride,
+                d_indices, chunk.facetCount,
+                width, height
+            );
+
+            cullRange.end();
+            ProfileRange rasterRange( FrameProfiler::STAGE_RASTER );
+
+            raster.drawFacets(
+                d_outputVertices, chunk.vertexStride,
+                culler.getDeviceSurvivors(), facetCount,
+                color
+            );
+        }
+        else
+        {
+            ProfileRange cullRange( FrameProfiler::STAGE_CULL );
+
+            unsigned int edgeCount = culler.cullEdges(
+                d_outputVertices, chunk.vertexStride,
+                d_edges, chunk.edgeCount,
+                width, height
+            );
+
+            cullRange.end();
+            ProfileRange rasterRange( FrameProfiler::STAGE_RASTER );
+
+            raster.drawEdges(
+                d_outputVertices, chunk.vertexStride,
+                culler.getDeviceSurvivors(), edgeCount,
+                color
+            );
+        }
+
+        // refill the slot once the draw is done with it
+        HANDLE_CUDA_ERROR( cudaEventRecord( slots[slot].consumed, 0 ) );
+
+        if ( i + SLOT_COUNT < visible.size() )
+        {
+            queueUpload( slot, chunks[visible[i + SLOT_COUNT]], drawFacets );
+        }
+    }
+    HANDLE_CUDA_ERROR( cudaDeviceSynchronize() );
+
+    if ( FrameProfiler::getInstance().isEnabled() )
+    {
+        std::cout << "Streamed Chunks: " << visible.size() << "/" << chunks.size()
+                  << " (" << streamedBytes / ( 1024.0 * 1024.0 ) << "MB)" << std::endl;
+    }
+}
+
+
+/**
+ * @brief   Finds the facet of the mesh under a point in the window, on the
+ *          host
+ *
+ * Like ShapeContainer::pick, the point is taken back to model space along
+ * the device +z axis. Only the chunks whose bounds the ray crosses are
+ * searched.
+ *
+ * @param   *vc     The view context the window is drawn with
+ * @param   x       The x-coordinate of the point in pixels
+ * @param   y       The y-coordinate of the point in pixels
+ *
+ * @return  The index in the mesh of the nearest facet under the point, or
+ *          -1 if there is none
+ */
+int OutOfCoreRenderer::pick( const ViewContext *vc, int x, int y ) const
+{
+    float inverse[ViewContext::TRANSFORM_DIM][ViewContext::TRANSFORM_DIM];
+    vc->getInverseTransform( inverse );
+
+    float origin[Mesh::COORD_DIM];
+    float direction[Mesh::COORD_DIM];
+    float invDirection[Mesh::COORD_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        origin[i] = inverse[i][0] * x + inverse[i][1] * y + inverse[i][3];
+        direction[i] = inverse[i][2];
+        invDirection[i] = 1 / direction[i];
+    }
+
+    float3 rayOrigin = make_float3( origin[0], origin[1], origin[2] );
+    float3 rayDirection = make_float3( direction[0], direction[1], direction[2] );
+
+    float nearest = FLT_MAX;
+    int nearestFacet = -1;
+
+    for ( const MeshChunk &chunk : chunks )
+    {
+        // slab test, an axis the ray runs along only gives infinities
+        float near = -FLT_MAX;
+        float far = FLT_MAX;
+
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+        {
+            float t0 = ( chunk.boundsMin[i] - origin[i] ) * invDirection[i];
+            float t1 = ( chunk.boundsMax[i] - origin[i] ) * invDirection[i];
+
+            near = std::max( near, std::min( t0, t1 ) );
+            far = std::min( far, std::max( t0, t1 ) );
+        }
+
+        if ( ( near > far ) || ( near >= nearest ) ) continue;
+
+        const float *vertices = ( const float * ) ( store.data() + chunk.offset );
+        const unsigned int *indices = ( const unsigned int * ) ( vertices + ( size_t ) chunk.vertexStride * Mesh::COORD_DIM );
+
+        for ( unsigned int facet = 0; facet < chunk.facetCount; facet++ )
+        {
+            const unsigned int *corners = indices + ( size_t ) facet * Mesh::FACET_DIM;
+            float distance;
+
+            bool crossed = intersectTriangle(
+                rayOrigin, rayDirection,
+                loadVertex( vertices, chunk.vertexStride, corners[0] ),
+                loadVertex( vertices, chunk.vertexStride, corners[1] ),
+                loadVertex( vertices, chunk.vertexStride, corners[2] ),
+                &distance
+            );
+
+            if ( crossed && ( distance < nearest ) )
+            {
+                nearest = distance;
+                nearestFacet = facetIds[chunk.firstFacet + facet];
+            }
+        }
+    }
+
+    return nearestFacet;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Sorts the facets of a mesh along a Morton curve and cuts them
+ *          into chunks, each with only the vertices and edges it uses
+ *
+ * @param   &mesh   The mesh to cut
+ *
+ * @return  void
+ */
+void OutOfCoreRenderer::buildChunks( const Mesh &mesh )
+{
+    unsigned int facetCount = mesh.getFacetCount();
+    const unsigned int *indices = mesh.getIndices();
+    const float *coords[Mesh::COORD_DIM] = { mesh.getX(), mesh.getY(), mesh.getZ() };
+
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+    mesh.getBounds( boundsMin, boundsMax );
+
+    // quantize the facet centroids to 10 bits per axis
+    float cells = ( 1 << BVH::MORTON_BITS ) - 1;
+    float scale[Mesh::COORD_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        float extent = boundsMax[i] - boundsMin[i];
+        scale[i] = ( extent > 0 ) ? cells / ( extent * Mesh::FACET_DIM ) : 0;
+    }
+
+    // Morton codes tied on the facet index
+    std::vector<unsigned long long> keys( facetCount );
+
+    for ( unsigned int facet = 0; facet < facetCount; facet++ )
+    {
+        const unsigned int *corners = indices + ( size_t ) facet * Mesh::FACET_DIM;
+        unsigned int code = 0;
+
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+        {
+            float sum = coords[i][corners[0]] + coords[i][corners[1]] + coords[i][corners[2]];
+            float cell = ( sum - boundsMin[i] * Mesh::FACET_DIM ) * scale[i];
+
+            cell = std::min( std::max( cell, 0.0f ), cells );
+            code |= spreadBits( ( unsigned int ) cell ) << ( Mesh::COORD_DIM - 1 - i );
+        }
+
+        keys[facet] = ( ( unsigned long long ) code << 32 ) | facet;
+    }
+
+    std::sort( keys.begin(), keys.end() );
+
+    facetIds.resize( facetCount );
+    for ( unsigned int i = 0; i < facetCount; i++ ) facetIds[i] = ( unsigned int ) keys[i];
+
+    keys.clear();
+    keys.shrink_to_fit();
+
+    // the chunk a vertex was last seen in, and its index there
+    std::vector<unsigned int> vertexChunk( mesh.getVertexCount(), NO_CHUNK );
+    std::vector<unsigned int> vertexRemap( mesh.getVertexCount() );
+
+    std::vector<float> chunkCoords[Mesh::COORD_DIM];
+    std::vector<unsigned int> chunkIndices;
+    std::vector<unsigned long long> edgeKeys;
+
+    // about half a vertex and one and a half edges per facet
+    store.reserve( ( size_t ) facetCount * 32 );
+
+    for ( unsigned int first = 0; first < facetCount; first += CHUNK_FACETS )
+    {
+        MeshChunk chunk;
+        chunk.firstFacet = first;
+        chunk.facetCount = std::min( facetCount - first, ( unsigned int ) CHUNK_FACETS );
+
+        unsigned int chunkIdx = chunks.size();
+
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ ) chunkCoords[i].clear();
+        chunkIndices.clear();
+        edgeKeys.clear();
+
+        for ( unsigned int i = 0; i < chunk.facetCount; i++ )
+        {
+            const unsigned int *corners = indices + ( size_t ) facetIds[first + i] * Mesh::FACET_DIM;
+            unsigned int local[Mesh::FACET_DIM];
+
+            for ( unsigned int corner = 0; corner < Mesh::FACET_DIM; corner++ )
+            {
+                unsigned int vertIdx = corners[corner];
+
+                if ( vertexChunk[vertIdx] != chunkIdx )
+                {
+                    vertexChunk[vertIdx] = chunkIdx;
+                    vertexRemap[vertIdx] = chunkCoords[0].size();
+
+                    for ( unsigned int axis = 0; axis < Mesh::COORD_DIM; axis++ )
+                    {
+                        float coord = coords[axis][vertIdx];
+
+                        chunkCoords[axis].push_back( coord );
+                        chunk.boundsMin[axis] = std::min( chunk.boundsMin[axis], coord );
+                        chunk.boundsMax[axis] = std::max( chunk.boundsMax[axis], coord );
+                    }
+                }
+
+                local[corner] = vertexRemap[vertIdx];
+                chunkIndices.push_back( local[corner] );
+            }
+
+            // the same low-high keys the resident mesh deduplicates edges by
+            for ( unsigned int corner = 0; corner < Mesh::FACET_DIM; corner++ )
+            {
+                unsigned long long a = local[corner];
+                unsigned long long b = local[( corner + 1 ) % Mesh::FACET_DIM];
+
+                if ( a == b ) continue;
+
+                edgeKeys.push_back( ( std::min( a, b ) << 32 ) | std::max( a, b ) );
+            }
+        }
+
+        std::sort( edgeKeys.begin(), edgeKeys.end() );
+        edgeKeys.erase( std::unique( edgeKeys.begin(), edgeKeys.end() ), edgeKeys.end() );
+
+        chunk.vertexCount = chunkCoords[0].size();
+        chunk.vertexStride = ( chunk.vertexCount + Mesh::VERTEX_ALIGN - 1 ) / Mesh::VERTEX_ALIGN * Mesh::VERTEX_ALIGN;
+        chunk.edgeCount = edgeKeys.size();
+        chunk.offset = ( store.size() + CHUNK_ALIGN - 1 ) / CHUNK_ALIGN * CHUNK_ALIGN;
+
+        // the padding between the arrays stays zero
+        store.resize( chunk.offset + getChunkBytes( chunk ), 0 );
+
+        float *vertices = ( float * ) ( store.data() + chunk.offset );
+
+        for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+        {
+            memcpy( vertices + ( size_t ) i * chunk.vertexStride, chunkCoords[i].data(), chunk.vertexCount * sizeof( float ) );
+        }
+
+        unsigned int *chunkFacets = ( unsigned int * ) ( vertices + ( size_t ) chunk.vertexStride * Mesh::COORD_DIM );
+        memcpy( chunkFacets, chunkIndices.data(), chunkIndices.size() * sizeof( unsigned int ) );
+
+        unsigned int *chunkEdges = chunkFacets + ( size_t ) chunk.facetCount * Mesh::FACET_DIM;
+
+        for ( unsigned int i = 0; i < chunk.edgeCount; i++ )
+        {
+            chunkEdges[i * Mesh::EDGE_DIM] = ( unsigned int ) ( edgeKeys[i] >> 32 );
+            chunkEdges[i * Mesh::EDGE_DIM + 1] = ( unsigned int ) edgeKeys[i];
+        }
+
+        chunks.push_back( chunk );
+    }
+}
+
+
+/**
+ * @brief   Allocates the device slots, sized for the largest chunk, and
+ *          their streams
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void OutOfCoreRenderer::allocateSlots()
+{
+    unsigned int maxVertexStride = 0;
+    slotBytes = 0;
+
+    for ( const MeshChunk &chunk : chunks )
+    {
+        maxVertexStride = std::max( maxVertexStride, chunk.vertexStride );
+        slotBytes = std::max( slotBytes, getChunkBytes( chunk ) );
+    }
+
+    for ( ChunkSlot &slot : slots )
+    {
+        HANDLE_CUDA_ERROR( cudaMalloc( &slot.d_buffer, slotBytes ) );
+
+        // without page-locked chunks, each slot stages its own
+        if ( !storePinned )
+        {
+            HANDLE_CUDA_ERROR( cudaMallocHost( &slot.h_staging, slotBytes ) );
+        }
+
+        HANDLE_CUDA_ERROR( cudaStreamCreateWithFlags( &slot.stream, cudaStreamNonBlocking ) );
+        HANDLE_CUDA_ERROR( cudaEventCreateWithFlags( &slot.uploaded, cudaEventDisableTiming ) );
+        HANDLE_CUDA_ERROR( cudaEventCreateWithFlags( &slot.consumed, cudaEventDisableTiming ) );
+    }
+
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_outputVertices, ( size_t ) maxVertexStride * Mesh::COORD_DIM * sizeof( float ) )
+    );
+}
+
+
+/**
+ * @brief   Queues the upload of a chunk into a slot on the slot's stream,
+ *          without waiting for it
+ *
+ * The upload waits on the device for the draw of the slot's previous chunk.
+ * Only the vertex pool and either the index buffer or the edge list are
+ * sent, at the same offsets they have in the host chunk.
+ *
+ * @param   slot    The index of the slot to fill
+ * @param   &chunk  The chunk to upload
+ * @param   facets  True to send the index buffer, false for the edge list
+ *
+ * @return  void
+ */
+void OutOfCoreRenderer::queueUpload( unsigned int slot, const MeshChunk &chunk, bool facets )
+{
+    ChunkSlot &target = slots[slot];
+
+    size_t vertexBytes = ( size_t ) chunk.vertexStride * Mesh::COORD_DIM * sizeof( float );
+    size_t indexBytes = ( size_t ) chunk.facetCount * Mesh::FACET_DIM * sizeof( unsigned int );
+    size_t edgeBytes = ( size_t ) chunk.edgeCount * Mesh::EDGE_DIM * sizeof( unsigned int );
+
+    size_t elementOffset = facets ? vertexBytes : vertexBytes + indexBytes;
+    size_t elementBytes = facets ? indexBytes : edgeBytes;
+
+    const char *source = store.data() + chunk.offset;
+
+    HANDLE_CUDA_ERROR( cudaStreamWaitEvent( target.stream, target.consumed, 0 ) );
+
+    if ( !storePinned )
+    {
+        // the staging buffer is free once its last transfer has landed
+        HANDLE_CUDA_ERROR( cudaEventSynchronize( target.uploaded ) );
+
+        memcpy( target.h_staging, source, vertexBytes );
+        memcpy( target.h_staging + elementOffset, source + elementOffset, elementBytes );
+
+        source = target.h_staging;
+    }
+
+    ProfileRange uploadRange( FrameProfiler::STAGE_UPLOAD, true, target.stream );
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpyAsync(
+            ( void * ) target.d_buffer,
+            ( const void * ) source,
+            vertexBytes,
+            cudaMemcpyHostToDevice,
+            target.stream
+        )
+    );
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpyAsync(
+            ( void * ) ( target.d_buffer + elementOffset ),
+            ( const void * ) ( source + elementOffset ),
+            elementBytes,
+            cudaMemcpyHostToDevice,
+            target.stream
+        )
+    );
+
+    uploadRange.end();
+
+    HANDLE_CUDA_ERROR( cudaEventRecord( target.uploaded, target.stream ) );
+}
+
+
+/**
+ * @brief   Frees the device slots, their staging buffers and streams
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void OutOfCoreRenderer::freeDevice()
+{
+    for ( ChunkSlot &slot : slots )
+    {
+        if ( slot.stream != nullptr ) HANDLE_CUDA_ERROR( cudaStreamSynchronize( slot.stream ) );
+
+        if ( slot.d_buffer != nullptr ) HANDLE_CUDA_ERROR( cudaFree( slot.d_buffer ) );
+        if ( slot.h_staging != nullptr ) HANDLE_CUDA_ERROR( cudaFreeHost( slot.h_staging ) );
+        if ( slot.stream != nullptr ) HANDLE_CUDA_ERROR( cudaStreamDestroy( slot.stream ) );
+        if ( slot.uploaded != nullptr ) HANDLE_CUDA_ERROR( cudaEventDestroy( slot.uploaded ) );
+        if ( slot.consumed != nullptr ) HANDLE_CUDA_ERROR( cudaEventDestroy( slot.consumed ) );
+
+        slot = ChunkSlot();
+    }
+
+    if ( d_outputVertices != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_outputVertices ) );
+        d_outputVertices = nullptr;
+    }
+
+    slotBytes = 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
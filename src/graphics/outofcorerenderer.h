@@ -0,0 +1,178 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    outofcorerenderer.h
+ * @brief   Renders a mesh larger than device memory by streaming it in chunks
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_OUTOFCORERENDERER_H
+# define GRAPHICS_OUTOFCORERENDERER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <vector>
+
+# include "culler.h"
+# include "mesh.h"
+# include "rasterizer.h"
+# include "viewcontext.h"
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * A spatially compact run of facets with its own vertex pool, laid out in
+ * host memory exactly as it is uploaded: x[], y[] and z[] padded to
+ * vertexStride, then the index buffer, then the unique edge list, all with
+ * chunk-local vertex indices
+ */
+struct MeshChunk
+{
+    size_t offset = 0;
+
+    unsigned int vertexCount = 0;
+    unsigned int vertexStride = 0;
+    unsigned int facetCount = 0;
+    unsigned int edgeCount = 0;
+
+    // first facet of the chunk in the Morton order of the whole mesh
+    unsigned int firstFacet = 0;
+
+    float boundsMin[Mesh::COORD_DIM] = { INFINITY, INFINITY, INFINITY };
+    float boundsMax[Mesh::COORD_DIM] = { -INFINITY, -INFINITY, -INFINITY };
+};
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * An out-of-core renderer keeps a mesh in host memory, cut into chunks of
+ * facets sorted along a Morton curve, and streams every chunk that can
+ * reach the window through a small ring of device slots. Each slot has its
+ * own non-blocking stream, so while one chunk is transformed, culled and
+ * rasterized the next ones are already crossing the bus. Device memory
+ * only ever holds SLOT_COUNT chunks, no matter how large the mesh is. The
+ * host chunks are page-locked when the system allows it so the transfers
+ * run at full bus speed straight from them; otherwise each slot stages its
+ * chunk through a pinned buffer of its own.
+ */
+class OutOfCoreRenderer
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int CHUNK_FACETS = 1 << 18;
+    static constexpr unsigned int SLOT_COUNT = 3;
+    static constexpr unsigned int TRANSFORM_BLOCK_SIZE = 256;
+
+    // device memory a resident mesh needs, with its edge list, facet
+    // hierarchy and culling scratch buffers, for deciding if it fits
+    static constexpr size_t RESIDENT_BYTES_PER_VERTEX = 24;
+    static constexpr size_t RESIDENT_BYTES_PER_FACET = 160;
+
+    // share of the free device memory a resident mesh may take
+    static constexpr float DEVICE_MEMORY_SHARE = 0.8f;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    OutOfCoreRenderer();
+    OutOfCoreRenderer( const OutOfCoreRenderer &renderer ) = delete;
+
+    ~OutOfCoreRenderer();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    OutOfCoreRenderer &operator=( const OutOfCoreRenderer &renderer ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static bool fitsOnDevice( unsigned int vertexCount, unsigned int facetCount );
+
+    void load( const Mesh &mesh );
+    void clear();
+
+    bool isLoaded() const;
+    unsigned int getChunkCount() const;
+
+    void draw( ViewContext *vc, Rasterizer &raster, Culler &culler, unsigned int color );
+    int pick( const ViewContext *vc, int x, int y ) const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ------------------------------- Types -------------------------------- */
+
+
+    struct ChunkSlot
+    {
+        char * d_buffer = nullptr;
+        char * h_staging = nullptr;
+
+        cudaStream_t stream = nullptr;
+
+        // the slot's chunk has landed, and the draw is done with it
+        cudaEvent_t uploaded = nullptr;
+        cudaEvent_t consumed = nullptr;
+    };
+
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::vector<MeshChunk> chunks = std::vector<MeshChunk>();
+
+    // every chunk back to back, and the original index of every facet in
+    // chunk order
+    std::vector<char> store = std::vector<char>();
+    std::vector<unsigned int> facetIds = std::vector<unsigned int>();
+    bool storePinned = false;
+
+    ChunkSlot slots[SLOT_COUNT] = {};
+    size_t slotBytes = 0;
+
+    float * d_outputVertices = nullptr;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void buildChunks( const Mesh &mesh );
+    void allocateSlots();
+
+    void queueUpload( unsigned int slot, const MeshChunk &chunk, bool facets );
+
+    void freeDevice();
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_OUTOFCORERENDERER_H
+
+
+/* -------------------------------------------------------------------------- */
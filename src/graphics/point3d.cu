@@ -275,6 +275,22 @@ Point3D Point3D::transform( const Matrix<float> &m ) const
 }
 
 
+/**
+ * @brief   Calculates a transformed copy of this 3D point, without any
+ *          temporary matrices
+ *
+ * @param   &m  The 4x4 transformation matrix
+ *
+ * @return  A transformed copy of this 3D point
+ */
+Point3D Point3D::transform( const Mat4f &m ) const
+{
+    Vec4f transformVector = m * Vec4f::point( getX(), getY(), getZ() );
+
+    return Point3D( transformVector[0], transformVector[1], transformVector[2] );
+}
+
+
 /**
  * @brief   Gets the magnitude of the vector between the origin and this
  *          3D point
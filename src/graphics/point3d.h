@@ -19,6 +19,7 @@
 
 # include <iostream>
 
+# include "mat4f.h"
 # include "vector2.h"
 # include "vector3.h"
 # include "vector4.h"
@@ -67,6 +68,7 @@ public:
     Point3D *clone() const;
 
     Point3D transform( const Matrix<float> &m ) const;
+    Point3D transform( const Mat4f &m ) const;
 
     float magnitude() const;
     float angle( const Point3D &p ) const;
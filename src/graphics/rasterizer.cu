@@ -0,0 +1,1458 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    rasterizer.cpp
+ * @brief   GPU line rasterizer into a device-resident framebuffer
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cmath>
+# include <cstring>
+
+# include "cudaerr.cuh"
+# include "frameprofiler.h"
+# include "mesh.h"
+# include "rasterizer.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+const unsigned int RASTER_BLOCK_SIZE = 256;
+
+// the most grid rows an instanced draw launches, one instance per row
+const unsigned int MAX_INSTANCE_ROWS = 65535;
+
+
+/* ---------------------------- Device Functions ---------------------------- */
+
+
+/**
+ * @brief   Clips a line segment to the rectangle [0, xMax] x [0, yMax] using
+ *          the Liang-Barsky algorithm
+ *
+ * @param   &x0     The x-coordinate of the start point, clipped in place
+ * @param   &y0     The y-coordinate of the start point, clipped in place
+ * @param   &x1     The x-coordinate of the end point, clipped in place
+ * @param   &y1     The y-coordinate of the end point, clipped in place
+ * @param   xMax    The largest x-coordinate in the rectangle
+ * @param   yMax    The largest y-coordinate in the rectangle
+ *
+ * @return  True if any part of the segment is inside the rectangle, false
+ *          otherwise, and always false for a segment with a NaN or infinite
+ *          end point
+ */
+__host__ __device__ bool clipEdge( float &x0, float &y0, float &x1, float &y1, float xMax, float yMax )
+{
+    // every boundary test is false for NaN, which would pass it through
+    if ( !isfinite( x0 ) || !isfinite( y0 ) || !isfinite( x1 ) || !isfinite( y1 ) ) return false;
+
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+
+    float p[4] = { -dx, dx, -dy, dy };
+    float q[4] = { x0, xMax - x0, y0, yMax - y0 };
+
+    float t0 = 0;
+    float t1 = 1;
+
+    for ( unsigned int i = 0; i < 4; i++ )
+    {
+        if ( p[i] == 0 )
+        {
+            // parallel to this boundary and outside of it
+            if ( q[i] < 0 ) return false;
+        }
+        else
+        {
+            float t = q[i] / p[i];
+
+            if ( p[i] < 0 )
+            {
+                if ( t > t1 ) return false;
+                if ( t > t0 ) t0 = t;
+            }
+            else
+            {
+                if ( t < t0 ) return false;
+                if ( t < t1 ) t1 = t;
+            }
+        }
+    }
+
+    x1 = x0 + t1 * dx;
+    y1 = y0 + t1 * dy;
+    x0 = x0 + t0 * dx;
+    y0 = y0 + t0 * dy;
+
+    return true;
+}
+
+
+/**
+ * @brief   Clips a line segment to the framebuffer and draws it with
+ *          Bresenham's algorithm
+ *
+ * Clipping first means segments that leave the view only cost the pixels
+ * that are actually on screen. Only the rows in [rowBegin, rowEnd) are
+ * written; the segment is still clipped to the whole framebuffer, so a
+ * line drawn band by band lands on exactly the same pixels as one drawn in
+ * a single pass.
+ *
+ * @param   *frameBuffer    The row-major framebuffer to draw into
+ * @param   width           The width of the framebuffer in pixels
+ * @param   height          The height of the framebuffer in pixels
+ * @param   x0              The x-coordinate of the start point
+ * @param   y0              The y-coordinate of the start point
+ * @param   x1              The x-coordinate of the end point
+ * @param   y1              The y-coordinate of the end point
+ * @param   color           The color to draw with
+ * @param   rowBegin        The first row that may be written
+ * @param   rowEnd          The row past the last one that may be written
+ *
+ * @return  void
+ */
+__host__ __device__ void drawLine(
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    float x0, float y0, float x1, float y1,
+    unsigned int color,
+    unsigned int rowBegin, unsigned int rowEnd
+)
+{
+    // skip edges that are entirely off screen
+    if ( !clipEdge( x0, y0, x1, y1, width - 1, height - 1 ) ) return;
+
+    int px = ( int ) x0;
+    int py = ( int ) y0;
+    int ex = ( int ) x1;
+    int ey = ( int ) y1;
+
+    int dx = abs( ex - px );
+    int dy = -abs( ey - py );
+    int sx = ( px < ex ) ? 1 : -1;
+    int sy = ( py < ey ) ? 1 : -1;
+    int err = dx + dy;
+
+    for ( ;; )
+    {
+        // the rows are walked in order, nothing past the window is drawn
+        if ( ( sy > 0 ) ? ( ( unsigned int ) py >= rowEnd ) : ( py < ( int ) rowBegin ) ) break;
+
+        if ( ( px >= 0 ) && ( py >= ( int ) rowBegin ) && ( px < ( int ) width ) &&
+             ( py < ( int ) height ) && ( ( unsigned int ) py < rowEnd ) )
+        {
+            frameBuffer[py * width + px] = color;
+        }
+
+        if ( ( px == ex ) && ( py == ey ) ) break;
+
+        int err2 = 2 * err;
+
+        if ( err2 >= dy )
+        {
+            err += dy;
+            px += sx;
+        }
+
+        if ( err2 <= dx )
+        {
+            err += dx;
+            py += sy;
+        }
+    }
+}
+
+
+/**
+ * @brief   Encodes a device-space z so that nearer depths compare as smaller
+ *          unsigned integers, the order atomicMin keeps
+ *
+ * Positive floats already order like their bit patterns; negative ones are
+ * flipped so they order below them, nearest first.
+ *
+ * @param   z   The device-space z to encode
+ *
+ * @return  The encoded depth
+ */
+__host__ __device__ unsigned int encodeDepth( float z )
+{
+    unsigned int bits;
+    memcpy( &bits, &z, sizeof( bits ) );
+
+    return ( bits & 0x80000000u ) ? ~bits : ( bits | 0x80000000u );
+}
+
+
+/**
+ * @brief   Fades a color toward the fade color of a depth shading the farther
+ *          back it is drawn
+ *
+ * @param   color       The 24-bit RGB color to fade
+ * @param   z           The device-space z the color is drawn at
+ * @param   &shading    The depth shading to fade with
+ *
+ * @return  The faded 24-bit RGB color
+ */
+__host__ __device__ unsigned int shadeDepth( unsigned int color, float z, const DepthShading &shading )
+{
+    if ( ( shading.fade <= 0 ) || ( shading.farZ <= shading.nearZ ) ) return color;
+
+    float distance = ( z - shading.nearZ ) / ( shading.farZ - shading.nearZ );
+    float weight = shading.fade * fminf( fmaxf( distance, 0.0f ), 1.0f );
+
+    unsigned int shaded = 0;
+
+    for ( unsigned int shift = 0; shift < 24; shift += 8 )
+    {
+        float from = ( color >> shift ) & 0xFF;
+        float to = ( shading.fadeColor >> shift ) & 0xFF;
+
+        shaded |= ( ( unsigned int ) ( from + ( to - from ) * weight + 0.5f ) ) << shift;
+    }
+
+    return shaded;
+}
+
+
+/**
+ * @brief   Clips a line segment to the framebuffer and draws it with
+ *          Bresenham's algorithm, testing and shading every pixel by depth
+ *
+ * The depth of a pixel is taken from where its center projects onto the
+ * unclipped segment, so clipping does not move it. A pixel is only written
+ * if no facet in the depth buffer is nearer.
+ *
+ * @param   *frameBuffer    The row-major framebuffer to draw into
+ * @param   width           The width of the framebuffer in pixels
+ * @param   height          The height of the framebuffer in pixels
+ * @param   x0              The x-coordinate of the start point
+ * @param   y0              The y-coordinate of the start point
+ * @param   z0              The device-space z of the start point
+ * @param   x1              The x-coordinate of the end point
+ * @param   y1              The y-coordinate of the end point
+ * @param   z1              The device-space z of the end point
+ * @param   color           The color to draw with
+ * @param   &shading        The depth shading to draw with
+ *
+ * @return  void
+ */
+__device__ void drawDepthLine(
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    float x0, float y0, float z0, float x1, float y1, float z1,
+    unsigned int color, const DepthShading &shading
+)
+{
+    float startX = x0;
+    float startY = y0;
+    float lineX = x1 - x0;
+    float lineY = y1 - y0;
+    float lineZ = z1 - z0;
+    float lengthSquared = lineX * lineX + lineY * lineY;
+
+    // skip edges that are entirely off screen
+    if ( !clipEdge( x0, y0, x1, y1, width - 1, height - 1 ) ) return;
+
+    int px = ( int ) x0;
+    int py = ( int ) y0;
+    int ex = ( int ) x1;
+    int ey = ( int ) y1;
+
+    int dx = abs( ex - px );
+    int dy = -abs( ey - py );
+    int sx = ( px < ex ) ? 1 : -1;
+    int sy = ( py < ey ) ? 1 : -1;
+    int err = dx + dy;
+
+    for ( ;; )
+    {
+        if ( ( px >= 0 ) && ( py >= 0 ) && ( px < ( int ) width ) && ( py < ( int ) height ) )
+        {
+            float t = 0;
+
+            if ( lengthSquared > 0 )
+            {
+                t = ( ( px + 0.5f - startX ) * lineX + ( py + 0.5f - startY ) * lineY ) / lengthSquared;
+                t = fminf( fmaxf( t, 0.0f ), 1.0f );
+            }
+
+            float z = z0 + t * lineZ;
+            unsigned int pixelIdx = py * width + px;
+
+            if ( ( shading.depthBuffer == nullptr ) || ( encodeDepth( z ) <= shading.depthBuffer[pixelIdx] ) )
+            {
+                frameBuffer[pixelIdx] = shadeDepth( color, z, shading );
+            }
+        }
+
+        if ( ( px == ex ) && ( py == ey ) ) break;
+
+        int err2 = 2 * err;
+
+        if ( err2 >= dy )
+        {
+            err += dy;
+            px += sx;
+        }
+
+        if ( err2 <= dx )
+        {
+            err += dx;
+            py += sy;
+        }
+    }
+}
+
+
+/**
+ * @brief   Scan converts a device-space triangle into a depth buffer,
+ *          keeping the nearest depth at every pixel center it covers
+ *
+ * The triangle is pushed back by a slope-scaled offset first, so the edges
+ * along its border pass the depth test against it even where they are drawn
+ * half a pixel off the facet's plane. Edge-on triangles cover nothing.
+ *
+ * @param   *depthBuffer    The row-major encoded depth buffer
+ * @param   width           The width of the depth buffer in pixels
+ * @param   height          The height of the depth buffer in pixels
+ * @param   *x              The device-space x of the three corners
+ * @param   *y              The device-space y of the three corners
+ * @param   *z              The device-space z of the three corners
+ *
+ * @return  void
+ */
+__device__ void writeFacetDepth(
+    unsigned int * depthBuffer, unsigned int width, unsigned int height,
+    const float * x, const float * y, const float * z
+)
+{
+    float area = ( x[1] - x[0] ) * ( y[2] - y[0] ) - ( y[1] - y[0] ) * ( x[2] - x[0] );
+
+    // also rejects corners that are not numbers
+    if ( !( fabsf( area ) > 0 ) ) return;
+
+    // the pixels whose centers can be inside, clamped to the window
+    float minX = fmaxf( fminf( x[0], fminf( x[1], x[2] ) ) - 0.5f, 0.0f );
+    float maxX = fminf( fmaxf( x[0], fmaxf( x[1], x[2] ) ) - 0.5f, width - 1.0f );
+    float minY = fmaxf( fminf( y[0], fminf( y[1], y[2] ) ) - 0.5f, 0.0f );
+    float maxY = fminf( fmaxf( y[0], fmaxf( y[1], y[2] ) ) - 0.5f, height - 1.0f );
+
+    if ( !( minX <= maxX ) || !( minY <= maxY ) ) return;
+
+    int beginX = ( int ) ceilf( minX );
+    int endX = ( int ) floorf( maxX );
+    int beginY = ( int ) ceilf( minY );
+    int endY = ( int ) floorf( maxY );
+
+    // the plane of the facet, z = z0 + slopeX ( x - x0 ) + slopeY ( y - y0 )
+    float slopeX = ( ( z[1] - z[0] ) * ( y[2] - y[0] ) - ( z[2] - z[0] ) * ( y[1] - y[0] ) ) / area;
+    float slopeY = ( ( z[2] - z[0] ) * ( x[1] - x[0] ) - ( z[1] - z[0] ) * ( x[2] - x[0] ) ) / area;
+
+    float offset = Rasterizer::DEPTH_SLOPE_OFFSET * fmaxf( fabsf( slopeX ), fabsf( slopeY ) ) +
+                   Rasterizer::DEPTH_OFFSET;
+
+    // inside means on the same side of all three edges as the area says
+    float side = ( area > 0 ) ? 1.0f : -1.0f;
+
+    for ( int py = beginY; py <= endY; py++ )
+    {
+        float cy = py + 0.5f;
+
+        for ( int px = beginX; px <= endX; px++ )
+        {
+            float cx = px + 0.5f;
+
+            float w0 = ( ( x[2] - x[1] ) * ( cy - y[1] ) - ( y[2] - y[1] ) * ( cx - x[1] ) ) * side;
+            float w1 = ( ( x[0] - x[2] ) * ( cy - y[2] ) - ( y[0] - y[2] ) * ( cx - x[2] ) ) * side;
+            float w2 = ( ( x[1] - x[0] ) * ( cy - y[0] ) - ( y[1] - y[0] ) * ( cx - x[0] ) ) * side;
+
+            if ( ( w0 < 0 ) || ( w1 < 0 ) || ( w2 < 0 ) ) continue;
+
+            float depth = z[0] + slopeX * ( cx - x[0] ) + slopeY * ( cy - y[0] ) + offset;
+
+            atomicMin( &depthBuffer[py * width + px], encodeDepth( depth ) );
+        }
+    }
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a rasterizer without a framebuffer
+ *
+ * @param   void
+ *
+ * @return  The created rasterizer
+ */
+Rasterizer::Rasterizer() = default;
+
+
+/**
+ * @brief   Rasterizer destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+Rasterizer::~Rasterizer()
+{
+    freeDevice();
+    freeInstances();
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Resizes the framebuffer, reallocating only if the size changed
+ *
+ * @param   width   The width of the framebuffer in pixels
+ * @param   height  The height of the framebuffer in pixels
+ *
+ * @return  void
+ */
+void Rasterizer::resize( unsigned int width, unsigned int height )
+{
+    if ( ( width == this->width ) && ( height == this->height ) ) return;
+
+    freeDevice();
+
+    this->width = width;
+    this->height = height;
+
+    if ( ( width == 0 ) || ( height == 0 ) ) return;
+
+    size_t bufferSize = width * height * sizeof( unsigned int );
+
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_frameBuffer, bufferSize )
+    );
+
+    HANDLE_CUDA_ERROR(
+        cudaMallocHost( &h_frameBuffer, bufferSize )
+    );
+
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_depthBuffer, width * height * sizeof( unsigned int ) )
+    );
+
+    depthWritten = false;
+}
+
+
+/**
+ * @brief   Fills the framebuffer with a color
+ *
+ * @param   color   The 24-bit RGB color to fill with
+ *
+ * @return  void
+ */
+void Rasterizer::clear( unsigned int color )
+{
+    // edges fade toward the background, and no facet has been drawn yet
+    clearColor = color;
+    depthWritten = false;
+
+    if ( d_frameBuffer == nullptr ) return;
+
+    unsigned int pixelCount = width * height;
+    unsigned int blocks = ceil( pixelCount / ( double ) RASTER_BLOCK_SIZE );
+
+    clearFrameBuffer<<<blocks, RASTER_BLOCK_SIZE>>>( d_frameBuffer, pixelCount, color );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+}
+
+
+/**
+ * @brief   Sets whether edges behind a facet are hidden
+ *
+ * With hidden lines on, the facets drawn with drawFacetDepth or
+ * drawInstanceDepth since the last clear hide every edge drawn after them
+ * that is farther back.
+ *
+ * @param   enabled     True to hide edges behind facets, false to draw every
+ *                      edge
+ *
+ * @return  void
+ */
+void Rasterizer::setHiddenLines( bool enabled )
+{
+    hiddenLines = enabled;
+}
+
+
+/**
+ * @brief   Determines if edges behind a facet are hidden
+ *
+ * @param   void
+ *
+ * @return  True if edges behind a facet are hidden, false otherwise
+ */
+bool Rasterizer::isHiddenLines() const
+{
+    return hiddenLines;
+}
+
+
+/**
+ * @brief   Sets whether edges fade toward the background the farther back
+ *          they are
+ *
+ * @param   enabled     True to fade edges by depth, false to draw them in
+ *                      their own color
+ *
+ * @return  void
+ */
+void Rasterizer::setDepthCueing( bool enabled )
+{
+    depthCueing = enabled;
+}
+
+
+/**
+ * @brief   Determines if edges fade toward the background the farther back
+ *          they are
+ *
+ * @param   void
+ *
+ * @return  True if edges are faded by depth, false otherwise
+ */
+bool Rasterizer::isDepthCueing() const
+{
+    return depthCueing;
+}
+
+
+/**
+ * @brief   Sets the device-space depths depth cueing fades between
+ *
+ * @param   nearZ   The depth edges are drawn at in their own color
+ * @param   farZ    The depth edges are faded the most at
+ *
+ * @return  void
+ */
+void Rasterizer::setDepthRange( float nearZ, float farZ )
+{
+    this->nearZ = nearZ;
+    this->farZ = farZ;
+}
+
+
+/**
+ * @brief   Gets the device-space depths depth cueing fades between
+ *
+ * @param   &nearZ  Set to the depth edges are drawn at in their own color
+ * @param   &farZ   Set to the depth edges are faded the most at
+ *
+ * @return  void
+ */
+void Rasterizer::getDepthRange( float &nearZ, float &farZ ) const
+{
+    nearZ = this->nearZ;
+    farZ = this->farZ;
+}
+
+
+/**
+ * @brief   Rasterizes facets into the depth buffer, one thread per facet,
+ *          if hidden lines are on
+ *
+ * The depth buffer is cleared by the first facets drawn after a clear.
+ *
+ * @param   *d_vertices     The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *d_indices      The device triangle index buffer
+ * @param   facetCount      The number of facets
+ *
+ * @return  void
+ */
+void Rasterizer::drawFacetDepth(
+    const float *d_vertices, unsigned int vertexStride,
+    const unsigned int *d_indices, unsigned int facetCount
+)
+{
+    if ( !hiddenLines || ( d_depthBuffer == nullptr ) || ( facetCount == 0 ) ) return;
+
+    beginDepth();
+
+    unsigned int blocks = ceil( facetCount / ( double ) RASTER_BLOCK_SIZE );
+
+    rasterizeFacetDepth<<<blocks, RASTER_BLOCK_SIZE>>>(
+        d_vertices, vertexStride,
+        d_indices, facetCount,
+        d_depthBuffer, width, height
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+}
+
+
+/**
+ * @brief   Rasterizes the facets of every staged instance of a mesh into the
+ *          depth buffer in a single launch, if hidden lines are on
+ *
+ * @param   *d_vertices     The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *d_indices      The device triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   instanceCount   The number of instances staged with
+ *                          reserveInstances
+ *
+ * @return  void
+ */
+void Rasterizer::drawInstanceDepth(
+    const float *d_vertices, unsigned int vertexStride,
+    const unsigned int *d_indices, unsigned int facetCount,
+    unsigned int instanceCount
+)
+{
+    if ( !hiddenLines || ( d_depthBuffer == nullptr ) || ( facetCount == 0 ) || ( instanceCount == 0 ) ) return;
+
+    beginDepth();
+
+    uploadInstances( instanceCount );
+
+    unsigned int rows = ( instanceCount < MAX_INSTANCE_ROWS ) ? instanceCount : MAX_INSTANCE_ROWS;
+
+    dim3 blocks( ceil( facetCount / ( double ) RASTER_BLOCK_SIZE ), rows );
+
+    rasterizeInstanceFacetDepth<<<blocks, RASTER_BLOCK_SIZE>>>(
+        d_vertices, vertexStride,
+        d_indices, facetCount,
+        d_instances, instanceCount,
+        d_depthBuffer, width, height
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+}
+
+
+/**
+ * @brief   Rasterizes a list of edges into the framebuffer, one thread per edge
+ *
+ * @param   *d_vertices     The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *d_edges        The device edge list, two vertex indices per edge
+ * @param   edgeCount       The number of edges
+ * @param   color           The 24-bit RGB color to draw with
+ *
+ * @return  void
+ */
+void Rasterizer::drawEdges(
+    const float *d_vertices, unsigned int vertexStride,
+    const unsigned int *d_edges, unsigned int edgeCount,
+    unsigned int color
+)
+{
+    if ( ( d_frameBuffer == nullptr ) || ( edgeCount == 0 ) ) return;
+
+    unsigned int blocks = ceil( edgeCount / ( double ) RASTER_BLOCK_SIZE );
+
+    rasterizeEdges<<<blocks, RASTER_BLOCK_SIZE>>>(
+        d_vertices, vertexStride,
+        d_edges, edgeCount,
+        d_frameBuffer, width, height,
+        color, getDepthShading()
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+}
+
+
+/**
+ * @brief   Rasterizes the edges of every facet into the framebuffer, one
+ *          thread per facet edge, drawing shared edges once per facet
+ *
+ * @param   *d_vertices     The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *d_indices      The device triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   color           The 24-bit RGB color to draw with
+ *
+ * @return  void
+ */
+void Rasterizer::drawFacets(
+    const float *d_vertices, unsigned int vertexStride,
+    const unsigned int *d_indices, unsigned int facetCount,
+    unsigned int color
+)
+{
+    if ( ( d_frameBuffer == nullptr ) || ( facetCount == 0 ) ) return;
+
+    unsigned int blocks = ceil( facetCount * Mesh::FACET_DIM / ( double ) RASTER_BLOCK_SIZE );
+
+    rasterizeFacetEdges<<<blocks, RASTER_BLOCK_SIZE>>>(
+        d_vertices, vertexStride,
+        d_indices, facetCount,
+        d_frameBuffer, width, height,
+        color, getDepthShading()
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+}
+
+
+/**
+ * @brief   Gets the pinned staging buffer for the instances of the next
+ *          instanced draw, growing it if it is too small
+ *
+ * @param   instanceCount   The number of instances that will be drawn
+ *
+ * @return  A host pointer to room for instanceCount instances, valid until
+ *          the next call
+ */
+DeviceInstance *Rasterizer::reserveInstances( unsigned int instanceCount )
+{
+    if ( instanceCount <= instanceCapacity ) return h_instances;
+
+    freeInstances();
+
+    // grow geometrically so adding placements one by one stays cheap
+    unsigned int capacity = ( instanceCount > 2 * instanceCapacity ) ? instanceCount : 2 * instanceCapacity;
+
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_instances, capacity * sizeof( DeviceInstance ) )
+    );
+
+    HANDLE_CUDA_ERROR(
+        cudaMallocHost( &h_instances, capacity * sizeof( DeviceInstance ) )
+    );
+
+    instanceCapacity = capacity;
+
+    return h_instances;
+}
+
+
+/**
+ * @brief   Rasterizes every staged instance of a mesh into the framebuffer in
+ *          a single launch, one thread per instance and edge
+ *
+ * The staged instances are copied to the device in one transfer. Vertices
+ * are read in model space and taken through each instance's transform as
+ * they are drawn, so no placement needs a vertex buffer of its own.
+ *
+ * @param   *d_vertices     The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *d_elements     The device edge list, or the triangle index
+ *                          buffer if facets is set
+ * @param   elementCount    The number of edges or facets
+ * @param   facets          True to draw the edges of every facet, false to
+ *                          draw an edge list
+ * @param   instanceCount   The number of instances staged with
+ *                          reserveInstances
+ * @param   cullBackFaces   True to skip facets facing away from the viewer,
+ *                          only when drawing facets
+ *
+ * @return  void
+ */
+void Rasterizer::drawInstances(
+    const float *d_vertices, unsigned int vertexStride,
+    const unsigned int *d_elements, unsigned int elementCount, bool facets,
+    unsigned int instanceCount, bool cullBackFaces
+)
+{
+    if ( ( d_frameBuffer == nullptr ) || ( elementCount == 0 ) || ( instanceCount == 0 ) ) return;
+
+    uploadInstances( instanceCount );
+
+    unsigned int threadCount = facets ? elementCount * Mesh::FACET_DIM : elementCount;
+    unsigned int rows = ( instanceCount < MAX_INSTANCE_ROWS ) ? instanceCount : MAX_INSTANCE_ROWS;
+
+    dim3 blocks( ceil( threadCount / ( double ) RASTER_BLOCK_SIZE ), rows );
+
+    if ( facets )
+    {
+        rasterizeInstanceFacetEdges<<<blocks, RASTER_BLOCK_SIZE>>>(
+            d_vertices, vertexStride,
+            d_elements, elementCount,
+            d_instances, instanceCount,
+            cullBackFaces,
+            d_frameBuffer, width, height,
+            getDepthShading()
+        );
+    }
+    else
+    {
+        rasterizeInstanceEdges<<<blocks, RASTER_BLOCK_SIZE>>>(
+            d_vertices, vertexStride,
+            d_elements, elementCount,
+            d_instances, instanceCount,
+            d_frameBuffer, width, height,
+            getDepthShading()
+        );
+    }
+
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+}
+
+
+/**
+ * @brief   Copies the finished frame back to the host and blits it to a
+ *          graphics context
+ *
+ * If the graphics context exposes a back buffer of the same size, the frame
+ * is copied straight into it. Otherwise it goes through the pinned host
+ * framebuffer and a single drawImage.
+ *
+ * @param   *gc     The graphics context to blit to
+ *
+ * @return  void
+ */
+void Rasterizer::blit( GraphicsContext *gc )
+{
+    if ( d_frameBuffer == nullptr ) return;
+
+    ProfileRange readbackRange( FrameProfiler::STAGE_READBACK );
+
+    size_t bufferSize = width * height * sizeof( unsigned int );
+
+    unsigned int *backBuffer = gc->getBackBuffer();
+
+    if ( ( backBuffer != nullptr ) &&
+         ( ( unsigned int ) gc->getWindowWidth() == width ) &&
+         ( ( unsigned int ) gc->getWindowHeight() == height ) )
+    {
+        HANDLE_CUDA_ERROR(
+            cudaMemcpy(
+                ( void * ) backBuffer,
+                ( void * ) d_frameBuffer,
+                bufferSize,
+                cudaMemcpyDeviceToHost
+            )
+        );
+        return;
+    }
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) h_frameBuffer,
+            ( void * ) d_frameBuffer,
+            bufferSize,
+            cudaMemcpyDeviceToHost
+        )
+    );
+
+    readbackRange.end();
+
+    gc->drawImage( h_frameBuffer, width, height );
+}
+
+
+/**
+ * @brief   Copies the finished frame back to host memory
+ *
+ * @param   *pixels     The getWidth() by getHeight() row-major pixels to
+ *                      write
+ *
+ * @return  void
+ */
+void Rasterizer::download( unsigned int *pixels ) const
+{
+    if ( d_frameBuffer == nullptr ) return;
+
+    ProfileRange readbackRange( FrameProfiler::STAGE_READBACK );
+
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) pixels,
+            ( void * ) d_frameBuffer,
+            width * height * sizeof( unsigned int ),
+            cudaMemcpyDeviceToHost
+        )
+    );
+}
+
+
+/**
+ * @brief   Gets the width of the framebuffer
+ *
+ * @param   void
+ *
+ * @return  The width of the framebuffer in pixels
+ */
+unsigned int Rasterizer::getWidth() const
+{
+    return width;
+}
+
+
+/**
+ * @brief   Gets the height of the framebuffer
+ *
+ * @param   void
+ *
+ * @return  The height of the framebuffer in pixels
+ */
+unsigned int Rasterizer::getHeight() const
+{
+    return height;
+}
+
+
+/**
+ * @brief   Gets the device framebuffer
+ *
+ * @param   void
+ *
+ * @return  A device pointer to the row-major 32-bit framebuffer
+ */
+unsigned int *Rasterizer::getDeviceFrameBuffer()
+{
+    return d_frameBuffer;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Frees the device and pinned framebuffers and the depth buffer
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Rasterizer::freeDevice()
+{
+    if ( d_frameBuffer != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_frameBuffer ) );
+        d_frameBuffer = nullptr;
+    }
+
+    if ( h_frameBuffer != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFreeHost( h_frameBuffer ) );
+        h_frameBuffer = nullptr;
+    }
+
+    if ( d_depthBuffer != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_depthBuffer ) );
+        d_depthBuffer = nullptr;
+    }
+
+    depthWritten = false;
+
+    width = 0;
+    height = 0;
+}
+
+
+/**
+ * @brief   Frees the device and pinned instance buffers
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Rasterizer::freeInstances()
+{
+    if ( d_instances != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_instances ) );
+        d_instances = nullptr;
+    }
+
+    if ( h_instances != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFreeHost( h_instances ) );
+        h_instances = nullptr;
+    }
+
+    instanceCapacity = 0;
+}
+
+
+/**
+ * @brief   Copies the staged instances of the next instanced draw to the
+ *          device
+ *
+ * @param   instanceCount   The number of instances staged with
+ *                          reserveInstances
+ *
+ * @return  void
+ */
+void Rasterizer::uploadInstances( unsigned int instanceCount )
+{
+    HANDLE_CUDA_ERROR(
+        cudaMemcpy(
+            ( void * ) d_instances,
+            ( void * ) h_instances,
+            instanceCount * sizeof( DeviceInstance ),
+            cudaMemcpyHostToDevice
+        )
+    );
+}
+
+
+/**
+ * @brief   Clears the depth buffer if no facet has been drawn into it since
+ *          the framebuffer was last cleared
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Rasterizer::beginDepth()
+{
+    if ( depthWritten ) return;
+
+    unsigned int pixelCount = width * height;
+    unsigned int blocks = ceil( pixelCount / ( double ) RASTER_BLOCK_SIZE );
+
+    clearDepthBuffer<<<blocks, RASTER_BLOCK_SIZE>>>( d_depthBuffer, pixelCount );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    depthWritten = true;
+}
+
+
+/**
+ * @brief   Gets how the next edges drawn are shaded by depth
+ *
+ * Edges are only tested against the depth buffer once facets have been
+ * drawn into it, so edges drawn without a depth pass are all kept.
+ *
+ * @param   void
+ *
+ * @return  The depth shading to pass to the raster kernels
+ */
+DepthShading Rasterizer::getDepthShading() const
+{
+    DepthShading shading;
+
+    shading.depthBuffer = ( hiddenLines && depthWritten ) ? d_depthBuffer : nullptr;
+    shading.nearZ = nearZ;
+    shading.farZ = farZ;
+    shading.fade = depthCueing ? DEPTH_CUE_FADE : 0.0f;
+    shading.fadeColor = clearColor;
+
+    return shading;
+}
+
+
+/**
+ * @brief   Takes a model-space vertex through an instance's transform
+ *
+ * Only x, y and z are needed to draw, w is left out.
+ *
+ * @param   &instance       The instance to transform with
+ * @param   *vertices       The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   vertIdx         The index of the vertex
+ * @param   &x              Set to the device-space x-coordinate
+ * @param   &y              Set to the device-space y-coordinate
+ * @param   &z              Set to the device-space z-coordinate
+ *
+ * @return  void
+ */
+__device__ void transformInstanceVertex(
+    const DeviceInstance &instance,
+    const float * vertices, unsigned int vertexStride, unsigned int vertIdx,
+    float &x, float &y, float &z
+)
+{
+    float vx = vertices[vertIdx];
+    float vy = vertices[vertexStride + vertIdx];
+    float vz = vertices[vertexStride * 2 + vertIdx];
+
+    const Vec4f &row0 = instance.transform[0];
+    const Vec4f &row1 = instance.transform[1];
+    const Vec4f &row2 = instance.transform[2];
+
+    x = row0[0] * vx + row0[1] * vy + row0[2] * vz + row0[3];
+    y = row1[0] * vx + row1[1] * vy + row1[2] * vz + row1[3];
+    z = row2[0] * vx + row2[1] * vy + row2[2] * vz + row2[3];
+}
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+/**
+ * @brief   Fills a framebuffer with a color, one thread per pixel
+ *
+ * @param   *frameBuffer    The framebuffer to fill
+ * @param   pixelCount      The number of pixels in the framebuffer
+ * @param   color           The color to fill with
+ *
+ * @return  void
+ */
+__global__ void clearFrameBuffer(
+    unsigned int * frameBuffer, unsigned int pixelCount, unsigned int color
+)
+{
+    unsigned int pixelIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( pixelIdx >= pixelCount ) return;
+
+    frameBuffer[pixelIdx] = color;
+}
+
+
+/**
+ * @brief   Fills a depth buffer with the farthest depth, one thread per pixel
+ *
+ * @param   *depthBuffer    The depth buffer to fill
+ * @param   pixelCount      The number of pixels in the depth buffer
+ *
+ * @return  void
+ */
+__global__ void clearDepthBuffer( unsigned int * depthBuffer, unsigned int pixelCount )
+{
+    unsigned int pixelIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( pixelIdx >= pixelCount ) return;
+
+    depthBuffer[pixelIdx] = Rasterizer::DEPTH_CLEAR;
+}
+
+
+/**
+ * @brief   Scan converts facets into a depth buffer, one thread per facet
+ *
+ * @param   *vertices       The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *indices        The triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   *depthBuffer    The row-major encoded depth buffer
+ * @param   width           The width of the depth buffer in pixels
+ * @param   height          The height of the depth buffer in pixels
+ *
+ * @return  void
+ */
+__global__ void rasterizeFacetDepth(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    unsigned int * depthBuffer, unsigned int width, unsigned int height
+)
+{
+    unsigned int facetIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( facetIdx >= facetCount ) return;
+
+    float x[Mesh::FACET_DIM];
+    float y[Mesh::FACET_DIM];
+    float z[Mesh::FACET_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+    {
+        unsigned int vertIdx = indices[facetIdx * Mesh::FACET_DIM + i];
+
+        x[i] = vertices[vertIdx];
+        y[i] = vertices[vertexStride + vertIdx];
+        z[i] = vertices[vertexStride * 2 + vertIdx];
+    }
+
+    writeFacetDepth( depthBuffer, width, height, x, y, z );
+}
+
+
+/**
+ * @brief   Scan converts facets once per instance into a depth buffer, one
+ *          thread per facet along x and one instance per grid row along y
+ *
+ * @param   *vertices       The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *indices        The triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   *instances      The instances to draw
+ * @param   instanceCount   The number of instances
+ * @param   *depthBuffer    The row-major encoded depth buffer
+ * @param   width           The width of the depth buffer in pixels
+ * @param   height          The height of the depth buffer in pixels
+ *
+ * @return  void
+ */
+__global__ void rasterizeInstanceFacetDepth(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    const DeviceInstance * instances, unsigned int instanceCount,
+    unsigned int * depthBuffer, unsigned int width, unsigned int height
+)
+{
+    unsigned int facetIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( facetIdx >= facetCount ) return;
+
+    unsigned int corners[Mesh::FACET_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+    {
+        corners[i] = indices[facetIdx * Mesh::FACET_DIM + i];
+    }
+
+    for ( unsigned int instanceIdx = blockIdx.y; instanceIdx < instanceCount; instanceIdx += gridDim.y )
+    {
+        const DeviceInstance &instance = instances[instanceIdx];
+
+        float x[Mesh::FACET_DIM];
+        float y[Mesh::FACET_DIM];
+        float z[Mesh::FACET_DIM];
+
+        for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+        {
+            transformInstanceVertex( instance, vertices, vertexStride, corners[i], x[i], y[i], z[i] );
+        }
+
+        writeFacetDepth( depthBuffer, width, height, x, y, z );
+    }
+}
+
+
+/**
+ * @brief   Rasterizes edges into a framebuffer with Bresenham's algorithm,
+ *          one thread per edge
+ *
+ * @param   *vertices       The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *edges          The edge list, two vertex indices per edge
+ * @param   edgeCount       The number of edges
+ * @param   *frameBuffer    The row-major framebuffer to draw into
+ * @param   width           The width of the framebuffer in pixels
+ * @param   height          The height of the framebuffer in pixels
+ * @param   color           The color to draw with
+ * @param   shading         The depth shading to draw with
+ *
+ * @return  void
+ */
+__global__ void rasterizeEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * edges, unsigned int edgeCount,
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    unsigned int color, DepthShading shading
+)
+{
+    unsigned int edgeIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( edgeIdx >= edgeCount ) return;
+
+    unsigned int start = edges[edgeIdx * Mesh::EDGE_DIM + 0];
+    unsigned int end = edges[edgeIdx * Mesh::EDGE_DIM + 1];
+
+    float x0 = vertices[start];
+    float y0 = vertices[vertexStride + start];
+    float x1 = vertices[end];
+    float y1 = vertices[vertexStride + end];
+
+    if ( ( shading.depthBuffer != nullptr ) || ( shading.fade > 0 ) )
+    {
+        float z0 = vertices[vertexStride * 2 + start];
+        float z1 = vertices[vertexStride * 2 + end];
+
+        drawDepthLine( frameBuffer, width, height, x0, y0, z0, x1, y1, z1, color, shading );
+    }
+    else
+    {
+        drawLine( frameBuffer, width, height, x0, y0, x1, y1, color );
+    }
+}
+
+
+/**
+ * @brief   Rasterizes the three edges of every facet into a framebuffer, one
+ *          thread per facet edge
+ *
+ * Edges shared between facets are drawn once per facet. This is for meshes
+ * whose unique edge list has not been built yet, such as while streaming.
+ *
+ * @param   *vertices       The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *indices        The triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   *frameBuffer    The row-major framebuffer to draw into
+ * @param   width           The width of the framebuffer in pixels
+ * @param   height          The height of the framebuffer in pixels
+ * @param   color           The color to draw with
+ * @param   shading         The depth shading to draw with
+ *
+ * @return  void
+ */
+__global__ void rasterizeFacetEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    unsigned int color, DepthShading shading
+)
+{
+    unsigned int edgeIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( edgeIdx >= facetCount * Mesh::FACET_DIM ) return;
+
+    unsigned int facetIdx = edgeIdx / Mesh::FACET_DIM;
+    unsigned int corner = edgeIdx % Mesh::FACET_DIM;
+
+    unsigned int start = indices[facetIdx * Mesh::FACET_DIM + corner];
+    unsigned int end = indices[facetIdx * Mesh::FACET_DIM + ( corner + 1 ) % Mesh::FACET_DIM];
+
+    float x0 = vertices[start];
+    float y0 = vertices[vertexStride + start];
+    float x1 = vertices[end];
+    float y1 = vertices[vertexStride + end];
+
+    if ( ( shading.depthBuffer != nullptr ) || ( shading.fade > 0 ) )
+    {
+        float z0 = vertices[vertexStride * 2 + start];
+        float z1 = vertices[vertexStride * 2 + end];
+
+        drawDepthLine( frameBuffer, width, height, x0, y0, z0, x1, y1, z1, color, shading );
+    }
+    else
+    {
+        drawLine( frameBuffer, width, height, x0, y0, x1, y1, color );
+    }
+}
+
+
+/**
+ * @brief   Rasterizes an edge list once per instance into a framebuffer, one
+ *          thread per edge along x and one instance per grid row along y
+ *
+ * Every thread of a block reads the same instance, so its transform is a
+ * broadcast load. With more instances than grid rows, each row also takes
+ * every gridDim.y-th instance after its own.
+ *
+ * @param   *vertices       The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *edges          The edge list, two vertex indices per edge
+ * @param   edgeCount       The number of edges
+ * @param   *instances      The instances to draw
+ * @param   instanceCount   The number of instances
+ * @param   *frameBuffer    The row-major framebuffer to draw into
+ * @param   width           The width of the framebuffer in pixels
+ * @param   height          The height of the framebuffer in pixels
+ * @param   shading         The depth shading to draw with
+ *
+ * @return  void
+ */
+__global__ void rasterizeInstanceEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * edges, unsigned int edgeCount,
+    const DeviceInstance * instances, unsigned int instanceCount,
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    DepthShading shading
+)
+{
+    unsigned int edgeIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( edgeIdx >= edgeCount ) return;
+
+    unsigned int start = edges[edgeIdx * Mesh::EDGE_DIM + 0];
+    unsigned int end = edges[edgeIdx * Mesh::EDGE_DIM + 1];
+
+    bool shaded = ( shading.depthBuffer != nullptr ) || ( shading.fade > 0 );
+
+    for ( unsigned int instanceIdx = blockIdx.y; instanceIdx < instanceCount; instanceIdx += gridDim.y )
+    {
+        const DeviceInstance &instance = instances[instanceIdx];
+
+        float x0, y0, z0, x1, y1, z1;
+        transformInstanceVertex( instance, vertices, vertexStride, start, x0, y0, z0 );
+        transformInstanceVertex( instance, vertices, vertexStride, end, x1, y1, z1 );
+
+        if ( shaded )
+        {
+            drawDepthLine( frameBuffer, width, height, x0, y0, z0, x1, y1, z1, instance.color, shading );
+        }
+        else
+        {
+            drawLine( frameBuffer, width, height, x0, y0, x1, y1, instance.color );
+        }
+    }
+}
+
+
+/**
+ * @brief   Rasterizes the three edges of every facet once per instance into a
+ *          framebuffer, one thread per facet edge along x and one instance per
+ *          grid row along y
+ *
+ * Facing is decided per instance, since each one is seen from its own side.
+ *
+ * @param   *vertices       The model-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride    The distance between the x[], y[] and z[] arrays
+ * @param   *indices        The triangle index buffer
+ * @param   facetCount      The number of facets
+ * @param   *instances      The instances to draw
+ * @param   instanceCount   The number of instances
+ * @param   cullBackFaces   True to skip facets facing away from the viewer
+ * @param   *frameBuffer    The row-major framebuffer to draw into
+ * @param   width           The width of the framebuffer in pixels
+ * @param   height          The height of the framebuffer in pixels
+ * @param   shading         The depth shading to draw with
+ *
+ * @return  void
+ */
+__global__ void rasterizeInstanceFacetEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    const DeviceInstance * instances, unsigned int instanceCount,
+    bool cullBackFaces,
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    DepthShading shading
+)
+{
+    unsigned int edgeIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( edgeIdx >= facetCount * Mesh::FACET_DIM ) return;
+
+    unsigned int facetIdx = edgeIdx / Mesh::FACET_DIM;
+    unsigned int corner = edgeIdx % Mesh::FACET_DIM;
+
+    unsigned int corners[Mesh::FACET_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+    {
+        corners[i] = indices[facetIdx * Mesh::FACET_DIM + i];
+    }
+
+    unsigned int next = ( corner + 1 ) % Mesh::FACET_DIM;
+
+    bool shaded = ( shading.depthBuffer != nullptr ) || ( shading.fade > 0 );
+
+    for ( unsigned int instanceIdx = blockIdx.y; instanceIdx < instanceCount; instanceIdx += gridDim.y )
+    {
+        const DeviceInstance &instance = instances[instanceIdx];
+
+        float x[Mesh::FACET_DIM];
+        float y[Mesh::FACET_DIM];
+        float z[Mesh::FACET_DIM];
+
+        // every corner is needed for the facing, only the edge's otherwise
+        for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+        {
+            if ( cullBackFaces || ( i == corner ) || ( i == next ) )
+            {
+                transformInstanceVertex( instance, vertices, vertexStride, corners[i], x[i], y[i], z[i] );
+            }
+        }
+
+        if ( cullBackFaces )
+        {
+            // z of the device-space normal, the same rule as the culler
+            float normalZ = ( x[1] - x[0] ) * ( y[2] - y[0] ) - ( y[1] - y[0] ) * ( x[2] - x[0] );
+
+            if ( normalZ < 0 ) continue;
+        }
+
+        if ( shaded )
+        {
+            drawDepthLine(
+                frameBuffer, width, height,
+                x[corner], y[corner], z[corner], x[next], y[next], z[next],
+                instance.color, shading
+            );
+        }
+        else
+        {
+            drawLine( frameBuffer, width, height, x[corner], y[corner], x[next], y[next], instance.color );
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
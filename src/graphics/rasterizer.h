@@ -0,0 +1,290 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    rasterizer.h
+ * @brief   GPU line rasterizer into a device-resident framebuffer
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_RASTERIZER_H
+# define GRAPHICS_RASTERIZER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "gcontext.h"
+# include "mat4f.h"
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * One placement of an instanced mesh: the transform from its model space
+ * straight to device space, and the color to draw it with
+ */
+struct DeviceInstance
+{
+    Mat4f transform;
+    unsigned int color;
+};
+
+
+/**
+ * How edges are shaded by depth: tested against a depth buffer, faded
+ * toward a color with distance, both or neither
+ */
+struct DepthShading
+{
+    // the depth buffer to test against, or null to draw every edge
+    const unsigned int * depthBuffer;
+
+    // the device-space z range faded over, nearest first
+    float nearZ;
+    float farZ;
+
+    // how much of the way to fadeColor the farthest edges are, 0 for none
+    float fade;
+    unsigned int fadeColor;
+};
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class Rasterizer
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // the encoded depth of a pixel no facet covers
+    static constexpr unsigned int DEPTH_CLEAR = 0xFFFFFFFF;
+
+    // the polygon offset facets are pushed back by, in device-space z per
+    // pixel of slope and in device-space z, so edges are not hidden by the
+    // facets they border
+    static constexpr float DEPTH_SLOPE_OFFSET = 1.0f;
+    static constexpr float DEPTH_OFFSET = 0.5f;
+
+    // how much of the way to the background the farthest edges fade
+    static constexpr float DEPTH_CUE_FADE = 0.8f;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    Rasterizer();
+    Rasterizer( const Rasterizer &raster ) = delete;
+
+    ~Rasterizer();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    Rasterizer &operator=( const Rasterizer &raster ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void resize( unsigned int width, unsigned int height );
+
+    void clear( unsigned int color );
+
+    void setHiddenLines( bool enabled );
+    bool isHiddenLines() const;
+
+    void setDepthCueing( bool enabled );
+    bool isDepthCueing() const;
+    void setDepthRange( float nearZ, float farZ );
+    void getDepthRange( float &nearZ, float &farZ ) const;
+
+    void drawFacetDepth(
+        const float *d_vertices, unsigned int vertexStride,
+        const unsigned int *d_indices, unsigned int facetCount
+    );
+
+    void drawInstanceDepth(
+        const float *d_vertices, unsigned int vertexStride,
+        const unsigned int *d_indices, unsigned int facetCount,
+        unsigned int instanceCount
+    );
+
+    void drawEdges(
+        const float *d_vertices, unsigned int vertexStride,
+        const unsigned int *d_edges, unsigned int edgeCount,
+        unsigned int color
+    );
+
+    void drawFacets(
+        const float *d_vertices, unsigned int vertexStride,
+        const unsigned int *d_indices, unsigned int facetCount,
+        unsigned int color
+    );
+
+    DeviceInstance *reserveInstances( unsigned int instanceCount );
+
+    void drawInstances(
+        const float *d_vertices, unsigned int vertexStride,
+        const unsigned int *d_elements, unsigned int elementCount, bool facets,
+        unsigned int instanceCount, bool cullBackFaces
+    );
+
+    void blit( GraphicsContext *gc );
+    void download( unsigned int *pixels ) const;
+
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+    unsigned int *getDeviceFrameBuffer();
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    unsigned int * d_frameBuffer = nullptr;
+    unsigned int * h_frameBuffer = nullptr;
+
+    // encoded device-space z of the nearest facet over every pixel
+    unsigned int * d_depthBuffer = nullptr;
+
+    bool hiddenLines = false;
+    bool depthCueing = false;
+
+    // true once a facet has been drawn into the depth buffer since the
+    // last clear, edges drawn before then are not tested
+    bool depthWritten = false;
+
+    float nearZ = 0;
+    float farZ = 0;
+    unsigned int clearColor = 0;
+
+    // the instances of the next instanced draw, staged in pinned memory
+    unsigned int instanceCapacity = 0;
+
+    DeviceInstance * d_instances = nullptr;
+    DeviceInstance * h_instances = nullptr;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void freeDevice();
+    void freeInstances();
+    void uploadInstances( unsigned int instanceCount );
+    void beginDepth();
+
+    DepthShading getDepthShading() const;
+
+
+    /* ====================================================================== */
+};
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+__host__ __device__ bool clipEdge( float &x0, float &y0, float &x1, float &y1, float xMax, float yMax );
+
+__host__ __device__ void drawLine(
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    float x0, float y0, float x1, float y1,
+    unsigned int color,
+    unsigned int rowBegin = 0, unsigned int rowEnd = ~0u
+);
+
+__host__ __device__ unsigned int encodeDepth( float z );
+
+__host__ __device__ unsigned int shadeDepth( unsigned int color, float z, const DepthShading &shading );
+
+__device__ void drawDepthLine(
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    float x0, float y0, float z0, float x1, float y1, float z1,
+    unsigned int color, const DepthShading &shading
+);
+
+__device__ void writeFacetDepth(
+    unsigned int * depthBuffer, unsigned int width, unsigned int height,
+    const float * x, const float * y, const float * z
+);
+
+__global__ void clearFrameBuffer(
+    unsigned int * frameBuffer, unsigned int pixelCount, unsigned int color
+);
+
+__global__ void clearDepthBuffer( unsigned int * depthBuffer, unsigned int pixelCount );
+
+__global__ void rasterizeFacetDepth(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    unsigned int * depthBuffer, unsigned int width, unsigned int height
+);
+
+__global__ void rasterizeInstanceFacetDepth(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    const DeviceInstance * instances, unsigned int instanceCount,
+    unsigned int * depthBuffer, unsigned int width, unsigned int height
+);
+
+__global__ void rasterizeEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * edges, unsigned int edgeCount,
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    unsigned int color, DepthShading shading
+);
+
+__global__ void rasterizeFacetEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    unsigned int color, DepthShading shading
+);
+
+__device__ void transformInstanceVertex(
+    const DeviceInstance &instance,
+    const float * vertices, unsigned int vertexStride, unsigned int vertIdx,
+    float &x, float &y, float &z
+);
+
+__global__ void rasterizeInstanceEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * edges, unsigned int edgeCount,
+    const DeviceInstance * instances, unsigned int instanceCount,
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    DepthShading shading
+);
+
+__global__ void rasterizeInstanceFacetEdges(
+    const float * vertices, unsigned int vertexStride,
+    const unsigned int * indices, unsigned int facetCount,
+    const DeviceInstance * instances, unsigned int instanceCount,
+    bool cullBackFaces,
+    unsigned int * frameBuffer, unsigned int width, unsigned int height,
+    DepthShading shading
+);
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_RASTERIZER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,667 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    rendersession.cpp
+ * @brief   Device-resident render state of the loaded model
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <chrono>
+# include <cstdlib>
+# include <iostream>
+
+# include "frameprofiler.h"
+# include "rendersession.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a render session with no model loaded
+ *
+ * @param   void
+ *
+ * @return  The created render session
+ */
+RenderSession::RenderSession()
+{
+    outOfCoreForced = ( getenv( "RENDER_OUT_OF_CORE" ) != nullptr );
+
+    // one binary runs everywhere, without a device it draws on the host
+    hostOnly = ( getenv( "RENDER_CPU" ) != nullptr ) || ( SplitRenderer::getDeviceCount() == 0 );
+
+    if ( hostOnly )
+    {
+        std::cout << "Rendering on the CPU with " << cpu.getThreadCount() << " threads"
+                  << ( CpuRenderer::hasVectorTransform() ? " (AVX2)" : "" ) << std::endl;
+        return;
+    }
+
+    const char *multiDevice = getenv( "RENDER_MULTI_GPU" );
+    if ( multiDevice == nullptr ) return;
+
+    // a count caps the devices used, anything else uses all of them
+    unsigned int deviceCount = SplitRenderer::getDeviceCount();
+    long requested = strtol( multiDevice, nullptr, 10 );
+
+    if ( ( requested > 0 ) && ( ( unsigned long ) requested < deviceCount ) ) deviceCount = requested;
+    if ( deviceCount > 1 ) splitDeviceCount = deviceCount;
+}
+
+
+/**
+ * @brief   Render session destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+RenderSession::~RenderSession() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Renders the loaded model and blits it to a graphics context
+ *
+ * The frame is only redrawn if the view, the colors, the window size or the
+ * facets on the device have changed since the last one; otherwise the
+ * framebuffer is blitted as it is. Nothing is allocated unless the window
+ * has been resized.
+ *
+ * @param   *gc     The graphics context to render to
+ * @param   *vc     The view context to render with
+ * @param   color   The 24-bit RGB color to draw the model with
+ *
+ * @return  void
+ */
+void RenderSession::render( GraphicsContext *gc, ViewContext *vc, unsigned int color )
+{
+    // the screen translation follows the window size
+    vc->updateWindow();
+
+    draw(
+        vc,
+        gc->getWindowWidth(), gc->getWindowHeight(),
+        color, gc->getBackgroundColor()
+    );
+
+    // the back buffer may be a different one than last frame
+    if ( hostOnly ) cpu.blit( gc );
+    else raster.blit( gc );
+
+    FrameProfiler::getInstance().endFrame();
+}
+
+
+/**
+ * @brief   Renders the loaded model into the framebuffer, if anything changed
+ *          since the last frame
+ *
+ * @param   *vc         The view context to render with, already sized to
+ *                      the window
+ * @param   width       The width of the window in pixels
+ * @param   height      The height of the window in pixels
+ * @param   color       The 24-bit RGB color to draw the model with
+ * @param   background  The 24-bit RGB background color
+ *
+ * @return  True if the frame was redrawn, false if it was already current
+ */
+bool RenderSession::draw(
+    ViewContext *vc,
+    unsigned int width, unsigned int height,
+    unsigned int color, unsigned int background
+)
+{
+    if ( hostOnly )
+    {
+        if ( ( width != cpu.getWidth() ) || ( height != cpu.getHeight() ) )
+        {
+            cpu.resize( width, height );
+            frameValid = false;
+        }
+    }
+    else if ( ( width != raster.getWidth() ) || ( height != raster.getHeight() ) )
+    {
+        raster.resize( width, height );
+        frameValid = false;
+    }
+
+    if ( isFrameCurrent( vc, color, background ) ) return false;
+
+    // the frame is timed until it has been copied back to the host
+    FrameProfiler::getInstance().beginFrame();
+
+    // depth cueing fades across whatever is in the scene
+    float nearZ, farZ;
+    if ( !hostOnly && scene.getDepthRange( vc, nearZ, farZ ) ) raster.setDepthRange( nearZ, farZ );
+
+    if ( hostOnly )
+    {
+        cpu.clear( background );
+
+        for ( unsigned int index = 0; index < scene.getModelCount(); index++ )
+        {
+            const SceneModel &model = scene.getModel( index );
+            if ( !model.isVisible() ) continue;
+
+            const ShapeContainer &shapes = model.getShapes();
+            Mat4f transform = vc->transform * model.getTransform();
+
+            unsigned int level = shapes.isAdaptiveDetail() ? shapes.selectLevelOfDetail( transform ) : 0;
+
+            const Mesh &lod = shapes.getLevelOfDetail( level );
+
+            if ( shapes.getInstanceCount() == 0 )
+            {
+                cpu.draw( lod, transform, culler.isBackFaceCulling(), model.getColor( color ) );
+            }
+
+            // the host has no instanced path, each instance is drawn in turn
+            for ( unsigned int instance = 0; instance < shapes.getInstanceCount(); instance++ )
+            {
+                cpu.draw(
+                    lod, transform * shapes.getInstanceTransform( instance ),
+                    culler.isBackFaceCulling(), shapes.getInstanceColor( instance )
+                );
+            }
+        }
+    }
+    else if ( split.isSplit() )
+    {
+        // every device takes the view transform with its own partition
+        split.draw(
+            vc, raster, color, background,
+            culler.isBackFaceCulling(), sc.isAdaptiveDetail()
+        );
+        deviceViewVersion = vc->getVersion();
+
+        // the other models are resident on the device the frame is composited on
+        if ( scene.draw( vc, raster, culler.isBackFaceCulling(), color, 1 ) ) deviceViewVersion = 0;
+    }
+    else if ( outOfCore.isLoaded() )
+    {
+        if ( vc->getVersion() != deviceViewVersion )
+        {
+            ShapeContainer::pushViewTransform( vc );
+            deviceViewVersion = vc->getVersion();
+        }
+
+        // the chunks are streamed in again on every frame
+        raster.clear( background );
+        outOfCore.draw( vc, raster, culler, color );
+
+        if ( scene.draw( vc, raster, culler.isBackFaceCulling(), color, 1 ) ) deviceViewVersion = 0;
+    }
+    else
+    {
+        // every model pushes its own transform, and only if it has to
+        raster.clear( background );
+        if ( scene.draw( vc, raster, culler.isBackFaceCulling(), color, 0 ) ) deviceViewVersion = 0;
+    }
+
+    frameValid = true;
+    frameViewVersion = vc->getVersion();
+    frameColor = color;
+    frameBackground = background;
+    frameFacetCount = sc.getMesh().getDeviceFacetCount();
+    frameStreaming = sc.getMesh().isStreaming();
+    frameInstanceVersion = sc.getInstanceVersion();
+    frameSceneVersion = scene.getVersion();
+
+    return true;
+}
+
+
+/**
+ * @brief   Copies the framebuffer back to host memory
+ *
+ * @param   *pixels     The row-major pixels of the last drawn window size
+ *                      to write
+ *
+ * @return  void
+ */
+void RenderSession::download( unsigned int *pixels ) const
+{
+    if ( hostOnly ) cpu.download( pixels );
+    else raster.download( pixels );
+
+    FrameProfiler::getInstance().endFrame();
+}
+
+
+/**
+ * @brief   Pushes the mesh of the shape container to the device, splits it
+ *          across the devices in multi-device mode, or cuts it into chunks
+ *          to stream if it does not fit
+ *
+ * Without a device, the mesh only gets its edge list built on the host.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RenderSession::upload()
+{
+    const Mesh &mesh = sc.getMesh();
+
+    auto uploadStartTime = std::chrono::steady_clock::now();
+
+    if ( hostOnly )
+    {
+        if ( !mesh.hasEdges() ) sc.getMesh().buildHostEdges();
+    }
+    else if ( splitDeviceCount > 0 )
+    {
+        split.split( mesh, splitDeviceCount );
+    }
+    else if ( outOfCoreForced || !OutOfCoreRenderer::fitsOnDevice( mesh.getVertexCount(), mesh.getFacetCount() ) )
+    {
+        outOfCore.load( mesh );
+    }
+    else
+    {
+        sc.pushToDevice();
+    }
+
+    auto uploadEndTime = std::chrono::steady_clock::now();
+    double uploadTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        uploadEndTime - uploadStartTime
+    ).count() / 1000000.0;
+    FrameProfiler::getInstance().addSample( FrameProfiler::STAGE_UPLOAD, uploadTime );
+
+    invalidate();
+}
+
+
+/**
+ * @brief   Pushes the mesh of a model added to the scene to the device
+ *
+ * Only the primary model is split or streamed, any other model is pushed
+ * to the one device whole. Without a device, the mesh only gets its edge
+ * list built on the host.
+ *
+ * @param   model   The index of the model in the scene
+ *
+ * @return  void
+ */
+void RenderSession::uploadModel( unsigned int model )
+{
+    if ( model == 0 )
+    {
+        upload();
+        return;
+    }
+
+    ShapeContainer &shapes = scene.getModel( model ).getShapes();
+
+    if ( hostOnly )
+    {
+        if ( !shapes.getMesh().hasEdges() ) shapes.getMesh().buildHostEdges();
+    }
+    else
+    {
+        shapes.pushToDevice();
+    }
+
+    invalidate();
+}
+
+
+/**
+ * @brief   Forces the next render to redraw the frame, for changes to the
+ *          mesh that do not change its facet count
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RenderSession::invalidate()
+{
+    scene.invalidate();
+    frameValid = false;
+}
+
+
+/**
+ * @brief   Unloads the model and frees its device buffers
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RenderSession::unload()
+{
+    split.clear();
+    outOfCore.clear();
+    scene.clear();
+    invalidate();
+}
+
+
+/**
+ * @brief   Determines if frames are drawn on the host, without a device
+ *
+ * @param   void
+ *
+ * @return  True if there is no device to draw on, false otherwise
+ */
+bool RenderSession::isHostOnly() const
+{
+    return hostOnly;
+}
+
+
+/**
+ * @brief   Determines if an uploaded mesh is split across devices
+ *
+ * A mesh in multi-device mode is uploaded whole, it cannot be streamed in
+ * through the shape container.
+ *
+ * @param   void
+ *
+ * @return  True in multi-device mode, false otherwise
+ */
+bool RenderSession::isMultiDevice() const
+{
+    return splitDeviceCount > 0;
+}
+
+
+/**
+ * @brief   Determines if the loaded model is streamed through the device in
+ *          chunks
+ *
+ * @param   void
+ *
+ * @return  True if the model is drawn out of core, false otherwise
+ */
+bool RenderSession::isOutOfCore() const
+{
+    return outOfCore.isLoaded();
+}
+
+
+/**
+ * @brief   Determines if a model can be streamed straight into the shape
+ *          container while it is read
+ *
+ * Streaming allocates the device buffers for the worst case up front, so it
+ * is only done if there is a device, the model is not split and the worst
+ * case fits. Otherwise the model is read whole and handed to upload.
+ *
+ * @param   facetCount  The number of facets of the model
+ *
+ * @return  True if the model can be streamed in, false otherwise
+ */
+bool RenderSession::canStream( unsigned int facetCount ) const
+{
+    if ( hostOnly || isMultiDevice() || outOfCoreForced ) return false;
+
+    // no shared vertices in the worst case
+    return OutOfCoreRenderer::fitsOnDevice( facetCount * Mesh::FACET_DIM, facetCount );
+}
+
+
+/**
+ * @brief   Finds the facet of the loaded model under a point in the window
+ *
+ * @param   *vc     The view context the window is drawn with
+ * @param   x       The x-coordinate of the point in pixels
+ * @param   y       The y-coordinate of the point in pixels
+ *
+ * @return  The index of the nearest facet under the point, or -1 if there
+ *          is none
+ */
+int RenderSession::pick( const ViewContext *vc, int x, int y ) const
+{
+    if ( hostOnly ) return cpu.pick( sc.getMesh(), vc, x, y );
+    if ( split.isSplit() ) return split.pick( vc, x, y );
+    if ( outOfCore.isLoaded() ) return outOfCore.pick( vc, x, y );
+
+    return sc.pick( vc, x, y );
+}
+
+
+/**
+ * @brief   Builds the simplified levels of detail of the loaded model, on
+ *          every device it is split across
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RenderSession::buildLevelsOfDetail()
+{
+    for ( unsigned int model = 1; model < scene.getModelCount(); model++ )
+    {
+        scene.getModel( model ).getShapes().buildLevelsOfDetail();
+    }
+
+    // the levels would have to be resident, which an out-of-core mesh is not
+    if ( outOfCore.isLoaded() ) return;
+
+    if ( split.isSplit() ) split.buildLevelsOfDetail();
+    else sc.buildLevelsOfDetail();
+}
+
+
+/**
+ * @brief   Sets whether facets facing away from the viewer are culled
+ *
+ * @param   enabled     True to cull back-facing facets, false to draw them
+ *
+ * @return  void
+ */
+void RenderSession::setBackFaceCulling( bool enabled )
+{
+    if ( enabled == culler.isBackFaceCulling() ) return;
+
+    culler.setBackFaceCulling( enabled );
+    invalidate();
+}
+
+
+/**
+ * @brief   Determines if facets facing away from the viewer are culled
+ *
+ * @param   void
+ *
+ * @return  True if back-facing facets are culled, false otherwise
+ */
+bool RenderSession::isBackFaceCulling() const
+{
+    return culler.isBackFaceCulling();
+}
+
+
+/**
+ * @brief   Sets whether edges behind facets are hidden
+ *
+ * Only models resident on the one device are hidden by each other; a
+ * split or streamed primary model is drawn in full and hides nothing, and
+ * the host draws every edge.
+ *
+ * @param   enabled     True to hide edges behind facets, false to draw
+ *                      every edge
+ *
+ * @return  void
+ */
+void RenderSession::setHiddenLines( bool enabled )
+{
+    if ( enabled == raster.isHiddenLines() ) return;
+
+    raster.setHiddenLines( enabled );
+    invalidate();
+}
+
+
+/**
+ * @brief   Determines if edges behind facets are hidden
+ *
+ * @param   void
+ *
+ * @return  True if hidden lines are removed, false otherwise
+ */
+bool RenderSession::isHiddenLines() const
+{
+    return raster.isHiddenLines();
+}
+
+
+/**
+ * @brief   Sets whether edges fade toward the background the farther back
+ *          they are
+ *
+ * No effect on the host, which draws every edge in its own color.
+ *
+ * @param   enabled     True to fade edges by depth, false to draw them flat
+ *
+ * @return  void
+ */
+void RenderSession::setDepthCueing( bool enabled )
+{
+    if ( enabled == raster.isDepthCueing() ) return;
+
+    raster.setDepthCueing( enabled );
+    invalidate();
+}
+
+
+/**
+ * @brief   Determines if edges fade by depth
+ *
+ * @param   void
+ *
+ * @return  True if edges are depth cued, false otherwise
+ */
+bool RenderSession::isDepthCueing() const
+{
+    return raster.isDepthCueing();
+}
+
+
+/**
+ * @brief   Sets whether the view is being moved interactively
+ *
+ * While interactive, a level of detail is picked by how large the model is
+ * on screen, keeping the frame rate up when it is small. Once the view
+ * settles, the full mesh is drawn again.
+ *
+ * @param   interactive     True while the view is being moved
+ *
+ * @return  void
+ */
+void RenderSession::setInteractive( bool interactive )
+{
+    if ( interactive == sc.isAdaptiveDetail() ) return;
+
+    for ( unsigned int model = 0; model < scene.getModelCount(); model++ )
+    {
+        scene.getModel( model ).getShapes().setAdaptiveDetail( interactive );
+    }
+
+    invalidate();
+}
+
+
+/**
+ * @brief   Determines if the view is being moved interactively
+ *
+ * @param   void
+ *
+ * @return  True while the view is being moved, false otherwise
+ */
+bool RenderSession::isInteractive() const
+{
+    return sc.isAdaptiveDetail();
+}
+
+
+/**
+ * @brief   Gets the shape container of the loaded model
+ *
+ * @param   void
+ *
+ * @return  A mutable reference to the shape container
+ */
+ShapeContainer &RenderSession::getShapes()
+{
+    return sc;
+}
+
+
+/**
+ * @brief   Gets the shape container of the loaded model
+ *
+ * @param   void
+ *
+ * @return  An immutable reference to the shape container
+ */
+const ShapeContainer &RenderSession::getShapes() const
+{
+    return sc;
+}
+
+
+/**
+ * @brief   Gets the scene the loaded model is the primary model of
+ *
+ * @param   void
+ *
+ * @return  A mutable reference to the scene
+ */
+Scene &RenderSession::getScene()
+{
+    return scene;
+}
+
+
+/**
+ * @brief   Gets the scene the loaded model is the primary model of
+ *
+ * @param   void
+ *
+ * @return  An immutable reference to the scene
+ */
+const Scene &RenderSession::getScene() const
+{
+    return scene;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Determines if the framebuffer already holds the frame for the
+ *          current inputs
+ *
+ * @param   *vc         The view context to render with
+ * @param   color       The 24-bit RGB color to draw the model with
+ * @param   background  The 24-bit RGB background color
+ *
+ * @return  True if the frame does not need to be redrawn, false otherwise
+ */
+bool RenderSession::isFrameCurrent( ViewContext *vc, unsigned int color, unsigned int background ) const
+{
+    const Mesh &mesh = sc.getMesh();
+
+    return frameValid &&
+           ( frameViewVersion == vc->getVersion() ) &&
+           ( frameColor == color ) &&
+           ( frameBackground == background ) &&
+           ( frameFacetCount == mesh.getDeviceFacetCount() ) &&
+           ( frameStreaming == mesh.isStreaming() ) &&
+           ( frameInstanceVersion == sc.getInstanceVersion() ) &&
+           ( frameSceneVersion == scene.getVersion() );
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,185 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    rendersession.h
+ * @brief   Device-resident render state of the loaded model
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_RENDERSESSION_H
+# define GRAPHICS_RENDERSESSION_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "cpurenderer.h"
+# include "culler.h"
+# include "gcontext.h"
+# include "outofcorerenderer.h"
+# include "rasterizer.h"
+# include "scene.h"
+# include "shapecontainer.h"
+# include "splitrenderer.h"
+# include "viewcontext.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A render session owns everything a frame is drawn from: the mesh and its
+ * device buffers, the device-space vertex buffer, the culling scratch
+ * buffers and the framebuffer. They stay allocated for as long as the model
+ * is loaded, and a frame is only redrawn when its inputs change. A view
+ * change uploads the 4x4 view transform and nothing else.
+ *
+ * With RENDER_MULTI_GPU set and more than one device visible, an uploaded
+ * mesh is split across the devices instead, up to the number it is set to,
+ * and the shape container only keeps the full mesh in host memory. A mesh
+ * too large for the free device memory, or any mesh with RENDER_OUT_OF_CORE
+ * set, stays in host memory and is streamed through the device in chunks
+ * on every frame.
+ *
+ * On a machine without a CUDA device, or with RENDER_CPU set, nothing is
+ * uploaded at all: the mesh stays in the shape container and every frame is
+ * drawn on the host by a CPU renderer instead.
+ *
+ * Instances of the mesh are drawn by the single-device and host paths; a
+ * split or streamed mesh is drawn once, where it is.
+ *
+ * Hidden lines and depth cueing are drawn on the device only. Edges are
+ * hidden by the facets of the models resident on the one device.
+ *
+ * The loaded model is the primary model of a scene. Models added next to it
+ * are always resident on the one device, and only the ones that changed are
+ * transformed and culled again on a frame. A split or streamed primary
+ * model is drawn without its model transform.
+ */
+class RenderSession
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    RenderSession();
+    RenderSession( const RenderSession &session ) = delete;
+
+    ~RenderSession();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    RenderSession &operator=( const RenderSession &session ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void render( GraphicsContext *gc, ViewContext *vc, unsigned int color );
+
+    bool draw(
+        ViewContext *vc,
+        unsigned int width, unsigned int height,
+        unsigned int color, unsigned int background
+    );
+    void download( unsigned int *pixels ) const;
+
+    void upload();
+    void uploadModel( unsigned int model );
+    void invalidate();
+    void unload();
+
+    bool isHostOnly() const;
+    bool isMultiDevice() const;
+    bool isOutOfCore() const;
+    bool canStream( unsigned int facetCount ) const;
+
+    int pick( const ViewContext *vc, int x, int y ) const;
+    void buildLevelsOfDetail();
+
+    void setBackFaceCulling( bool enabled );
+    bool isBackFaceCulling() const;
+
+    void setHiddenLines( bool enabled );
+    bool isHiddenLines() const;
+
+    void setDepthCueing( bool enabled );
+    bool isDepthCueing() const;
+
+    void setInteractive( bool interactive );
+    bool isInteractive() const;
+
+    ShapeContainer &getShapes();
+    const ShapeContainer &getShapes() const;
+
+    Scene &getScene();
+    const Scene &getScene() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    Scene scene;
+
+    // the shapes of the primary model
+    ShapeContainer &sc = scene.getModel( 0 ).getShapes();
+
+    Rasterizer raster;
+
+    Culler culler;
+
+    SplitRenderer split;
+
+    // devices an uploaded mesh is split across, or 0 for one device
+    unsigned int splitDeviceCount = 0;
+
+    OutOfCoreRenderer outOfCore;
+    bool outOfCoreForced = false;
+
+    CpuRenderer cpu;
+    bool hostOnly = false;
+
+    // inputs of the frame currently in the framebuffer
+    bool frameValid = false;
+    unsigned long long frameViewVersion = 0;
+    unsigned int frameColor = 0;
+    unsigned int frameBackground = 0;
+    unsigned int frameFacetCount = 0;
+    bool frameStreaming = false;
+    unsigned long long frameInstanceVersion = 0;
+    unsigned long long frameSceneVersion = 0;
+
+    // version of the view transform on the device
+    unsigned long long deviceViewVersion = 0;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool isFrameCurrent( ViewContext *vc, unsigned int color, unsigned int background ) const;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_RENDERSESSION_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,434 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    renderthread.cpp
+ * @brief   Dedicated thread that owns the device and renders the newest view
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cerrno>
+# include <fcntl.h>
+# include <iostream>
+# include <unistd.h>
+
+# include "renderthread.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a render thread with no model loaded and starts it
+ *
+ * @param   void
+ *
+ * @return  The created render thread
+ */
+RenderThread::RenderThread() :
+    view( 0, 0 )
+{
+    if ( pipe( framePipe ) != 0 )
+    {
+        throw RenderThreadException( "Failed to create the frame pipe." );
+    }
+
+    // neither side may ever block on the pipe
+    for ( int fd : framePipe )
+    {
+        fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+    }
+
+    worker = std::thread( &RenderThread::threadLoop, this );
+}
+
+
+/**
+ * @brief   Render thread destructor, waits for the current frame or task to
+ *          finish and frees the device buffers on the render thread
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+RenderThread::~RenderThread()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        stopping = true;
+    }
+
+    wake.notify_one();
+    worker.join();
+
+    close( framePipe[0] );
+    close( framePipe[1] );
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Publishes the newest view state to draw, replacing any state the
+ *          render thread has not picked up yet, only ever to be called by
+ *          the event thread
+ *
+ * @param   &state  The state to draw
+ *
+ * @return  void
+ */
+void RenderThread::publish( const RenderState &state )
+{
+    states.getWriteSlot() = state;
+    states.publish();
+
+    notify();
+}
+
+
+/**
+ * @brief   Posts a task to run on the render thread before its next frame
+ *
+ * @param   &task   The task to run, given the render thread
+ *
+ * @return  void
+ */
+void RenderThread::post( const Task &task )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        tasks.push_back( task );
+        wakePending = true;
+    }
+
+    wake.notify_one();
+}
+
+
+/**
+ * @brief   Draws the newest finished frame to a graphics context, only ever
+ *          to be called by the event thread
+ *
+ * @param   *gc     The graphics context to draw to
+ *
+ * @return  True if a frame was drawn, false if none has been finished yet
+ */
+bool RenderThread::present( GraphicsContext *gc )
+{
+    // the pipe only says that something arrived, the mailbox says what
+    char drain[64];
+    while ( read( framePipe[0], drain, sizeof( drain ) ) > 0 );
+
+    frames.fetch();
+
+    const RenderFrame &frame = frames.getReadSlot();
+
+    if ( frame.width == 0 ) return false;
+
+    gc->drawImage( frame.pixels.data(), frame.width, frame.height );
+
+    return true;
+}
+
+
+/**
+ * @brief   Gets the file descriptor that becomes readable when a frame is
+ *          finished, to wait on together with the window's events
+ *
+ * @param   void
+ *
+ * @return  The read end of the frame pipe
+ */
+int RenderThread::getFrameFd() const
+{
+    return framePipe[0];
+}
+
+
+/**
+ * @brief   Takes the bounds a task asked the view to be fitted to, only ever
+ *          to be called by the event thread
+ *
+ * @param   *boundsMin  Set to the smallest coordinates of the box
+ * @param   *boundsMax  Set to the largest coordinates of the box
+ *
+ * @return  True if there were bounds to fit to, false otherwise
+ */
+bool RenderThread::takeViewFit( float *boundsMin, float *boundsMax )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+
+    if ( !fitPending ) return false;
+
+    for ( unsigned int i = 0; i < 3; i++ )
+    {
+        boundsMin[i] = fitMin[i];
+        boundsMax[i] = fitMax[i];
+    }
+
+    fitPending = false;
+
+    return true;
+}
+
+
+/**
+ * @brief   Draws the newest published state if it changed the frame and
+ *          hands the frame to the event thread, only ever to be called on
+ *          the render thread, e.g. from a task to show progress
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RenderThread::drawLatest()
+{
+    if ( !fetchState() ) return;
+
+    if ( !session->draw( &view, state.width, state.height, state.color, state.background ) ) return;
+
+    RenderFrame &frame = frames.getWriteSlot();
+
+    frame.width = state.width;
+    frame.height = state.height;
+    frame.pixels.resize( ( size_t ) state.width * state.height );
+
+    session->download( frame.pixels.data() );
+
+    frames.publish();
+
+    // a full pipe already has a wakeup in it
+    char signal = 1;
+    if ( write( framePipe[1], &signal, sizeof( signal ) ) < 0 && errno != EAGAIN )
+    {
+        std::cerr << "RenderThread: failed to signal a frame." << std::endl;
+    }
+}
+
+
+/**
+ * @brief   Fits the view to a bounding box, only ever to be called on the
+ *          render thread, e.g. from a task that loaded a model
+ *
+ * The render thread's view is fitted at once so the next frame is drawn
+ * with it, and the event thread is woken to fit its own view the same way,
+ * which it then publishes like any other view change.
+ *
+ * @param   *boundsMin  The smallest coordinates of the box
+ * @param   *boundsMax  The largest coordinates of the box
+ *
+ * @return  void
+ */
+void RenderThread::fitView( const float *boundsMin, const float *boundsMax )
+{
+    // without a window yet there is nothing to fit, the event thread still is
+    if ( fetchState() )
+    {
+        view.frameBounds( boundsMin, boundsMax, ViewContext::DEFAULT_FRAME_FILL );
+
+        // keep the fit until the event thread publishes it back
+        Vector3<float> translation = view.getTranslation();
+        Vector3<float> scale = view.getScale();
+
+        state.translation[0] = translation.getX();
+        state.translation[1] = translation.getY();
+        state.translation[2] = translation.getZ();
+
+        state.scale[0] = scale.getX();
+        state.scale[1] = scale.getY();
+        state.scale[2] = scale.getZ();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+
+        for ( unsigned int i = 0; i < 3; i++ )
+        {
+            fitMin[i] = boundsMin[i];
+            fitMax[i] = boundsMax[i];
+        }
+
+        fitPending = true;
+    }
+
+    char signal = 1;
+    if ( write( framePipe[1], &signal, sizeof( signal ) ) < 0 && errno != EAGAIN )
+    {
+        std::cerr << "RenderThread: failed to signal a view fit." << std::endl;
+    }
+}
+
+
+/**
+ * @brief   Gets the render session, only ever to be used on the render
+ *          thread
+ *
+ * @param   void
+ *
+ * @return  A mutable reference to the render session
+ */
+RenderSession &RenderThread::getSession()
+{
+    return *session;
+}
+
+
+/**
+ * @brief   Gets the view the render thread draws with, only ever to be used
+ *          on the render thread
+ *
+ * @param   void
+ *
+ * @return  A pointer to the render thread's view context
+ */
+ViewContext *RenderThread::getView()
+{
+    return &view;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   The render thread's main loop, runs posted tasks and draws the
+ *          newest state until the render thread is stopped
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RenderThread::threadLoop()
+{
+    // the device buffers are created, used and freed on this thread only
+    RenderSession threadSession;
+    session = &threadSession;
+
+    for ( ;; )
+    {
+        std::deque<Task> pending;
+
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            wake.wait( lock, [this]() { return stopping || wakePending; } );
+
+            if ( stopping ) break;
+
+            wakePending = false;
+            pending.swap( tasks );
+        }
+
+        // tasks see the view the user is looking at, e.g. to pick with it
+        fetchState();
+
+        for ( const Task &task : pending )
+        {
+            // a failed task, like a missing model file, must not stop the thread
+            try
+            {
+                task( *this );
+            }
+            catch ( const std::exception &e )
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+
+        drawLatest();
+    }
+
+    session = nullptr;
+}
+
+
+/**
+ * @brief   Takes the newest published state, if there is one, and applies
+ *          it to the render thread's view and session
+ *
+ * @param   void
+ *
+ * @return  True if there is a state with a window to draw, false otherwise
+ */
+bool RenderThread::fetchState()
+{
+    if ( states.fetch() )
+    {
+        state = states.getReadSlot();
+        hasState = true;
+    }
+
+    if ( !hasState || ( state.width == 0 ) || ( state.height == 0 ) ) return false;
+
+    applyState();
+
+    return true;
+}
+
+
+/**
+ * @brief   Brings the render thread's view and session in line with the
+ *          current state, touching only what changed so an unchanged view
+ *          keeps its version
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RenderThread::applyState()
+{
+    view.setWindowSize( state.width, state.height );
+
+    Vector3<float> translation = view.getTranslation();
+    Vector2<float> rotation = view.getRotation();
+    Vector3<float> scale = view.getScale();
+
+    if ( ( translation.getX() != state.translation[0] ) ||
+         ( translation.getY() != state.translation[1] ) ||
+         ( translation.getZ() != state.translation[2] ) )
+    {
+        view.setTranslation( state.translation[0], state.translation[1], state.translation[2] );
+    }
+
+    if ( ( rotation.getX() != state.rotation[0] ) ||
+         ( rotation.getY() != state.rotation[1] ) )
+    {
+        view.setRotation( state.rotation[0], state.rotation[1] );
+    }
+
+    if ( ( scale.getX() != state.scale[0] ) ||
+         ( scale.getY() != state.scale[1] ) ||
+         ( scale.getZ() != state.scale[2] ) )
+    {
+        view.setScale( state.scale[0], state.scale[1], state.scale[2] );
+    }
+
+    session->setBackFaceCulling( state.backFaceCulling );
+    session->setHiddenLines( state.hiddenLines );
+    session->setDepthCueing( state.depthCueing );
+    session->setInteractive( state.interactive );
+}
+
+
+/**
+ * @brief   Wakes the render thread up for a new state
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RenderThread::notify()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        wakePending = true;
+    }
+
+    wake.notify_one();
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,195 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    renderthread.h
+ * @brief   Dedicated thread that owns the device and renders the newest view
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_RENDERTHREAD_H
+# define GRAPHICS_RENDERTHREAD_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <condition_variable>
+# include <deque>
+# include <functional>
+# include <mutex>
+# include <stdexcept>
+# include <string>
+# include <thread>
+# include <vector>
+
+# include "gcontext.h"
+# include "mailbox.h"
+# include "rendersession.h"
+# include "viewcontext.h"
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * Everything a frame is drawn from that the event thread controls
+ */
+struct RenderState
+{
+    float translation[3] = { 0, 0, 0 };
+    float rotation[2] = { 0, 0 };
+    float scale[3] = { 0, 0, 0 };
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    unsigned int color = 0;
+    unsigned int background = 0;
+
+    bool interactive = false;
+    bool backFaceCulling = false;
+    bool hiddenLines = false;
+    bool depthCueing = false;
+};
+
+
+/**
+ * A finished frame on its way back to the event thread
+ */
+struct RenderFrame
+{
+    std::vector<unsigned int> pixels = std::vector<unsigned int>();
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+};
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class RenderThreadException : public std::runtime_error
+{
+public:
+    explicit RenderThreadException( const std::string& msg ):
+    std::runtime_error( ( std::string( "RenderThread Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/**
+ * The render thread is the only thread that touches the device. It owns the
+ * render session, and with it the CUDA context and every device buffer. The
+ * event thread publishes the newest RenderState through a mailbox and never
+ * waits; the render thread always draws the newest state, skipping any that
+ * were replaced before it got to them, and hands finished frames back
+ * through a second mailbox. A pipe becomes readable when a frame is ready,
+ * so the event loop can wait on it together with the window. Work that
+ * needs the device, like loading a model, is posted as a task and runs on
+ * the render thread between frames. A task that learns where the model is
+ * fits the render thread's view to it right away, and hands the bounds to
+ * the event thread to fit its own view the same way.
+ */
+class RenderThread
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ------------------------------- Types -------------------------------- */
+
+
+    typedef std::function<void( RenderThread &renderer )> Task;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    RenderThread();
+    RenderThread( const RenderThread &renderer ) = delete;
+
+    ~RenderThread();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    RenderThread &operator=( const RenderThread &renderer ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    // event thread
+    void publish( const RenderState &state );
+    void post( const Task &task );
+
+    bool present( GraphicsContext *gc );
+    int getFrameFd() const;
+    bool takeViewFit( float *boundsMin, float *boundsMax );
+
+    // render thread
+    void drawLatest();
+    void fitView( const float *boundsMin, const float *boundsMax );
+
+    RenderSession &getSession();
+    ViewContext *getView();
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    Mailbox<RenderState> states;
+    Mailbox<RenderFrame> frames;
+
+    // read end becomes readable when a frame is published
+    int framePipe[2] = { -1, -1 };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Task> tasks = std::deque<Task>();
+    bool wakePending = false;
+    bool stopping = false;
+
+    // bounds the event thread's view is to be fitted to
+    bool fitPending = false;
+    float fitMin[3] = { 0, 0, 0 };
+    float fitMax[3] = { 0, 0, 0 };
+
+    // only touched by the render thread
+    RenderSession * session = nullptr;
+    ViewContext view;
+    RenderState state = RenderState();
+    bool hasState = false;
+
+    std::thread worker;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void threadLoop();
+    bool fetchState();
+    void applyState();
+    void notify();
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_RENDERTHREAD_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,609 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    scene.cpp
+ * @brief   Several models, each placed, colored and shown on its own
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <limits>
+
+# include "scene.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty scene model
+ *
+ * @param   &name   The name of the model, usually the file it came from
+ *
+ * @return  The created scene model
+ */
+SceneModel::SceneModel( const std::string &name ) :
+    name( name )
+{
+
+}
+
+
+/**
+ * @brief   Scene model destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+SceneModel::~SceneModel() = default;
+
+
+/**
+ * @brief   Creates a scene with an empty primary model
+ *
+ * @param   void
+ *
+ * @return  The created scene
+ */
+Scene::Scene()
+{
+    models.emplace_back( new SceneModel( "" ) );
+}
+
+
+/**
+ * @brief   Scene destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+Scene::~Scene() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Transforms and culls the model again, only if anything it was
+ *          culled with has changed
+ *
+ * Instances have nothing cached, they are culled as they are drawn.
+ *
+ * @param   *vc             The view context to draw with
+ * @param   &raster         The rasterizer the model will be drawn into
+ * @param   cullBackFaces   True to cull back-facing facets
+ *
+ * @return  True if a transform was pushed to the device, false otherwise
+ */
+bool SceneModel::update( const ViewContext *vc, Rasterizer &raster, bool cullBackFaces )
+{
+    if ( !isDrawable() ) return false;
+
+    const Mesh &mesh = sc.getMesh();
+
+    Mat4f transform = vc->transform * modelTransform;
+
+    culler.setBackFaceCulling( cullBackFaces );
+
+    if ( sc.getInstanceCount() > 0 ) return false;
+
+    // while adapting, draw the coarsest level that still has enough detail
+    unsigned int level = sc.isAdaptiveDetail() ? sc.selectLevelOfDetail( transform ) : 0;
+
+    unsigned int width = raster.getWidth();
+    unsigned int height = raster.getHeight();
+
+    bool pushed = false;
+
+    if ( !isCacheCurrent( vc, level, width, height, cullBackFaces ) )
+    {
+        ShapeContainer::pushTransform( transform );
+        pushed = true;
+
+        survivorCount = sc.transformAndCull( transform, level, width, height, culler, &survivorFacets );
+
+        cacheValid = true;
+        cacheViewVersion = vc->getVersion();
+        cacheTransformVersion = transformVersion;
+        cacheLevel = level;
+        cacheWidth = width;
+        cacheHeight = height;
+        cacheFacetCount = mesh.getDeviceFacetCount();
+        cacheStreaming = mesh.isStreaming();
+        cacheBackFaces = cullBackFaces;
+    }
+
+    return pushed;
+}
+
+
+/**
+ * @brief   Draws the facets of the model into the depth buffer of a
+ *          rasterizer, if it has hidden lines on
+ *
+ * The model must have been updated for this frame first.
+ *
+ * @param   *vc         The view context to draw with
+ * @param   &raster     The rasterizer to draw into
+ *
+ * @return  void
+ */
+void SceneModel::drawDepth( const ViewContext *vc, Rasterizer &raster ) const
+{
+    if ( !isDrawable() || !raster.isHiddenLines() ) return;
+
+    if ( sc.getInstanceCount() > 0 )
+    {
+        sc.drawInstanceDepth( vc->transform * modelTransform, raster );
+        return;
+    }
+
+    if ( cacheValid ) sc.rasterizeDepth( cacheLevel, raster );
+}
+
+
+/**
+ * @brief   Draws the edges of the model into a rasterizer
+ *
+ * The model must have been updated for this frame first. Only the cached
+ * survivors are rasterized; instances are placed by the model transform
+ * too, and are drawn in full on every frame.
+ *
+ * @param   *vc         The view context to draw with
+ * @param   &raster     The rasterizer to draw into
+ * @param   color       The 24-bit RGB color the scene is drawn with
+ *
+ * @return  void
+ */
+void SceneModel::drawEdges( const ViewContext *vc, Rasterizer &raster, unsigned int color )
+{
+    if ( !isDrawable() ) return;
+
+    unsigned int drawColor = getColor( color );
+
+    if ( sc.getInstanceCount() > 0 )
+    {
+        sc.draw( vc->transform * modelTransform, raster, culler, drawColor );
+        return;
+    }
+
+    if ( cacheValid ) sc.rasterize( cacheLevel, raster, culler, survivorCount, survivorFacets, drawColor );
+}
+
+
+/**
+ * @brief   Widens a device-space depth range to take in the model, if it is
+ *          shown
+ *
+ * @param   *vc         The view context to draw with
+ * @param   &nearZ      The nearest depth so far
+ * @param   &farZ       The farthest depth so far
+ *
+ * @return  void
+ */
+void SceneModel::expandDepthRange( const ViewContext *vc, float &nearZ, float &farZ ) const
+{
+    if ( !visible ) return;
+
+    sc.expandDepthRange( vc->transform * modelTransform, nearZ, farZ );
+}
+
+
+/**
+ * @brief   Forces the next draw to transform and cull the model again, for
+ *          changes to the mesh that do not change its facet count
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void SceneModel::invalidate()
+{
+    cacheValid = false;
+    version++;
+}
+
+
+/**
+ * @brief   Sets the transform that places the model in the world
+ *
+ * @param   &transform  The transform from model space to world space
+ *
+ * @return  void
+ */
+void SceneModel::setTransform( const Mat4f &transform )
+{
+    if ( transform == modelTransform ) return;
+
+    modelTransform = transform;
+    transformVersion++;
+    version++;
+}
+
+
+/**
+ * @brief   Gets the transform that places the model in the world
+ *
+ * @param   void
+ *
+ * @return  The transform from model space to world space
+ */
+const Mat4f &SceneModel::getTransform() const
+{
+    return modelTransform;
+}
+
+
+/**
+ * @brief   Sets the color of the model
+ *
+ * @param   color   The 24-bit RGB color to draw the model with, or
+ *                  USE_SCENE_COLOR to draw it with the scene's color
+ *
+ * @return  void
+ */
+void SceneModel::setColor( unsigned int color )
+{
+    if ( color == this->color ) return;
+
+    this->color = color;
+    version++;
+}
+
+
+/**
+ * @brief   Gets the color the model is drawn with
+ *
+ * @param   sceneColor  The 24-bit RGB color the scene is drawn with
+ *
+ * @return  The 24-bit RGB color of the model
+ */
+unsigned int SceneModel::getColor( unsigned int sceneColor ) const
+{
+    return ( color == USE_SCENE_COLOR ) ? sceneColor : color;
+}
+
+
+/**
+ * @brief   Sets whether the model is drawn
+ *
+ * @param   visible     True to draw the model, false to hide it
+ *
+ * @return  void
+ */
+void SceneModel::setVisible( bool visible )
+{
+    if ( visible == this->visible ) return;
+
+    this->visible = visible;
+    version++;
+}
+
+
+/**
+ * @brief   Determines if the model is drawn
+ *
+ * @param   void
+ *
+ * @return  True if the model is drawn, false if it is hidden
+ */
+bool SceneModel::isVisible() const
+{
+    return visible;
+}
+
+
+/**
+ * @brief   Gets the name of the model
+ *
+ * @param   void
+ *
+ * @return  The name of the model
+ */
+const std::string &SceneModel::getName() const
+{
+    return name;
+}
+
+
+/**
+ * @brief   Gets a version number that changes whenever the model looks
+ *          different, not counting its facets on the device
+ *
+ * @param   void
+ *
+ * @return  The version of the model
+ */
+unsigned long long SceneModel::getVersion() const
+{
+    return version + sc.getInstanceVersion();
+}
+
+
+/**
+ * @brief   Gets the shape container of the model
+ *
+ * @param   void
+ *
+ * @return  A mutable reference to the shape container
+ */
+ShapeContainer &SceneModel::getShapes()
+{
+    return sc;
+}
+
+
+/**
+ * @brief   Gets the shape container of the model
+ *
+ * @param   void
+ *
+ * @return  An immutable reference to the shape container
+ */
+const ShapeContainer &SceneModel::getShapes() const
+{
+    return sc;
+}
+
+
+/**
+ * @brief   Draws every visible model of the scene into a rasterizer
+ *
+ * Only the models that changed since the last frame, or that the view
+ * change affects, are transformed and culled again. The others only have
+ * their cached survivors rasterized. With hidden lines on, every model is
+ * drawn into the depth buffer before any model's edges.
+ *
+ * @param   *vc             The view context to draw with
+ * @param   &raster         The rasterizer to draw into
+ * @param   cullBackFaces   True to cull back-facing facets
+ * @param   color           The 24-bit RGB color to draw models without a
+ *                          color of their own with
+ * @param   firstModel      The index of the first model to draw, 1 if the
+ *                          primary model is drawn elsewhere
+ *
+ * @return  True if a transform was pushed to the device, false otherwise
+ */
+bool Scene::draw(
+    const ViewContext *vc, Rasterizer &raster,
+    bool cullBackFaces, unsigned int color,
+    unsigned int firstModel
+)
+{
+    bool pushed = false;
+
+    for ( unsigned int model = firstModel; model < models.size(); model++ )
+    {
+        if ( models[model]->update( vc, raster, cullBackFaces ) ) pushed = true;
+    }
+
+    // every facet hides the edges behind it, whichever model either is in
+    if ( raster.isHiddenLines() )
+    {
+        for ( unsigned int model = firstModel; model < models.size(); model++ )
+        {
+            models[model]->drawDepth( vc, raster );
+        }
+    }
+
+    for ( unsigned int model = firstModel; model < models.size(); model++ )
+    {
+        models[model]->drawEdges( vc, raster, color );
+    }
+
+    return pushed;
+}
+
+
+/**
+ * @brief   Gets the device-space depths the shown models of the scene lie
+ *          between
+ *
+ * @param   *vc         The view context to draw with
+ * @param   &nearZ      Set to the depth of the nearest corner of any model
+ * @param   &farZ       Set to the depth of the farthest corner of any model
+ *
+ * @return  True if any model has vertices, false otherwise
+ */
+bool Scene::getDepthRange( const ViewContext *vc, float &nearZ, float &farZ ) const
+{
+    nearZ = std::numeric_limits<float>::infinity();
+    farZ = -std::numeric_limits<float>::infinity();
+
+    for ( const std::unique_ptr<SceneModel> &model : models )
+    {
+        model->expandDepthRange( vc, nearZ, farZ );
+    }
+
+    return nearZ <= farZ;
+}
+
+
+/**
+ * @brief   Forces the next draw to transform and cull every model again
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Scene::invalidate()
+{
+    for ( const std::unique_ptr<SceneModel> &model : models ) model->invalidate();
+}
+
+
+/**
+ * @brief   Adds an empty model to the scene, drawn after the others
+ *
+ * @param   &name   The name of the model, usually the file it came from
+ *
+ * @return  The index of the added model
+ */
+unsigned int Scene::addModel( const std::string &name )
+{
+    models.emplace_back( new SceneModel( name ) );
+    version++;
+
+    return models.size() - 1;
+}
+
+
+/**
+ * @brief   Removes a model from the scene and frees its device buffers, the
+ *          models after it move down by one
+ *
+ * @param   model   The index of the model to remove
+ *
+ * @return  void
+ */
+void Scene::removeModel( unsigned int model )
+{
+    if ( model >= models.size() ) throw SceneException( "Model index out of range." );
+    if ( model == 0 ) throw SceneException( "The primary model cannot be removed." );
+
+    // keep the changes of the removed model counted, so the sum never repeats
+    version += models[model]->getVersion() + 1;
+
+    models.erase( models.begin() + model );
+}
+
+
+/**
+ * @brief   Empties the primary model and removes every other one
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Scene::clear()
+{
+    while ( models.size() > 1 ) removeModel( models.size() - 1 );
+
+    SceneModel &primary = *models[0];
+
+    primary.getShapes().erase();
+    primary.setTransform( Mat4f::identity() );
+    primary.setColor( SceneModel::USE_SCENE_COLOR );
+    primary.setVisible( true );
+    primary.invalidate();
+}
+
+
+/**
+ * @brief   Gets a model of the scene
+ *
+ * @param   model   The index of the model, 0 for the primary one
+ *
+ * @return  A mutable reference to the model
+ */
+SceneModel &Scene::getModel( unsigned int model )
+{
+    if ( model >= models.size() ) throw SceneException( "Model index out of range." );
+
+    return *models[model];
+}
+
+
+/**
+ * @brief   Gets a model of the scene
+ *
+ * @param   model   The index of the model, 0 for the primary one
+ *
+ * @return  An immutable reference to the model
+ */
+const SceneModel &Scene::getModel( unsigned int model ) const
+{
+    if ( model >= models.size() ) throw SceneException( "Model index out of range." );
+
+    return *models[model];
+}
+
+
+/**
+ * @brief   Gets the number of models in the scene
+ *
+ * @param   void
+ *
+ * @return  The number of models, at least 1
+ */
+unsigned int Scene::getModelCount() const
+{
+    return models.size();
+}
+
+
+/**
+ * @brief   Gets a version number that changes whenever a model is added,
+ *          removed or changed
+ *
+ * @param   void
+ *
+ * @return  The version of the scene
+ */
+unsigned long long Scene::getVersion() const
+{
+    unsigned long long sceneVersion = version;
+
+    for ( const std::unique_ptr<SceneModel> &model : models ) sceneVersion += model->getVersion();
+
+    return sceneVersion;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Determines if the model is shown and has been pushed to the
+ *          device
+ *
+ * @param   void
+ *
+ * @return  True if the model can be drawn, false otherwise
+ */
+bool SceneModel::isDrawable() const
+{
+    const Mesh &mesh = sc.getMesh();
+
+    return visible && mesh.isOnDevice() && ( mesh.getDeviceVertexCount() > 0 );
+}
+
+
+/**
+ * @brief   Determines if the survivors in the culler were culled with the
+ *          current inputs
+ *
+ * @param   *vc             The view context to draw with
+ * @param   level           The level of detail to draw
+ * @param   width           The width of the window in pixels
+ * @param   height          The height of the window in pixels
+ * @param   cullBackFaces   True if back-facing facets are culled
+ *
+ * @return  True if the survivors can be rasterized as they are, false
+ *          otherwise
+ */
+bool SceneModel::isCacheCurrent(
+    const ViewContext *vc, unsigned int level,
+    unsigned int width, unsigned int height, bool cullBackFaces
+) const
+{
+    const Mesh &mesh = sc.getMesh();
+
+    return cacheValid &&
+           ( cacheViewVersion == vc->getVersion() ) &&
+           ( cacheTransformVersion == transformVersion ) &&
+           ( cacheLevel == level ) &&
+           ( cacheWidth == width ) &&
+           ( cacheHeight == height ) &&
+           ( cacheFacetCount == mesh.getDeviceFacetCount() ) &&
+           ( cacheStreaming == mesh.isStreaming() ) &&
+           ( cacheBackFaces == cullBackFaces );
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,234 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    scene.h
+ * @brief   Several models, each placed, colored and shown on its own
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_SCENE_H
+# define GRAPHICS_SCENE_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <memory>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include "culler.h"
+# include "mat4f.h"
+# include "rasterizer.h"
+# include "shapecontainer.h"
+# include "viewcontext.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class SceneException : public std::runtime_error
+{
+public:
+    explicit SceneException( const std::string& msg ):
+    std::runtime_error( ( std::string( "Scene Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/**
+ * A scene model is one mesh in a scene, with its own model transform, color
+ * and visibility. It keeps its own device-space vertex buffer and culling
+ * survivors, so a frame in which nothing about the model changed only
+ * rasterizes the edges that survived last time. The model is transformed
+ * and culled again only once the view, its model transform, its level of
+ * detail, the window size, back-face culling or its facets on the device
+ * have changed. A hidden model costs nothing and keeps what it had cached.
+ *
+ * A model is drawn in three steps, so that with hidden lines on the facets
+ * of every model in a scene are in the depth buffer before any edges are
+ * drawn: update, drawDepth, then drawEdges.
+ */
+class SceneModel
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // draw with the color the scene is drawn with
+    static constexpr unsigned int USE_SCENE_COLOR = 0xFFFFFFFF;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit SceneModel( const std::string &name );
+    SceneModel( const SceneModel &model ) = delete;
+
+    ~SceneModel();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    SceneModel &operator=( const SceneModel &model ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool update( const ViewContext *vc, Rasterizer &raster, bool cullBackFaces );
+    void drawDepth( const ViewContext *vc, Rasterizer &raster ) const;
+    void drawEdges( const ViewContext *vc, Rasterizer &raster, unsigned int color );
+    void expandDepthRange( const ViewContext *vc, float &nearZ, float &farZ ) const;
+    void invalidate();
+
+    void setTransform( const Mat4f &transform );
+    const Mat4f &getTransform() const;
+
+    void setColor( unsigned int color );
+    unsigned int getColor( unsigned int sceneColor ) const;
+
+    void setVisible( bool visible );
+    bool isVisible() const;
+
+    const std::string &getName() const;
+    unsigned long long getVersion() const;
+
+    ShapeContainer &getShapes();
+    const ShapeContainer &getShapes() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::string name;
+
+    ShapeContainer sc = ShapeContainer();
+
+    Culler culler;
+
+    Mat4f modelTransform = Mat4f::identity();
+    unsigned int color = USE_SCENE_COLOR;
+    bool visible = true;
+
+    // bumped on every change that changes what the model looks like
+    unsigned long long version = 0;
+
+    // inputs of the survivors currently in the culler
+    bool cacheValid = false;
+    unsigned long long cacheViewVersion = 0;
+    unsigned long long cacheTransformVersion = 0;
+    unsigned int cacheLevel = 0;
+    unsigned int cacheWidth = 0;
+    unsigned int cacheHeight = 0;
+    unsigned int cacheFacetCount = 0;
+    bool cacheStreaming = false;
+    bool cacheBackFaces = false;
+
+    unsigned long long transformVersion = 0;
+
+    unsigned int survivorCount = 0;
+    bool survivorFacets = false;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool isDrawable() const;
+    bool isCacheCurrent(
+        const ViewContext *vc, unsigned int level,
+        unsigned int width, unsigned int height, bool cullBackFaces
+    ) const;
+
+
+    /* ====================================================================== */
+};
+
+
+/**
+ * A scene holds every model that is drawn into a frame. The first model is
+ * the primary one, the one a file is opened into; it is always there and
+ * only ever emptied. Models added next to it are drawn in the order they
+ * were added.
+ */
+class Scene
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    Scene();
+    Scene( const Scene &scene ) = delete;
+
+    ~Scene();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    Scene &operator=( const Scene &scene ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool draw(
+        const ViewContext *vc, Rasterizer &raster,
+        bool cullBackFaces, unsigned int color,
+        unsigned int firstModel
+    );
+    void invalidate();
+
+    bool getDepthRange( const ViewContext *vc, float &nearZ, float &farZ ) const;
+
+    unsigned int addModel( const std::string &name );
+    void removeModel( unsigned int model );
+    void clear();
+
+    SceneModel &getModel( unsigned int model );
+    const SceneModel &getModel( unsigned int model ) const;
+    unsigned int getModelCount() const;
+
+    unsigned long long getVersion() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::vector<std::unique_ptr<SceneModel>> models = std::vector<std::unique_ptr<SceneModel>>();
+
+    // bumped whenever a model is added or removed
+    unsigned long long version = 0;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_SCENE_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -3,7 +3,7 @@
 
 /**
  * @file    shapecontainer.cpp
- * @brief   Set container of shape pointers
+ * @brief   Set container of shape pointers backed by an indexed mesh
  */
 
 
@@ -11,24 +11,88 @@
 
 
 # include <algorithm>
-# include <chrono>
+# include <cmath>
 # include <set>
 # include <sstream>
+# include <stdexcept>
+# include <utility>
 # include <driver_types.h>
 
 # include "cudaerr.cuh"
+# include "frameprofiler.h"
+# include "meshsimplifier.h"
 # include "shape.h"
 # include "shapecontainer.h"
-# include "triangle.h"
 
 
-/* ----------------------- Constructors / Destructors ----------------------- */
+/* -------------------------------- Constants ------------------------------- */
 
 
-const unsigned int SHAPE_DIM = 3;
 const unsigned int VERT_DIM = 4;
 
 
+/* ---------------------------- Device Constants ---------------------------- */
+
+
+// the view transform, read by every thread of applyViewTransform at once
+__constant__ Mat4f c_viewTransform;
+
+
+/* ---------------------------- Static Variables ---------------------------- */
+
+
+// applyViewTransform block size, from the occupancy calculator on first use
+static int transformBlockSize = 0;
+
+
+/* ---------------------------- Helper Functions ---------------------------- */
+
+
+/**
+ * @brief   Determines if any part of a transformed bounding box can reach
+ *          the window
+ *
+ * @param   &transform  The transform from model space to device space
+ * @param   *boundsMin  The smallest model-space coordinates of the box
+ * @param   *boundsMax  The largest model-space coordinates of the box
+ * @param   width       The width of the window in pixels
+ * @param   height      The height of the window in pixels
+ *
+ * @return  False if all eight corners are past the same side of the window,
+ *          true otherwise
+ */
+static bool isBoxInWindow(
+    const Mat4f &transform,
+    const float *boundsMin, const float *boundsMax,
+    unsigned int width, unsigned int height
+)
+{
+    bool left = true;
+    bool right = true;
+    bool above = true;
+    bool below = true;
+
+    for ( unsigned int corner = 0; corner < 8; corner++ )
+    {
+        Vec4f point = { {
+            ( corner & 1 ) ? boundsMax[0] : boundsMin[0],
+            ( corner & 2 ) ? boundsMax[1] : boundsMin[1],
+            ( corner & 4 ) ? boundsMax[2] : boundsMin[2],
+            1
+        } };
+
+        Vec4f device = transform * point;
+
+        left = left && ( device[0] < 0 );
+        right = right && ( device[0] > width - 1.0f );
+        above = above && ( device[1] < 0 );
+        below = below && ( device[1] > height - 1.0f );
+    }
+
+    return !( left || right || above || below );
+}
+
+
 /* ----------------------- Constructors / Destructors ----------------------- */
 
 
@@ -49,9 +113,34 @@ ShapeContainer::ShapeContainer() = default;
  *
  * @return  The created shape container
  */
-ShapeContainer::ShapeContainer( const ShapeContainer &sc )
+ShapeContainer::ShapeContainer( const ShapeContainer &sc ):
+mesh( sc.mesh ), levels( sc.levels ), adaptiveDetail( sc.adaptiveDetail ),
+instanceTransforms( sc.instanceTransforms ), instanceColors( sc.instanceColors ),
+instanceVersion( sc.instanceVersion )
+{
+    cloneShapes( sc );
+}
+
+
+/**
+ * @brief   Creates a shape container that takes over the shapes, mesh,
+ *          levels of detail and instances of another shape container,
+ *          leaving it empty
+ *
+ * Like a copy, the created shape container has to be pushed to the device
+ * before it is drawn.
+ *
+ * @param   &&sc    The shape container to move from
+ *
+ * @return  The created shape container
+ */
+ShapeContainer::ShapeContainer( ShapeContainer &&sc ) noexcept:
+shapes( std::move( sc.shapes ) ), arena( std::move( sc.arena ) ),
+mesh( std::move( sc.mesh ) ), levels( std::move( sc.levels ) ), adaptiveDetail( sc.adaptiveDetail ),
+instanceTransforms( std::move( sc.instanceTransforms ) ), instanceColors( std::move( sc.instanceColors ) ),
+instanceVersion( sc.instanceVersion )
 {
-    add( sc );
+    sc.erase();
 }
 
 
@@ -64,11 +153,7 @@ ShapeContainer::ShapeContainer( const ShapeContainer &sc )
  */
 ShapeContainer::~ShapeContainer()
 {
-    std::for_each( shapes.begin(), shapes.end(), [this]( Shape *shape )
-       {
-           delete shape;
-       }
-    );
+    freeDevice();
 }
 
 
@@ -85,8 +170,43 @@ ShapeContainer::~ShapeContainer()
  */
 ShapeContainer &ShapeContainer::operator=( const ShapeContainer &sc )
 {
+    if ( this == &sc ) return *this;
+
+    erase();
+    cloneShapes( sc );
+    mesh = sc.mesh;
+    levels = sc.levels;
+    adaptiveDetail = sc.adaptiveDetail;
+    instanceTransforms = sc.instanceTransforms;
+    instanceColors = sc.instanceColors;
+    instanceVersion++;
+    return *this;
+}
+
+
+/**
+ * @brief   Moves the shapes, mesh, levels of detail and instances of another
+ *          shape container into this shape container, leaving it empty
+ *
+ * @param   &&sc    The shape container to move from
+ *
+ * @return  This shape container
+ */
+ShapeContainer &ShapeContainer::operator=( ShapeContainer &&sc ) noexcept
+{
+    if ( this == &sc ) return *this;
+
     erase();
-    add( sc );
+    shapes = std::move( sc.shapes );
+    arena = std::move( sc.arena );
+    mesh = std::move( sc.mesh );
+    levels = std::move( sc.levels );
+    adaptiveDetail = sc.adaptiveDetail;
+    instanceTransforms = std::move( sc.instanceTransforms );
+    instanceColors = std::move( sc.instanceColors );
+    instanceVersion++;
+
+    sc.erase();
     return *this;
 }
 
@@ -112,73 +232,127 @@ std::ostream &operator<<( std::ostream &os, const ShapeContainer &sc )
 
 /**
  * Pushes this shape container to the GPU device
+ *
+ * The mesh is uploaded in a single transfer, a device-space vertex buffer
+ * is allocated to match and the facet hierarchy is built on the device.
  */
 void ShapeContainer::pushToDevice()
 {
     // free existing device mallocs if they exist
-    if ( d_inputShapes != nullptr)
-    {
-        HANDLE_CUDA_ERROR(cudaFree(d_inputShapes));
-    }
-    if ( d_outputShapes != nullptr)
-    {
-        HANDLE_CUDA_ERROR(cudaFree(d_outputShapes));
-    }
+    freeDevice();
+
+    // push the mesh and its levels of detail
+    mesh.pushToDevice();
 
-    // malloc new input and output
+    for ( Mesh &level : levels ) level.pushToDevice();
+
+    // nothing to transform
+    if ( !mesh.isOnDevice() ) return;
+
+    size_t bufferSize = ( size_t ) mesh.getDeviceVertexStride() * Mesh::COORD_DIM * sizeof( float );
+
+    // malloc device-space output
     HANDLE_CUDA_ERROR(
-        cudaMalloc(&d_inputShapes, shapes.size() * SHAPE_DIM * VERT_DIM * sizeof(float))
+        cudaMalloc( &d_outputVertices, bufferSize )
     );
 
+    bvh.build( mesh );
+}
+
+
+/**
+ * @brief   Starts streaming this shape container's mesh to the GPU device
+ *          while it is being built
+ *
+ * The device-space vertex buffer is sized for the worst case, so facets
+ * can be drawn as soon as their batch has landed.
+ *
+ * @param   facetCapacity   The total number of facets the mesh will hold
+ *
+ * @return  void
+ */
+void ShapeContainer::beginStream( unsigned int facetCapacity )
+{
+    // free existing device mallocs if they exist
+    freeDevice();
+
+    mesh.beginStream( facetCapacity );
+
+    size_t bufferSize = ( size_t ) mesh.getDeviceVertexStride() * Mesh::COORD_DIM * sizeof( float );
+
+    if ( bufferSize == 0 ) return;
+
+    // malloc device-space output
     HANDLE_CUDA_ERROR(
-        cudaMalloc(&d_outputShapes, shapes.size() * SHAPE_DIM * VERT_DIM * sizeof(float))
+        cudaMalloc( &d_outputVertices, bufferSize )
     );
+}
 
-    // copy each tri to input memory
-    for (unsigned int shapeIdx = 0; shapeIdx < shapes.size(); shapeIdx++)
-    {
 
-        float shape[SHAPE_DIM][VERT_DIM];
-        unsigned int shapeOffset = shapeIdx * SHAPE_DIM * VERT_DIM;
+/**
+ * @brief   Queues the facets added since the last call for upload
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeContainer::streamPending()
+{
+    mesh.streamPending();
+}
 
-        for (unsigned int vertIdx = 0; vertIdx < SHAPE_DIM; vertIdx++)
-        {
-            for (unsigned int coordIdx = 0; coordIdx < VERT_DIM; coordIdx++)
-            {
-                if (coordIdx < VERT_DIM - 1)
-                {
-                    shape[vertIdx][coordIdx] = (*(shapes[shapeIdx]))[vertIdx][coordIdx];
-                }
-                else
-                {
-                    shape[vertIdx][coordIdx] = 1;
-                }
-            }
-        }
 
-        HANDLE_CUDA_ERROR(
-            cudaMemcpy(
-                (void *) (d_inputShapes + shapeOffset),
-                (void *) shape,
-                SHAPE_DIM * VERT_DIM * sizeof(float),
-                cudaMemcpyHostToDevice
-            )
-        );
+/**
+ * @brief   Finishes streaming, switches to the deduplicated edge list and
+ *          builds the facet hierarchy
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeContainer::endStream()
+{
+    if ( !mesh.isStreaming() ) return;
 
-    }
+    freeDevice();
+
+    mesh.endStream();
+
+    // nothing to transform
+    if ( !mesh.isOnDevice() ) return;
+
+    size_t bufferSize = ( size_t ) mesh.getDeviceVertexStride() * Mesh::COORD_DIM * sizeof( float );
+
+    // malloc device-space output
+    HANDLE_CUDA_ERROR(
+        cudaMalloc( &d_outputVertices, bufferSize )
+    );
+
+    bvh.build( mesh );
 }
 
 
 /**
  * @brief   Adds a shape to this shape container
  *
+ * Only the mesh is drawn, so the shape must be a facet. Lines are drawn on
+ * their own, as overlays.
+ *
  * @param   &shape  The shape to add
  *
  * @return  void
  */
 void ShapeContainer::add( const Shape &shape )
 {
-    shapes.insert( shapes.end(), shape.clone() );
+    if ( shape.getVertexCount() != 3 )
+    {
+        throw ShapeException( "Only triangles can be added to a shape container, got a shape with "
+                              + std::to_string( shape.getVertexCount() ) + " vertices." );
+    }
+
+    shapes.insert( shapes.end(), shape.clone( arena ) );
+    mesh.addFacet( shape[0], shape[1], shape[2] );
+    levels.clear();
 }
 
 
@@ -192,192 +366,995 @@ void ShapeContainer::add( const Shape &shape )
  */
 void ShapeContainer::add( const ShapeContainer &sc )
 {
-    std::for_each( sc.shapes.begin(), sc.shapes.end(), [this]( Shape *shape )
-       {
-           add( *shape );
-       }
-    );
+    cloneShapes( sc );
+    mesh.append( sc.mesh );
+    levels.clear();
+}
+
+
+/**
+ * @brief   Adds a facet to this shape container's mesh without creating a
+ *          shape object for it
+ *
+ * @param   &a  The first vertex of the facet
+ * @param   &b  The second vertex of the facet
+ * @param   &c  The third vertex of the facet
+ *
+ * @return  void
+ */
+void ShapeContainer::addFacet( const Point3D &a, const Point3D &b, const Point3D &c )
+{
+    mesh.addFacet( a, b, c );
+    levels.clear();
 }
 
 
 /**
  * @brief   Draws the shapes in this shape container
  *
- * @param   *gc     The graphics context to draw to
+ * The mesh is transformed and its unique edges rasterized on the device,
+ * nothing is copied back to the host. The view transform must already have
+ * been pushed with pushViewTransform. Edges that cannot reach the window are
+ * culled and compacted away before rasterization. While the mesh is
+ * streaming, or when back faces are culled, facets are culled instead and
+ * drawn edge by facet edge. With adaptive detail on, a simplified level of
+ * detail is drawn when the model is small on screen. The full mesh is first
+ * narrowed down to the facets the hierarchy finds in the window, and once
+ * their edges are fewer than the unique edges, they are drawn instead. If
+ * the mesh has instances, every visible instance is drawn instead of the
+ * mesh itself.
+ *
  * @param   *vc     The view context to draw with
+ * @param   &raster The rasterizer to draw into
+ * @param   &culler The culler to cull edges and facets with
+ * @param   color   The 24-bit RGB color to draw with
+ *
+ * @return  void
+ */
+void ShapeContainer::draw( ViewContext *vc, Rasterizer &raster, Culler &culler, unsigned int color ) const
+{
+    draw( vc->transform, raster, culler, color );
+}
+
+
+/**
+ * @brief   Draws the shapes in this shape container with a transform from
+ *          model space straight to device space
+ *
+ * This is draw with a view context, for a mesh placed in the world by a
+ * model transform of its own. The transform must already have been pushed
+ * with pushTransform. Only edges are drawn; hidden lines are left to the
+ * caller, which draws the depth of everything in the frame first.
+ *
+ * @param   &transform  The transform from model space to device space
+ * @param   &raster     The rasterizer to draw into
+ * @param   &culler     The culler to cull edges and facets with
+ * @param   color       The 24-bit RGB color to draw with
  *
  * @return  void
  */
-void ShapeContainer::draw( GraphicsContext *gc, ViewContext *vc ) const
+void ShapeContainer::draw( const Mat4f &transform, Rasterizer &raster, Culler &culler, unsigned int color ) const
 {
-    auto drawStartTime = std::chrono::high_resolution_clock::now();
+    // nothing has been pushed to the device
+    if ( !mesh.isOnDevice() || ( mesh.getDeviceVertexCount() == 0 ) ) return;
 
-    // copy view transform to local
-    float viewTransform[VERT_DIM][VERT_DIM];
+    // while adapting, draw the coarsest level that still has enough detail
+    unsigned int level = adaptiveDetail ? selectLevelOfDetail( transform ) : 0;
 
-    for (unsigned int row = 0; row < VERT_DIM; row++)
+    if ( !instanceTransforms.empty() )
     {
-        for (unsigned int col = 0; col < VERT_DIM; col++)
-        {
-            viewTransform[row][col] = ViewContext::transform[row][col];
-        }
+        drawInstances( getLevelOfDetail( level ), transform, raster, culler );
+        return;
     }
 
-    // copy view transform to device
-    HANDLE_CUDA_ERROR(
-        cudaMemcpy(
-            ( void * ) ViewContext::d_viewTransform,
-            ( void * ) viewTransform,
-            VERT_DIM * VERT_DIM * sizeof( float ),
-            cudaMemcpyHostToDevice
-        )
+    bool drawFacets = false;
+    unsigned int elementCount = transformAndCull(
+        transform, level, raster.getWidth(), raster.getHeight(), culler, &drawFacets
     );
 
-    // zero output matrix
-    HANDLE_CUDA_ERROR(
-        cudaMemset(d_outputShapes, 0, shapes.size() * SHAPE_DIM * VERT_DIM * sizeof(float))
-    );
+    rasterize( level, raster, culler, elementCount, drawFacets, color );
+}
 
-    // run GPU kernel
-    unsigned int blocks = ceil(shapes.size() / 1024.0);
 
-    applyViewTransform<<<blocks, 1024>>>(
-        d_inputShapes,
-        d_outputShapes,
-        ViewContext::d_viewTransform
-    );
-    HANDLE_CUDA_ERROR(cudaDeviceSynchronize());
+/**
+ * @brief   Transforms a level of detail to device space and culls the edges
+ *          or facets that cannot reach the window
+ *
+ * This is the first half of draw, without the instances. The survivors stay
+ * in the culler and the device-space vertices in this shape container until
+ * either is used again, so they can be rasterized again on a later frame
+ * without redoing any of this. The transform must already have been pushed
+ * with pushTransform.
+ *
+ * @param   &transform  The transform from model space to device space
+ * @param   level       The level of detail to draw, where 0 is the full mesh
+ * @param   width       The width of the window in pixels
+ * @param   height      The height of the window in pixels
+ * @param   &culler     The culler to cull edges and facets with
+ * @param   *facets     Set to true if the survivors are facets, false if
+ *                      they are edges
+ *
+ * @return  The number of surviving edges or facets
+ */
+unsigned int ShapeContainer::transformAndCull(
+    const Mat4f &transform, unsigned int level,
+    unsigned int width, unsigned int height,
+    Culler &culler, bool *facets
+) const
+{
+    *facets = false;
 
-    // parse output points into output shapes vector
-    std::vector<Shape*> parsedShapes;
+    // nothing has been pushed to the device
+    if ( !mesh.isOnDevice() || ( mesh.getDeviceVertexCount() == 0 ) ) return 0;
 
-    for (unsigned int shapeIdx = 0; shapeIdx < shapes.size(); shapeIdx++)
+    const Mesh &lod = getLevelOfDetail( level );
+
+    unsigned int vertexCount = lod.getDeviceVertexCount();
+
+    // pick the block size that fills a multiprocessor best, once
+    if ( transformBlockSize == 0 )
     {
-        float shape[SHAPE_DIM][VERT_DIM];
-        unsigned int shapeOffset = shapeIdx * SHAPE_DIM * VERT_DIM;
+        int minGridSize;
 
         HANDLE_CUDA_ERROR(
-            cudaMemcpy(
-                (void *) shape,
-                (void *) (d_outputShapes + shapeOffset),
-                SHAPE_DIM * VERT_DIM * sizeof(float),
-                cudaMemcpyDeviceToHost
-            )
+            cudaOccupancyMaxPotentialBlockSize( &minGridSize, &transformBlockSize, applyViewTransform, 0, 0 )
         );
+    }
 
-        Point3D verts[3];
+    // run GPU kernel, one thread per VERTEX_ALIGN consecutive vertices
+    unsigned int groupCount = ( vertexCount + Mesh::VERTEX_ALIGN - 1 ) / Mesh::VERTEX_ALIGN;
+    unsigned int blocks = ( groupCount + transformBlockSize - 1 ) / transformBlockSize;
 
-        for (unsigned int vertIdx = 0; vertIdx < SHAPE_DIM; vertIdx++)
-        {
-            verts[vertIdx].setX(shape[vertIdx][0]);
-            verts[vertIdx].setY(shape[vertIdx][1]);
-            verts[vertIdx].setZ(shape[vertIdx][2]);
-        }
+    ProfileRange transformRange( FrameProfiler::STAGE_TRANSFORM );
+
+    applyViewTransform<<<blocks, transformBlockSize>>>(
+        ( const float4 * ) lod.getDeviceVertices(),
+        ( float4 * ) d_outputVertices,
+        lod.getDeviceVertexStride(),
+        vertexCount
+    );
+    HANDLE_CUDA_ERROR( cudaGetLastError() );
+
+    transformRange.end();
 
-        Triangle * tri = new Triangle(verts[0], verts[1], verts[2]);
-        parsedShapes.insert(parsedShapes.end(), tri);
+    // no unique edge list until the stream ends, and facing is per facet
+    bool drawFacets = lod.isStreaming() || culler.isBackFaceCulling();
+
+    const unsigned int *d_facets = lod.getDeviceIndices();
+    unsigned int facetCount = lod.getDeviceFacetCount();
+
+    ProfileRange cullRange( FrameProfiler::STAGE_CULL );
+
+    if ( ( &lod == &mesh ) && bvh.isBuilt() )
+    {
+        float matrix[VERT_DIM][VERT_DIM];
+        transform.toArray( matrix );
+
+        facetCount = bvh.queryFrustum( mesh, matrix, width, height, &d_facets );
+
+        // zoomed in, the edges of the visible facets beat culling every edge
+        if ( facetCount * Mesh::FACET_DIM < mesh.getEdgeCount() ) drawFacets = true;
     }
 
-    auto transformEndTime = std::chrono::high_resolution_clock::now();
-    double transformTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        transformEndTime - drawStartTime
-    ).count() / 1000000.0;
-    std::cout << "Transform Time: " << transformTime << "ms" << std::endl;
+    *facets = drawFacets;
 
-    // draw shapes
-    std::for_each(parsedShapes.begin(), parsedShapes.end(), [gc](Shape *shape)
-       {
-           shape->draw(gc);
-       }
-    );
+    if ( drawFacets )
+    {
+        return culler.cullFacets(
+            d_outputVertices, lod.getDeviceVertexStride(),
+            d_facets, facetCount,
+            width, height
+        );
+    }
 
-    auto drawEndTime = std::chrono::high_resolution_clock::now();
-    double drawTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        drawEndTime - drawStartTime
-    ).count() / 1000000.0;
-    std::cout << "Total Draw Time: " << drawTime << "ms" << std::endl;
+    // rasterize each unique edge that can reach the window once
+    return culler.cullEdges(
+        d_outputVertices, lod.getDeviceVertexStride(),
+        lod.getDeviceEdges(), lod.getEdgeCount(),
+        width, height
+    );
 }
 
 
 /**
- * @brief   Converts the shapes in this shape container to strings and
- *          outputs them to an output stream
+ * @brief   Rasterizes the edges or facets that survived transformAndCull
  *
- * @param   &os     The output stream to write to
+ * @param   level           The level of detail they were culled from
+ * @param   &raster         The rasterizer to draw into
+ * @param   &culler         The culler holding the survivors
+ * @param   elementCount    The number of surviving edges or facets
+ * @param   facets          True if the survivors are facets, false if they
+ *                          are edges
+ * @param   color           The 24-bit RGB color to draw with
  *
- * @return  The output stream
+ * @return  void
  */
-std::ostream &ShapeContainer::out( std::ostream &os ) const
+void ShapeContainer::rasterize(
+    unsigned int level, Rasterizer &raster, const Culler &culler,
+    unsigned int elementCount, bool facets, unsigned int color
+) const
 {
-    std::for_each( shapes.begin(), shapes.end(), [&os]( Shape *shape )
-       {
-           shape->out( const_cast<std::ostream&>( os ) );
-           os << std::endl;
-       }
-    );
-    return os;
+    if ( elementCount == 0 ) return;
+
+    const Mesh &lod = getLevelOfDetail( level );
+
+    ProfileRange rasterRange( FrameProfiler::STAGE_RASTER );
+
+    if ( facets )
+    {
+        raster.drawFacets(
+            d_outputVertices, lod.getDeviceVertexStride(),
+            culler.getDeviceSurvivors(), elementCount,
+            color
+        );
+    }
+    else
+    {
+        raster.drawEdges(
+            d_outputVertices, lod.getDeviceVertexStride(),
+            culler.getDeviceSurvivors(), elementCount,
+            color
+        );
+    }
 }
 
 
 /**
- * @brief   Removes all shapes from this shape container
+ * @brief   Rasterizes every facet of a level of detail into the depth buffer,
+ *          if hidden lines are on
  *
- * @param   void
+ * Facets are taken from the device-space vertices of the last
+ * transformAndCull, with none culled: a facet off screen or facing away
+ * still hides nothing, but costs only its bounding box test.
+ *
+ * @param   level   The level of detail last transformed, where 0 is the
+ *                  full mesh
+ * @param   &raster The rasterizer to draw into
  *
  * @return  void
  */
-void ShapeContainer::erase()
+void ShapeContainer::rasterizeDepth( unsigned int level, Rasterizer &raster ) const
 {
-    std::for_each( shapes.begin(), shapes.end(), []( Shape *shape )
-       {
-           delete shape;
-       }
+    if ( !raster.isHiddenLines() ) return;
+
+    // nothing has been pushed to the device
+    if ( !mesh.isOnDevice() || ( mesh.getDeviceVertexCount() == 0 ) ) return;
+
+    const Mesh &lod = getLevelOfDetail( level );
+
+    ProfileRange depthRange( FrameProfiler::STAGE_DEPTH );
+
+    raster.drawFacetDepth(
+        d_outputVertices, lod.getDeviceVertexStride(),
+        lod.getDeviceIndices(), lod.getDeviceFacetCount()
     );
-    shapes.clear();
 }
 
 
 /**
- * @brief   Gets the size of the shape container
+ * @brief   Rasterizes the facets of every instance that can reach the window
+ *          into the depth buffer, all in one launch, if hidden lines are on
  *
- * @param   void
+ * This is the depth half of draw for a mesh with instances, so the depth of
+ * several meshes can be drawn before any of their edges. The transform does
+ * not have to be pushed.
  *
- * @return  The size of the shape container
+ * @param   &transform  The transform from model space to device space
+ * @param   &raster     The rasterizer to draw into
+ *
+ * @return  void
  */
-unsigned int ShapeContainer::size()
+void ShapeContainer::drawInstanceDepth( const Mat4f &transform, Rasterizer &raster ) const
 {
-    return shapes.size();
-}
+    if ( !raster.isHiddenLines() || instanceTransforms.empty() ) return;
 
+    // nothing has been pushed to the device
+    if ( !mesh.isOnDevice() || ( mesh.getDeviceVertexCount() == 0 ) ) return;
 
-/* ------------------------------ GPU Kernels ------------------------------- */
+    unsigned int level = adaptiveDetail ? selectLevelOfDetail( transform ) : 0;
+    const Mesh &lod = getLevelOfDetail( level );
 
+    ProfileRange cullRange( FrameProfiler::STAGE_CULL, false );
 
-__global__ void applyViewTransform(
-    float * inputShapes, float * outputShapes, float * viewTransform
-)
+    unsigned int visibleCount = stageInstances( lod, transform, raster );
+
+    cullRange.end();
+
+    ProfileRange depthRange( FrameProfiler::STAGE_DEPTH );
+
+    raster.drawInstanceDepth(
+        lod.getDeviceVertices(), lod.getDeviceVertexStride(),
+        lod.getDeviceIndices(), lod.getDeviceFacetCount(),
+        visibleCount
+    );
+}
+
+
+/**
+ * @brief   Widens a device-space depth range to take in the bounding box of
+ *          the mesh, or of every instance of it if it has any
+ *
+ * @param   &transform  The transform from model space to device space
+ * @param   &nearZ      The nearest depth so far, lowered to the nearest
+ *                      corner
+ * @param   &farZ       The farthest depth so far, raised to the farthest
+ *                      corner
+ *
+ * @return  void
+ */
+void ShapeContainer::expandDepthRange( const Mat4f &transform, float &nearZ, float &farZ ) const
 {
-    unsigned int shapeIdx = blockIdx.x * blockDim.x + threadIdx.x;
-    unsigned int shapeOffset = shapeIdx * SHAPE_DIM * VERT_DIM;
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+    mesh.getBounds( boundsMin, boundsMax );
+
+    // an empty mesh has an inverted box
+    if ( boundsMin[0] > boundsMax[0] ) return;
 
-    // matrix vector multiplication
-    for (unsigned int vertIdx = 0; vertIdx < SHAPE_DIM; vertIdx++)
+    size_t placements = instanceTransforms.empty() ? 1 : instanceTransforms.size();
+
+    for ( size_t i = 0; i < placements; i++ )
     {
-        unsigned int vertOffset = vertIdx * VERT_DIM;
+        Mat4f placed = instanceTransforms.empty() ? transform : transform * instanceTransforms[i];
 
-        for (unsigned int row = 0; row < VERT_DIM; row++)
+        for ( unsigned int corner = 0; corner < 8; corner++ )
         {
+            Vec4f point = { {
+                ( corner & 1 ) ? boundsMax[0] : boundsMin[0],
+                ( corner & 2 ) ? boundsMax[1] : boundsMin[1],
+                ( corner & 4 ) ? boundsMax[2] : boundsMin[2],
+                1
+            } };
 
-            unsigned int rowOffset = row * VERT_DIM;
+            float z = ( placed * point )[2];
 
-            for (unsigned int i = 0; i < VERT_DIM; i++)
-            {
-                outputShapes[shapeOffset + vertOffset + row] +=
-                    viewTransform[rowOffset + i] * inputShapes[shapeOffset + vertOffset + i];
-            }
+            if ( z < nearZ ) nearZ = z;
+            if ( z > farZ ) farZ = z;
         }
     }
 }
 
 
+/**
+ * @brief   Finds the facet of the full mesh under a point in the window
+ *
+ * The point is taken back to model space together with the device +z axis,
+ * which is the direction the viewer looks along, and the first facet along
+ * that ray is found in the facet hierarchy.
+ *
+ * @param   *vc     The view context the window is drawn with
+ * @param   x       The x-coordinate of the point in pixels
+ * @param   y       The y-coordinate of the point in pixels
+ * @param   *distance   Set to the distance along the ray to the facet, if
+ *                      not null
+ *
+ * @return  The index of the facet under the point, or -1 if there is none
+ */
+int ShapeContainer::pick( const ViewContext *vc, int x, int y, float *distance ) const
+{
+    float inverse[VERT_DIM][VERT_DIM];
+    vc->getInverseTransform( inverse );
+
+    float origin[Mesh::COORD_DIM];
+    float direction[Mesh::COORD_DIM];
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        origin[i] = inverse[i][0] * x + inverse[i][1] * y + inverse[i][3];
+        direction[i] = inverse[i][2];
+    }
+
+    return bvh.queryRay( mesh, origin, direction, distance );
+}
+
+
+/**
+ * @brief   Copies a view context's transformation matrix to the device for
+ *          every following draw
+ *
+ * @param   *vc     The view context to copy the transformation matrix from
+ *
+ * @return  void
+ */
+void ShapeContainer::pushViewTransform( const ViewContext *vc )
+{
+    pushTransform( vc->transform );
+}
+
+
+/**
+ * @brief   Copies a transform from model space to device space to the device
+ *          for every following draw
+ *
+ * @param   &transform  The transform to copy
+ *
+ * @return  void
+ */
+void ShapeContainer::pushTransform( const Mat4f &transform )
+{
+    HANDLE_CUDA_ERROR(
+        cudaMemcpyToSymbol( c_viewTransform, &transform, sizeof( Mat4f ) )
+    );
+}
+
+
+/**
+ * @brief   Converts the shapes in this shape container to strings and
+ *          outputs them to an output stream
+ *
+ * @param   &os     The output stream to write to
+ *
+ * @return  The output stream
+ */
+std::ostream &ShapeContainer::out( std::ostream &os ) const
+{
+    std::for_each( shapes.begin(), shapes.end(), [&os]( Shape *shape )
+       {
+           shape->out( const_cast<std::ostream&>( os ) );
+           os << std::endl;
+       }
+    );
+    return os;
+}
+
+
+/**
+ * @brief   Removes all shapes from this shape container
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeContainer::erase()
+{
+    freeDevice();
+
+    // the shapes are freed with the arena, all at once
+    shapes.clear();
+    arena.clear();
+
+    mesh.erase();
+    levels.clear();
+
+    clearInstances();
+}
+
+
+/**
+ * @brief   Gets the size of the shape container
+ *
+ * @param   void
+ *
+ * @return  The number of facets in the shape container
+ */
+unsigned int ShapeContainer::size()
+{
+    return mesh.getFacetCount();
+}
+
+
+/**
+ * @brief   Gets the indexed mesh backing this shape container
+ *
+ * @param   void
+ *
+ * @return  A mutable reference to the mesh
+ */
+Mesh &ShapeContainer::getMesh()
+{
+    return mesh;
+}
+
+
+/**
+ * @brief   Gets the indexed mesh backing this shape container
+ *
+ * @param   void
+ *
+ * @return  An immutable reference to the mesh
+ */
+const Mesh &ShapeContainer::getMesh() const
+{
+    return mesh;
+}
+
+
+/**
+ * @brief   Builds the levels of detail of this shape container's mesh
+ *
+ * Each level is simplified from the one before it to 1 / LOD_REDUCTION of
+ * its facets, until LOD_LEVEL_COUNT levels exist or a level would have
+ * fewer than LOD_MIN_FACETS. If the mesh is on the device, the levels are
+ * pushed as well; if it is drawn from host memory with its edge list, the
+ * levels get theirs built on the host.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeContainer::buildLevelsOfDetail()
+{
+    levels.clear();
+
+    if ( mesh.isStreaming() ) return;
+
+    // levels are built from each other, so they must not move
+    levels.reserve( LOD_LEVEL_COUNT );
+
+    const Mesh *source = &mesh;
+
+    for ( unsigned int level = 1; level <= LOD_LEVEL_COUNT; level++ )
+    {
+        unsigned int targetFacetCount = source->getFacetCount() / LOD_REDUCTION;
+
+        if ( targetFacetCount < LOD_MIN_FACETS ) break;
+
+        MeshSimplifier simplifier( *source );
+        simplifier.simplify( targetFacetCount );
+
+        levels.emplace_back();
+        simplifier.store( levels.back() );
+
+        source = &levels.back();
+    }
+
+    if ( !mesh.isOnDevice() )
+    {
+        if ( mesh.hasEdges() )
+        {
+            for ( Mesh &level : levels ) level.buildHostEdges();
+        }
+
+        return;
+    }
+
+    for ( Mesh &level : levels ) level.pushToDevice();
+}
+
+
+/**
+ * @brief   Gets the number of levels of detail, including the full mesh
+ *
+ * @param   void
+ *
+ * @return  The number of levels of detail
+ */
+unsigned int ShapeContainer::getLevelOfDetailCount() const
+{
+    return levels.size() + 1;
+}
+
+
+/**
+ * @brief   Gets a level of detail of this shape container's mesh
+ *
+ * @param   level   The level to get, where 0 is the full mesh
+ *
+ * @return  An immutable reference to the mesh of that level
+ */
+const Mesh &ShapeContainer::getLevelOfDetail( unsigned int level ) const
+{
+    if ( level == 0 ) return mesh;
+
+    if ( level > levels.size() )
+    {
+        throw std::out_of_range( "ShapeContainer level of detail out of range." );
+    }
+
+    return levels[level - 1];
+}
+
+
+/**
+ * @brief   Selects the coarsest level of detail that still has enough facets
+ *          for the size of the model on screen
+ *
+ * The on-screen size is estimated from the bounding box diagonal and the
+ * scale of the view transform, read off its rows, so the rotation does not
+ * matter and nothing is allocated.
+ *
+ * @param   *vc     The view context to draw with
+ *
+ * @return  The selected level, where 0 is the full mesh
+ */
+unsigned int ShapeContainer::selectLevelOfDetail( const ViewContext *vc ) const
+{
+    return selectLevelOfDetail( vc->transform );
+}
+
+
+/**
+ * @brief   Selects the coarsest level of detail that still has enough facets
+ *          for the size of the model on screen, for a model placed by a
+ *          transform of its own
+ *
+ * @param   &modelTransform     The transform from model space to device
+ *                              space
+ *
+ * @return  The selected level, where 0 is the full mesh
+ */
+unsigned int ShapeContainer::selectLevelOfDetail( const Mat4f &modelTransform ) const
+{
+    if ( levels.empty() ) return 0;
+
+    float transform[VERT_DIM][VERT_DIM];
+    modelTransform.toArray( transform );
+
+    // the row norms of the linear part are the scale along each screen axis
+    float scale = 0;
+
+    for ( unsigned int row = 0; row < 2; row++ )
+    {
+        float rowNorm = sqrt(
+            transform[row][0] * transform[row][0] +
+            transform[row][1] * transform[row][1] +
+            transform[row][2] * transform[row][2]
+        );
+
+        if ( rowNorm > scale ) scale = rowNorm;
+    }
+
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+    mesh.getBounds( boundsMin, boundsMax );
+
+    float diagonal = 0;
+
+    for ( unsigned int i = 0; i < Mesh::COORD_DIM; i++ )
+    {
+        diagonal += ( boundsMax[i] - boundsMin[i] ) * ( boundsMax[i] - boundsMin[i] );
+    }
+
+    float screenSize = sqrt( diagonal ) * scale;
+    float facetBudget = LOD_FACETS_PER_PIXEL * screenSize * screenSize;
+
+    // fall back to the coarsest level kept where the mesh is if even that is
+    // too fine
+    unsigned int selected = 0;
+
+    for ( unsigned int level = 0; level < getLevelOfDetailCount(); level++ )
+    {
+        const Mesh &lod = getLevelOfDetail( level );
+
+        if ( lod.isOnDevice() != mesh.isOnDevice() ) continue;
+
+        selected = level;
+
+        if ( lod.getFacetCount() <= facetBudget ) break;
+    }
+
+    return selected;
+}
+
+
+/**
+ * @brief   Places another copy of the mesh, sharing its vertices and edges
+ *          on the device with every other copy
+ *
+ * Once there is an instance, draw only draws the instances. Picking still
+ * finds facets of the mesh in its own model space.
+ *
+ * @param   &transform  The transform from the mesh's model space to world
+ *                      space, applied before the view transform
+ * @param   color       The 24-bit RGB color to draw the instance with
+ *
+ * @return  The index of the new instance
+ */
+unsigned int ShapeContainer::addInstance( const Mat4f &transform, unsigned int color )
+{
+    instanceTransforms.push_back( transform );
+    instanceColors.push_back( color );
+    instanceVersion++;
+
+    return instanceTransforms.size() - 1;
+}
+
+
+/**
+ * @brief   Moves or recolors an instance of the mesh
+ *
+ * @param   instance    The index of the instance
+ * @param   &transform  The transform from the mesh's model space to world
+ *                      space
+ * @param   color       The 24-bit RGB color to draw the instance with
+ *
+ * @return  void
+ */
+void ShapeContainer::setInstance( unsigned int instance, const Mat4f &transform, unsigned int color )
+{
+    if ( instance >= instanceTransforms.size() )
+    {
+        throw std::out_of_range( "ShapeContainer instance out of range." );
+    }
+
+    instanceTransforms[instance] = transform;
+    instanceColors[instance] = color;
+    instanceVersion++;
+}
+
+
+/**
+ * @brief   Removes every instance, so draw draws the mesh itself again
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeContainer::clearInstances()
+{
+    instanceTransforms.clear();
+    instanceColors.clear();
+    instanceVersion++;
+}
+
+
+/**
+ * @brief   Gets the number of instances of the mesh
+ *
+ * @param   void
+ *
+ * @return  The number of instances, 0 if the mesh is drawn by itself
+ */
+unsigned int ShapeContainer::getInstanceCount() const
+{
+    return instanceTransforms.size();
+}
+
+
+/**
+ * @brief   Gets the transform of an instance of the mesh
+ *
+ * @param   instance    The index of the instance
+ *
+ * @return  The transform from the mesh's model space to world space
+ */
+const Mat4f &ShapeContainer::getInstanceTransform( unsigned int instance ) const
+{
+    return instanceTransforms.at( instance );
+}
+
+
+/**
+ * @brief   Gets the color of an instance of the mesh
+ *
+ * @param   instance    The index of the instance
+ *
+ * @return  The 24-bit RGB color the instance is drawn with
+ */
+unsigned int ShapeContainer::getInstanceColor( unsigned int instance ) const
+{
+    return instanceColors.at( instance );
+}
+
+
+/**
+ * @brief   Gets a number that changes whenever an instance is added, moved,
+ *          recolored or removed
+ *
+ * @param   void
+ *
+ * @return  The version of the instances
+ */
+unsigned long long ShapeContainer::getInstanceVersion() const
+{
+    return instanceVersion;
+}
+
+
+/**
+ * @brief   Sets whether draw picks a level of detail by on-screen size, or
+ *          always draws the full mesh
+ *
+ * @param   enabled     True to pick a level of detail, false for full detail
+ *
+ * @return  void
+ */
+void ShapeContainer::setAdaptiveDetail( bool enabled )
+{
+    adaptiveDetail = enabled;
+}
+
+
+/**
+ * @brief   Determines if draw picks a level of detail by on-screen size
+ *
+ * @param   void
+ *
+ * @return  True if a level of detail is picked, false otherwise
+ */
+bool ShapeContainer::isAdaptiveDetail() const
+{
+    return adaptiveDetail;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Clones the shape objects of another shape container into this
+ *          shape container's arena without touching the mesh
+ *
+ * @param   &sc     The shape container to clone from
+ *
+ * @return  void
+ */
+void ShapeContainer::cloneShapes( const ShapeContainer &sc )
+{
+    shapes.reserve( shapes.size() + sc.shapes.size() );
+
+    std::for_each( sc.shapes.begin(), sc.shapes.end(), [this]( Shape *shape )
+       {
+           shapes.insert( shapes.end(), shape->clone( arena ) );
+       }
+    );
+}
+
+
+/**
+ * @brief   Frees the device buffers and pinned staging buffer of this shape
+ *          container
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeContainer::freeDevice()
+{
+    bvh.clear();
+
+    if ( d_outputVertices != nullptr )
+    {
+        HANDLE_CUDA_ERROR( cudaFree( d_outputVertices ) );
+        d_outputVertices = nullptr;
+    }
+}
+
+
+/**
+ * @brief   Stages every instance of a level of detail that can reach the
+ *          window in the rasterizer
+ *
+ * Each instance's transform is combined with the view transform on the
+ * host, and instances whose bounding box is off screen are dropped before
+ * anything is sent to the device.
+ *
+ * @param   &lod        The level of detail to stage the instances of
+ * @param   &transform  The transform from model space to device space
+ * @param   &raster     The rasterizer to stage the instances in
+ *
+ * @return  The number of instances staged
+ */
+unsigned int ShapeContainer::stageInstances( const Mesh &lod, const Mat4f &transform, Rasterizer &raster ) const
+{
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+    lod.getBounds( boundsMin, boundsMax );
+
+    DeviceInstance *staged = raster.reserveInstances( instanceTransforms.size() );
+    unsigned int visibleCount = 0;
+
+    for ( size_t i = 0; i < instanceTransforms.size(); i++ )
+    {
+        Mat4f instanceTransform = transform * instanceTransforms[i];
+
+        if ( !isBoxInWindow( instanceTransform, boundsMin, boundsMax, raster.getWidth(), raster.getHeight() ) ) continue;
+
+        staged[visibleCount].transform = instanceTransform;
+        staged[visibleCount].color = instanceColors[i];
+        visibleCount++;
+    }
+
+    return visibleCount;
+}
+
+
+/**
+ * @brief   Draws every instance of a level of detail that can reach the
+ *          window, all in one launch
+ *
+ * Each instance's transform is combined with the view transform on the
+ * host, and instances whose bounding box is off screen are dropped before
+ * anything is sent to the device. The rasterizer transforms the shared
+ * model-space vertices per instance as it draws, so memory grows with the
+ * mesh and not with the number of instances. The level of detail is picked
+ * for the view alone, not for each instance's scale.
+ *
+ * @param   &lod        The level of detail to draw
+ * @param   &transform  The transform from model space to device space
+ * @param   &raster     The rasterizer to draw into
+ * @param   &culler     The culler, only asked whether back faces are culled
+ *
+ * @return  void
+ */
+void ShapeContainer::drawInstances( const Mesh &lod, const Mat4f &transform, Rasterizer &raster, Culler &culler ) const
+{
+    ProfileRange cullRange( FrameProfiler::STAGE_CULL, false );
+
+    unsigned int visibleCount = stageInstances( lod, transform, raster );
+
+    cullRange.end();
+
+    // no unique edge list until the stream ends, and facing is per facet
+    bool drawFacets = lod.isStreaming() || culler.isBackFaceCulling();
+
+    ProfileRange rasterRange( FrameProfiler::STAGE_RASTER );
+
+    raster.drawInstances(
+        lod.getDeviceVertices(), lod.getDeviceVertexStride(),
+        drawFacets ? lod.getDeviceIndices() : lod.getDeviceEdges(),
+        drawFacets ? lod.getDeviceFacetCount() : lod.getEdgeCount(),
+        drawFacets,
+        visibleCount, culler.isBackFaceCulling()
+    );
+}
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+/**
+ * @brief   Applies one row of the view transform to four vertices
+ *
+ * @param   row     The row of the view transform to apply
+ * @param   &x      The x coordinates of the vertices
+ * @param   &y      The y coordinates of the vertices
+ * @param   &z      The z coordinates of the vertices
+ *
+ * @return  The transformed coordinates of the vertices along that row
+ */
+__device__ float4 transformRow( unsigned int row, const float4 &x, const float4 &y, const float4 &z )
+{
+    const Vec4f &m = c_viewTransform[row];
+
+    return make_float4(
+        m[0] * x.x + m[1] * y.x + m[2] * z.x + m[3],
+        m[0] * x.y + m[1] * y.y + m[2] * z.y + m[3],
+        m[0] * x.z + m[1] * y.z + m[2] * z.z + m[3],
+        m[0] * x.w + m[1] * y.w + m[2] * z.w + m[3]
+    );
+}
+
+
+/**
+ * @brief   Applies the view transform to every vertex of a structure-of-arrays
+ *          vertex pool, one thread per Mesh::VERTEX_ALIGN consecutive vertices
+ *
+ * Each coordinate array is read and written as float4, so a warp moves
+ * 512 contiguous bytes per array per access. The matrix comes from constant
+ * memory, where every thread of a warp hits the same address, and each
+ * output is stored exactly once.
+ *
+ * @param   *inputVertices      The model-space vertex pool, as x[], y[], z[]
+ * @param   *outputVertices     The device-space vertex pool, as x[], y[], z[]
+ * @param   vertexStride        The distance between the x[], y[] and z[]
+ *                              arrays of both pools, in floats, a multiple of
+ *                              Mesh::VERTEX_ALIGN
+ * @param   vertexCount         The number of vertices in the pool
+ *
+ * @return  void
+ */
+__global__ void applyViewTransform(
+    const float4 * inputVertices, float4 * outputVertices,
+    unsigned int vertexStride, unsigned int vertexCount
+)
+{
+    unsigned int groupIdx = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( groupIdx * Mesh::VERTEX_ALIGN >= vertexCount ) return;
+
+    unsigned int groupStride = vertexStride / Mesh::VERTEX_ALIGN;
+
+    // coalesced vector loads from each coordinate array
+    float4 x = inputVertices[groupIdx];
+    float4 y = inputVertices[groupStride + groupIdx];
+    float4 z = inputVertices[groupStride * 2 + groupIdx];
+
+    // a trailing partial group runs into the stride padding, never past it
+    outputVertices[groupIdx] = transformRow( 0, x, y, z );
+    outputVertices[groupStride + groupIdx] = transformRow( 1, x, y, z );
+    outputVertices[groupStride * 2 + groupIdx] = transformRow( 2, x, y, z );
+}
+
+
 /* -------------------------------------------------------------------------- */
\ No newline at end of file
@@ -3,7 +3,7 @@
 
 /**
  * @file    shapecontainer.h
- * @brief   Set container of shape pointers
+ * @brief   Set container of shape pointers backed by an indexed mesh
  */
 
 
@@ -19,9 +19,14 @@
 
 # include <set>
 
+# include "bvh.h"
+# include "culler.h"
 # include "gcontext.h"
+# include "mesh.h"
+# include "rasterizer.h"
 # include "viewcontext.h"
 # include "shape.h"
+# include "shapearena.h"
 
 
 /* --------------------------------- Class ---------------------------------- */
@@ -33,11 +38,23 @@ class ShapeContainer
 
 public:
 
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int LOD_LEVEL_COUNT = 3;
+    static constexpr unsigned int LOD_REDUCTION = 4;
+    static constexpr unsigned int LOD_MIN_FACETS = 1024;
+
+    // facets drawn per square pixel of the model's on-screen size
+    static constexpr float LOD_FACETS_PER_PIXEL = 0.5f;
+
+
     /* --------------------- Constructors / Destructors --------------------- */
 
 
     ShapeContainer();
     ShapeContainer( const ShapeContainer &sc );
+    ShapeContainer( ShapeContainer &&sc ) noexcept;
 
     ~ShapeContainer();
 
@@ -46,17 +63,62 @@ public:
 
 
     ShapeContainer &operator=( const ShapeContainer &sc );
+    ShapeContainer &operator=( ShapeContainer &&sc ) noexcept;
 
 
     /* ------------------------------ Functions ----------------------------- */
 
     void pushToDevice();
 
+    void beginStream( unsigned int facetCapacity );
+    void streamPending();
+    void endStream();
+
     void add( const Shape &shape );
     void add( const ShapeContainer &sc );
+    void addFacet( const Point3D &a, const Point3D &b, const Point3D &c );
     unsigned int size();
 
-    void draw( GraphicsContext *gc, ViewContext *vc ) const;
+    Mesh &getMesh();
+    const Mesh &getMesh() const;
+
+    void buildLevelsOfDetail();
+    unsigned int getLevelOfDetailCount() const;
+    const Mesh &getLevelOfDetail( unsigned int level ) const;
+    unsigned int selectLevelOfDetail( const ViewContext *vc ) const;
+    unsigned int selectLevelOfDetail( const Mat4f &modelTransform ) const;
+
+    void setAdaptiveDetail( bool enabled );
+    bool isAdaptiveDetail() const;
+
+    unsigned int addInstance( const Mat4f &transform, unsigned int color );
+    void setInstance( unsigned int instance, const Mat4f &transform, unsigned int color );
+    void clearInstances();
+    unsigned int getInstanceCount() const;
+    const Mat4f &getInstanceTransform( unsigned int instance ) const;
+    unsigned int getInstanceColor( unsigned int instance ) const;
+    unsigned long long getInstanceVersion() const;
+
+    void draw( ViewContext *vc, Rasterizer &raster, Culler &culler, unsigned int color ) const;
+    void draw( const Mat4f &transform, Rasterizer &raster, Culler &culler, unsigned int color ) const;
+
+    unsigned int transformAndCull(
+        const Mat4f &transform, unsigned int level,
+        unsigned int width, unsigned int height,
+        Culler &culler, bool *facets
+    ) const;
+
+    void rasterize(
+        unsigned int level, Rasterizer &raster, const Culler &culler,
+        unsigned int elementCount, bool facets, unsigned int color
+    ) const;
+    void rasterizeDepth( unsigned int level, Rasterizer &raster ) const;
+    void drawInstanceDepth( const Mat4f &transform, Rasterizer &raster ) const;
+    void expandDepthRange( const Mat4f &transform, float &nearZ, float &farZ ) const;
+    int pick( const ViewContext *vc, int x, int y, float *distance = nullptr ) const;
+
+    static void pushViewTransform( const ViewContext *vc );
+    static void pushTransform( const Mat4f &transform );
 
     std::ostream &out( std::ostream &os ) const;
 
@@ -70,9 +132,36 @@ private:
     /* ----------------------------- Attributes ----------------------------- */
 
 
+    // the shapes and their points are built in the arena and freed with it
     std::vector<Shape*> shapes = std::vector<Shape*>();
-    float * d_inputShapes = nullptr;
-    float * d_outputShapes = nullptr;
+    ShapeArena arena;
+
+    Mesh mesh = Mesh();
+
+    // simplified copies of the mesh, each a quarter of the one before
+    std::vector<Mesh> levels = std::vector<Mesh>();
+    bool adaptiveDetail = false;
+
+    // hierarchy over the facets of the full mesh, rebuilt on every push
+    BVH bvh;
+
+    // placements of the mesh in world space, drawn instead of the mesh
+    // itself when there are any
+    std::vector<Mat4f> instanceTransforms = std::vector<Mat4f>();
+    std::vector<unsigned int> instanceColors = std::vector<unsigned int>();
+    unsigned long long instanceVersion = 0;
+
+    float * d_outputVertices = nullptr;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void cloneShapes( const ShapeContainer &sc );
+    void freeDevice();
+
+    unsigned int stageInstances( const Mesh &lod, const Mat4f &transform, Rasterizer &raster ) const;
+    void drawInstances( const Mesh &lod, const Mat4f &transform, Rasterizer &raster, Culler &culler ) const;
 
 
     /* ====================================================================== */
@@ -88,8 +177,11 @@ std::ostream &operator<<( std::ostream &os, const ShapeContainer &sc );
 /* ------------------------------ GPU Kernels ------------------------------- */
 
 
+__device__ float4 transformRow( unsigned int row, const float4 &x, const float4 &y, const float4 &z );
+
 __global__ void applyViewTransform(
-    float * inputShapes, float * outputShapes, float * viewTransform
+    const float4 * inputVertices, float4 * outputVertices,
+    unsigned int vertexStride, unsigned int vertexCount
 );
 
 
@@ -47,6 +47,24 @@ verts( Vector2<Point3D*>( start.clone(), end.clone() ) )
 {}
 
 
+/**
+ * @brief   Creates a colored line from two points, with the vertices built
+ *          in a shape arena
+ *
+ * @param   &start  The starting point of the line
+ * @param   &end    The ending point of the line
+ * @param   &color  The color of the line
+ * @param   &arena  The shape arena to build the vertices in
+ *
+ * @return  The created line
+ */
+Line::Line( const Point3D &start, const Point3D &end, const Color &color, ShapeArena &arena ):
+Shape( color, midpoint( start, end ) ),
+verts( Vector2<Point3D*>( arena.create<Point3D>( start ), arena.create<Point3D>( end ) ) ),
+ownsVerts( false )
+{}
+
+
 /**
  * @brief   Creates a line from an existing line
  *
@@ -55,7 +73,7 @@ verts( Vector2<Point3D*>( start.clone(), end.clone() ) )
  * @return  The created line
  */
 Line::Line( const Line &line ):
-Shape( line.color, line.origin ), verts( line.verts )
+Shape( line.color, line.origin ), verts( Point3D::vector2DeepCopy( line.verts ) )
 {}
 
 
@@ -68,7 +86,7 @@ Shape( line.color, line.origin ), verts( line.verts )
  */
 Line::~Line()
 {
-    Point3D::vector2DeepDelete( verts );
+    if ( ownsVerts ) Point3D::vector2DeepDelete( verts );
 }
 
 
@@ -84,9 +102,10 @@ Line::~Line()
  */
 Line &Line::operator=( const Line &line )
 {
-    Point3D::vector2DeepDelete( verts );
+    // copy into the vertices in place, wherever they were allocated
+    *verts[0] = *line.verts[0];
+    *verts[1] = *line.verts[1];
 
-    this->verts = Point3D::vector2DeepCopy( line.verts );
     this->color = line.color;
     this->origin = line.origin;
 
@@ -171,6 +190,32 @@ Line *Line::clone() const
 }
 
 
+/**
+ * @brief   Clones this line into a shape arena
+ *
+ * @param   &arena  The shape arena to build the copy in
+ *
+ * @return  The cloned copy of this line, owned by the arena
+ */
+Line *Line::clone( ShapeArena &arena ) const
+{
+    return arena.create<Line>( *verts[0], *verts[1], color, arena );
+}
+
+
+/**
+ * @brief   Gets the number of vertices of this line
+ *
+ * @param   void
+ *
+ * @return  The number of vertices
+ */
+unsigned int Line::getVertexCount() const
+{
+    return 2;
+}
+
+
 /**
  * @brief   Converts this line to a string and flushes it to an output
  *          stream
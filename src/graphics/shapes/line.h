@@ -35,6 +35,7 @@ public:
 
     Line( const Point3D &start, const Point3D &end );
     Line( const Point3D &start, const Point3D &end, const Color &color );
+    Line( const Point3D &start, const Point3D &end, const Color &color, ShapeArena &arena );
     Line( const Line &line );
 
     ~Line() override;
@@ -54,6 +55,8 @@ public:
 
     void draw( GraphicsContext *gc ) const override;
     Line *clone() const override;
+    Line *clone( ShapeArena &arena ) const override;
+    unsigned int getVertexCount() const override;
 
     std::ostream &out( std::ostream &os ) const override;
 
@@ -67,6 +70,9 @@ private:
 
     Vector2<Point3D*> verts;
 
+    // false if the vertices live in a shape arena and are freed with it
+    bool ownsVerts = true;
+
 
     /* ------------------------------ Functions ----------------------------- */
 
@@ -21,6 +21,7 @@
 
 # include "color.h"
 # include "point3d.h"
+# include "shapearena.h"
 # include "viewcontext.h"
 # include "gcontext.h"
 
@@ -67,6 +68,8 @@ public:
 
     virtual void draw( GraphicsContext *gc ) const = 0;
     virtual Shape *clone() const = 0;
+    virtual Shape *clone( ShapeArena &arena ) const = 0;
+    virtual unsigned int getVertexCount() const = 0;
 
     const Color &getColor() const;
     const Point3D &getOrigin() const;
@@ -0,0 +1,179 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    shapearena.cpp
+ * @brief   Block allocator the shapes of a shape container are built in
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "shapearena.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty shape arena, the first block is allocated on
+ *          first use
+ *
+ * @param   void
+ *
+ * @return  The created shape arena
+ */
+ShapeArena::ShapeArena() = default;
+
+
+/**
+ * @brief   Creates a shape arena that takes over the blocks and objects of
+ *          another arena, leaving it empty
+ *
+ * @param   &&arena     The shape arena to move from
+ *
+ * @return  The created shape arena
+ */
+ShapeArena::ShapeArena( ShapeArena &&arena ) noexcept:
+blocks( std::move( arena.blocks ) ), blockOffset( arena.blockOffset ),
+destructors( std::move( arena.destructors ) )
+{
+    arena.blocks.clear();
+    arena.blockOffset = BLOCK_SIZE;
+    arena.destructors.clear();
+}
+
+
+/**
+ * @brief   Shape arena destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+ShapeArena::~ShapeArena()
+{
+    clear();
+}
+
+
+/* -------------------------- Overloaded Operators -------------------------- */
+
+
+/**
+ * @brief   Destroys the objects of this arena and takes over the blocks and
+ *          objects of another arena, leaving it empty
+ *
+ * @param   &&arena     The shape arena to move from
+ *
+ * @return  A reference to this shape arena
+ */
+ShapeArena &ShapeArena::operator=( ShapeArena &&arena ) noexcept
+{
+    if ( this == &arena ) return *this;
+
+    clear();
+
+    blocks = std::move( arena.blocks );
+    blockOffset = arena.blockOffset;
+    destructors = std::move( arena.destructors );
+
+    arena.blocks.clear();
+    arena.blockOffset = BLOCK_SIZE;
+    arena.destructors.clear();
+
+    return *this;
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Destroys every object in the arena, newest first, and frees all
+ *          of its blocks
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeArena::clear()
+{
+    for ( auto destructor = destructors.rbegin(); destructor != destructors.rend(); ++destructor )
+    {
+        destructor->destroy( destructor->object );
+    }
+
+    destructors.clear();
+    blocks.clear();
+    blockOffset = BLOCK_SIZE;
+}
+
+
+/**
+ * @brief   Gets the number of blocks the arena has allocated
+ *
+ * @param   void
+ *
+ * @return  The number of blocks
+ */
+size_t ShapeArena::getBlockCount() const
+{
+    return blocks.size();
+}
+
+
+/**
+ * @brief   Gets the number of objects in the arena that have a destructor
+ *          to run
+ *
+ * @param   void
+ *
+ * @return  The number of objects
+ */
+size_t ShapeArena::getObjectCount() const
+{
+    return destructors.size();
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Reserves memory in the arena, starting a new block when the
+ *          current one is full
+ *
+ * An object too large for a block gets a block of its own, kept behind the
+ * current one so the space left in it is not lost.
+ *
+ * @param   size        The size of the memory in bytes
+ * @param   alignment   The alignment of the memory in bytes, a power of two
+ *                      no larger than that of std::max_align_t
+ *
+ * @return  A pointer to the reserved memory
+ */
+void *ShapeArena::allocate( size_t size, size_t alignment )
+{
+    if ( size > BLOCK_SIZE )
+    {
+        blocks.emplace( blocks.begin(), new char[size] );
+        return blocks.front().get();
+    }
+
+    size_t offset = ( blockOffset + alignment - 1 ) & ~( alignment - 1 );
+
+    if ( offset + size > BLOCK_SIZE )
+    {
+        blocks.emplace_back( new char[BLOCK_SIZE] );
+        offset = 0;
+    }
+
+    blockOffset = offset + size;
+
+    return blocks.back().get() + offset;
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,145 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    shapearena.h
+ * @brief   Block allocator the shapes of a shape container are built in
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef SHAPE_SHAPEARENA_H
+# define SHAPE_SHAPEARENA_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <memory>
+# include <new>
+# include <type_traits>
+# include <utility>
+# include <vector>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A shape arena hands out memory by bumping an offset through large blocks,
+ * so building a shape and its points costs no allocation of its own. Objects
+ * are never freed one at a time; clear() runs their destructors in reverse
+ * order of creation and then releases every block at once. Pointers into the
+ * arena stay valid when the arena is moved, since the blocks themselves never
+ * move.
+ */
+class ShapeArena
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    ShapeArena();
+    ShapeArena( const ShapeArena &arena ) = delete;
+    ShapeArena( ShapeArena &&arena ) noexcept;
+
+    ~ShapeArena();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    ShapeArena &operator=( const ShapeArena &arena ) = delete;
+    ShapeArena &operator=( ShapeArena &&arena ) noexcept;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    /**
+     * @brief   Constructs an object in the arena
+     *
+     * @param   &&args  The arguments to construct the object with
+     *
+     * @return  A pointer to the object, owned by the arena
+     */
+    template<typename T, typename... Args>
+    T *create( Args &&... args )
+    {
+        void *memory = allocate( sizeof( T ), alignof( T ) );
+
+        // make room for the destructor first, so it cannot fail afterwards
+        if ( !std::is_trivially_destructible<T>::value ) destructors.reserve( destructors.size() + 1 );
+
+        T *object = new ( memory ) T( std::forward<Args>( args )... );
+
+        if ( !std::is_trivially_destructible<T>::value ) destructors.push_back( { object, &destroy<T> } );
+
+        return object;
+    }
+
+    void clear();
+
+    size_t getBlockCount() const;
+    size_t getObjectCount() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* -------------------------------- Types ------------------------------- */
+
+
+    struct Destructor
+    {
+        void *object;
+        void ( *destroy )( void *object );
+    };
+
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // the last block is the one being bumped through
+    std::vector<std::unique_ptr<char[]>> blocks = std::vector<std::unique_ptr<char[]>>();
+    size_t blockOffset = BLOCK_SIZE;
+
+    std::vector<Destructor> destructors = std::vector<Destructor>();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void *allocate( size_t size, size_t alignment );
+
+    template<typename T>
+    static void destroy( void *object )
+    {
+        static_cast<T*>( object )->~T();
+    }
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // SHAPE_SHAPEARENA_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -48,6 +48,30 @@ verts( Vector3<Point3D*>( start.clone(), mid.clone(), end.clone() ) )
 {}
 
 
+/**
+ * @brief   Creates a colored triangle from three points, with the vertices
+ *          built in a shape arena
+ *
+ * @param   &start  The starting point of the triangle
+ * @param   &mid    The middle point of the triangle
+ * @param   &end    The ending point of the triangle
+ * @param   &color  The color of the triangle
+ * @param   &arena  The shape arena to build the vertices in
+ *
+ * @return  The created triangle
+ */
+Triangle::Triangle(
+    const Point3D &start, const Point3D &mid, const Point3D &end,
+    const Color &color, ShapeArena &arena
+):
+Shape( color, midpoint( start, mid, end ) ),
+verts( Vector3<Point3D*>(
+    arena.create<Point3D>( start ), arena.create<Point3D>( mid ), arena.create<Point3D>( end )
+) ),
+ownsVerts( false )
+{}
+
+
 /**
  * @brief   Creates a triangle from an existing triangle
  *
@@ -56,7 +80,8 @@ verts( Vector3<Point3D*>( start.clone(), mid.clone(), end.clone() ) )
  * @return  The created triangle
  */
 Triangle::Triangle( const Triangle &triangle ) :
-Shape( triangle.color, triangle.origin ), verts( triangle.verts )
+Shape( triangle.color, triangle.origin ),
+verts( Point3D::vector3DeepCopy( triangle.verts ) )
 {}
 
 
@@ -69,7 +94,7 @@ Shape( triangle.color, triangle.origin ), verts( triangle.verts )
  */
 Triangle::~Triangle()
 {
-    Point3D::vector3DeepDelete( verts );
+    if ( ownsVerts ) Point3D::vector3DeepDelete( verts );
 }
 
 
@@ -85,9 +110,11 @@ Triangle::~Triangle()
  */
 Triangle &Triangle::operator=( const Triangle &triangle )
 {
-    Point3D::vector3DeepDelete( verts );
+    // copy into the vertices in place, wherever they were allocated
+    *verts[0] = *triangle.verts[0];
+    *verts[1] = *triangle.verts[1];
+    *verts[2] = *triangle.verts[2];
 
-    this->verts = Point3D::vector3DeepCopy( triangle.verts );
     this->color = triangle.color;
     this->origin = triangle.origin;
 
@@ -178,6 +205,32 @@ Triangle *Triangle::clone() const
 }
 
 
+/**
+ * @brief   Clones this triangle into a shape arena
+ *
+ * @param   &arena  The shape arena to build the copy in
+ *
+ * @return  The cloned copy of this triangle, owned by the arena
+ */
+Triangle *Triangle::clone( ShapeArena &arena ) const
+{
+    return arena.create<Triangle>( *verts[0], *verts[1], *verts[2], color, arena );
+}
+
+
+/**
+ * @brief   Gets the number of vertices of this triangle
+ *
+ * @param   void
+ *
+ * @return  The number of vertices
+ */
+unsigned int Triangle::getVertexCount() const
+{
+    return 3;
+}
+
+
 /**
  * @brief   Converts this triangle to a string and flushes it to an output
  *          stream
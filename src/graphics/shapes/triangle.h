@@ -35,6 +35,10 @@ public:
 
     Triangle( const Point3D &start, const Point3D &mid, const Point3D &end );
     Triangle( const Point3D &start, const Point3D &mid, const Point3D &end, const Color &color );
+    Triangle(
+        const Point3D &start, const Point3D &mid, const Point3D &end,
+        const Color &color, ShapeArena &arena
+    );
     Triangle( const Triangle &tri );
 
     ~Triangle() override;
@@ -54,6 +58,8 @@ public:
 
     void draw( GraphicsContext *gc ) const override;
     Triangle *clone() const override;
+    Triangle *clone( ShapeArena &arena ) const override;
+    unsigned int getVertexCount() const override;
 
     std::ostream &out( std::ostream &os ) const override;
 
@@ -67,6 +73,9 @@ private:
 
     Vector3<Point3D*> verts;
 
+    // false if the vertices live in a shape arena and are freed with it
+    bool ownsVerts = true;
+
 
     /* ------------------------------ Functions ----------------------------- */
 
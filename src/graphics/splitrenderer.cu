@@ -0,0 +1,538 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    splitrenderer.cpp
+ * @brief   Renders a mesh split across every visible device
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cmath>
+# include <limits>
+# include <numeric>
+
+# include "cudaerr.cuh"
+# include "splitrenderer.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a split renderer with no mesh
+ *
+ * @param   void
+ *
+ * @return  The created split renderer
+ */
+SplitRenderer::SplitRenderer() = default;
+
+
+/**
+ * @brief   Split renderer destructor, frees every partition on its device
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+SplitRenderer::~SplitRenderer()
+{
+    clear();
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the number of devices a mesh can be split across
+ *
+ * @param   void
+ *
+ * @return  The number of visible devices
+ */
+unsigned int SplitRenderer::getDeviceCount()
+{
+    int count = 0;
+
+    if ( cudaGetDeviceCount( &count ) != cudaSuccess )
+    {
+        // no driver or no devices, which is not an error here
+        cudaGetLastError();
+        return 0;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Splits a mesh across devices and pushes every partition to its
+ *          device
+ *
+ * The current device becomes the primary device, which composites the
+ * frames, and holds the first partition. The full mesh itself is never
+ * pushed to any device.
+ *
+ * @param   &mesh           The mesh to split, only read on the host
+ * @param   deviceCount     The number of devices to split across, at most
+ *                          the number of visible devices
+ *
+ * @return  void
+ */
+void SplitRenderer::split( const Mesh &mesh, unsigned int deviceCount )
+{
+    clear();
+
+    HANDLE_CUDA_ERROR( cudaGetDevice( &primaryDevice ) );
+
+    facetCount = mesh.getFacetCount();
+    deviceCount = std::min( std::min( deviceCount, getDeviceCount() ), facetCount );
+
+    if ( deviceCount == 0 ) return;
+
+    // slabs along the longest axis of the bounding box
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+    mesh.getBounds( boundsMin, boundsMax );
+
+    unsigned int axis = 0;
+
+    for ( unsigned int i = 1; i < Mesh::COORD_DIM; i++ )
+    {
+        if ( boundsMax[i] - boundsMin[i] > boundsMax[axis] - boundsMin[axis] ) axis = i;
+    }
+
+    const float *coords = ( axis == 0 ) ? mesh.getX() : ( axis == 1 ) ? mesh.getY() : mesh.getZ();
+    const unsigned int *indices = mesh.getIndices();
+
+    std::vector<float> keys( facetCount );
+
+    for ( unsigned int facet = 0; facet < facetCount; facet++ )
+    {
+        const unsigned int *corners = indices + ( size_t ) facet * Mesh::FACET_DIM;
+        keys[facet] = coords[corners[0]] + coords[corners[1]] + coords[corners[2]];
+    }
+
+    // equal facet counts per device, each slab only partially sorted
+    std::vector<unsigned int> order( facetCount );
+    std::iota( order.begin(), order.end(), 0 );
+
+    std::vector<unsigned int> starts( deviceCount + 1 );
+
+    for ( unsigned int part = 0; part <= deviceCount; part++ )
+    {
+        starts[part] = ( unsigned int ) ( ( unsigned long long ) facetCount * part / deviceCount );
+    }
+
+    for ( unsigned int part = 1; part < deviceCount; part++ )
+    {
+        std::nth_element(
+            order.begin() + starts[part - 1], order.begin() + starts[part], order.end(),
+            [&keys]( unsigned int a, unsigned int b ) { return keys[a] < keys[b]; }
+        );
+    }
+
+    // the primary device first, then the others in order
+    std::vector<int> devices( 1, primaryDevice );
+
+    for ( int device = 0; devices.size() < deviceCount; device++ )
+    {
+        if ( device != primaryDevice ) devices.push_back( device );
+    }
+
+    for ( int device : devices )
+    {
+        std::unique_ptr<DevicePartition> partition( new DevicePartition() );
+        partition->device = device;
+        partitions.push_back( std::move( partition ) );
+    }
+
+    // the primary device copies the partial frames straight from its peers
+    for ( const std::unique_ptr<DevicePartition> &partition : partitions )
+    {
+        if ( partition->device == primaryDevice ) continue;
+
+        int canAccess = 0;
+        HANDLE_CUDA_ERROR( cudaDeviceCanAccessPeer( &canAccess, primaryDevice, partition->device ) );
+
+        if ( !canAccess ) continue;
+
+        cudaError_t err = cudaDeviceEnablePeerAccess( partition->device, 0 );
+
+        if ( err == cudaErrorPeerAccessAlreadyEnabled ) cudaGetLastError();
+        else HANDLE_CUDA_ERROR( err );
+    }
+
+    if ( !pool || ( poolSize != deviceCount ) )
+    {
+        pool.reset( new ThreadPool( deviceCount ) );
+        poolSize = deviceCount;
+    }
+
+    // every device builds and pushes its own partition
+    pool->parallelFor( deviceCount, [&]( unsigned int part )
+    {
+        buildPartition( mesh, order.data() + starts[part], starts[part + 1] - starts[part], *partitions[part] );
+    } );
+
+    HANDLE_CUDA_ERROR( cudaSetDevice( primaryDevice ) );
+}
+
+
+/**
+ * @brief   Frees every partition on its device
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void SplitRenderer::clear()
+{
+    if ( partitions.empty() ) return;
+
+    for ( std::unique_ptr<DevicePartition> &partition : partitions )
+    {
+        if ( partition->d_peerFrame != nullptr )
+        {
+            HANDLE_CUDA_ERROR( cudaSetDevice( primaryDevice ) );
+            HANDLE_CUDA_ERROR( cudaFree( partition->d_peerFrame ) );
+        }
+
+        // the buffers of the partition belong to its device
+        HANDLE_CUDA_ERROR( cudaSetDevice( partition->device ) );
+        partition.reset();
+    }
+
+    HANDLE_CUDA_ERROR( cudaSetDevice( primaryDevice ) );
+
+    partitions.clear();
+    facetCount = 0;
+    peerWidth = 0;
+    peerHeight = 0;
+}
+
+
+/**
+ * @brief   Determines if a mesh is split across devices
+ *
+ * @param   void
+ *
+ * @return  True if there is a split mesh, false otherwise
+ */
+bool SplitRenderer::isSplit() const
+{
+    return !partitions.empty();
+}
+
+
+/**
+ * @brief   Gets the number of devices the mesh is split across
+ *
+ * @param   void
+ *
+ * @return  The number of partitions
+ */
+unsigned int SplitRenderer::getPartitionCount() const
+{
+    return partitions.size();
+}
+
+
+/**
+ * @brief   Gets the number of facets of the split mesh
+ *
+ * @param   void
+ *
+ * @return  The number of facets across all partitions
+ */
+unsigned int SplitRenderer::getFacetCount() const
+{
+    return facetCount;
+}
+
+
+/**
+ * @brief   Builds the simplified levels of detail of every partition on its
+ *          device
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void SplitRenderer::buildLevelsOfDetail()
+{
+    if ( partitions.empty() ) return;
+
+    pool->parallelFor( partitions.size(), [this]( unsigned int part )
+    {
+        HANDLE_CUDA_ERROR( cudaSetDevice( partitions[part]->device ) );
+        partitions[part]->sc.buildLevelsOfDetail();
+    } );
+
+    HANDLE_CUDA_ERROR( cudaSetDevice( primaryDevice ) );
+}
+
+
+/**
+ * @brief   Draws every partition on its device and composites the frames
+ *          into the primary device's framebuffer
+ *
+ * The primary device draws its own partition straight into the target, the
+ * others draw into their own framebuffers and copy them over. A partial
+ * frame is only its partition's lines on the background, so compositing
+ * keeps every pixel that is not the background.
+ *
+ * @param   *vc                 The view context to render with
+ * @param   &target             The framebuffer on the primary device, sized
+ *                              to the window
+ * @param   color               The 24-bit RGB color to draw with
+ * @param   background          The 24-bit RGB background color
+ * @param   backFaceCulling     True to cull back-facing facets
+ * @param   adaptiveDetail      True to draw a level of detail picked by how
+ *                              large each partition is on screen
+ *
+ * @return  void
+ */
+void SplitRenderer::draw(
+    ViewContext *vc, Rasterizer &target,
+    unsigned int color, unsigned int background,
+    bool backFaceCulling, bool adaptiveDetail
+)
+{
+    if ( partitions.empty() ) return;
+
+    unsigned int width = target.getWidth();
+    unsigned int height = target.getHeight();
+    size_t frameBytes = ( size_t ) width * height * sizeof( unsigned int );
+
+    resizePeerFrames( width, height );
+
+    pool->parallelFor( partitions.size(), [&]( unsigned int part )
+    {
+        DevicePartition &partition = *partitions[part];
+        bool primary = ( partition.device == primaryDevice );
+
+        HANDLE_CUDA_ERROR( cudaSetDevice( partition.device ) );
+
+        Rasterizer &raster = primary ? target : partition.raster;
+
+        if ( ( raster.getWidth() != width ) || ( raster.getHeight() != height ) )
+        {
+            raster.resize( width, height );
+        }
+
+        partition.culler.setBackFaceCulling( backFaceCulling );
+        partition.sc.setAdaptiveDetail( adaptiveDetail );
+
+        // every partition fades the same, none of them hides lines
+        if ( !primary )
+        {
+            float nearZ, farZ;
+            target.getDepthRange( nearZ, farZ );
+
+            raster.setDepthCueing( target.isDepthCueing() );
+            raster.setDepthRange( nearZ, farZ );
+        }
+
+        // every device has its own constant memory
+        ShapeContainer::pushViewTransform( vc );
+
+        raster.clear( background );
+        partition.sc.draw( vc, raster, partition.culler, color );
+
+        if ( primary ) return;
+
+        HANDLE_CUDA_ERROR(
+            cudaMemcpyPeer(
+                partition.d_peerFrame, primaryDevice,
+                partition.raster.getDeviceFrameBuffer(), partition.device,
+                frameBytes
+            )
+        );
+    } );
+
+    HANDLE_CUDA_ERROR( cudaSetDevice( primaryDevice ) );
+
+    unsigned int pixelCount = width * height;
+    unsigned int blocks = ceil( pixelCount / ( double ) COMPOSITE_BLOCK_SIZE );
+
+    for ( const std::unique_ptr<DevicePartition> &partition : partitions )
+    {
+        if ( partition->d_peerFrame == nullptr ) continue;
+
+        compositeFrame<<<blocks, COMPOSITE_BLOCK_SIZE>>>(
+            partition->d_peerFrame, target.getDeviceFrameBuffer(),
+            pixelCount, background
+        );
+        HANDLE_CUDA_ERROR( cudaGetLastError() );
+    }
+}
+
+
+/**
+ * @brief   Finds the facet of the full mesh under a point in the window
+ *
+ * @param   *vc     The view context the window is drawn with
+ * @param   x       The x-coordinate of the point in pixels
+ * @param   y       The y-coordinate of the point in pixels
+ *
+ * @return  The index in the full mesh of the nearest facet under the point
+ *          on any device, or -1 if there is none
+ */
+int SplitRenderer::pick( const ViewContext *vc, int x, int y ) const
+{
+    int nearestFacet = -1;
+    float nearestDistance = std::numeric_limits<float>::infinity();
+
+    for ( const std::unique_ptr<DevicePartition> &partition : partitions )
+    {
+        HANDLE_CUDA_ERROR( cudaSetDevice( partition->device ) );
+
+        float distance = 0;
+        int facet = partition->sc.pick( vc, x, y, &distance );
+
+        if ( ( facet >= 0 ) && ( distance < nearestDistance ) )
+        {
+            nearestFacet = partition->facetIds[facet];
+            nearestDistance = distance;
+        }
+    }
+
+    HANDLE_CUDA_ERROR( cudaSetDevice( primaryDevice ) );
+
+    return nearestFacet;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Copies a set of facets of a mesh into a partition and pushes it
+ *          to the partition's device, on the calling thread
+ *
+ * @param   &mesh       The full mesh
+ * @param   *facets     The indices of the facets of the partition
+ * @param   count       The number of facets of the partition
+ * @param   &partition  The partition to fill
+ *
+ * @return  void
+ */
+void SplitRenderer::buildPartition(
+    const Mesh &mesh, const unsigned int *facets, unsigned int count,
+    DevicePartition &partition
+)
+{
+    const unsigned int NO_VERTEX = std::numeric_limits<unsigned int>::max();
+
+    const unsigned int *indices = mesh.getIndices();
+
+    std::vector<unsigned int> remap( mesh.getVertexCount(), NO_VERTEX );
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<unsigned int> partIndices;
+    partIndices.reserve( ( size_t ) count * Mesh::FACET_DIM );
+
+    // the partition only keeps the vertices its facets use
+    for ( unsigned int i = 0; i < count; i++ )
+    {
+        for ( unsigned int corner = 0; corner < Mesh::FACET_DIM; corner++ )
+        {
+            unsigned int vertIdx = indices[( size_t ) facets[i] * Mesh::FACET_DIM + corner];
+
+            if ( remap[vertIdx] == NO_VERTEX )
+            {
+                remap[vertIdx] = x.size();
+                x.push_back( mesh.getX()[vertIdx] );
+                y.push_back( mesh.getY()[vertIdx] );
+                z.push_back( mesh.getZ()[vertIdx] );
+            }
+
+            partIndices.push_back( remap[vertIdx] );
+        }
+    }
+
+    partition.facetIds.assign( facets, facets + count );
+
+    HANDLE_CUDA_ERROR( cudaSetDevice( partition.device ) );
+
+    partition.sc.getMesh().assign(
+        x.data(), y.data(), z.data(), x.size(),
+        partIndices.data(), count,
+        nullptr, 0
+    );
+    partition.sc.pushToDevice();
+}
+
+
+/**
+ * @brief   Reallocates the peer frames on the primary device for a new
+ *          window size
+ *
+ * @param   width   The width of the window in pixels
+ * @param   height  The height of the window in pixels
+ *
+ * @return  void
+ */
+void SplitRenderer::resizePeerFrames( unsigned int width, unsigned int height )
+{
+    if ( ( width == peerWidth ) && ( height == peerHeight ) ) return;
+
+    HANDLE_CUDA_ERROR( cudaSetDevice( primaryDevice ) );
+
+    for ( const std::unique_ptr<DevicePartition> &partition : partitions )
+    {
+        if ( partition->device == primaryDevice ) continue;
+
+        if ( partition->d_peerFrame != nullptr )
+        {
+            HANDLE_CUDA_ERROR( cudaFree( partition->d_peerFrame ) );
+            partition->d_peerFrame = nullptr;
+        }
+
+        HANDLE_CUDA_ERROR(
+            cudaMalloc( &partition->d_peerFrame, ( size_t ) width * height * sizeof( unsigned int ) )
+        );
+    }
+
+    peerWidth = width;
+    peerHeight = height;
+}
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+/**
+ * @brief   Composites a partial frame over a frame, one thread per pixel
+ *
+ * @param   *partialFrame   The partial frame, its partition's lines on the
+ *                          background
+ * @param   *frame          The frame to composite into
+ * @param   pixelCount      The number of pixels of both frames
+ * @param   background      The 24-bit RGB background color
+ *
+ * @return  void
+ */
+__global__ void compositeFrame(
+    const unsigned int * partialFrame, unsigned int * frame,
+    unsigned int pixelCount, unsigned int background
+)
+{
+    unsigned int i = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if ( i >= pixelCount ) return;
+
+    unsigned int pixel = partialFrame[i];
+
+    if ( pixel != background ) frame[i] = pixel;
+}
+
+
+/* -------------------------------------------------------------------------- */
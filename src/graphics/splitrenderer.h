@@ -0,0 +1,168 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    splitrenderer.h
+ * @brief   Renders a mesh split across every visible device
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_SPLITRENDERER_H
+# define GRAPHICS_SPLITRENDERER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <memory>
+# include <vector>
+
+# include "culler.h"
+# include "mesh.h"
+# include "rasterizer.h"
+# include "shapecontainer.h"
+# include "threadpool.h"
+# include "viewcontext.h"
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * The share of a split mesh that lives on one device, with everything that
+ * device needs to draw it
+ */
+struct DevicePartition
+{
+    int device = 0;
+
+    ShapeContainer sc = ShapeContainer();
+    Rasterizer raster;
+    Culler culler;
+
+    // index in the full mesh of every facet of the partition
+    std::vector<unsigned int> facetIds = std::vector<unsigned int>();
+
+    // the partition's finished frame, copied to the primary device
+    unsigned int * d_peerFrame = nullptr;
+};
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A split renderer cuts a mesh into equal slabs of facets along the longest
+ * axis of its bounding box and puts one slab on each device, so a mesh is
+ * only limited by the memory of all the devices together. Every device
+ * transforms, culls and rasterizes its own slab on its own host thread, and
+ * the partial frames are copied peer to peer to the primary device, the
+ * one that was current when the mesh was split, which composites them.
+ * Slabs are compact in space, so a zoomed-in view culls most of them away.
+ */
+class SplitRenderer
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int COMPOSITE_BLOCK_SIZE = 256;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    SplitRenderer();
+    SplitRenderer( const SplitRenderer &renderer ) = delete;
+
+    ~SplitRenderer();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    SplitRenderer &operator=( const SplitRenderer &renderer ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static unsigned int getDeviceCount();
+
+    void split( const Mesh &mesh, unsigned int deviceCount );
+    void clear();
+
+    bool isSplit() const;
+    unsigned int getPartitionCount() const;
+    unsigned int getFacetCount() const;
+
+    void buildLevelsOfDetail();
+
+    void draw(
+        ViewContext *vc, Rasterizer &target,
+        unsigned int color, unsigned int background,
+        bool backFaceCulling, bool adaptiveDetail
+    );
+
+    int pick( const ViewContext *vc, int x, int y ) const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::vector<std::unique_ptr<DevicePartition>> partitions =
+        std::vector<std::unique_ptr<DevicePartition>>();
+
+    int primaryDevice = 0;
+    unsigned int facetCount = 0;
+
+    // size of the peer frames on the primary device
+    unsigned int peerWidth = 0;
+    unsigned int peerHeight = 0;
+
+    // one host thread per device
+    std::unique_ptr<ThreadPool> pool = nullptr;
+    unsigned int poolSize = 0;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static void buildPartition(
+        const Mesh &mesh, const unsigned int *facets, unsigned int count,
+        DevicePartition &partition
+    );
+
+    void resizePeerFrames( unsigned int width, unsigned int height );
+
+
+    /* ====================================================================== */
+};
+
+
+/* ------------------------------ GPU Kernels ------------------------------- */
+
+
+__global__ void compositeFrame(
+    const unsigned int * partialFrame, unsigned int * frame,
+    unsigned int pixelCount, unsigned int background
+);
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_SPLITRENDERER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,466 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    framecodec.cpp
+ * @brief   Delta compression of rendered frames for streaming to a viewer
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cstdint>
+
+# include "framecodec.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+// only 24-bit RGB is sent, whatever is in the high byte
+const unsigned int RGB_MASK = 0xFFFFFF;
+
+// width, height, flags and tile count
+const size_t FRAME_HEADER_SIZE = 4 + 4 + 1 + 4;
+const size_t TILE_COUNT_OFFSET = 4 + 4 + 1;
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * Reads the values of an encoded frame, failing at its end
+ */
+struct ByteReader
+{
+    const unsigned char *data;
+    size_t size;
+    size_t offset;
+};
+
+
+/* ---------------------------- Static Functions ---------------------------- */
+
+
+/**
+ * @brief   Appends a little-endian value to a byte buffer
+ *
+ * @param   &data   The buffer to append to
+ * @param   value   The value to append
+ * @param   bytes   The number of low bytes of the value to append
+ *
+ * @return  void
+ */
+static void putValue( std::vector<unsigned char> &data, uint32_t value, unsigned int bytes )
+{
+    for ( unsigned int i = 0; i < bytes; i++ ) data.push_back( ( value >> ( 8 * i ) ) & 0xFF );
+}
+
+
+/**
+ * @brief   Appends a base-128 varint, seven bits per byte with the high bit
+ *          set on every byte but the last
+ *
+ * @param   &data   The buffer to append to
+ * @param   value   The value to append
+ *
+ * @return  void
+ */
+static void putVarint( std::vector<unsigned char> &data, uint32_t value )
+{
+    while ( value >= 0x80 )
+    {
+        data.push_back( ( value & 0x7F ) | 0x80 );
+        value >>= 7;
+    }
+
+    data.push_back( value );
+}
+
+
+/**
+ * @brief   Appends a run of one color, its length followed by its color red
+ *          first
+ *
+ * @param   &data   The buffer to append to
+ * @param   length  The number of pixels in the run
+ * @param   color   The 24-bit RGB color of the run
+ *
+ * @return  void
+ */
+static void putRun( std::vector<unsigned char> &data, uint32_t length, uint32_t color )
+{
+    putVarint( data, length );
+
+    data.push_back( ( color >> 16 ) & 0xFF );
+    data.push_back( ( color >> 8 ) & 0xFF );
+    data.push_back( color & 0xFF );
+}
+
+
+/**
+ * @brief   Reads a little-endian value
+ *
+ * @param   &reader The reader to read from
+ * @param   bytes   The number of bytes of the value
+ *
+ * @return  The value read
+ */
+static uint32_t getValue( ByteReader &reader, unsigned int bytes )
+{
+    if ( reader.size - reader.offset < bytes ) throw FrameCodecException( "Truncated frame." );
+
+    uint32_t value = 0;
+
+    for ( unsigned int i = 0; i < bytes; i++ ) value |= ( uint32_t ) reader.data[reader.offset++] << ( 8 * i );
+
+    return value;
+}
+
+
+/**
+ * @brief   Reads a base-128 varint
+ *
+ * @param   &reader The reader to read from
+ *
+ * @return  The value read
+ */
+static uint32_t getVarint( ByteReader &reader )
+{
+    uint32_t value = 0;
+
+    for ( unsigned int shift = 0; shift < 32; shift += 7 )
+    {
+        uint32_t byte = getValue( reader, 1 );
+        value |= ( byte & 0x7F ) << shift;
+
+        if ( !( byte & 0x80 ) ) return value;
+    }
+
+    throw FrameCodecException( "Bad run length." );
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a decoder with no frame decoded yet
+ *
+ * @param   maxSize     The most bytes a frame may encode to, at its worst;
+ *                      a frame header claiming a larger frame is corrupt
+ */
+FrameDecoder::FrameDecoder( size_t maxSize ) :
+    maxSize( maxSize )
+{
+
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the most bytes a frame of a size can encode to, when every
+ *          tile is in it and every pixel is a run of its own
+ *
+ * @param   width       The width of the frame in pixels
+ * @param   height      The height of the frame in pixels
+ *
+ * @return  The size of the largest encoding in bytes
+ */
+size_t FrameEncoder::getMaxSize( unsigned int width, unsigned int height )
+{
+    size_t tilesX = ( width + TILE_SIZE - 1 ) / TILE_SIZE;
+    size_t tilesY = ( height + TILE_SIZE - 1 ) / TILE_SIZE;
+
+    // a run of one pixel is a one-byte length and three color bytes, and a
+    // longer run is never more than four bytes a pixel
+    return FRAME_HEADER_SIZE + tilesX * tilesY * 4 + ( size_t ) width * height * 4;
+}
+
+
+/**
+ * @brief   Encodes the tiles of a frame that changed since the last frame
+ *          encoded
+ *
+ * @param   *pixels     The row-major 24-bit RGB pixels of the frame
+ * @param   width       The width of the frame in pixels
+ * @param   height      The height of the frame in pixels
+ * @param   &data       Set to the encoded frame
+ *
+ * @return  True if the frame was encoded, false if nothing changed and
+ *          there is nothing to send
+ */
+bool FrameEncoder::encode(
+    const unsigned int *pixels, unsigned int width, unsigned int height,
+    std::vector<unsigned char> &data
+)
+{
+    bool keyFrame = ( width != this->width ) || ( height != this->height ) || reference.empty();
+
+    unsigned int tilesX = ( width + TILE_SIZE - 1 ) / TILE_SIZE;
+    unsigned int tilesY = ( height + TILE_SIZE - 1 ) / TILE_SIZE;
+
+    data.clear();
+    putValue( data, width, 4 );
+    putValue( data, height, 4 );
+    putValue( data, keyFrame ? FLAG_KEY_FRAME : 0, 1 );
+    putValue( data, 0, 4 );
+
+    // a delta frame has the size of the reference already
+    this->width = width;
+    this->height = height;
+
+    uint32_t tileCount = 0;
+
+    for ( unsigned int tileY = 0; tileY < tilesY; tileY++ )
+    {
+        for ( unsigned int tileX = 0; tileX < tilesX; tileX++ )
+        {
+            if ( !keyFrame && !isTileChanged( pixels, tileX, tileY ) ) continue;
+
+            putValue( data, tileX, 2 );
+            putValue( data, tileY, 2 );
+            encodeTile( pixels, tileX, tileY, data );
+
+            tileCount++;
+        }
+    }
+
+    if ( !keyFrame && ( tileCount == 0 ) )
+    {
+        data.clear();
+        return false;
+    }
+
+    for ( unsigned int i = 0; i < 4; i++ ) data[TILE_COUNT_OFFSET + i] = ( tileCount >> ( 8 * i ) ) & 0xFF;
+
+    reference.resize( ( size_t ) width * height );
+    for ( size_t i = 0; i < reference.size(); i++ ) reference[i] = pixels[i] & RGB_MASK;
+
+    return true;
+}
+
+
+/**
+ * @brief   Makes the next frame encoded a key frame, for a viewer that has
+ *          no frame to apply a delta to
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FrameEncoder::reset()
+{
+    reference.clear();
+    width = 0;
+    height = 0;
+}
+
+
+/**
+ * @brief   Applies an encoded frame to the last frame decoded
+ *
+ * @param   *data   The encoded frame
+ * @param   size    The size of the encoded frame in bytes
+ *
+ * @return  void
+ */
+void FrameDecoder::decode( const unsigned char *data, size_t size )
+{
+    ByteReader reader = { data, size, 0 };
+
+    if ( size < FRAME_HEADER_SIZE ) throw FrameCodecException( "Truncated frame." );
+
+    unsigned int frameWidth = getValue( reader, 4 );
+    unsigned int frameHeight = getValue( reader, 4 );
+    unsigned int flags = getValue( reader, 1 );
+    uint32_t tileCount = getValue( reader, 4 );
+
+    // checked before the pixels are allocated, which a header alone sizes
+    if ( ( frameWidth > MAX_FRAME_DIMENSION ) || ( frameHeight > MAX_FRAME_DIMENSION ) ||
+         ( FrameEncoder::getMaxSize( frameWidth, frameHeight ) > maxSize ) )
+    {
+        throw FrameCodecException( "Bad frame size." );
+    }
+
+    if ( flags & FrameEncoder::FLAG_KEY_FRAME )
+    {
+        width = frameWidth;
+        height = frameHeight;
+        pixels.assign( ( size_t ) width * height, 0 );
+    }
+    else if ( ( frameWidth != width ) || ( frameHeight != height ) )
+    {
+        throw FrameCodecException( "Delta frame does not match the last frame." );
+    }
+
+    unsigned int tileSize = FrameEncoder::TILE_SIZE;
+    unsigned int tilesX = ( width + tileSize - 1 ) / tileSize;
+    unsigned int tilesY = ( height + tileSize - 1 ) / tileSize;
+
+    for ( uint32_t tile = 0; tile < tileCount; tile++ )
+    {
+        unsigned int tileX = getValue( reader, 2 );
+        unsigned int tileY = getValue( reader, 2 );
+
+        if ( ( tileX >= tilesX ) || ( tileY >= tilesY ) ) throw FrameCodecException( "Bad tile position." );
+
+        unsigned int x0 = tileX * tileSize;
+        unsigned int y0 = tileY * tileSize;
+        unsigned int tileWidth = std::min( tileSize, width - x0 );
+        unsigned int tileHeight = std::min( tileSize, height - y0 );
+        unsigned int tilePixels = tileWidth * tileHeight;
+
+        for ( unsigned int pixel = 0; pixel < tilePixels; )
+        {
+            uint32_t length = getVarint( reader );
+
+            if ( ( length == 0 ) || ( length > tilePixels - pixel ) ) throw FrameCodecException( "Bad run length." );
+
+            // colors are written red first
+            uint32_t red = getValue( reader, 1 );
+            uint32_t green = getValue( reader, 1 );
+            uint32_t blue = getValue( reader, 1 );
+            uint32_t color = ( red << 16 ) | ( green << 8 ) | blue;
+
+            for ( uint32_t i = 0; i < length; i++, pixel++ )
+            {
+                unsigned int x = x0 + pixel % tileWidth;
+                unsigned int y = y0 + pixel / tileWidth;
+
+                pixels[( size_t ) y * width + x] = color;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief   Gets the last frame decoded
+ *
+ * @param   void
+ *
+ * @return  The row-major 24-bit RGB pixels of the frame
+ */
+const unsigned int *FrameDecoder::getPixels() const
+{
+    return pixels.data();
+}
+
+
+/**
+ * @brief   Gets the width of the last frame decoded
+ *
+ * @param   void
+ *
+ * @return  The width in pixels, 0 before the first frame
+ */
+unsigned int FrameDecoder::getWidth() const
+{
+    return width;
+}
+
+
+/**
+ * @brief   Gets the height of the last frame decoded
+ *
+ * @param   void
+ *
+ * @return  The height in pixels, 0 before the first frame
+ */
+unsigned int FrameDecoder::getHeight() const
+{
+    return height;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Determines if a tile differs from the last frame encoded
+ *
+ * @param   *pixels     The row-major 24-bit RGB pixels of the frame
+ * @param   tileX       The column of the tile
+ * @param   tileY       The row of the tile
+ *
+ * @return  True if any pixel of the tile changed, false otherwise
+ */
+bool FrameEncoder::isTileChanged( const unsigned int *pixels, unsigned int tileX, unsigned int tileY ) const
+{
+    unsigned int x0 = tileX * TILE_SIZE;
+    unsigned int y0 = tileY * TILE_SIZE;
+    unsigned int x1 = std::min( x0 + TILE_SIZE, width );
+    unsigned int y1 = std::min( y0 + TILE_SIZE, height );
+
+    for ( unsigned int y = y0; y < y1; y++ )
+    {
+        const unsigned int *row = pixels + ( size_t ) y * width;
+        const unsigned int *referenceRow = reference.data() + ( size_t ) y * width;
+
+        for ( unsigned int x = x0; x < x1; x++ )
+        {
+            if ( ( row[x] & RGB_MASK ) != referenceRow[x] ) return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief   Appends the runs of one color a tile is made of
+ *
+ * @param   *pixels     The row-major 24-bit RGB pixels of the frame
+ * @param   tileX       The column of the tile
+ * @param   tileY       The row of the tile
+ * @param   &data       The buffer to append to
+ *
+ * @return  void
+ */
+void FrameEncoder::encodeTile(
+    const unsigned int *pixels, unsigned int tileX, unsigned int tileY,
+    std::vector<unsigned char> &data
+) const
+{
+    unsigned int x0 = tileX * TILE_SIZE;
+    unsigned int y0 = tileY * TILE_SIZE;
+    unsigned int x1 = std::min( x0 + TILE_SIZE, width );
+    unsigned int y1 = std::min( y0 + TILE_SIZE, height );
+
+    uint32_t runColor = 0;
+    uint32_t runLength = 0;
+
+    for ( unsigned int y = y0; y < y1; y++ )
+    {
+        const unsigned int *row = pixels + ( size_t ) y * width;
+
+        for ( unsigned int x = x0; x < x1; x++ )
+        {
+            uint32_t color = row[x] & RGB_MASK;
+
+            if ( ( runLength > 0 ) && ( color == runColor ) )
+            {
+                runLength++;
+                continue;
+            }
+
+            if ( runLength > 0 )
+            {
+                putRun( data, runLength, runColor );
+            }
+
+            runColor = color;
+            runLength = 1;
+        }
+    }
+
+    putRun( data, runLength, runColor );
+}
+
+
+/* -------------------------------------------------------------------------- */
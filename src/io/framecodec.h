@@ -0,0 +1,166 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    framecodec.h
+ * @brief   Delta compression of rendered frames for streaming to a viewer
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef IO_FRAMECODEC_H
+# define IO_FRAMECODEC_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class FrameCodecException : public std::runtime_error
+{
+public:
+    explicit FrameCodecException( const std::string& msg ):
+    std::runtime_error( ( std::string( "FrameCodec Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/**
+ * A frame is cut into TILE_SIZE square tiles, and only the tiles that
+ * differ from the last frame encoded are written, each as runs of one
+ * color in row-major order within the tile. A wireframe is mostly runs of
+ * the background, so a changed tile is a few dozen bytes, and a frame in
+ * which nothing moved is not written at all. The first frame, and every
+ * frame after the size changes or reset is called, is a key frame with
+ * every tile in it.
+ *
+ * An encoded frame is its width and height as 32-bit values, a byte of
+ * flags and the 32-bit number of tiles, then for every tile its 16-bit
+ * column and row and its runs. A run is its length as a base-128 varint
+ * followed by its color as three bytes, red first. Every other value is
+ * little-endian.
+ */
+class FrameEncoder
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int TILE_SIZE = 32;
+
+    static constexpr unsigned char FLAG_KEY_FRAME = 0x01;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static size_t getMaxSize( unsigned int width, unsigned int height );
+
+    bool encode(
+        const unsigned int *pixels, unsigned int width, unsigned int height,
+        std::vector<unsigned char> &data
+    );
+
+    void reset();
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // the last frame encoded, which the next one is a delta against
+    std::vector<unsigned int> reference = std::vector<unsigned int>();
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool isTileChanged( const unsigned int *pixels, unsigned int tileX, unsigned int tileY ) const;
+
+    void encodeTile(
+        const unsigned int *pixels, unsigned int tileX, unsigned int tileY,
+        std::vector<unsigned char> &data
+    ) const;
+
+
+    /* ====================================================================== */
+};
+
+
+/**
+ * Rebuilds the frames written by a frame encoder, one after the other, in
+ * the order they were encoded
+ */
+class FrameDecoder
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // wider or taller frames are taken as corrupt
+    static constexpr unsigned int MAX_FRAME_DIMENSION = 16384;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit FrameDecoder( size_t maxSize );
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void decode( const unsigned char *data, size_t size );
+
+    const unsigned int *getPixels() const;
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // frames that could encode to more bytes are taken as corrupt
+    size_t maxSize;
+
+    std::vector<unsigned int> pixels = std::vector<unsigned int>();
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // IO_FRAMECODEC_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,489 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    imagewriter.cpp
+ * @brief   Writes rendered frames to PNG and PPM image files
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstdint>
+# include <cstring>
+# include <fstream>
+
+# include "imagewriter.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+const unsigned int PNG_FILTER_NONE = 0;
+const unsigned int PNG_COLOR_TYPE_RGB = 2;
+const unsigned int PNG_BIT_DEPTH = 8;
+
+const unsigned int RGB_CHANNELS = 3;
+
+// zlib header for a deflate stream with a 32K window and no dictionary
+const unsigned char ZLIB_HEADER[2] = { 0x78, 0x01 };
+
+// deflate length codes 257 to 285, RFC 1951 section 3.2.5
+const unsigned int DEFLATE_LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+const unsigned int DEFLATE_LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+const unsigned int DEFLATE_MIN_MATCH = 3;
+const unsigned int DEFLATE_MAX_MATCH = 258;
+const unsigned int DEFLATE_END_OF_BLOCK = 256;
+
+// matches only ever reach back one pixel
+const unsigned int DEFLATE_PIXEL_DISTANCE_CODE = 2;
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * Packs deflate's least significant bit first codes into bytes
+ */
+struct BitWriter
+{
+    std::vector<unsigned char> &out;
+
+    uint32_t buffer;
+    unsigned int bitCount;
+};
+
+
+/* ---------------------------- Static Functions ---------------------------- */
+
+
+/**
+ * @brief   Appends bits to a deflate stream, least significant bit first
+ *
+ * @param   &writer     The bit writer to append to
+ * @param   value       The bits to append
+ * @param   count       The number of bits of value to append
+ *
+ * @return  void
+ */
+static void writeBits( BitWriter &writer, uint32_t value, unsigned int count )
+{
+    writer.buffer |= value << writer.bitCount;
+    writer.bitCount += count;
+
+    while ( writer.bitCount >= 8 )
+    {
+        writer.out.push_back( writer.buffer & 0xFF );
+        writer.buffer >>= 8;
+        writer.bitCount -= 8;
+    }
+}
+
+
+/**
+ * @brief   Appends a Huffman code to a deflate stream, which stores codes
+ *          most significant bit first
+ *
+ * @param   &writer     The bit writer to append to
+ * @param   code        The code to append
+ * @param   length      The length of the code in bits
+ *
+ * @return  void
+ */
+static void writeCode( BitWriter &writer, uint32_t code, unsigned int length )
+{
+    uint32_t reversed = 0;
+
+    for ( unsigned int i = 0; i < length; i++ )
+    {
+        reversed = ( reversed << 1 ) | ( ( code >> i ) & 1 );
+    }
+
+    writeBits( writer, reversed, length );
+}
+
+
+/**
+ * @brief   Appends a literal or length symbol with the fixed Huffman codes
+ *
+ * @param   &writer     The bit writer to append to
+ * @param   symbol      The literal/length symbol, 0 to 287
+ *
+ * @return  void
+ */
+static void writeFixedSymbol( BitWriter &writer, unsigned int symbol )
+{
+    if ( symbol < 144 ) writeCode( writer, 0x30 + symbol, 8 );
+    else if ( symbol < 256 ) writeCode( writer, 0x190 + ( symbol - 144 ), 9 );
+    else if ( symbol < 280 ) writeCode( writer, symbol - 256, 7 );
+    else writeCode( writer, 0xC0 + ( symbol - 280 ), 8 );
+}
+
+
+/**
+ * @brief   Appends a match of the previous pixel with the fixed Huffman codes
+ *
+ * @param   &writer     The bit writer to append to
+ * @param   length      The length of the match in bytes, 3 to 258
+ *
+ * @return  void
+ */
+static void writePixelMatch( BitWriter &writer, unsigned int length )
+{
+    unsigned int code = 28;
+    while ( DEFLATE_LENGTH_BASE[code] > length ) code--;
+
+    writeFixedSymbol( writer, 257 + code );
+    writeBits( writer, length - DEFLATE_LENGTH_BASE[code], DEFLATE_LENGTH_EXTRA[code] );
+
+    // distance codes are five bits, no extra bits for a distance of 3
+    writeCode( writer, DEFLATE_PIXEL_DISTANCE_CODE, 5 );
+}
+
+
+/**
+ * @brief   Compresses bytes into a zlib stream with a single fixed Huffman
+ *          block, encoding repeats of the previous pixel as matches
+ *
+ * @param   &raw    The bytes to compress
+ *
+ * @return  The zlib stream
+ */
+static std::vector<unsigned char> deflatePixels( const std::vector<unsigned char> &raw )
+{
+    std::vector<unsigned char> out( ZLIB_HEADER, ZLIB_HEADER + sizeof( ZLIB_HEADER ) );
+    BitWriter writer = { out, 0, 0 };
+
+    // final block, fixed Huffman codes
+    writeBits( writer, 1, 1 );
+    writeBits( writer, 1, 2 );
+
+    size_t i = 0;
+
+    while ( i < raw.size() )
+    {
+        size_t length = 0;
+
+        if ( i >= RGB_CHANNELS )
+        {
+            while ( ( length < DEFLATE_MAX_MATCH ) &&
+                    ( i + length < raw.size() ) &&
+                    ( raw[i + length] == raw[i + length - RGB_CHANNELS] ) )
+            {
+                length++;
+            }
+        }
+
+        if ( length >= DEFLATE_MIN_MATCH )
+        {
+            writePixelMatch( writer, length );
+            i += length;
+        }
+        else
+        {
+            writeFixedSymbol( writer, raw[i] );
+            i++;
+        }
+    }
+
+    writeFixedSymbol( writer, DEFLATE_END_OF_BLOCK );
+    if ( writer.bitCount > 0 ) writeBits( writer, 0, 8 - writer.bitCount );
+
+    // Adler-32 of the uncompressed bytes, big-endian
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    for ( unsigned char byte : raw )
+    {
+        a = ( a + byte ) % 65521;
+        b = ( b + a ) % 65521;
+    }
+
+    uint32_t adler = ( b << 16 ) | a;
+
+    for ( int shift = 24; shift >= 0; shift -= 8 )
+    {
+        out.push_back( ( adler >> shift ) & 0xFF );
+    }
+
+    return out;
+}
+
+
+/**
+ * @brief   Builds the lookup table of the PNG CRC-32
+ *
+ * @param   void
+ *
+ * @return  The CRC of every byte value
+ */
+static std::vector<uint32_t> buildCRCTable()
+{
+    std::vector<uint32_t> table( 256 );
+
+    for ( uint32_t n = 0; n < 256; n++ )
+    {
+        uint32_t c = n;
+
+        for ( unsigned int k = 0; k < 8; k++ )
+        {
+            c = ( c & 1 ) ? ( 0xEDB88320 ^ ( c >> 1 ) ) : ( c >> 1 );
+        }
+
+        table[n] = c;
+    }
+
+    return table;
+}
+
+
+/**
+ * @brief   Updates a CRC-32 with more bytes
+ *
+ * @param   crc     The CRC of the bytes so far, inverted
+ * @param   *data   The bytes to add
+ * @param   size    The number of bytes to add
+ *
+ * @return  The updated CRC, inverted
+ */
+static uint32_t updateCRC( uint32_t crc, const unsigned char *data, size_t size )
+{
+    static const std::vector<uint32_t> table = buildCRCTable();
+
+    for ( size_t i = 0; i < size; i++ )
+    {
+        crc = table[( crc ^ data[i] ) & 0xFF] ^ ( crc >> 8 );
+    }
+
+    return crc;
+}
+
+
+/**
+ * @brief   Appends a big-endian 32-bit value
+ *
+ * @param   &out    The bytes to append to
+ * @param   value   The value to append
+ *
+ * @return  void
+ */
+static void appendUInt32( std::vector<unsigned char> &out, uint32_t value )
+{
+    for ( int shift = 24; shift >= 0; shift -= 8 )
+    {
+        out.push_back( ( value >> shift ) & 0xFF );
+    }
+}
+
+
+/**
+ * @brief   Appends a PNG chunk
+ *
+ * @param   &out    The bytes to append to
+ * @param   *type   The four-character chunk type
+ * @param   &data   The chunk data
+ *
+ * @return  void
+ */
+static void appendChunk( std::vector<unsigned char> &out, const char *type, const std::vector<unsigned char> &data )
+{
+    appendUInt32( out, data.size() );
+
+    size_t start = out.size();
+    out.insert( out.end(), type, type + 4 );
+    out.insert( out.end(), data.begin(), data.end() );
+
+    // the CRC covers the type and the data, not the length
+    uint32_t crc = updateCRC( 0xFFFFFFFF, out.data() + start, out.size() - start ) ^ 0xFFFFFFFF;
+    appendUInt32( out, crc );
+}
+
+
+/**
+ * @brief   Determines if a path ends with an extension
+ *
+ * @param   &path       The path to check
+ * @param   *extension  The extension, including the dot
+ *
+ * @return  True if the path ends with the extension, false otherwise
+ */
+static bool hasExtension( const std::string &path, const char *extension )
+{
+    size_t length = strlen( extension );
+
+    return ( path.size() >= length ) &&
+           ( path.compare( path.size() - length, length, extension ) == 0 );
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Writes a frame to an image file, in the format its extension
+ *          names
+ *
+ * @param   &path       The path of the image file, ending in .png or .ppm
+ * @param   *pixels     The row-major 24-bit RGB pixels of the frame
+ * @param   width       The width of the frame in pixels
+ * @param   height      The height of the frame in pixels
+ *
+ * @return  void
+ */
+void ImageWriter::write(
+    const std::string &path,
+    const unsigned int *pixels, unsigned int width, unsigned int height
+)
+{
+    if ( hasExtension( path, PNG_EXTENSION ) ) writePNG( path, pixels, width, height );
+    else if ( hasExtension( path, PPM_EXTENSION ) ) writePPM( path, pixels, width, height );
+    else throw ImageWriterException( "Unsupported image format: " + path );
+}
+
+
+/**
+ * @brief   Writes a frame to a PNG file
+ *
+ * @param   &path       The path of the image file
+ * @param   *pixels     The row-major 24-bit RGB pixels of the frame
+ * @param   width       The width of the frame in pixels
+ * @param   height      The height of the frame in pixels
+ *
+ * @return  void
+ */
+void ImageWriter::writePNG(
+    const std::string &path,
+    const unsigned int *pixels, unsigned int width, unsigned int height
+)
+{
+    writeFile( path, encodePNG( pixels, width, height ) );
+}
+
+
+/**
+ * @brief   Writes a frame to a binary PPM file
+ *
+ * @param   &path       The path of the image file
+ * @param   *pixels     The row-major 24-bit RGB pixels of the frame
+ * @param   width       The width of the frame in pixels
+ * @param   height      The height of the frame in pixels
+ *
+ * @return  void
+ */
+void ImageWriter::writePPM(
+    const std::string &path,
+    const unsigned int *pixels, unsigned int width, unsigned int height
+)
+{
+    std::string header = "P6\n" + std::to_string( width ) + " " + std::to_string( height ) + "\n255\n";
+
+    std::vector<unsigned char> data( header.begin(), header.end() );
+    data.reserve( data.size() + ( size_t ) width * height * RGB_CHANNELS );
+
+    for ( size_t i = 0; i < ( size_t ) width * height; i++ )
+    {
+        data.push_back( ( pixels[i] >> 16 ) & 0xFF );
+        data.push_back( ( pixels[i] >> 8 ) & 0xFF );
+        data.push_back( pixels[i] & 0xFF );
+    }
+
+    writeFile( path, data );
+}
+
+
+/**
+ * @brief   Encodes a frame as an 8-bit RGB PNG image
+ *
+ * @param   *pixels     The row-major 24-bit RGB pixels of the frame
+ * @param   width       The width of the frame in pixels
+ * @param   height      The height of the frame in pixels
+ *
+ * @return  The bytes of the PNG file
+ */
+std::vector<unsigned char> ImageWriter::encodePNG(
+    const unsigned int *pixels, unsigned int width, unsigned int height
+)
+{
+    if ( ( width == 0 ) || ( height == 0 ) )
+    {
+        throw ImageWriterException( "Cannot encode an empty image." );
+    }
+
+    // every scanline starts with its filter type
+    std::vector<unsigned char> raw;
+    raw.reserve( ( size_t ) height * ( 1 + ( size_t ) width * RGB_CHANNELS ) );
+
+    for ( unsigned int y = 0; y < height; y++ )
+    {
+        raw.push_back( PNG_FILTER_NONE );
+
+        for ( unsigned int x = 0; x < width; x++ )
+        {
+            unsigned int pixel = pixels[( size_t ) y * width + x];
+
+            raw.push_back( ( pixel >> 16 ) & 0xFF );
+            raw.push_back( ( pixel >> 8 ) & 0xFF );
+            raw.push_back( pixel & 0xFF );
+        }
+    }
+
+    std::vector<unsigned char> header;
+    appendUInt32( header, width );
+    appendUInt32( header, height );
+    header.push_back( PNG_BIT_DEPTH );
+    header.push_back( PNG_COLOR_TYPE_RGB );
+    header.push_back( 0 );  // deflate
+    header.push_back( 0 );  // adaptive filtering
+    header.push_back( 0 );  // not interlaced
+
+    std::vector<unsigned char> png( PNG_SIGNATURE, PNG_SIGNATURE + sizeof( PNG_SIGNATURE ) );
+    appendChunk( png, "IHDR", header );
+    appendChunk( png, "IDAT", deflatePixels( raw ) );
+    appendChunk( png, "IEND", std::vector<unsigned char>() );
+
+    return png;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Writes bytes to a file, replacing it
+ *
+ * @param   &path   The path of the file
+ * @param   &data   The bytes to write
+ *
+ * @return  void
+ */
+void ImageWriter::writeFile( const std::string &path, const std::vector<unsigned char> &data )
+{
+    std::ofstream out( path.c_str(), std::ios::binary | std::ios::trunc );
+
+    if ( !out.is_open() )
+    {
+        throw ImageWriterException( "Failed to open image file: " + path );
+    }
+
+    out.write( ( const char * ) data.data(), data.size() );
+    out.close();
+
+    if ( !out )
+    {
+        throw ImageWriterException( "Failed to write image file: " + path );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,101 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    imagewriter.h
+ * @brief   Writes rendered frames to PNG and PPM image files
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef IO_IMAGEWRITER_H
+# define IO_IMAGEWRITER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class ImageWriterException : public std::runtime_error
+{
+public:
+    explicit ImageWriterException( const std::string& msg ):
+    std::runtime_error( ( std::string( "ImageWriter Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/**
+ * Frames are row-major 24-bit RGB pixels, 0xRRGGBB in the low bits of an
+ * unsigned int, the way the rasterizer and the graphics contexts keep
+ * them. PNG files are compressed without an external library: a wireframe
+ * is mostly runs of the background color, and encoding only runs of
+ * repeated pixels as deflate matches already shrinks a frame to a few
+ * percent of its raw size.
+ */
+class ImageWriter
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr const char * PNG_EXTENSION = ".png";
+    static constexpr const char * PPM_EXTENSION = ".ppm";
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static void write(
+        const std::string &path,
+        const unsigned int *pixels, unsigned int width, unsigned int height
+    );
+
+    static void writePNG(
+        const std::string &path,
+        const unsigned int *pixels, unsigned int width, unsigned int height
+    );
+
+    static void writePPM(
+        const std::string &path,
+        const unsigned int *pixels, unsigned int width, unsigned int height
+    );
+
+    static std::vector<unsigned char> encodePNG(
+        const unsigned int *pixels, unsigned int width, unsigned int height
+    );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static void writeFile( const std::string &path, const std::vector<unsigned char> &data );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // IO_IMAGEWRITER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,235 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mappedfile.cpp
+ * @brief   Read-only memory-mapped file
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstring>
+
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+
+# include "mappedfile.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ull;
+const unsigned long long FNV_PRIME = 1099511628211ull;
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a mapped file with no file open
+ *
+ * @param   void
+ *
+ * @return  The created mapped file
+ */
+MappedFile::MappedFile() = default;
+
+
+/**
+ * @brief   Creates a mapped file and maps the specified file
+ *
+ * @param   &filePath   The path of the file to map
+ *
+ * @return  The created mapped file
+ */
+MappedFile::MappedFile( const std::string &filePath )
+{
+    open( filePath );
+}
+
+
+/**
+ * @brief   Mapped file destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Maps a file read-only, replacing any file already mapped
+ *
+ * @param   &filePath   The path of the file to map
+ *
+ * @return  void
+ */
+void MappedFile::open( const std::string &filePath )
+{
+    close();
+
+    fd = ::open( filePath.c_str(), O_RDONLY );
+
+    // throw error if file fails to open
+    if ( fd < 0 )
+    {
+        throw MappedFileException( "File does not exist." );
+    }
+
+    struct stat fileStat;
+
+    if ( fstat( fd, &fileStat ) != 0 )
+    {
+        close();
+        throw MappedFileException( "Could not read file size." );
+    }
+
+    size = fileStat.st_size;
+    modifiedTime = fileStat.st_mtim.tv_sec * 1000000000ll + fileStat.st_mtim.tv_nsec;
+
+    // empty files cannot be mapped
+    if ( size == 0 ) return;
+
+    void *mapping = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    if ( mapping == MAP_FAILED )
+    {
+        close();
+        throw MappedFileException( "Could not map file." );
+    }
+
+    // readers go through the whole file, often from several threads
+    madvise( mapping, size, MADV_WILLNEED );
+
+    data = ( const char * ) mapping;
+}
+
+
+/**
+ * @brief   Unmaps the file and closes its descriptor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void MappedFile::close()
+{
+    if ( data != nullptr )
+    {
+        munmap( ( void * ) data, size );
+        data = nullptr;
+    }
+
+    if ( fd >= 0 )
+    {
+        ::close( fd );
+        fd = -1;
+    }
+
+    size = 0;
+    modifiedTime = 0;
+}
+
+
+/**
+ * @brief   Determines if a file is open
+ *
+ * @param   void
+ *
+ * @return  True if a file is open, false otherwise
+ */
+bool MappedFile::isOpen() const
+{
+    return fd >= 0;
+}
+
+
+/**
+ * @brief   Gets the mapped contents of the file
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first byte of the file, or nullptr if the file
+ *          is empty or not open
+ */
+const char *MappedFile::getData() const
+{
+    return data;
+}
+
+
+/**
+ * @brief   Gets the size of the file
+ *
+ * @param   void
+ *
+ * @return  The size of the file in bytes
+ */
+size_t MappedFile::getSize() const
+{
+    return size;
+}
+
+
+/**
+ * @brief   Gets the last modification time of the file
+ *
+ * @param   void
+ *
+ * @return  The modification time in nanoseconds since the epoch
+ */
+long long MappedFile::getModifiedTime() const
+{
+    return modifiedTime;
+}
+
+
+/**
+ * @brief   Hashes the contents of the file
+ *
+ * FNV-1a over 64-bit words, with the tail folded in byte by byte. Each
+ * step also folds the high half down, since a multiply only carries bits
+ * upward. This is not the standard byte-wise FNV-1a, it only has to be
+ * stable and fast enough to run over a large file.
+ *
+ * @param   void
+ *
+ * @return  The 64-bit hash of the contents
+ */
+unsigned long long MappedFile::hash() const
+{
+    unsigned long long result = FNV_OFFSET_BASIS;
+
+    size_t wordCount = size / sizeof( unsigned long long );
+
+    for ( size_t i = 0; i < wordCount; i++ )
+    {
+        unsigned long long word;
+        memcpy( &word, data + i * sizeof( word ), sizeof( word ) );
+
+        result = ( result ^ word ) * FNV_PRIME;
+        result ^= result >> 32;
+    }
+
+    for ( size_t i = wordCount * sizeof( unsigned long long ); i < size; i++ )
+    {
+        result = ( result ^ ( unsigned char ) data[i] ) * FNV_PRIME;
+    }
+
+    return result;
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,97 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mappedfile.h
+ * @brief   Read-only memory-mapped file
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef IO_MAPPEDFILE_H
+# define IO_MAPPEDFILE_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <stdexcept>
+# include <string>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class MappedFileException : public std::runtime_error
+{
+public:
+    explicit MappedFileException( const std::string& msg ):
+    std::runtime_error( ( std::string( "MappedFile Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+class MappedFile
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    MappedFile();
+    explicit MappedFile( const std::string &filePath );
+    MappedFile( const MappedFile &file ) = delete;
+
+    ~MappedFile();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    MappedFile &operator=( const MappedFile &file ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void open( const std::string &filePath );
+    void close();
+
+    bool isOpen() const;
+
+    const char *getData() const;
+    size_t getSize() const;
+    long long getModifiedTime() const;
+
+    unsigned long long hash() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    int fd = -1;
+    const char * data = nullptr;
+    size_t size = 0;
+    long long modifiedTime = 0;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // IO_MAPPEDFILE_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,232 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    meshcache.cpp
+ * @brief   Preprocessed mesh cache stored next to a source model file
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstdint>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <fstream>
+
+# include "mappedfile.h"
+# include "meshcache.h"
+
+
+/* -------------------------------- Constants ------------------------------- */
+
+
+const char CACHE_MAGIC[8] = { 'S', 'T', 'L', 'M', 'E', 'S', 'H', '\0' };
+const uint32_t CACHE_VERSION = 1;
+
+
+/* ---------------------------------- Types --------------------------------- */
+
+
+/**
+ * The on-disk cache header, followed by x[], y[] and z[] of vertexCount
+ * floats each, facetCount * 3 indices and edgeCount * 2 indices.
+ */
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    uint64_t sourceHash;
+
+    uint32_t vertexCount;
+    uint32_t facetCount;
+    uint32_t edgeCount;
+    uint32_t reserved;
+
+    float boundsMin[Mesh::COORD_DIM];
+    float boundsMax[Mesh::COORD_DIM];
+};
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the path of the cache file for a source model file
+ *
+ * @param   &sourcePath     The path of the source model file
+ *
+ * @return  The path of the cache file
+ */
+std::string MeshCache::getCachePath( const std::string &sourcePath )
+{
+    return sourcePath + CACHE_EXTENSION;
+}
+
+
+/**
+ * @brief   Loads a mesh from the cache file of a source model file
+ *
+ * The cache is only used if it matches the source. A matching size and
+ * modification time is trusted as is; if only the time differs, the source
+ * is hashed, so copied or touched files still hit the cache. Setting
+ * RENDER_NO_MESH_CACHE skips the cache entirely.
+ *
+ * @param   &sourcePath     The path of the source model file
+ * @param   &mesh           The mesh to load into, left untouched on a miss
+ *
+ * @return  True if the mesh was loaded from the cache, false otherwise
+ */
+bool MeshCache::load( const std::string &sourcePath, Mesh &mesh )
+{
+    if ( getenv( "RENDER_NO_MESH_CACHE" ) ) return false;
+
+    MappedFile source;
+    MappedFile cache;
+
+    try
+    {
+        source.open( sourcePath );
+        cache.open( getCachePath( sourcePath ) );
+    }
+    catch ( const MappedFileException & )
+    {
+        return false;
+    }
+
+    if ( cache.getSize() < sizeof( CacheHeader ) ) return false;
+
+    CacheHeader header;
+    memcpy( &header, cache.getData(), sizeof( header ) );
+
+    if ( ( memcmp( header.magic, CACHE_MAGIC, sizeof( CACHE_MAGIC ) ) != 0 ) ||
+         ( header.version != CACHE_VERSION ) ||
+         ( header.headerSize != sizeof( CacheHeader ) ) )
+    {
+        return false;
+    }
+
+    // the payload must fill the rest of the file exactly
+    size_t vertexBytes = ( size_t ) header.vertexCount * sizeof( float );
+    size_t indexBytes = ( size_t ) header.facetCount * Mesh::FACET_DIM * sizeof( unsigned int );
+    size_t edgeBytes = ( size_t ) header.edgeCount * Mesh::EDGE_DIM * sizeof( unsigned int );
+
+    if ( cache.getSize() != sizeof( CacheHeader ) + vertexBytes * Mesh::COORD_DIM + indexBytes + edgeBytes )
+    {
+        return false;
+    }
+
+    // make sure the cache was built from this version of the source
+    if ( header.sourceSize != source.getSize() ) return false;
+
+    if ( ( header.sourceModifiedTime != source.getModifiedTime() ) &&
+         ( header.sourceHash != source.hash() ) )
+    {
+        return false;
+    }
+
+    const char *payload = cache.getData() + sizeof( CacheHeader );
+
+    const float *x = ( const float * ) payload;
+    const float *y = ( const float * ) ( payload + vertexBytes );
+    const float *z = ( const float * ) ( payload + vertexBytes * 2 );
+    const unsigned int *indices = ( const unsigned int * ) ( payload + vertexBytes * 3 );
+    const unsigned int *edges = ( const unsigned int * ) ( payload + vertexBytes * 3 + indexBytes );
+
+    try
+    {
+        mesh.assign(
+            x, y, z, header.vertexCount,
+            indices, header.facetCount,
+            edges, header.edgeCount
+        );
+    }
+    catch ( const MeshException & )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief   Stores a mesh in the cache file of a source model file
+ *
+ * The mesh must already have its edge list, i.e. have been pushed to the
+ * device once. The cache is written to a temporary file and renamed into
+ * place, so a reader never sees a partial cache. Failing to write a cache
+ * is not an error, the next open just parses the source again.
+ *
+ * @param   &sourcePath     The path of the source model file
+ * @param   &mesh           The mesh built from the source
+ *
+ * @return  True if the cache was written, false otherwise
+ */
+bool MeshCache::store( const std::string &sourcePath, const Mesh &mesh )
+{
+    if ( getenv( "RENDER_NO_MESH_CACHE" ) ) return false;
+    if ( !mesh.hasEdges() ) return false;
+
+    CacheHeader header;
+    memset( &header, 0, sizeof( header ) );
+
+    try
+    {
+        MappedFile source( sourcePath );
+
+        header.sourceSize = source.getSize();
+        header.sourceModifiedTime = source.getModifiedTime();
+        header.sourceHash = source.hash();
+    }
+    catch ( const MappedFileException & )
+    {
+        return false;
+    }
+
+    memcpy( header.magic, CACHE_MAGIC, sizeof( CACHE_MAGIC ) );
+    header.version = CACHE_VERSION;
+    header.headerSize = sizeof( CacheHeader );
+
+    header.vertexCount = mesh.getVertexCount();
+    header.facetCount = mesh.getFacetCount();
+    header.edgeCount = mesh.getEdgeCount();
+
+    mesh.getBounds( header.boundsMin, header.boundsMax );
+
+    size_t vertexBytes = ( size_t ) header.vertexCount * sizeof( float );
+    size_t indexBytes = ( size_t ) header.facetCount * Mesh::FACET_DIM * sizeof( unsigned int );
+    size_t edgeBytes = ( size_t ) header.edgeCount * Mesh::EDGE_DIM * sizeof( unsigned int );
+
+    std::string cachePath = getCachePath( sourcePath );
+    std::string tempPath = cachePath + ".tmp";
+
+    std::ofstream out( tempPath.c_str(), std::ios::binary | std::ios::trunc );
+
+    if ( !out.is_open() ) return false;
+
+    out.write( ( const char * ) &header, sizeof( header ) );
+    out.write( ( const char * ) mesh.getX(), vertexBytes );
+    out.write( ( const char * ) mesh.getY(), vertexBytes );
+    out.write( ( const char * ) mesh.getZ(), vertexBytes );
+    out.write( ( const char * ) mesh.getIndices(), indexBytes );
+    out.write( ( const char * ) mesh.getEdges(), edgeBytes );
+    out.close();
+
+    if ( !out || ( std::rename( tempPath.c_str(), cachePath.c_str() ) != 0 ) )
+    {
+        std::remove( tempPath.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,65 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    meshcache.h
+ * @brief   Preprocessed mesh cache stored next to a source model file
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef IO_MESHCACHE_H
+# define IO_MESHCACHE_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <string>
+
+# include "mesh.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A cache file holds a welded mesh exactly as Mesh keeps it: the x[], y[],
+ * z[] vertex pool, the index buffer, the unique edge list and the bounding
+ * box. Its header records the size, modification time and content hash of
+ * the source file it was built from, so a stale cache is never used.
+ */
+class MeshCache
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr const char * CACHE_EXTENSION = ".meshcache";
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static std::string getCachePath( const std::string &sourcePath );
+
+    static bool load( const std::string &sourcePath, Mesh &mesh );
+    static bool store( const std::string &sourcePath, const Mesh &mesh );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // IO_MESHCACHE_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,464 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    remotelink.cpp
+ * @brief   Message connection between a render server and a remote viewer
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <arpa/inet.h>
+# include <cerrno>
+# include <cstring>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/socket.h>
+# include <unistd.h>
+# include <utility>
+
+# include "remotelink.h"
+
+
+/* ---------------------------- Static Functions ---------------------------- */
+
+
+/**
+ * @brief   Appends a 32-bit value in network byte order to a byte buffer
+ *
+ * @param   &data   The buffer to append to
+ * @param   value   The value to append
+ *
+ * @return  void
+ */
+static void putNetworkValue( std::vector<unsigned char> &data, uint32_t value )
+{
+    uint32_t network = htonl( value );
+    const unsigned char *bytes = ( const unsigned char * ) &network;
+
+    data.insert( data.end(), bytes, bytes + sizeof( network ) );
+}
+
+
+/**
+ * @brief   Reads a 32-bit value in network byte order
+ *
+ * @param   *data   The bytes to read from
+ *
+ * @return  The value read
+ */
+static uint32_t getNetworkValue( const unsigned char *data )
+{
+    uint32_t network;
+    memcpy( &network, data, sizeof( network ) );
+
+    return ntohl( network );
+}
+
+
+/**
+ * @brief   Turns off Nagle's algorithm on a connected socket
+ *
+ * @param   fd  The socket
+ *
+ * @return  void
+ */
+static void setNoDelay( int fd )
+{
+    int enabled = 1;
+    setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof( enabled ) );
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a link that is not connected
+ *
+ * @param   void
+ *
+ * @return  The created remote link
+ */
+RemoteLink::RemoteLink() = default;
+
+
+/**
+ * @brief   Creates a link over a connected socket, which it takes over
+ *
+ * @param   fd  The connected socket
+ *
+ * @return  The created remote link
+ */
+RemoteLink::RemoteLink( int fd ) :
+    fd( fd )
+{
+
+}
+
+
+/**
+ * @brief   Creates a link that takes over the connection of another link,
+ *          leaving it closed
+ *
+ * @param   &&link  The remote link to move from
+ *
+ * @return  The created remote link
+ */
+RemoteLink::RemoteLink( RemoteLink &&link ) noexcept :
+    fd( link.fd ), inbox( std::move( link.inbox ) )
+{
+    link.fd = -1;
+    link.inbox.clear();
+}
+
+
+/**
+ * @brief   Remote link destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+RemoteLink::~RemoteLink()
+{
+    close();
+}
+
+
+/* -------------------------- Overloaded Operators -------------------------- */
+
+
+/**
+ * @brief   Closes this link and takes over the connection of another link,
+ *          leaving it closed
+ *
+ * @param   &&link  The remote link to move from
+ *
+ * @return  A reference to this remote link
+ */
+RemoteLink &RemoteLink::operator=( RemoteLink &&link ) noexcept
+{
+    if ( this == &link ) return *this;
+
+    close();
+
+    fd = link.fd;
+    inbox = std::move( link.inbox );
+
+    link.fd = -1;
+    link.inbox.clear();
+
+    return *this;
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Opens a socket that viewers connect to, on every interface
+ *
+ * @param   port    The TCP port to listen on
+ *
+ * @return  The listening socket
+ */
+int RemoteLink::listen( unsigned short port )
+{
+    int listenFd = socket( AF_INET, SOCK_STREAM, 0 );
+
+    if ( listenFd < 0 ) throw RemoteLinkException( std::string( "Failed to create socket: " ) + strerror( errno ) );
+
+    // a restarted server can take the port back at once
+    int enabled = 1;
+    setsockopt( listenFd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof( enabled ) );
+
+    sockaddr_in address;
+    memset( &address, 0, sizeof( address ) );
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_ANY );
+    address.sin_port = htons( port );
+
+    if ( ( bind( listenFd, ( sockaddr * ) &address, sizeof( address ) ) < 0 ) || ( ::listen( listenFd, 1 ) < 0 ) )
+    {
+        std::string error = strerror( errno );
+        ::close( listenFd );
+
+        throw RemoteLinkException( "Failed to listen on port " + std::to_string( port ) + ": " + error );
+    }
+
+    return listenFd;
+}
+
+
+/**
+ * @brief   Accepts the next viewer waiting on a listening socket
+ *
+ * @param   listenFd    The listening socket
+ *
+ * @return  The link to the viewer, closed if accepting failed
+ */
+RemoteLink RemoteLink::accept( int listenFd )
+{
+    int fd = ::accept( listenFd, nullptr, nullptr );
+
+    if ( fd >= 0 ) setNoDelay( fd );
+
+    return RemoteLink( fd );
+}
+
+
+/**
+ * @brief   Connects to a render server
+ *
+ * @param   &host   The host name or address of the server
+ * @param   port    The TCP port the server listens on
+ *
+ * @return  The link to the server
+ */
+RemoteLink RemoteLink::connect( const std::string &host, unsigned short port )
+{
+    addrinfo hints;
+    memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *addresses = nullptr;
+    int status = getaddrinfo( host.c_str(), std::to_string( port ).c_str(), &hints, &addresses );
+
+    if ( status != 0 ) throw RemoteLinkException( "Failed to resolve " + host + ": " + gai_strerror( status ) );
+
+    int fd = -1;
+
+    for ( addrinfo *address = addresses; address != nullptr; address = address->ai_next )
+    {
+        fd = socket( address->ai_family, address->ai_socktype, address->ai_protocol );
+
+        if ( fd < 0 ) continue;
+        if ( ::connect( fd, address->ai_addr, address->ai_addrlen ) == 0 ) break;
+
+        ::close( fd );
+        fd = -1;
+    }
+
+    freeaddrinfo( addresses );
+
+    if ( fd < 0 ) throw RemoteLinkException( "Failed to connect to " + host + ":" + std::to_string( port ) );
+
+    setNoDelay( fd );
+
+    return RemoteLink( fd );
+}
+
+
+/**
+ * @brief   Sends a message whose payload is 32-bit values
+ *
+ * @param   type        The type of the message
+ * @param   &values     The values, sent in network byte order
+ *
+ * @return  True if the message was sent, false if the link is closed
+ */
+bool RemoteLink::send( uint32_t type, const std::vector<uint32_t> &values )
+{
+    std::vector<unsigned char> payload;
+    payload.reserve( values.size() * sizeof( uint32_t ) );
+
+    for ( uint32_t value : values ) putNetworkValue( payload, value );
+
+    return send( type, payload.data(), payload.size() );
+}
+
+
+/**
+ * @brief   Sends a message
+ *
+ * @param   type        The type of the message
+ * @param   *payload    The payload of the message
+ * @param   size        The size of the payload in bytes
+ *
+ * @return  True if the message was sent, false if the link is closed
+ */
+bool RemoteLink::send( uint32_t type, const unsigned char *payload, size_t size )
+{
+    if ( fd < 0 ) return false;
+
+    // one write, so a small message is not split over two packets
+    std::vector<unsigned char> message;
+    message.reserve( HEADER_SIZE + size );
+
+    putNetworkValue( message, type );
+    putNetworkValue( message, size );
+    message.insert( message.end(), payload, payload + size );
+
+    return sendAll( message.data(), message.size() );
+}
+
+
+/**
+ * @brief   Takes the next whole message that has arrived, without waiting
+ *
+ * Call it until it returns false once the socket is readable; a link that
+ * the other side closed is closed then.
+ *
+ * @param   &message    Set to the message
+ *
+ * @return  True if there was a whole message, false otherwise
+ */
+bool RemoteLink::receive( Message &message )
+{
+    if ( takeMessage( message ) ) return true;
+    if ( fd < 0 ) return false;
+
+    size_t received = inbox.size();
+    inbox.resize( received + RECEIVE_CHUNK_SIZE );
+
+    ssize_t count = recv( fd, inbox.data() + received, RECEIVE_CHUNK_SIZE, MSG_DONTWAIT );
+
+    if ( count > 0 )
+    {
+        inbox.resize( received + count );
+        return takeMessage( message );
+    }
+
+    inbox.resize( received );
+
+    // nothing more has arrived yet
+    if ( ( count < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINTR ) ) ) return false;
+
+    close();
+    return false;
+}
+
+
+/**
+ * @brief   Closes the connection
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void RemoteLink::close()
+{
+    if ( fd >= 0 ) ::close( fd );
+
+    fd = -1;
+    inbox.clear();
+}
+
+
+/**
+ * @brief   Determines if the link is connected
+ *
+ * @param   void
+ *
+ * @return  True if the link is connected, false otherwise
+ */
+bool RemoteLink::isOpen() const
+{
+    return fd >= 0;
+}
+
+
+/**
+ * @brief   Gets the socket of the link, to wait on for messages
+ *
+ * @param   void
+ *
+ * @return  The socket, or -1 if the link is closed
+ */
+int RemoteLink::getFd() const
+{
+    return fd;
+}
+
+
+/**
+ * @brief   Reads one of the 32-bit values in the payload of a message
+ *
+ * @param   &message    The message to read from
+ * @param   index       The index of the value
+ *
+ * @return  The value, or 0 if the payload is too short to have it
+ */
+uint32_t RemoteLink::getValue( const Message &message, unsigned int index )
+{
+    size_t offset = ( size_t ) index * sizeof( uint32_t );
+
+    if ( offset + sizeof( uint32_t ) > message.payload.size() ) return 0;
+
+    return getNetworkValue( message.payload.data() + offset );
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Writes bytes to the socket until all of them are written
+ *
+ * @param   *data   The bytes to write
+ * @param   size    The number of bytes
+ *
+ * @return  True if every byte was written, false if the link failed and
+ *          was closed
+ */
+bool RemoteLink::sendAll( const unsigned char *data, size_t size )
+{
+    while ( size > 0 )
+    {
+        // a viewer that went away must not take the server down with SIGPIPE
+        ssize_t count = ::send( fd, data, size, MSG_NOSIGNAL );
+
+        if ( ( count < 0 ) && ( errno == EINTR ) ) continue;
+
+        if ( count <= 0 )
+        {
+            close();
+            return false;
+        }
+
+        data += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief   Moves the first message out of the bytes received, if all of it
+ *          has arrived
+ *
+ * @param   &message    Set to the message
+ *
+ * @return  True if there was a whole message, false otherwise
+ */
+bool RemoteLink::takeMessage( Message &message )
+{
+    if ( inbox.size() < HEADER_SIZE ) return false;
+
+    uint32_t type = getNetworkValue( inbox.data() );
+    uint32_t size = getNetworkValue( inbox.data() + sizeof( uint32_t ) );
+
+    if ( size > MAX_PAYLOAD_SIZE )
+    {
+        close();
+        return false;
+    }
+
+    if ( inbox.size() < HEADER_SIZE + size ) return false;
+
+    message.type = type;
+    message.payload.assign( inbox.begin() + HEADER_SIZE, inbox.begin() + HEADER_SIZE + size );
+
+    inbox.erase( inbox.begin(), inbox.begin() + HEADER_SIZE + size );
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,162 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    remotelink.h
+ * @brief   Message connection between a render server and a remote viewer
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef IO_REMOTELINK_H
+# define IO_REMOTELINK_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <cstdint>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class RemoteLinkException : public std::runtime_error
+{
+public:
+    explicit RemoteLinkException( const std::string& msg ):
+    std::runtime_error( ( std::string( "RemoteLink Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/**
+ * A remote link is one TCP connection between a render server and a viewer.
+ * Every message is its 32-bit type and 32-bit payload size in network byte
+ * order, followed by the payload. Sending blocks until the message is
+ * handed to the socket; receiving never blocks, it takes whatever has
+ * arrived and hands back the messages that are complete. Nagle's algorithm
+ * is off, so input events and small frames are not held back.
+ *
+ * A link that fails or is closed by the other side is closed, and only
+ * isOpen tells; nothing is thrown once the link is up.
+ */
+class RemoteLink
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* -------------------------------- Types ------------------------------- */
+
+
+    enum MessageType
+    {
+        // server to viewer: a 32-bit sequence number and an encoded frame
+        MESSAGE_FRAME = 1,
+
+        // viewer to server
+        MESSAGE_ACK,            // the sequence number of a frame shown
+        MESSAGE_RESIZE,         // the width and height of the window
+        MESSAGE_KEY_DOWN,       // a keysym
+        MESSAGE_KEY_UP,         // a keysym
+        MESSAGE_BUTTON_DOWN,    // a button and the pointer's x and y
+        MESSAGE_BUTTON_UP,      // a button and the pointer's x and y
+        MESSAGE_MOTION          // the pointer's x and y
+    };
+
+
+    struct Message
+    {
+        uint32_t type;
+        std::vector<unsigned char> payload;
+    };
+
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr size_t HEADER_SIZE = 8;
+
+    // larger payloads are taken as a corrupt stream
+    static constexpr size_t MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+    // the most an encoded frame can be, after its sequence number
+    static constexpr size_t MAX_FRAME_SIZE = MAX_PAYLOAD_SIZE - sizeof( uint32_t );
+
+    static constexpr size_t RECEIVE_CHUNK_SIZE = 64 * 1024;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    RemoteLink();
+    explicit RemoteLink( int fd );
+    RemoteLink( const RemoteLink &link ) = delete;
+    RemoteLink( RemoteLink &&link ) noexcept;
+
+    ~RemoteLink();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    RemoteLink &operator=( const RemoteLink &link ) = delete;
+    RemoteLink &operator=( RemoteLink &&link ) noexcept;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static int listen( unsigned short port );
+    static RemoteLink accept( int listenFd );
+    static RemoteLink connect( const std::string &host, unsigned short port );
+
+    bool send( uint32_t type, const std::vector<uint32_t> &values );
+    bool send( uint32_t type, const unsigned char *payload, size_t size );
+    bool receive( Message &message );
+
+    void close();
+    bool isOpen() const;
+    int getFd() const;
+
+    static uint32_t getValue( const Message &message, unsigned int index );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    int fd = -1;
+
+    // bytes received that do not make a whole message yet
+    std::vector<unsigned char> inbox = std::vector<unsigned char>();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool sendAll( const unsigned char *data, size_t size );
+    bool takeMessage( Message &message );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // IO_REMOTELINK_H
+
+
+/* -------------------------------------------------------------------------- */
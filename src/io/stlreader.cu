@@ -10,11 +10,329 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
-# include <sstream>
+# include <algorithm>
+# include <cstring>
+# include <utility>
 
+# include "meshpreprocessor.h"
 # include "stlreader.h"
 
 
+/* -------------------------------- Constants ------------------------------- */
+
+
+// binary STL layout: an 80-byte header, a 32-bit facet count, then one
+// 50-byte record per facet (normal, three vertices, attribute byte count)
+const size_t BINARY_HEADER_SIZE = 80;
+const size_t BINARY_PREAMBLE_SIZE = BINARY_HEADER_SIZE + sizeof( uint32_t );
+const size_t BINARY_RECORD_SIZE = 50;
+const size_t BINARY_VERTEX_OFFSET = 3 * sizeof( float );
+
+// ASCII files are split into a few chunks per thread so uneven chunks
+// balance out, but never into chunks too small to be worth a task
+const unsigned int ASCII_CHUNKS_PER_THREAD = 4;
+const size_t ASCII_MIN_CHUNK_SIZE = 256 * 1024;
+
+// ASCII batches smaller than this are not worth splitting across threads
+const unsigned int ASCII_MIN_PARALLEL_FACETS = 2048;
+
+// streamed batches fill exactly one mesh staging slot
+const unsigned int STREAM_BATCH_FACETS = Mesh::STREAM_SLOT_FACETS;
+
+const unsigned int FACET_COORD_COUNT = Mesh::FACET_DIM * Mesh::COORD_DIM;
+
+
+/* ----------------------------- Parse Functions ---------------------------- */
+
+
+/**
+ * @brief   Checks if a character is ASCII whitespace
+ *
+ * @param   c   The character to check
+ *
+ * @return  True if the character is whitespace, false otherwise
+ */
+static inline bool isSpace( char c )
+{
+    return ( c == ' ' ) || ( c == '\n' ) || ( c == '\r' ) || ( c == '\t' ) ||
+           ( c == '\v' ) || ( c == '\f' );
+}
+
+
+/**
+ * @brief   Reads the next whitespace-delimited token
+ *
+ * @param   &cursor     The read position, moved past the token
+ * @param   *end        The end of the buffer
+ * @param   &length     Set to the length of the token
+ *
+ * @return  A pointer to the start of the token, or end if there is none
+ */
+static inline const char *nextToken( const char *&cursor, const char *end, size_t &length )
+{
+    while ( ( cursor < end ) && isSpace( *cursor ) ) cursor++;
+
+    const char *token = cursor;
+
+    while ( ( cursor < end ) && !isSpace( *cursor ) ) cursor++;
+
+    length = cursor - token;
+
+    return token;
+}
+
+
+/**
+ * @brief   Checks if a token matches a keyword
+ *
+ * @param   *token      The token to check
+ * @param   length      The length of the token
+ * @param   *keyword    The null-terminated keyword
+ *
+ * @return  True if the token is the keyword, false otherwise
+ */
+static inline bool isToken( const char *token, size_t length, const char *keyword )
+{
+    return ( strlen( keyword ) == length ) && ( memcmp( token, keyword, length ) == 0 );
+}
+
+
+/**
+ * @brief   Checks if a buffer starts like an ASCII STL file, with "solid" and
+ *          a name followed by a line that starts a facet or ends the solid
+ *
+ * @param   *data   The start of the buffer
+ * @param   size    The size of the buffer
+ *
+ * @return  True if the buffer starts like an ASCII STL file, false otherwise
+ */
+static bool hasAsciiPrologue( const char *data, size_t size )
+{
+    const char *cursor = data;
+    const char *end = data + size;
+    size_t length;
+
+    const char *token = nextToken( cursor, end, length );
+
+    if ( !isToken( token, length, "solid" ) ) return false;
+
+    // the name is the rest of the line, and may be empty or several words
+    while ( ( cursor < end ) && ( *cursor != '\n' ) ) cursor++;
+
+    token = nextToken( cursor, end, length );
+
+    return isToken( token, length, "facet" ) || isToken( token, length, "endsolid" );
+}
+
+
+/**
+ * @brief   Parses a decimal float in the style of std::from_chars
+ *
+ * Accepts an optional sign, digits with an optional fraction, and an
+ * optional exponent. The significand is accumulated as an integer and
+ * scaled once, so the result does not depend on locale and does not go
+ * through a stream.
+ *
+ * @param   *first  The start of the characters to parse
+ * @param   *last   The end of the characters to parse
+ * @param   &value  Set to the parsed value on success
+ *
+ * @return  A pointer past the parsed characters, or first if nothing could
+ *          be parsed
+ */
+static const char *parseFloat( const char *first, const char *last, float &value )
+{
+    static const double POWERS_OF_TEN[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    static const int MAX_EXACT_POWER = 22;
+    static const int MAX_SIGNIFICANT_DIGITS = 19;
+
+    const char *cursor = first;
+
+    bool negative = false;
+
+    if ( ( cursor < last ) && ( ( *cursor == '-' ) || ( *cursor == '+' ) ) )
+    {
+        negative = ( *cursor == '-' );
+        cursor++;
+    }
+
+    unsigned long long significand = 0;
+    int digitCount = 0;
+    int exponent = 0;
+    bool anyDigits = false;
+
+    // integer part
+    for ( ; ( cursor < last ) && ( *cursor >= '0' ) && ( *cursor <= '9' ); cursor++ )
+    {
+        anyDigits = true;
+
+        if ( digitCount < MAX_SIGNIFICANT_DIGITS )
+        {
+            significand = significand * 10 + ( *cursor - '0' );
+            if ( significand != 0 ) digitCount++;
+        }
+        else
+        {
+            exponent++;
+        }
+    }
+
+    // fractional part
+    if ( ( cursor < last ) && ( *cursor == '.' ) )
+    {
+        for ( cursor++; ( cursor < last ) && ( *cursor >= '0' ) && ( *cursor <= '9' ); cursor++ )
+        {
+            anyDigits = true;
+
+            if ( digitCount < MAX_SIGNIFICANT_DIGITS )
+            {
+                significand = significand * 10 + ( *cursor - '0' );
+                if ( significand != 0 ) digitCount++;
+                exponent--;
+            }
+        }
+    }
+
+    if ( !anyDigits ) return first;
+
+    // exponent part, only consumed if it is well formed
+    if ( ( cursor < last ) && ( ( *cursor == 'e' ) || ( *cursor == 'E' ) ) )
+    {
+        const char *expCursor = cursor + 1;
+        bool expNegative = false;
+
+        if ( ( expCursor < last ) && ( ( *expCursor == '-' ) || ( *expCursor == '+' ) ) )
+        {
+            expNegative = ( *expCursor == '-' );
+            expCursor++;
+        }
+
+        if ( ( expCursor < last ) && ( *expCursor >= '0' ) && ( *expCursor <= '9' ) )
+        {
+            int expValue = 0;
+
+            for ( ; ( expCursor < last ) && ( *expCursor >= '0' ) && ( *expCursor <= '9' ); expCursor++ )
+            {
+                if ( expValue < 10000 ) expValue = expValue * 10 + ( *expCursor - '0' );
+            }
+
+            exponent += expNegative ? -expValue : expValue;
+            cursor = expCursor;
+        }
+    }
+
+    double result = ( double ) significand;
+
+    // scale in exact steps of at most 10^22
+    while ( ( exponent > 0 ) && ( result != 0 ) )
+    {
+        int step = ( exponent > MAX_EXACT_POWER ) ? MAX_EXACT_POWER : exponent;
+        result *= POWERS_OF_TEN[step];
+        exponent -= step;
+    }
+
+    while ( ( exponent < 0 ) && ( result != 0 ) )
+    {
+        int step = ( -exponent > MAX_EXACT_POWER ) ? MAX_EXACT_POWER : -exponent;
+        result /= POWERS_OF_TEN[step];
+        exponent += step;
+    }
+
+    value = ( float ) ( negative ? -result : result );
+
+    return cursor;
+}
+
+
+/**
+ * @brief   Parses the three vertices of an ASCII facet
+ *
+ * Expects the cursor to be just past a "facet" keyword. Everything up to
+ * each "vertex" keyword (the normal, "outer loop") is skipped.
+ *
+ * @param   &cursor     The read position, moved past the last vertex
+ * @param   *end        The end of the buffer
+ * @param   *coords     Set to the nine vertex coordinates
+ *
+ * @return  void
+ */
+static void parseAsciiFacet( const char *&cursor, const char *end, float *coords )
+{
+    for ( unsigned int i = 0; i < Mesh::FACET_DIM; i++ )
+    {
+        size_t length;
+        const char *token = nextToken( cursor, end, length );
+
+        while ( ( length > 0 ) && !isToken( token, length, "vertex" ) )
+        {
+            // a facet must not end before its third vertex
+            if ( isToken( token, length, "endfacet" ) || isToken( token, length, "facet" ) )
+            {
+                throw STLReaderException( "Invalid or corrupt file format." );
+            }
+
+            token = nextToken( cursor, end, length );
+        }
+
+        if ( length == 0 )
+        {
+            throw STLReaderException( "Invalid or corrupt file format." );
+        }
+
+        for ( unsigned int j = 0; j < Mesh::COORD_DIM; j++ )
+        {
+            while ( ( cursor < end ) && isSpace( *cursor ) ) cursor++;
+
+            const char *parsed = parseFloat( cursor, end, coords[i * Mesh::COORD_DIM + j] );
+
+            if ( ( parsed == cursor ) || ( ( parsed < end ) && !isSpace( *parsed ) ) )
+            {
+                throw STLReaderException( "Invalid or corrupt file format." );
+            }
+
+            cursor = parsed;
+        }
+    }
+}
+
+
+/**
+ * @brief   Finds the next "facet" keyword at or after a position
+ *
+ * Only whole tokens match, so the "facet" in "endfacet" is not found.
+ *
+ * @param   *begin      The start of the buffer
+ * @param   *cursor     The position to start searching from
+ * @param   *end        The end of the buffer
+ *
+ * @return  A pointer to the keyword, or end if there is none
+ */
+static const char *findFacetKeyword( const char *begin, const char *cursor, const char *end )
+{
+    static const size_t KEYWORD_LENGTH = 5;
+
+    while ( ( cursor = ( const char * ) memchr( cursor, 'f', end - cursor ) ) != nullptr )
+    {
+        bool startsToken = ( cursor == begin ) || isSpace( cursor[-1] );
+        bool fits = ( size_t ) ( end - cursor ) >= KEYWORD_LENGTH;
+
+        if ( startsToken && fits && ( memcmp( cursor, "facet", KEYWORD_LENGTH ) == 0 ) &&
+             ( ( cursor + KEYWORD_LENGTH == end ) || isSpace( cursor[KEYWORD_LENGTH] ) ) )
+        {
+            return cursor;
+        }
+
+        cursor++;
+    }
+
+    return end;
+}
+
+
 /* ----------------------- Constructors / Destructors ----------------------- */
 
 
@@ -37,7 +355,7 @@ STLReader::STLReader() = default;
  */
 STLReader::STLReader( const char *filePath )
 {
-    open( ( std::string& ) filePath );
+    open( std::string( filePath ) );
 }
 
 
@@ -61,7 +379,12 @@ STLReader::STLReader( const std::string &filePath )
  *
  * @return  The created STL reader
  */
-STLReader::STLReader( const STLReader &stlReader ) = default;
+STLReader::STLReader( const STLReader &stlReader ) :
+threadCount( stlReader.threadCount )
+{
+    // the copy gets its own mapping of the same file
+    if ( stlReader.isOpen ) open( stlReader.filePath );
+}
 
 
 /**
@@ -75,9 +398,29 @@ STLReader::~STLReader()
 {
     // close if a file is open
     if ( isOpen ) close();
+}
+
+
+/* -------------------------- Overloaded Operators -------------------------- */
+
+
+/**
+ * @brief   Sets this STL reader to read the same file as another STL reader
+ *
+ * @param   &stlReader  The STL reader to copy
+ *
+ * @return  This STL reader
+ */
+STLReader &STLReader::operator=( const STLReader &stlReader )
+{
+    if ( this == &stlReader ) return *this;
+
+    if ( isOpen ) close();
+    if ( stlReader.isOpen ) open( stlReader.filePath );
 
-    // free file stream
-    delete in;
+    threadCount = stlReader.threadCount;
+
+    return *this;
 }
 
 
@@ -96,14 +439,10 @@ void STLReader::open( const std::string &filePath )
     // close file if already open
     if ( isOpen ) close();
 
-    // open an input file stream
-    in->open( filePath.c_str() );
+    this->filePath = filePath;
 
-    // throw error if file fails to open
-    if ( !in->is_open() )
-    {
-        throw STLReaderException( "File does not exist." );
-    }
+    // map the file and detect its format
+    mapFile();
 
     // set open flag
     isOpen = true;
@@ -119,14 +458,44 @@ void STLReader::open( const std::string &filePath )
  */
 void STLReader::close()
 {
-    // close input file stream
-    in->close();
+    // release the file mapping
+    unmapFile();
 
     // clear open flag
     isOpen = false;
 }
 
 
+/**
+ * @brief   Checks if the currently opened STL file is a binary STL file
+ *
+ * @param   void
+ *
+ * @return  True if the file is binary STL, false if it is ASCII STL
+ */
+bool STLReader::isBinary() const
+{
+    return binary;
+}
+
+
+/**
+ * @brief   Sets the number of threads used to parse ASCII STL files
+ *
+ * @param   threadCount     The number of threads, or 0 to use one per
+ *                          hardware thread
+ *
+ * @return  void
+ */
+void STLReader::setThreadCount( unsigned int threadCount )
+{
+    this->threadCount = threadCount;
+
+    // restarted with the new size on next use
+    pool.reset();
+}
+
+
 /**
  * @brief   Gets the number of facets in the currently opened STL file
  *
@@ -142,31 +511,67 @@ unsigned int STLReader::getFacetCount()
         throw STLReaderException( "No open file." );
     }
 
-    // initialize facet count
-    unsigned int facetCount = 0;
+    // binary files store their facet count in the header
+    if ( binary ) return getBinaryFacetCount();
 
-    // count facets
-    while ( *in )
+    return getAsciiFacetCount();
+}
+
+
+/**
+ * @brief   Reads a single facet from the currently opened STL file
+ *
+ * @param   index   The index of the facet to read
+ *
+ * @return  The facet as a triangle
+ */
+Triangle STLReader::readFacet( unsigned int index )
+{
+    // throw an exception if not open
+    if ( !isOpen )
     {
-        std::string line;
-        getline( *in, line );
+        throw STLReaderException( "No open file." );
+    }
 
-        std::string token;
-        std::stringstream ss = std::stringstream( line );
-        ss >> token;
+    if ( binary ) return readBinaryFacet( index );
 
-        if ( ( token == "facet" ) ) facetCount++;
+    return readAsciiFacet( index );
+}
+
+
+/**
+ * @brief   Reads every facet in the currently opened STL file into a shape
+ *          container's mesh
+ *
+ * @param   void
+ *
+ * @return  A shape container holding the facets
+ */
+ShapeContainer STLReader::readFacets()
+{
+    // throw an exception if not open
+    if ( !isOpen )
+    {
+        throw STLReaderException( "No open file." );
     }
 
-    // seek back to the beginning of the input stream
-    in->clear();
-    in->seekg( 0 );
+    if ( binary ) return readBinaryFacets();
 
-    return facetCount;
+    return readAsciiFacets();
 }
 
 
-Triangle STLReader::readFacet( unsigned int index )
+/**
+ * @brief   Reads the vertex coordinates of a range of facets without
+ *          building a mesh
+ *
+ * @param   first   The index of the first facet to read
+ * @param   count   The maximum number of facets to read
+ * @param   *coords Set to nine coordinates per facet read
+ *
+ * @return  The number of facets read, less than count at the end of file
+ */
+unsigned int STLReader::readFacetCoords( unsigned int first, unsigned int count, float *coords )
 {
     // throw an exception if not open
     if ( !isOpen )
@@ -174,144 +579,497 @@ Triangle STLReader::readFacet( unsigned int index )
         throw STLReaderException( "No open file." );
     }
 
-    // iterate to facet at index
-    unsigned int facetCount = 0;
+    unsigned int facetCount = getFacetCount();
+
+    if ( first >= facetCount ) return 0;
+    if ( count > facetCount - first ) count = facetCount - first;
+
+    if ( binary )
+    {
+        for ( unsigned int i = 0; i < count; i++ )
+        {
+            memcpy(
+                coords + ( size_t ) i * FACET_COORD_COUNT,
+                getBinaryRecord( first + i ) + BINARY_VERTEX_OFFSET,
+                FACET_COORD_COUNT * sizeof( float )
+            );
+        }
+
+        return count;
+    }
+
+    // ASCII facets are found through the offset index, so split the range
+    const char *end = data + dataSize;
+
+    unsigned int taskCount = ( count < ASCII_MIN_PARALLEL_FACETS ) ? 1 : getPool().getThreadCount();
+    unsigned int facetsPerTask = ( count + taskCount - 1 ) / taskCount;
+
+    auto parseRange = [&]( unsigned int taskIdx )
+    {
+        unsigned int begin = taskIdx * facetsPerTask;
+        unsigned int stop = std::min( begin + facetsPerTask, count );
+
+        for ( unsigned int i = begin; i < stop; i++ )
+        {
+            const char *cursor = data + facetOffsets[first + i] + strlen( "facet" );
+            parseAsciiFacet( cursor, end, coords + ( size_t ) i * FACET_COORD_COUNT );
+        }
+    };
+
+    if ( taskCount == 1 ) parseRange( 0 );
+    else getPool().parallelFor( taskCount, parseRange );
+
+    return count;
+}
+
+
+/**
+ * @brief   Reads every facet into a shape container while streaming it to
+ *          the GPU device batch by batch
+ *
+ * Each batch is welded into the mesh and queued for upload asynchronously,
+ * so the next batch is parsed while the previous one crosses the bus. After
+ * every batch onBatch is called, which may draw the part that has arrived.
+ * The shape container is ready to draw with its unique edges on return.
+ *
+ * @param   &sc         The empty shape container to read into
+ * @param   &onBatch    Called with the number of facets read so far
+ *
+ * @return  void
+ */
+void STLReader::streamFacets( ShapeContainer &sc, const std::function<void( unsigned int )> &onBatch )
+{
+    unsigned int facetCount = getFacetCount();
+
+    Mesh &mesh = sc.getMesh();
+
+    mesh.reserve( facetCount );
+    sc.beginStream( facetCount );
 
-    while ( *in && ( facetCount <= index ) )
+    std::vector<float> coords( ( size_t ) STREAM_BATCH_FACETS * FACET_COORD_COUNT );
+
+    for ( unsigned int first = 0; first < facetCount; first += STREAM_BATCH_FACETS )
     {
-        std::string line;
-        getline( *in, line );
+        unsigned int batchCount = readFacetCoords( first, STREAM_BATCH_FACETS, coords.data() );
+
+        for ( unsigned int i = 0; i < batchCount; i++ )
+        {
+            const float *facet = &coords[( size_t ) i * FACET_COORD_COUNT];
 
-        std::string token;
-        std::stringstream ss = std::stringstream( line );
-        ss >> token;
+            unsigned int a = mesh.addVertex( facet[0], facet[1], facet[2] );
+            unsigned int b = mesh.addVertex( facet[3], facet[4], facet[5] );
+            unsigned int c = mesh.addVertex( facet[6], facet[7], facet[8] );
 
-        if ( ( token == "facet" ) ) facetCount++;
+            mesh.addFacet( a, b, c );
+        }
+
+        sc.streamPending();
+        onBatch( first + batchCount );
     }
 
-    // throw end-of-file exception
-    if ( !*in )
+    sc.endStream();
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Gets the thread pool used to parse ASCII files, starting it on
+ *          first use
+ *
+ * @param   void
+ *
+ * @return  The thread pool
+ */
+ThreadPool &STLReader::getPool()
+{
+    if ( !pool ) pool.reset( new ThreadPool( threadCount ) );
+
+    return *pool;
+}
+
+
+/**
+ * @brief   Memory-maps the file at filePath and detects whether it is binary
+ *
+ * A file is treated as binary when it is large enough for the facet count
+ * in the binary header and does not start with "solid" followed by a facet
+ * line. Some exporters write bytes past the last record, which are
+ * ignored, and many start a binary header with "solid", which the facet
+ * line after it tells apart.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void STLReader::mapFile()
+{
+    try
     {
-        throw STLReaderException( "Facet index out of range." );
+        file.open( filePath );
     }
+    catch ( const MappedFileException & )
+    {
+        throw STLReaderException( "File does not exist." );
+    }
+
+    // empty files have no mapping, and hold no facets either way
+    data = file.getData();
+    dataSize = file.getSize();
+
+    binary = ( dataSize >= BINARY_PREAMBLE_SIZE ) &&
+             ( BINARY_PREAMBLE_SIZE + ( size_t ) getBinaryFacetCount() * BINARY_RECORD_SIZE <= dataSize ) &&
+             !hasAsciiPrologue( data, dataSize );
+}
+
+
+/**
+ * @brief   Releases the file mapping
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void STLReader::unmapFile()
+{
+    file.close();
+
+    data = nullptr;
+    dataSize = 0;
+    binary = false;
+
+    // the facet index belongs to the mapping it was built from
+    std::vector<size_t>().swap( facetOffsets );
+    facetsIndexed = false;
+}
+
 
-    // advance the stream 1 position
-    std::string garbage;
-    getline( *in, garbage );
+/**
+ * @brief   Gets a pointer to a facet record in the mapped binary file
+ *
+ * @param   index   The index of the facet record
+ *
+ * @return  A pointer to the start of the 50-byte record
+ */
+const char *STLReader::getBinaryRecord( unsigned int index ) const
+{
+    return data + BINARY_PREAMBLE_SIZE + ( size_t ) index * BINARY_RECORD_SIZE;
+}
 
-    // create array of 3D points to store vertices
-    Point3D verts[3];
 
-    // read the vertices
-    for ( unsigned int i = 0; i < 3; i++ )
+/**
+ * @brief   Gets the facet count stored in the binary header
+ *
+ * @param   void
+ *
+ * @return  The number of facets in the file
+ */
+unsigned int STLReader::getBinaryFacetCount() const
+{
+    // the count is little-endian and may not be aligned
+    uint32_t facetCount;
+    memcpy( &facetCount, data + BINARY_HEADER_SIZE, sizeof( facetCount ) );
+
+    return facetCount;
+}
+
+
+/**
+ * @brief   Reads a single facet straight from the mapped binary file
+ *
+ * @param   index   The index of the facet to read
+ *
+ * @return  The facet as a triangle
+ */
+Triangle STLReader::readBinaryFacet( unsigned int index ) const
+{
+    if ( index >= getBinaryFacetCount() )
     {
-        // get string stream for current vertex string
-        std::string vertexString;
-        getline( *in, vertexString );
+        throw STLReaderException( "Facet index out of range." );
+    }
 
-        std::string token;
-        std::stringstream ss = std::stringstream( vertexString );
-        ss >> token;
+    float coords[FACET_COORD_COUNT];
+    memcpy( coords, getBinaryRecord( index ) + BINARY_VERTEX_OFFSET, sizeof( coords ) );
 
-        // throw an exception if vertex string is invalid
-        if ( token != "vertex" )
+    return Triangle(
+        Point3D( coords[0], coords[1], coords[2] ),
+        Point3D( coords[3], coords[4], coords[5] ),
+        Point3D( coords[6], coords[7], coords[8] )
+    );
+}
+
+
+/**
+ * @brief   Reads every facet of the mapped binary file into a shape
+ *          container's mesh
+ *
+ * With a device the weld fits on, the records are gathered into one
+ * coordinate array and welded on it by the mesh preprocessor. Otherwise,
+ * records are copied out of the mapping directly into the mesh's vertex
+ * pool, so nothing is allocated per facet.
+ *
+ * @param   void
+ *
+ * @return  A shape container holding the facets
+ */
+ShapeContainer STLReader::readBinaryFacets() const
+{
+    unsigned int facetCount = getBinaryFacetCount();
+
+    ShapeContainer sc = ShapeContainer();
+    Mesh &mesh = sc.getMesh();
+
+    if ( MeshPreprocessor::isAvailable() && MeshPreprocessor::fitsOnDevice( facetCount ) )
+    {
+        std::vector<float> coords( ( size_t ) facetCount * FACET_COORD_COUNT );
+
+        // records are 50 bytes, so the floats are not 4-byte aligned
+        for ( unsigned int i = 0; i < facetCount; i++ )
         {
-            throw STLReaderException( "Invalid or corrupt file format." );
+            memcpy(
+                &coords[( size_t ) i * FACET_COORD_COUNT],
+                getBinaryRecord( i ) + BINARY_VERTEX_OFFSET,
+                FACET_COORD_COUNT * sizeof( float )
+            );
         }
 
-        // read vertex coords
-        double x;
-        double y;
-        double z;
+        if ( MeshPreprocessor::process( coords.data(), facetCount, mesh ) ) return sc;
+    }
+
+    mesh.reserve( facetCount );
 
-        ss >> x;
-        ss >> y;
-        ss >> z;
+    for ( unsigned int i = 0; i < facetCount; i++ )
+    {
+        // records are 50 bytes, so the floats are not 4-byte aligned
+        float coords[FACET_COORD_COUNT];
+        memcpy( coords, getBinaryRecord( i ) + BINARY_VERTEX_OFFSET, sizeof( coords ) );
 
-        // create vertex
-        verts[i] = Point3D( x, y, z );
+        unsigned int a = mesh.addVertex( coords[0], coords[1], coords[2] );
+        unsigned int b = mesh.addVertex( coords[3], coords[4], coords[5] );
+        unsigned int c = mesh.addVertex( coords[6], coords[7], coords[8] );
+
+        mesh.addFacet( a, b, c );
     }
 
-    // seek back to the beginning of the input stream
-    in->clear();
-    in->seekg( 0 );
+    return sc;
+}
+
+
+/**
+ * @brief   Splits the mapped ASCII file into chunks that each start at a
+ *          "facet" keyword
+ *
+ * @param   chunkCount  The number of chunks to aim for
+ *
+ * @return  The chunk boundaries as byte offsets, starting with 0 and ending
+ *          with the file size, with one more entry than there are chunks
+ */
+std::vector<size_t> STLReader::splitAsciiChunks( unsigned int chunkCount ) const
+{
+    std::vector<size_t> bounds = std::vector<size_t>();
+    bounds.push_back( 0 );
+
+    const char *end = data + dataSize;
+
+    for ( unsigned int i = 1; i < chunkCount; i++ )
+    {
+        size_t target = dataSize / chunkCount * i;
+        if ( target <= bounds.back() ) continue;
+
+        size_t bound = findFacetKeyword( data, data + target, end ) - data;
+
+        // a boundary past the last facet would only make an empty chunk
+        if ( bound >= dataSize ) break;
+        if ( bound > bounds.back() ) bounds.push_back( bound );
+    }
 
-    // create a facet from the verts
-    Triangle facet = Triangle( verts[0], verts[1], verts[2] );
+    bounds.push_back( dataSize );
 
-    return facet;
+    return bounds;
 }
 
 
-ShapeContainer STLReader::readFacets()
+/**
+ * @brief   Records the offset of every facet in the mapped ASCII file
+ *
+ * Runs once per open file, the first time a facet count or a single facet
+ * is asked for, so later lookups do not rescan the file.
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void STLReader::indexAsciiFacets()
 {
-    // throw an exception if not open
-    if ( !isOpen )
+    if ( facetsIndexed ) return;
+
+    const char *end = data + dataSize;
+    const char *cursor = data;
+
+    facetOffsets.clear();
+
+    while ( ( cursor = findFacetKeyword( data, cursor, end ) ) != end )
     {
-        throw STLReaderException( "No open file." );
+        facetOffsets.push_back( cursor - data );
+        cursor++;
     }
 
-    // create shape container
-    ShapeContainer sc = ShapeContainer();
+    facetOffsets.shrink_to_fit();
+    facetsIndexed = true;
+}
+
 
-    // advance to next facet line
-    while ( *in )
+/**
+ * @brief   Gets the number of facets in the mapped ASCII file
+ *
+ * @param   void
+ *
+ * @return  The number of facets in the file
+ */
+unsigned int STLReader::getAsciiFacetCount()
+{
+    indexAsciiFacets();
+
+    return facetOffsets.size();
+}
+
+
+/**
+ * @brief   Reads a single facet from the mapped ASCII file
+ *
+ * @param   index   The index of the facet to read
+ *
+ * @return  The facet as a triangle
+ */
+Triangle STLReader::readAsciiFacet( unsigned int index )
+{
+    indexAsciiFacets();
+
+    // throw end-of-file exception
+    if ( index >= facetOffsets.size() )
     {
-        // get line
-        std::string line;
-        getline( *in, line );
+        throw STLReaderException( "Facet index out of range." );
+    }
 
-        std::string token;
-        std::stringstream ss = std::stringstream( line );
-        ss >> token;
+    const char *end = data + dataSize;
+    const char *cursor = data + facetOffsets[index] + strlen( "facet" );
 
-        // process if facet
-        if (( token == "facet" ))
+    float coords[FACET_COORD_COUNT];
+    parseAsciiFacet( cursor, end, coords );
+
+    return Triangle(
+        Point3D( coords[0], coords[1], coords[2] ),
+        Point3D( coords[3], coords[4], coords[5] ),
+        Point3D( coords[6], coords[7], coords[8] )
+    );
+}
+
+
+/**
+ * @brief   Reads every facet of the mapped ASCII file into a shape
+ *          container's mesh, parsing chunks of the file in parallel
+ *
+ * Each chunk is parsed into its own coordinate array on the thread pool.
+ * The arrays are then welded into the mesh in file order, so the result is
+ * the same as a sequential parse no matter how the file was split. With a
+ * device the weld fits on, they are joined and welded by the mesh
+ * preprocessor instead.
+ *
+ * @param   void
+ *
+ * @return  A shape container holding the facets
+ */
+ShapeContainer STLReader::readAsciiFacets()
+{
+    ThreadPool &pool = getPool();
+
+    unsigned int chunkCount = pool.getThreadCount() * ASCII_CHUNKS_PER_THREAD;
+    size_t maxChunkCount = dataSize / ASCII_MIN_CHUNK_SIZE + 1;
+    if ( chunkCount > maxChunkCount ) chunkCount = maxChunkCount;
+
+    std::vector<size_t> bounds = splitAsciiChunks( chunkCount );
+    chunkCount = bounds.size() - 1;
+
+    std::vector<std::vector<float>> chunkCoords( chunkCount );
+
+    pool.parallelFor( chunkCount, [&]( unsigned int chunkIdx )
+    {
+        const char *begin = data + bounds[chunkIdx];
+        const char *end = data + dataSize;
+        const char *chunkEnd = data + bounds[chunkIdx + 1];
+
+        std::vector<float> &coords = chunkCoords[chunkIdx];
+
+        // roughly 220 bytes per facet in typical exports
+        coords.reserve( ( chunkEnd - begin ) / 220 * FACET_COORD_COUNT );
+
+        const char *cursor = begin;
+
+        // only facets that start inside the chunk belong to it
+        while ( ( cursor = findFacetKeyword( begin, cursor, chunkEnd ) ) != chunkEnd )
         {
-            // advance the stream 1 position
-            getline( *in, line );
+            float facet[FACET_COORD_COUNT];
 
-            // create array of 3D points to store vertices
-            Point3D verts[3];
+            cursor += strlen( "facet" );
+            parseAsciiFacet( cursor, end, facet );
 
-            // read the vertices
-            for ( unsigned int i = 0; i < 3; i++ )
-            {
-                // get string stream for current vertex string
-                getline( *in, line );
+            coords.insert( coords.end(), facet, facet + FACET_COORD_COUNT );
+        }
+    } );
+
+    // count the facets so the mesh only grows once
+    size_t facetCount = 0;
+
+    for ( const std::vector<float> &coords : chunkCoords )
+    {
+        facetCount += coords.size() / FACET_COORD_COUNT;
+    }
 
-                ss = std::stringstream( line );
-                ss >> token;
+    ShapeContainer sc = ShapeContainer();
+    Mesh &mesh = sc.getMesh();
 
-                // throw an exception if vertex string is invalid
-                if ( token != "vertex" )
-                {
-                    throw STLReaderException( "Invalid or corrupt file format." );
-                }
+    if ( MeshPreprocessor::isAvailable() && MeshPreprocessor::fitsOnDevice( facetCount ) )
+    {
+        std::vector<float> coords;
+        coords.reserve( facetCount * FACET_COORD_COUNT );
 
-                // read vertex coords
-                double x;
-                double y;
-                double z;
+        // join in file order
+        for ( std::vector<float> &chunk : chunkCoords )
+        {
+            coords.insert( coords.end(), chunk.begin(), chunk.end() );
+            std::vector<float>().swap( chunk );
+        }
 
-                ss >> x;
-                ss >> y;
-                ss >> z;
+        if ( MeshPreprocessor::process( coords.data(), facetCount, mesh ) ) return sc;
 
-                // create vertex
-                verts[i] = Point3D( x, y, z );
-            }
+        // the weld did not fit on the device, do it on the host instead
+        chunkCoords.clear();
+        chunkCoords.push_back( std::move( coords ) );
+    }
+
+    mesh.reserve( facetCount );
+
+    // merge in file order
+    for ( std::vector<float> &coords : chunkCoords )
+    {
+        for ( size_t i = 0; i < coords.size(); i += FACET_COORD_COUNT )
+        {
+            const float *facet = &coords[i];
 
-            // create a facet from the verts
-            Triangle facet = Triangle( verts[0], verts[1], verts[2] );
+            unsigned int a = mesh.addVertex( facet[0], facet[1], facet[2] );
+            unsigned int b = mesh.addVertex( facet[3], facet[4], facet[5] );
+            unsigned int c = mesh.addVertex( facet[6], facet[7], facet[8] );
 
-            // add the facet to the shape container
-            sc.add( facet );
+            mesh.addFacet( a, b, c );
         }
+
+        // release each chunk as soon as it is merged
+        std::vector<float>().swap( coords );
     }
 
     return sc;
 }
 
 
-/* -------------------------------------------------------------------------- */
\ No newline at end of file
+/* -------------------------------------------------------------------------- */
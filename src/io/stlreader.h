@@ -17,9 +17,13 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include <functional>
+# include <memory>
 # include <string>
-# include <fstream>
+# include <vector>
 
+# include "mappedfile.h"
+# include "threadpool.h"
 # include "triangle.h"
 # include "shapecontainer.h"
 
@@ -56,16 +60,28 @@ public:
     ~STLReader();
 
 
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    STLReader &operator=( const STLReader &stlReader );
+
+
     /* ------------------------------ Functions ----------------------------- */
 
 
     void open( const std::string &filePath );
     void close();
 
+    bool isBinary() const;
+    void setThreadCount( unsigned int threadCount );
+
     unsigned int getFacetCount();
     Triangle readFacet( unsigned int index );
     ShapeContainer readFacets();
 
+    unsigned int readFacetCoords( unsigned int first, unsigned int count, float *coords );
+    void streamFacets( ShapeContainer &sc, const std::function<void( unsigned int )> &onBatch );
+
 
     /* ============================== PROTECTED ============================= */
 
@@ -78,8 +94,41 @@ private:
     /* ----------------------------- Attributes ----------------------------- */
 
 
-    std::ifstream *in = new std::ifstream();
     bool isOpen = false;
+    unsigned int threadCount = 0;
+    std::unique_ptr<ThreadPool> pool = nullptr;
+
+    std::string filePath = std::string();
+
+    MappedFile file;
+    const char * data = nullptr;
+    size_t dataSize = 0;
+    bool binary = false;
+
+    std::vector<size_t> facetOffsets = std::vector<size_t>();
+    bool facetsIndexed = false;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    ThreadPool &getPool();
+
+    void mapFile();
+    void unmapFile();
+
+    const char *getBinaryRecord( unsigned int index ) const;
+    unsigned int getBinaryFacetCount() const;
+
+    Triangle readBinaryFacet( unsigned int index ) const;
+    ShapeContainer readBinaryFacets() const;
+
+    std::vector<size_t> splitAsciiChunks( unsigned int chunkCount ) const;
+    void indexAsciiFacets();
+    unsigned int getAsciiFacetCount();
+
+    Triangle readAsciiFacet( unsigned int index );
+    ShapeContainer readAsciiFacets();
 
 
     /* ====================================================================== */
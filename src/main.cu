@@ -10,7 +10,18 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include <cmath>
+# include <cstdio>
+# include <cstring>
+# include <fstream>
+# include <iostream>
+# include <string>
+
+# include "batchrenderer.h"
 # include "drawcontext.h"
+# include "imagewriter.h"
+# include "remotecontext.h"
+# include "remoteviewer.h"
 # include "viewcontext.h"
 # include "x11context.h"
 
@@ -20,17 +31,37 @@ using namespace std;
 /* ------------------------------- Functions -------------------------------- */
 
 
-int main()
+/**
+ * @brief   Prints how to run a batch job
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void printBatchUsage()
 {
-    /* ---------------- Create Graphics and Drawing Context ----------------- */
-
-
-    GraphicsContext *gc = new X11Context( 800, 800, X11Context::WHITE );
-    ViewContext *vc = new ViewContext( gc );
-    DrawContext *dc = new DrawContext( vc );
+    cerr << "usage: render --batch [options] MODEL..." << endl;
+    cerr << endl;
+    cerr << "  --list PATH        read model paths from PATH, one per line, - for stdin" << endl;
+    cerr << "  --out DIR          write images to DIR (default .)" << endl;
+    cerr << "  --size WxH         image size in pixels (default 800x800)" << endl;
+    cerr << "  --angle AZ,EL      render from azimuth AZ and elevation EL in degrees," << endl;
+    cerr << "                     may be repeated" << endl;
+    cerr << "  --turntable N      render N views evenly around the model" << endl;
+    cerr << "  --elevation EL     elevation of the turntable views in degrees" << endl;
+    cerr << "  --format png|ppm   image format (default png)" << endl;
+}
 
-    /* ---------------------------- Print Header ---------------------------- */
 
+/**
+ * @brief   Prints the header and the controls of an interactive session
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void printControls()
+{
     cout << endl;
     cout << "/* =========== GPU Accelerated 3D Renderer =========== */" << endl;
     cout << endl;
@@ -55,6 +86,306 @@ int main()
     cout << endl;
     cout << "/* ------------------------------------------------- */" << endl;
     cout << endl;
+}
+
+
+/**
+ * @brief   Reads model paths from a list file, one per line
+ *
+ * @param   &listPath   The path of the list file, - for standard input
+ * @param   &paths      The paths to append to
+ *
+ * @return  void
+ */
+static void readModelList( const string &listPath, vector<string> &paths )
+{
+    ifstream file;
+    istream *in = &cin;
+
+    if ( listPath != "-" )
+    {
+        file.open( listPath.c_str() );
+
+        if ( !file.is_open() ) throw BatchRendererException( "Failed to open model list: " + listPath );
+
+        in = &file;
+    }
+
+    string line;
+
+    while ( getline( *in, line ) )
+    {
+        if ( !line.empty() ) paths.push_back( line );
+    }
+}
+
+
+/**
+ * @brief   Parses the command line of a batch job
+ *
+ * @param   argc    The number of arguments
+ * @param   **argv  The arguments, starting with --batch
+ *
+ * @return  The options of the batch job
+ */
+static BatchOptions parseBatchOptions( int argc, char **argv )
+{
+    BatchOptions options;
+
+    unsigned int turntableViews = 0;
+    float turntableElevation = 0;
+
+    for ( int i = 2; i < argc; i++ )
+    {
+        string arg = argv[i];
+
+        // every option takes a value
+        if ( ( arg.compare( 0, 2, "--" ) == 0 ) && ( i + 1 >= argc ) )
+        {
+            throw BatchRendererException( "Missing value for " + arg );
+        }
+
+        if ( arg == "--list" )
+        {
+            readModelList( argv[++i], options.modelPaths );
+        }
+        else if ( arg == "--out" )
+        {
+            options.outputDirectory = argv[++i];
+        }
+        else if ( arg == "--size" )
+        {
+            if ( sscanf( argv[++i], "%ux%u", &options.width, &options.height ) != 2 )
+            {
+                throw BatchRendererException( string( "Bad image size: " ) + argv[i] );
+            }
+        }
+        else if ( arg == "--angle" )
+        {
+            float azimuth;
+            float elevation;
+
+            if ( sscanf( argv[++i], "%f,%f", &azimuth, &elevation ) != 2 )
+            {
+                throw BatchRendererException( string( "Bad camera angle: " ) + argv[i] );
+            }
+
+            BatchView view;
+            view.azimuth = azimuth * M_PI / 180;
+            view.elevation = elevation * M_PI / 180;
+            options.views.push_back( view );
+        }
+        else if ( arg == "--turntable" )
+        {
+            if ( sscanf( argv[++i], "%u", &turntableViews ) != 1 )
+            {
+                throw BatchRendererException( string( "Bad view count: " ) + argv[i] );
+            }
+        }
+        else if ( arg == "--elevation" )
+        {
+            if ( sscanf( argv[++i], "%f", &turntableElevation ) != 1 )
+            {
+                throw BatchRendererException( string( "Bad elevation: " ) + argv[i] );
+            }
+        }
+        else if ( arg == "--format" )
+        {
+            string format = argv[++i];
+
+            if ( format == "png" ) options.imageExtension = ImageWriter::PNG_EXTENSION;
+            else if ( format == "ppm" ) options.imageExtension = ImageWriter::PPM_EXTENSION;
+            else throw BatchRendererException( "Unsupported image format: " + format );
+        }
+        else if ( arg.compare( 0, 2, "--" ) == 0 )
+        {
+            throw BatchRendererException( "Unknown option: " + arg );
+        }
+        else
+        {
+            options.modelPaths.push_back( arg );
+        }
+    }
+
+    for ( unsigned int view = 0; view < turntableViews; view++ )
+    {
+        BatchView turntableView;
+        turntableView.azimuth = 2 * M_PI * view / turntableViews;
+        turntableView.elevation = turntableElevation * M_PI / 180;
+        options.views.push_back( turntableView );
+    }
+
+    if ( options.modelPaths.empty() ) throw BatchRendererException( "No models to render." );
+
+    return options;
+}
+
+
+/**
+ * @brief   Runs a batch job without a window
+ *
+ * @param   argc    The number of arguments
+ * @param   **argv  The arguments, starting with --batch
+ *
+ * @return  The exit status, nonzero if anything failed
+ */
+static int runBatch( int argc, char **argv )
+{
+    try
+    {
+        BatchRenderer renderer( parseBatchOptions( argc, argv ) );
+
+        unsigned int failures = renderer.run();
+
+        if ( failures > 0 ) cerr << failures << " FAILED" << endl;
+
+        return ( failures > 0 ) ? 1 : 0;
+    }
+    catch ( const BatchRendererException &e )
+    {
+        cerr << e.what() << endl << endl;
+        printBatchUsage();
+        return 2;
+    }
+}
+
+
+/**
+ * @brief   Reads a TCP port number
+ *
+ * @param   *text   The text to read
+ * @param   &port   Set to the port
+ *
+ * @return  True if the text is a port number, false otherwise
+ */
+static bool parsePort( const char *text, unsigned short &port )
+{
+    unsigned int value = 0;
+    char extra = 0;
+
+    if ( ( sscanf( text, "%u%c", &value, &extra ) != 1 ) || ( value == 0 ) || ( value > 65535 ) ) return false;
+
+    port = ( unsigned short ) value;
+    return true;
+}
+
+
+/**
+ * @brief   Runs an interactive session without a window, streamed to a
+ *          remote viewer
+ *
+ * @param   argc    The number of arguments
+ * @param   **argv  The arguments, starting with --serve
+ *
+ * @return  The exit status, nonzero if the server could not start
+ */
+static int runServer( int argc, char **argv )
+{
+    unsigned short port = 0;
+
+    if ( ( argc != 3 ) || !parsePort( argv[2], port ) )
+    {
+        cerr << "usage: render --serve PORT" << endl;
+        return 2;
+    }
+
+    try
+    {
+        RemoteContext gc( port, 800, 800, GraphicsContext::WHITE );
+        ViewContext vc( &gc );
+        DrawContext dc( &vc );
+
+        printControls();
+
+        // the viewer only sends input, files are still opened from here
+        cout << "SERVING ON PORT " << port << ", FILE PROMPTS APPEAR IN THIS TERMINAL" << endl;
+
+        gc.runLoop( &dc );
+    }
+    catch ( const RemoteLinkException &e )
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief   Shows a session streamed from a render server in a window
+ *
+ * @param   argc    The number of arguments
+ * @param   **argv  The arguments, starting with --connect
+ *
+ * @return  The exit status, nonzero if the server could not be reached
+ */
+static int runViewer( int argc, char **argv )
+{
+    string address = ( argc == 3 ) ? argv[2] : "";
+    size_t colon = address.rfind( ':' );
+    unsigned short port = 0;
+
+    if ( ( colon == string::npos ) || ( colon == 0 ) || !parsePort( address.c_str() + colon + 1, port ) )
+    {
+        cerr << "usage: render --connect HOST:PORT" << endl;
+        return 2;
+    }
+
+    try
+    {
+        RemoteViewer viewer( address.substr( 0, colon ), port );
+        X11Context gc( 800, 800, GraphicsContext::WHITE );
+
+        cout << "CONNECTED TO " << address << endl;
+
+        gc.runLoop( &viewer );
+    }
+    catch ( const RemoteLinkException &e )
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int main( int argc, char **argv )
+{
+    /* ------------------------ Run Headless Batches ------------------------ */
+
+
+    if ( ( argc > 1 ) && ( strcmp( argv[1], "--batch" ) == 0 ) )
+    {
+        return runBatch( argc, argv );
+    }
+
+
+    /* ----------------------- Serve or View Remotely ----------------------- */
+
+
+    if ( ( argc > 1 ) && ( strcmp( argv[1], "--serve" ) == 0 ) )
+    {
+        return runServer( argc, argv );
+    }
+
+    if ( ( argc > 1 ) && ( strcmp( argv[1], "--connect" ) == 0 ) )
+    {
+        return runViewer( argc, argv );
+    }
+
+
+    /* ---------------- Create Graphics and Drawing Context ----------------- */
+
+
+    GraphicsContext *gc = new X11Context( 800, 800, X11Context::WHITE );
+    ViewContext *vc = new ViewContext( gc );
+    DrawContext *dc = new DrawContext( vc );
+
+    /* ---------------------------- Print Header ---------------------------- */
+
+    printControls();
 
     /* --------------------------- Enter Run Loop --------------------------- */
 
@@ -0,0 +1,33 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mat4f.cpp
+ * @brief   Fixed-size 4x4 float matrix for host and device code
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "mat4f.h"
+
+
+/* ----------------------- Global Overloaded Operators ---------------------- */
+
+
+/**
+ * @brief   Writes a matrix to an output stream
+ *
+ * @param   &os     The output stream to write to
+ * @param   &m      The matrix to write
+ *
+ * @return  The output stream
+ */
+std::ostream &operator<<( std::ostream &os, const Mat4f &m )
+{
+    return m.out( os );
+}
+
+
+/* -------------------------------------------------------------------------- */
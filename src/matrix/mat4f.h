@@ -0,0 +1,221 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mat4f.h
+ * @brief   Fixed-size 4x4 float matrix for host and device code
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef MATRIX_MAT4F_H
+# define MATRIX_MAT4F_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <iostream>
+
+# if defined( __SSE__ ) && !defined( __CUDA_ARCH__ )
+# include <xmmintrin.h>
+# endif
+
+# include "vec4f.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A row-major 4x4 float matrix on the stack, so composing transforms never
+ * allocates. The same type is used by the host-side view math and by
+ * device code; on the host the products use SSE when it is available and
+ * sum in the same order as the scalar path, so both give the same result.
+ * Like Vec4f it is an aggregate, so it can be copied straight into
+ * __constant__ memory.
+ */
+struct alignas( 16 ) Mat4f
+{
+    /* =============================== PUBLIC =============================== */
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int DIM = 4;
+
+    Vec4f rows[DIM];
+
+
+    /* ------------------------------ Factories ----------------------------- */
+
+
+    __host__ __device__ static constexpr Mat4f identity()
+    {
+        return Mat4f { {
+            Vec4f { { 1, 0, 0, 0 } },
+            Vec4f { { 0, 1, 0, 0 } },
+            Vec4f { { 0, 0, 1, 0 } },
+            Vec4f { { 0, 0, 0, 1 } }
+        } };
+    }
+
+
+    __host__ __device__ static constexpr Mat4f translation( float x, float y, float z )
+    {
+        return Mat4f { {
+            Vec4f { { 1, 0, 0, x } },
+            Vec4f { { 0, 1, 0, y } },
+            Vec4f { { 0, 0, 1, z } },
+            Vec4f { { 0, 0, 0, 1 } }
+        } };
+    }
+
+
+    __host__ __device__ static constexpr Mat4f scaling( float x, float y, float z )
+    {
+        return Mat4f { {
+            Vec4f { { x, 0, 0, 0 } },
+            Vec4f { { 0, y, 0, 0 } },
+            Vec4f { { 0, 0, z, 0 } },
+            Vec4f { { 0, 0, 0, 1 } }
+        } };
+    }
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    __host__ __device__ Vec4f &operator[]( unsigned int row )
+    {
+        return rows[row];
+    }
+
+
+    __host__ __device__ constexpr const Vec4f &operator[]( unsigned int row ) const
+    {
+        return rows[row];
+    }
+
+
+    __host__ __device__ Vec4f operator*( const Vec4f &b ) const
+    {
+# if defined( __SSE__ ) && !defined( __CUDA_ARCH__ )
+        __m128 vector = _mm_load_ps( b.v );
+
+        __m128 p0 = _mm_mul_ps( _mm_load_ps( rows[0].v ), vector );
+        __m128 p1 = _mm_mul_ps( _mm_load_ps( rows[1].v ), vector );
+        __m128 p2 = _mm_mul_ps( _mm_load_ps( rows[2].v ), vector );
+        __m128 p3 = _mm_mul_ps( _mm_load_ps( rows[3].v ), vector );
+
+        // after the transpose, lane i of each register belongs to row i
+        _MM_TRANSPOSE4_PS( p0, p1, p2, p3 );
+
+        Vec4f product;
+        _mm_store_ps( product.v, _mm_add_ps( _mm_add_ps( p0, p1 ), _mm_add_ps( p2, p3 ) ) );
+
+        return product;
+# else
+        return Vec4f { { rows[0].dot( b ), rows[1].dot( b ), rows[2].dot( b ), rows[3].dot( b ) } };
+# endif
+    }
+
+
+    __host__ __device__ Mat4f operator*( const Mat4f &b ) const
+    {
+        Mat4f product;
+
+        // each row of the product is a weighted sum of the rows of b
+        for ( unsigned int row = 0; row < DIM; row++ )
+        {
+# if defined( __SSE__ ) && !defined( __CUDA_ARCH__ )
+            __m128 sum = _mm_mul_ps( _mm_set1_ps( rows[row][0] ), _mm_load_ps( b.rows[0].v ) );
+
+            for ( unsigned int i = 1; i < DIM; i++ )
+            {
+                sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( rows[row][i] ), _mm_load_ps( b.rows[i].v ) ) );
+            }
+
+            _mm_store_ps( product.rows[row].v, sum );
+# else
+            for ( unsigned int col = 0; col < DIM; col++ )
+            {
+                float sum = rows[row][0] * b.rows[0][col];
+
+                for ( unsigned int i = 1; i < DIM; i++ )
+                {
+                    sum += rows[row][i] * b.rows[i][col];
+                }
+
+                product.rows[row][col] = sum;
+            }
+# endif
+        }
+
+        return product;
+    }
+
+
+    __host__ __device__ constexpr bool operator==( const Mat4f &b ) const
+    {
+        return ( rows[0] == b.rows[0] ) && ( rows[1] == b.rows[1] ) &&
+               ( rows[2] == b.rows[2] ) && ( rows[3] == b.rows[3] );
+    }
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    __host__ __device__ constexpr Mat4f transposed() const
+    {
+        return Mat4f { {
+            Vec4f { { rows[0][0], rows[1][0], rows[2][0], rows[3][0] } },
+            Vec4f { { rows[0][1], rows[1][1], rows[2][1], rows[3][1] } },
+            Vec4f { { rows[0][2], rows[1][2], rows[2][2], rows[3][2] } },
+            Vec4f { { rows[0][3], rows[1][3], rows[2][3], rows[3][3] } }
+        } };
+    }
+
+
+    __host__ __device__ void toArray( float m[DIM][DIM] ) const
+    {
+        for ( unsigned int row = 0; row < DIM; row++ )
+        {
+            for ( unsigned int col = 0; col < DIM; col++ )
+            {
+                m[row][col] = rows[row][col];
+            }
+        }
+    }
+
+
+    std::ostream &out( std::ostream &os ) const
+    {
+        for ( unsigned int row = 0; row < DIM; row++ )
+        {
+            rows[row].out( os ) << std::endl;
+        }
+
+        return os;
+    }
+
+
+    /* ====================================================================== */
+};
+
+
+/* ----------------------- Global Overloaded Operators ---------------------- */
+
+
+std::ostream &operator<<( std::ostream &os, const Mat4f &m );
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // MATRIX_MAT4F_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -46,13 +46,16 @@ public:
 
 
     Matrix( unsigned int rows, unsigned int cols ):
-    rows( rows ), cols( cols ), inner( std::vector<T>( rows * cols ) )
+    rows( rows ), cols( cols ),
+    heap( std::vector<T>( ( rows * cols > INLINE_SIZE ) ? rows * cols : 0 ) )
     {}
 
 
     Matrix( const Matrix<T> &m ):
-    rows( m.rows ), cols( m.cols ), inner( m.inner )
-    {}
+    rows( m.rows ), cols( m.cols ), heap( m.heap )
+    {
+        std::copy( m.local, m.local + INLINE_SIZE, local );
+    }
 
 
     virtual ~Matrix() = default;
@@ -67,15 +70,9 @@ public:
         rows = m.rows;
         cols = m.cols;
 
-        // clear inner matrix
-        inner.clear();
-        inner.resize( rows * cols );
-
-        // push back other matrix inner elements
-        for ( unsigned int i = 0; i < m.inner.size(); i++ )
-        {
-            inner[i] = m.inner[i];
-        }
+        // copy other matrix elements, inline or not
+        heap = m.heap;
+        std::copy( m.local, m.local + INLINE_SIZE, local );
 
         return *this;
     }
@@ -90,9 +87,9 @@ public:
         }
 
         // sum corresponding elements from each matrix
-        for ( unsigned int i = 0; i < inner.size(); i++ )
+        for ( unsigned int i = 0; i < rows * cols; i++ )
         {
-            inner[i] += m.inner[i];
+            elements()[i] += m.elements()[i];
         }
 
         return *this;
@@ -108,9 +105,9 @@ public:
         }
 
         // find difference of corresponding elements from each matrix
-        for ( unsigned int i = 0; i < inner.size(); i++ )
+        for ( unsigned int i = 0; i < rows * cols; i++ )
         {
-            inner[i] -= m.inner[i];
+            elements()[i] -= m.elements()[i];
         }
 
         return *this;
@@ -120,9 +117,9 @@ public:
     Matrix<T> &operator*=( double s )
     {
         // find difference of corresponding elements from each matrix
-        for ( unsigned int i = 0; i < inner.size(); i++ )
+        for ( unsigned int i = 0; i < rows * cols; i++ )
         {
-            inner[i] *= s;
+            elements()[i] *= s;
         }
 
         return *this;
@@ -141,9 +138,9 @@ public:
         Matrix<T> sum = Matrix<T>( rows, cols );
 
         // find difference of corresponding elements from each matrix
-        for ( unsigned int i = 0; i < inner.size(); i++ )
+        for ( unsigned int i = 0; i < rows * cols; i++ )
         {
-            sum.inner[i] = inner[i] + m.inner[i];
+            sum.elements()[i] = elements()[i] + m.elements()[i];
         }
 
         return sum;
@@ -162,9 +159,9 @@ public:
         Matrix<T> difference = Matrix<T>( rows, cols );
 
         // find difference of corresponding elements from each matrix
-        for ( unsigned int i = 0; i < inner.size(); i++ )
+        for ( unsigned int i = 0; i < rows * cols; i++ )
         {
-            difference.inner[i] = inner[i] - m.inner[i];
+            difference.elements()[i] = elements()[i] - m.elements()[i];
         }
 
         return difference;
@@ -208,9 +205,9 @@ public:
         Matrix<T> product( *this );
 
         // execute the scalar-product matrix
-        for ( unsigned int i = 0; i < product.inner.size(); i++ )
+        for ( unsigned int i = 0; i < product.rows * product.cols; i++ )
         {
-            product.inner[i] *= s;
+            product.elements()[i] *= s;
         }
 
         return product;
@@ -243,7 +240,7 @@ public:
             throw MatrixException( "Matrix row index out of bounds." );
         }
 
-        return &inner[row * cols];
+        return &elements()[row * cols];
     }
 
 
@@ -255,7 +252,7 @@ public:
             throw MatrixException( "Matrix row index out of bounds." );
         }
 
-        return &inner[row * cols];
+        return &elements()[row * cols];
     }
 
 
@@ -266,9 +263,9 @@ public:
             return false;
         }
 
-        for ( unsigned int i = 0; i < inner.size(); i++ )
+        for ( unsigned int i = 0; i < rows * cols; i++ )
         {
-            if ( inner[i] != m.inner[i] )
+            if ( elements()[i] != m.elements()[i] )
             {
                 return false;
             }
@@ -322,9 +319,29 @@ protected:
     /* ----------------------------- Attributes ----------------------------- */
 
 
+    // matrices of up to INLINE_SIZE elements, vectors and points, are
+    // stored inline so building one does not allocate
+    static constexpr unsigned int INLINE_SIZE = 4;
+
     unsigned int rows;
     unsigned int cols;
-    std::vector<T> inner;
+    T local[INLINE_SIZE] = {};
+    std::vector<T> heap;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    T *elements()
+    {
+        return heap.empty() ? local : heap.data();
+    }
+
+
+    const T *elements() const
+    {
+        return heap.empty() ? local : heap.data();
+    }
 
 
     /* =============================== PRIVATE ============================== */
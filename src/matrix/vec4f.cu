@@ -0,0 +1,33 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    vec4f.cpp
+ * @brief   Fixed-size 4D float vector for host and device code
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "vec4f.h"
+
+
+/* ----------------------- Global Overloaded Operators ---------------------- */
+
+
+/**
+ * @brief   Writes a vector to an output stream
+ *
+ * @param   &os     The output stream to write to
+ * @param   &v      The vector to write
+ *
+ * @return  The output stream
+ */
+std::ostream &operator<<( std::ostream &os, const Vec4f &v )
+{
+    return v.out( os );
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,143 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    vec4f.h
+ * @brief   Fixed-size 4D float vector for host and device code
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef MATRIX_VEC4F_H
+# define MATRIX_VEC4F_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <iostream>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A 4D float vector on the stack, aligned for a single SSE load and for
+ * float4 access on the device. It is an aggregate with no default
+ * initializers, so it can live in __constant__ memory and be
+ * brace-initialized in constant expressions.
+ */
+struct alignas( 16 ) Vec4f
+{
+    /* =============================== PUBLIC =============================== */
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int DIM = 4;
+
+    float v[DIM];
+
+
+    /* ------------------------------ Factories ----------------------------- */
+
+
+    __host__ __device__ static constexpr Vec4f zero()
+    {
+        return Vec4f { { 0, 0, 0, 0 } };
+    }
+
+
+    __host__ __device__ static constexpr Vec4f point( float x, float y, float z )
+    {
+        return Vec4f { { x, y, z, 1 } };
+    }
+
+
+    __host__ __device__ static constexpr Vec4f direction( float x, float y, float z )
+    {
+        return Vec4f { { x, y, z, 0 } };
+    }
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    __host__ __device__ float &operator[]( unsigned int i )
+    {
+        return v[i];
+    }
+
+
+    __host__ __device__ constexpr const float &operator[]( unsigned int i ) const
+    {
+        return v[i];
+    }
+
+
+    __host__ __device__ constexpr Vec4f operator+( const Vec4f &b ) const
+    {
+        return Vec4f { { v[0] + b.v[0], v[1] + b.v[1], v[2] + b.v[2], v[3] + b.v[3] } };
+    }
+
+
+    __host__ __device__ constexpr Vec4f operator-( const Vec4f &b ) const
+    {
+        return Vec4f { { v[0] - b.v[0], v[1] - b.v[1], v[2] - b.v[2], v[3] - b.v[3] } };
+    }
+
+
+    __host__ __device__ constexpr Vec4f operator*( float s ) const
+    {
+        return Vec4f { { v[0] * s, v[1] * s, v[2] * s, v[3] * s } };
+    }
+
+
+    __host__ __device__ constexpr bool operator==( const Vec4f &b ) const
+    {
+        return ( v[0] == b.v[0] ) && ( v[1] == b.v[1] ) && ( v[2] == b.v[2] ) && ( v[3] == b.v[3] );
+    }
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    __host__ __device__ constexpr float getX() const { return v[0]; }
+    __host__ __device__ constexpr float getY() const { return v[1]; }
+    __host__ __device__ constexpr float getZ() const { return v[2]; }
+    __host__ __device__ constexpr float getW() const { return v[3]; }
+
+
+    __host__ __device__ constexpr float dot( const Vec4f &b ) const
+    {
+        // pairwise, the same order the SSE matrix-vector product sums in
+        return ( v[0] * b.v[0] + v[1] * b.v[1] ) + ( v[2] * b.v[2] + v[3] * b.v[3] );
+    }
+
+
+    std::ostream &out( std::ostream &os ) const
+    {
+        os << "[ " << v[0] << ", " << v[1] << ", " << v[2] << ", " << v[3] << " ]";
+        return os;
+    }
+
+
+    /* ====================================================================== */
+};
+
+
+/* ----------------------- Global Overloaded Operators ---------------------- */
+
+
+std::ostream &operator<<( std::ostream &os, const Vec4f &v );
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // MATRIX_VEC4F_H
+
+
+/* -------------------------------------------------------------------------- */
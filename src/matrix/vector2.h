@@ -180,7 +180,7 @@ public:
 
     const T &operator[]( unsigned int index ) const
     {
-        if ( index > 2 )
+        if ( index > 1 )
         {
             throw MatrixException( "Vector2 index out of bounds." );
         }
@@ -191,7 +191,7 @@ public:
 
     T &operator[]( unsigned int index )
     {
-        if ( index > 2 )
+        if ( index > 1 )
         {
             throw MatrixException( "Vector2 index out of bounds." );
         }
@@ -0,0 +1,184 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    blockingqueue.h
+ * @brief   Bounded queue handing work from one thread to another
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef UTIL_BLOCKINGQUEUE_H
+# define UTIL_BLOCKINGQUEUE_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <condition_variable>
+# include <deque>
+# include <mutex>
+# include <utility>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A bounded first-in first-out queue. Pushing waits while the queue is
+ * full and popping waits while it is empty, so a producer never runs more
+ * than the capacity ahead of its consumer. Closing the queue wakes both
+ * sides: pushes are refused from then on and pops drain what is left.
+ */
+template<typename T>
+class BlockingQueue
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit BlockingQueue( unsigned int capacity );
+    BlockingQueue( const BlockingQueue &queue ) = delete;
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    BlockingQueue &operator=( const BlockingQueue &queue ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool push( T item );
+    bool pop( T &item );
+
+    void close();
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    unsigned int capacity = 1;
+
+    std::deque<T> items = std::deque<T>();
+    bool closed = false;
+
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+
+    /* ====================================================================== */
+};
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty queue
+ *
+ * @param   capacity    The number of items the queue holds before pushing
+ *                      waits, at least one
+ *
+ * @return  The created queue
+ */
+template<typename T>
+BlockingQueue<T>::BlockingQueue( unsigned int capacity ) :
+    capacity( capacity > 0 ? capacity : 1 )
+{
+
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Adds an item to the back of the queue, waiting for room
+ *
+ * @param   item    The item to add, moved into the queue
+ *
+ * @return  True if the item was added, false if the queue was closed
+ */
+template<typename T>
+bool BlockingQueue<T>::push( T item )
+{
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        notFull.wait( lock, [this]() { return closed || ( items.size() < capacity ); } );
+
+        if ( closed ) return false;
+
+        items.push_back( std::move( item ) );
+    }
+
+    notEmpty.notify_one();
+    return true;
+}
+
+
+/**
+ * @brief   Takes the item at the front of the queue, waiting for one
+ *
+ * @param   &item   Set to the item taken
+ *
+ * @return  True if an item was taken, false if the queue is closed and
+ *          empty
+ */
+template<typename T>
+bool BlockingQueue<T>::pop( T &item )
+{
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        notEmpty.wait( lock, [this]() { return closed || !items.empty(); } );
+
+        if ( items.empty() ) return false;
+
+        item = std::move( items.front() );
+        items.pop_front();
+    }
+
+    notFull.notify_one();
+    return true;
+}
+
+
+/**
+ * @brief   Closes the queue, refusing further pushes and letting pops end
+ *          once the queue is drained
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+template<typename T>
+void BlockingQueue<T>::close()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        closed = true;
+    }
+
+    notFull.notify_all();
+    notEmpty.notify_all();
+}
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // UTIL_BLOCKINGQUEUE_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,177 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mailbox.h
+ * @brief   Lock-free single-slot mailbox between one writer and one reader
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef UTIL_MAILBOX_H
+# define UTIL_MAILBOX_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <atomic>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/**
+ * A mailbox holds at most one letter: publishing replaces whatever the
+ * reader has not fetched yet, so the reader only ever sees the newest one.
+ * It is a triple buffer. The writer and the reader each own a slot, and the
+ * third one, the latest, is swapped with a single atomic exchange on either
+ * side, so neither ever waits for the other or copies under a lock. Slots
+ * are reused, so one that owns memory keeps it between letters.
+ */
+template<typename T>
+class Mailbox
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    Mailbox();
+    Mailbox( const Mailbox &mailbox ) = delete;
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    Mailbox &operator=( const Mailbox &mailbox ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    T &getWriteSlot();
+    void publish();
+
+    bool fetch();
+    const T &getReadSlot() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr unsigned int SLOT_COUNT = 3;
+    static constexpr unsigned int FRESH = 4;
+    static constexpr unsigned int SLOT_MASK = 3;
+
+    T slots[SLOT_COUNT];
+
+    unsigned int writeSlot = 0;
+    unsigned int readSlot = 2;
+
+    // the slot between the two, FRESH while the reader has not fetched it
+    std::atomic<unsigned int> latest;
+
+
+    /* ====================================================================== */
+};
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty mailbox
+ *
+ * @param   void
+ *
+ * @return  The created mailbox
+ */
+template<typename T>
+Mailbox<T>::Mailbox() : latest( 1 )
+{
+
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the slot the writer fills in before publishing it, only
+ *          ever to be called by the writer
+ *
+ * @param   void
+ *
+ * @return  A mutable reference to the writer's slot
+ */
+template<typename T>
+T &Mailbox<T>::getWriteSlot()
+{
+    return slots[writeSlot];
+}
+
+
+/**
+ * @brief   Publishes the writer's slot as the newest letter, dropping the
+ *          previous one if it has not been fetched
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+template<typename T>
+void Mailbox<T>::publish()
+{
+    writeSlot = latest.exchange( writeSlot | FRESH, std::memory_order_acq_rel ) & SLOT_MASK;
+}
+
+
+/**
+ * @brief   Takes the newest letter into the reader's slot, only ever to be
+ *          called by the reader
+ *
+ * @param   void
+ *
+ * @return  True if a letter was published since the last fetch, false if
+ *          the reader's slot still holds the one it had
+ */
+template<typename T>
+bool Mailbox<T>::fetch()
+{
+    if ( !( latest.load( std::memory_order_acquire ) & FRESH ) ) return false;
+
+    readSlot = latest.exchange( readSlot, std::memory_order_acq_rel ) & SLOT_MASK;
+    return true;
+}
+
+
+/**
+ * @brief   Gets the letter last fetched by the reader
+ *
+ * @param   void
+ *
+ * @return  An immutable reference to the reader's slot
+ */
+template<typename T>
+const T &Mailbox<T>::getReadSlot() const
+{
+    return slots[readSlot];
+}
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // UTIL_MAILBOX_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,194 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    threadpool.cpp
+ * @brief   Fixed-size pool of worker threads for data-parallel host work
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "threadpool.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a thread pool
+ *
+ * The calling thread always takes part in parallelFor, so the pool starts
+ * one fewer worker than the requested thread count.
+ *
+ * @param   threadCount     The number of threads to run tasks on, or 0 to
+ *                          use one per hardware thread
+ *
+ * @return  The created thread pool
+ */
+ThreadPool::ThreadPool( unsigned int threadCount ) : nextTask( 0 )
+{
+    if ( threadCount == 0 ) threadCount = std::thread::hardware_concurrency();
+    if ( threadCount == 0 ) threadCount = 1;
+
+    for ( unsigned int i = 1; i < threadCount; i++ )
+    {
+        workers.emplace_back( &ThreadPool::workerLoop, this );
+    }
+}
+
+
+/**
+ * @brief   Thread pool destructor, joins every worker
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        stopping = true;
+    }
+
+    jobReady.notify_all();
+
+    for ( std::thread &worker : workers ) worker.join();
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Runs a task once for every index in [0, taskCount) across the pool
+ *          and waits for all of them to finish
+ *
+ * Indices are handed out one at a time, so uneven tasks balance themselves.
+ * If a task throws, the remaining indices are skipped and the first
+ * exception is rethrown on the calling thread.
+ *
+ * @param   taskCount   The number of task indices to run
+ * @param   &task       The task to run for each index
+ *
+ * @return  void
+ */
+void ThreadPool::parallelFor( unsigned int taskCount, const std::function<void( unsigned int )> &task )
+{
+    if ( taskCount == 0 ) return;
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+
+        job = &task;
+        jobTaskCount = taskCount;
+        jobError = nullptr;
+        nextTask = 0;
+        activeWorkers = workers.size();
+        jobGeneration++;
+    }
+
+    jobReady.notify_all();
+
+    // the calling thread works too
+    runTasks();
+
+    std::exception_ptr error;
+
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        jobDone.wait( lock, [this] { return activeWorkers == 0; } );
+
+        job = nullptr;
+        error = jobError;
+    }
+
+    if ( error ) std::rethrow_exception( error );
+}
+
+
+/**
+ * @brief   Gets the number of threads that run tasks, including the caller
+ *
+ * @param   void
+ *
+ * @return  The number of threads
+ */
+unsigned int ThreadPool::getThreadCount() const
+{
+    return workers.size() + 1;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Waits for jobs and runs their tasks until the pool is destroyed
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ThreadPool::workerLoop()
+{
+    unsigned long long seenGeneration = 0;
+
+    for ( ;; )
+    {
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            jobReady.wait( lock, [&] { return stopping || ( jobGeneration != seenGeneration ); } );
+
+            if ( stopping ) return;
+
+            seenGeneration = jobGeneration;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            activeWorkers--;
+        }
+
+        jobDone.notify_one();
+    }
+}
+
+
+/**
+ * @brief   Claims and runs task indices of the current job until none remain
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ThreadPool::runTasks()
+{
+    for ( ;; )
+    {
+        unsigned int taskIdx = nextTask++;
+
+        if ( taskIdx >= jobTaskCount ) return;
+
+        try
+        {
+            ( *job )( taskIdx );
+        }
+        catch ( ... )
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+
+            if ( !jobError ) jobError = std::current_exception();
+
+            // skip whatever is left of the job
+            nextTask = jobTaskCount;
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
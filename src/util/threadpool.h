@@ -0,0 +1,101 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    threadpool.h
+ * @brief   Fixed-size pool of worker threads for data-parallel host work
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef UTIL_THREADPOOL_H
+# define UTIL_THREADPOOL_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <atomic>
+# include <condition_variable>
+# include <exception>
+# include <functional>
+# include <mutex>
+# include <thread>
+# include <vector>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class ThreadPool
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit ThreadPool( unsigned int threadCount = 0 );
+    ThreadPool( const ThreadPool &pool ) = delete;
+
+    ~ThreadPool();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    ThreadPool &operator=( const ThreadPool &pool ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void parallelFor( unsigned int taskCount, const std::function<void( unsigned int )> &task );
+
+    unsigned int getThreadCount() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::vector<std::thread> workers = std::vector<std::thread>();
+
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+
+    const std::function<void( unsigned int )> * job = nullptr;
+    unsigned int jobTaskCount = 0;
+    unsigned long long jobGeneration = 0;
+    unsigned int activeWorkers = 0;
+    bool stopping = false;
+
+    std::atomic<unsigned int> nextTask;
+    std::exception_ptr jobError = nullptr;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void workerLoop();
+    void runTasks();
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // UTIL_THREADPOOL_H
+
+
+/* -------------------------------------------------------------------------- */